@@ -0,0 +1,290 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "osdep/io.h"
+
+#include "common/global.h"
+#include "common/msg.h"
+#include "common/stats.h"
+#include "misc/charset_conv.h"
+#include "misc/language.h"
+#include "misc/thread_pool.h"
+#include "options/path.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
+
+#include "dir_cache.h"
+
+// Number of directories to keep listings for.
+#define MAX_DIRS 64
+
+// Maximum number of directories read in parallel.
+#define MAX_THREADS 8
+
+struct dir {
+    char *path;
+    struct mp_dir_listing *listing;
+    // State of the directory when it was read.
+    dev_t dev;
+    ino_t ino;
+    time_t mtime, ctime;
+    uint64_t last_used;
+};
+
+struct mp_dir_cache {
+    struct mp_log *log;
+    struct stats_ctx *stats;
+    struct mp_thread_pool *pool;
+
+    mp_mutex lock;
+    struct dir dirs[MAX_DIRS];
+    int num_dirs;
+    uint64_t use_counter;
+};
+
+static void cache_destroy(void *p)
+{
+    struct mp_dir_cache *cache = p;
+    talloc_free(cache->pool);
+    for (int n = 0; n < cache->num_dirs; n++) {
+        talloc_free(cache->dirs[n].path);
+        mp_dir_listing_release(cache->dirs[n].listing);
+    }
+    mp_mutex_destroy(&cache->lock);
+}
+
+void mp_dir_cache_init(struct mpv_global *global)
+{
+    struct mp_dir_cache *cache = talloc_zero(global, struct mp_dir_cache);
+    talloc_set_destructor(cache, cache_destroy);
+    mp_mutex_init(&cache->lock);
+    cache->log = mp_log_new(cache, global->log, "dir_cache");
+    cache->stats = stats_ctx_create(cache, global, "dir_cache");
+    cache->pool = mp_thread_pool_create(cache, 0, 0, MAX_THREADS);
+
+    mp_assert(!global->dir_cache);
+    global->dir_cache = cache;
+}
+
+void mp_dir_listing_release(struct mp_dir_listing *listing)
+{
+    if (listing && atomic_fetch_add(&listing->refcount, -1) == 1)
+        talloc_free(listing);
+}
+
+static struct mp_dir_listing *read_dir(struct mp_log *log, const char *path,
+                                       int flags)
+{
+    DIR *d = opendir(path);
+    if (!d)
+        return NULL;
+
+    struct mp_dir_listing *listing = talloc_zero(NULL, struct mp_dir_listing);
+    listing->flags = flags;
+    atomic_init(&listing->refcount, 1);
+
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+            continue;
+        struct mp_dir_entry e = {.name = talloc_strdup(listing, de->d_name)};
+        e.utf8_name = mp_iconv_to_utf8(log, bstr0(e.name), "UTF-8-MAC",
+                                       MP_NO_LATIN1_FALLBACK);
+        if ((char *)e.utf8_name.start != e.name)
+            talloc_steal(listing, e.utf8_name.start);
+        e.lang = mp_guess_lang_from_filename(e.utf8_name, &e.lang_start,
+                                             &e.lang_flags);
+        if (flags & MP_DIR_STAT) {
+            char *file = mp_path_join(NULL, path, e.name);
+            e.stat_ok = stat(file, &e.st) == 0;
+            e.is_dir = e.stat_ok && S_ISDIR(e.st.st_mode);
+            talloc_free(file);
+        }
+        MP_TARRAY_APPEND(listing, listing->entries, listing->num_entries, e);
+    }
+    closedir(d);
+
+    return listing;
+}
+
+static struct dir *find_dir(struct mp_dir_cache *cache, const char *path)
+{
+    for (int n = 0; n < cache->num_dirs; n++) {
+        if (strcmp(cache->dirs[n].path, path) == 0)
+            return &cache->dirs[n];
+    }
+    return NULL;
+}
+
+static bool same_state(struct dir *dir, struct stat *st)
+{
+    return dir->dev == st->st_dev && dir->ino == st->st_ino &&
+           dir->mtime == st->st_mtime && dir->ctime == st->st_ctime;
+}
+
+// Add the listing to the cache, replacing an older listing of the directory
+// or the least recently used one.
+static void add_dir(struct mp_dir_cache *cache, const char *path,
+                    struct stat *st, struct mp_dir_listing *listing)
+{
+    struct dir *dir = find_dir(cache, path);
+    if (!dir && cache->num_dirs < MAX_DIRS)
+        dir = &cache->dirs[cache->num_dirs++];
+    if (!dir) {
+        dir = &cache->dirs[0];
+        for (int n = 1; n < cache->num_dirs; n++) {
+            if (cache->dirs[n].last_used < dir->last_used)
+                dir = &cache->dirs[n];
+        }
+    }
+    if (!dir->path || strcmp(dir->path, path) != 0) {
+        talloc_free(dir->path);
+        dir->path = talloc_strdup(cache, path);
+    }
+    mp_dir_listing_release(dir->listing);
+    atomic_fetch_add(&listing->refcount, 1);
+    dir->listing = listing;
+    dir->dev = st->st_dev;
+    dir->ino = st->st_ino;
+    dir->mtime = st->st_mtime;
+    dir->ctime = st->st_ctime;
+    dir->last_used = ++cache->use_counter;
+}
+
+struct mp_dir_listing *mp_dir_cache_get(struct mpv_global *global,
+                                        const char *path, int flags)
+{
+    struct mp_dir_cache *cache = global->dir_cache;
+
+    struct stat st;
+    if (stat(path, &st) || !S_ISDIR(st.st_mode))
+        return NULL;
+
+    if (!cache)
+        return read_dir(NULL, path, flags);
+
+    mp_mutex_lock(&cache->lock);
+    struct dir *dir = find_dir(cache, path);
+    if (dir && (dir->listing->flags & flags) == flags && same_state(dir, &st)) {
+        struct mp_dir_listing *listing = dir->listing;
+        atomic_fetch_add(&listing->refcount, 1);
+        dir->last_used = ++cache->use_counter;
+        mp_mutex_unlock(&cache->lock);
+        stats_event(cache->stats, "hit");
+        return listing;
+    }
+    mp_mutex_unlock(&cache->lock);
+
+    stats_event(cache->stats, "miss");
+    time_t now = time(NULL);
+    int64_t start = mp_time_ns();
+    struct mp_dir_listing *listing = read_dir(cache->log, path, flags);
+    if (!listing)
+        return NULL;
+    MP_DBG(cache, "Read %s (%d entries) in %.1f ms.\n", path,
+           listing->num_entries, MP_TIME_NS_TO_MS(mp_time_ns() - start));
+
+    // The mtime has a resolution of 1 second on some filesystems, so a
+    // directory changed in the same second as it was read could change again
+    // without a different mtime. Don't cache it in this case.
+    if (st.st_mtime < now && st.st_ctime < now) {
+        mp_mutex_lock(&cache->lock);
+        add_dir(cache, path, &st, listing);
+        mp_mutex_unlock(&cache->lock);
+    }
+
+    return listing;
+}
+
+struct prefetch_batch {
+    mp_mutex lock;
+    mp_cond wakeup;
+    int pending;
+};
+
+struct prefetch_job {
+    struct mpv_global *global;
+    const char *path;
+    int flags;
+    struct prefetch_batch *batch;
+    struct mp_dir_listing *listing;
+};
+
+static void prefetch_work(void *p)
+{
+    struct prefetch_job *job = p;
+    job->listing = mp_dir_cache_get(job->global, job->path, job->flags);
+
+    struct prefetch_batch *batch = job->batch;
+    mp_mutex_lock(&batch->lock);
+    batch->pending--;
+    mp_cond_signal(&batch->wakeup);
+    mp_mutex_unlock(&batch->lock);
+}
+
+void mp_dir_cache_prefetch(struct mpv_global *global, char **paths,
+                           int num_paths, int flags,
+                           struct mp_dir_listing **listings)
+{
+    struct mp_dir_cache *cache = global->dir_cache;
+    if (!cache || num_paths < 2) {
+        for (int n = 0; listings && n < num_paths; n++)
+            listings[n] = mp_dir_cache_get(global, paths[n], flags);
+        return;
+    }
+
+    // Listings which are only put into the cache would evict each other if
+    // there are more than it can hold, and then be read a second time. Read
+    // the others on demand instead.
+    if (!listings)
+        num_paths = MPMIN(num_paths, MAX_DIRS);
+
+    int64_t start = mp_time_ns();
+    struct prefetch_batch batch = {.pending = num_paths};
+    mp_mutex_init(&batch.lock);
+    mp_cond_init(&batch.wakeup);
+
+    struct prefetch_job *jobs = talloc_array(NULL, struct prefetch_job, num_paths);
+    for (int n = 0; n < num_paths; n++) {
+        jobs[n] = (struct prefetch_job){global, paths[n], flags, &batch, NULL};
+        if (!mp_thread_pool_queue(cache->pool, prefetch_work, &jobs[n]))
+            prefetch_work(&jobs[n]);
+    }
+
+    mp_mutex_lock(&batch.lock);
+    while (batch.pending)
+        mp_cond_wait(&batch.wakeup, &batch.lock);
+    mp_mutex_unlock(&batch.lock);
+
+    mp_cond_destroy(&batch.wakeup);
+    mp_mutex_destroy(&batch.lock);
+    for (int n = 0; n < num_paths; n++) {
+        if (listings) {
+            listings[n] = jobs[n].listing;
+        } else {
+            mp_dir_listing_release(jobs[n].listing);
+        }
+    }
+    talloc_free(jobs);
+
+    double ms = MP_TIME_NS_TO_MS(mp_time_ns() - start);
+    stats_value(cache->stats, "prefetch-ms", ms);
+    MP_VERBOSE(cache, "Read %d directories in %.1f ms.\n", num_paths, ms);
+}
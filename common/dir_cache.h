@@ -0,0 +1,78 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+#include "common/common.h"
+#include "misc/bstr.h"
+
+struct mpv_global;
+
+enum mp_dir_flags {
+    MP_DIR_STAT = 1 << 0, // stat() every entry
+};
+
+struct mp_dir_entry {
+    char *name;         // as returned by readdir()
+    bstr utf8_name;     // name converted from UTF-8-MAC (normalized form)
+    // Language guessed from utf8_name, see mp_guess_lang_from_filename().
+    bstr lang;
+    int lang_start;
+    enum track_flags lang_flags;
+    // Only set with MP_DIR_STAT. This is from when the listing was read, and
+    // the listing is only revalidated against the directory's mtime/ctime,
+    // which writing to an entry doesn't change. So st can be stale: callers
+    // must stat() the file themselves if they need its current size, times
+    // etc. The file type (is_dir) can only change by replacing the entry,
+    // which does change the directory's mtime.
+    bool stat_ok;       // st is valid
+    bool is_dir;
+    struct stat st;
+};
+
+// A directory listing, without "." and "..", in readdir() order. It's
+// immutable, and must be released with mp_dir_listing_release().
+struct mp_dir_listing {
+    struct mp_dir_entry *entries;
+    int num_entries;
+    int flags;          // enum mp_dir_flags it was created with
+    atomic_int refcount;
+};
+
+// Create the process-wide cache of directory listings. Listings are reused
+// as long as the directory's mtime/ctime do not change.
+void mp_dir_cache_init(struct mpv_global *global);
+
+// Return the listing of the given directory, or NULL if it can't be read.
+// flags is a set of enum mp_dir_flags. Thread-safe.
+struct mp_dir_listing *mp_dir_cache_get(struct mpv_global *global,
+                                        const char *path, int flags);
+
+// Read the listings of all given directories into the cache in parallel, so
+// that mp_dir_cache_get() is fast afterwards. Returns once all are done.
+// If listings is not NULL, it's set to what mp_dir_cache_get() would return
+// for each path, and the caller must release them. Use this if there can be
+// more directories than the cache holds.
+void mp_dir_cache_prefetch(struct mpv_global *global, char **paths,
+                           int num_paths, int flags,
+                           struct mp_dir_listing **listings);
+
+void mp_dir_listing_release(struct mp_dir_listing *listing);
@@ -11,6 +11,8 @@ struct mpv_global {
     char *configdir;
     struct stats_base *stats;
     struct demux_packet_pool *packet_pool;
+    struct mp_ass_cache *ass_cache;
+    struct mp_dir_cache *dir_cache;
 };
 
 #endif
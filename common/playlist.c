@@ -51,13 +51,191 @@ void playlist_entry_add_params(struct playlist_entry *e,
         playlist_entry_add_param(e, params[n].name, params[n].value);
 }
 
-static void playlist_update_indexes(struct playlist *pl, int start, int end)
+// The entries are stored in an implicit treap: a binary tree in playlist
+// order, where each node stores the size of its subtree, and which is kept
+// balanced by random heap priorities. This makes inserting, removing and
+// looking up entries by index O(log n) even with huge playlists. Entries are
+// linked to their parent, so the index of an entry can be found by walking up.
+
+static uint32_t next_prio(struct playlist *pl)
+{
+    // xorshift32
+    uint32_t x = pl->rand_state ? pl->rand_state : 0x9e3779b9;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return pl->rand_state = x;
+}
+
+static int tree_size(struct playlist_entry *e)
+{
+    return e ? e->tree_size : 0;
+}
+
+static void tree_update(struct playlist_entry *e)
+{
+    e->tree_size = tree_size(e->tree_left) + 1 + tree_size(e->tree_right);
+}
+
+static void tree_set_left(struct playlist_entry *e, struct playlist_entry *c)
+{
+    e->tree_left = c;
+    if (c)
+        c->tree_parent = e;
+}
+
+static void tree_set_right(struct playlist_entry *e, struct playlist_entry *c)
+{
+    e->tree_right = c;
+    if (c)
+        c->tree_parent = e;
+}
+
+static void tree_set_root(struct playlist *pl, struct playlist_entry *root)
+{
+    pl->tree_root = root;
+    if (root)
+        root->tree_parent = NULL;
+}
+
+static void tree_init_node(struct playlist *pl, struct playlist_entry *e)
+{
+    e->tree_left = e->tree_right = e->tree_parent = NULL;
+    e->tree_size = 1;
+    e->tree_prio = next_prio(pl);
+}
+
+// Concatenate two trees. The parent pointer of the result is not set.
+static struct playlist_entry *tree_merge(struct playlist_entry *a,
+                                         struct playlist_entry *b)
+{
+    if (!a || !b)
+        return a ? a : b;
+    if (a->tree_prio > b->tree_prio) {
+        tree_set_right(a, tree_merge(a->tree_right, b));
+        tree_update(a);
+        return a;
+    } else {
+        tree_set_left(b, tree_merge(a, b->tree_left));
+        tree_update(b);
+        return b;
+    }
+}
+
+// Split the tree into the first n entries and the rest. The parent pointers
+// of the results are not set.
+static void tree_split(struct playlist_entry *e, int n,
+                       struct playlist_entry **l, struct playlist_entry **r)
+{
+    if (!e) {
+        *l = *r = NULL;
+        return;
+    }
+    struct playlist_entry *a, *b;
+    int left = tree_size(e->tree_left);
+    if (n <= left) {
+        tree_split(e->tree_left, n, &a, &b);
+        tree_set_left(e, b);
+        tree_update(e);
+        *l = a;
+        *r = e;
+    } else {
+        tree_split(e->tree_right, n - left - 1, &a, &b);
+        tree_set_right(e, a);
+        tree_update(e);
+        *l = e;
+        *r = b;
+    }
+}
+
+// Insert the subtree so that its first entry has the given index.
+static void tree_insert(struct playlist *pl, int index,
+                        struct playlist_entry *tree)
+{
+    struct playlist_entry *l, *r;
+    tree_split(pl->tree_root, index, &l, &r);
+    tree_set_root(pl, tree_merge(tree_merge(l, tree), r));
+}
+
+static void tree_unlink(struct playlist *pl, struct playlist_entry *e)
+{
+    struct playlist_entry *c = tree_merge(e->tree_left, e->tree_right);
+    struct playlist_entry *p = e->tree_parent;
+    if (!p) {
+        tree_set_root(pl, c);
+    } else if (p->tree_left == e) {
+        tree_set_left(p, c);
+    } else {
+        tree_set_right(p, c);
+    }
+    for (; p; p = p->tree_parent)
+        tree_update(p);
+    e->tree_left = e->tree_right = e->tree_parent = NULL;
+}
+
+// Build a tree from the entries in the given order in O(n), using a stack of
+// the right spine of the tree built so far.
+static struct playlist_entry *tree_build(struct playlist *pl,
+                                         struct playlist_entry **entries,
+                                         int num_entries)
+{
+    struct playlist_entry **spine = NULL;
+    int num_spine = 0;
+    for (int n = 0; n < num_entries; n++) {
+        struct playlist_entry *e = entries[n];
+        tree_init_node(pl, e);
+        struct playlist_entry *last = NULL;
+        while (num_spine && spine[num_spine - 1]->tree_prio < e->tree_prio) {
+            last = spine[--num_spine];
+            tree_update(last);
+        }
+        tree_set_left(e, last);
+        if (num_spine)
+            tree_set_right(spine[num_spine - 1], e);
+        MP_TARRAY_APPEND(NULL, spine, num_spine, e);
+    }
+    struct playlist_entry *root = num_spine ? spine[0] : NULL;
+    while (num_spine)
+        tree_update(spine[--num_spine]);
+    talloc_free(spine);
+    if (root)
+        root->tree_parent = NULL;
+    return root;
+}
+
+// Return all entries in playlist order (allocated under ta_parent).
+static struct playlist_entry **tree_get_entries(void *ta_parent,
+                                                struct playlist *pl)
 {
-    start = MPMAX(start, 0);
-    end = end < 0 ? pl->num_entries : MPMIN(end, pl->num_entries);
+    struct playlist_entry **entries =
+        talloc_array(ta_parent, struct playlist_entry *, pl->num_entries);
+    int n = 0;
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
+        entries[n++] = e;
+    mp_assert(n == pl->num_entries);
+    return entries;
+}
+
+static void tree_set_entries(struct playlist *pl,
+                             struct playlist_entry **entries, int num_entries)
+{
+    tree_set_root(pl, tree_build(pl, entries, num_entries));
+    pl->num_entries = num_entries;
+}
+
+static struct playlist_entry *tree_first(struct playlist_entry *e)
+{
+    while (e && e->tree_left)
+        e = e->tree_left;
+    return e;
+}
 
-    for (int n = start; n < end; n++)
-        pl->entries[n]->pl_index = n;
+static struct playlist_entry *tree_last(struct playlist_entry *e)
+{
+    while (e && e->tree_right)
+        e = e->tree_right;
+    return e;
 }
 
 // Inserts the entry so that it takes "at"'s place, shifting "at" and all
@@ -68,15 +246,14 @@ void playlist_insert_at(struct playlist *pl, struct playlist_entry *add,
     mp_assert(add->filename);
     mp_assert(!at || at->pl == pl);
 
-    int index = at ? at->pl_index : pl->num_entries;
-    MP_TARRAY_INSERT_AT(pl, pl->entries, pl->num_entries, index, add);
+    int index = at ? playlist_entry_to_index(pl, at) : pl->num_entries;
+    tree_init_node(pl, add);
+    tree_insert(pl, index, add);
+    pl->num_entries++;
 
     add->pl = pl;
-    add->pl_index = index;
     add->id = ++pl->id_alloc;
 
-    playlist_update_indexes(pl, index, pl->num_entries);
-
     talloc_steal(pl, add);
 }
 
@@ -89,6 +266,17 @@ void playlist_entry_unref(struct playlist_entry *e)
     }
 }
 
+// Detach the entry after it was taken out of the tree.
+static void playlist_entry_release(struct playlist_entry *entry)
+{
+    entry->pl = NULL;
+    entry->tree_left = entry->tree_right = entry->tree_parent = NULL;
+    ta_set_parent(entry, NULL);
+
+    entry->removed = true;
+    playlist_entry_unref(entry);
+}
+
 void playlist_remove(struct playlist *pl, struct playlist_entry *entry)
 {
     mp_assert(pl && entry->pl == pl);
@@ -98,22 +286,30 @@ void playlist_remove(struct playlist *pl, struct playlist_entry *entry)
         pl->current_was_replaced = true;
     }
 
-    MP_TARRAY_REMOVE_AT(pl->entries, pl->num_entries, entry->pl_index);
-    playlist_update_indexes(pl, entry->pl_index, -1);
+    tree_unlink(pl, entry);
+    pl->num_entries--;
 
-    entry->pl = NULL;
-    entry->pl_index = -1;
-    ta_set_parent(entry, NULL);
+    playlist_entry_release(entry);
+}
 
-    entry->removed = true;
-    playlist_entry_unref(entry);
+// Remove all entries except keep (which can be NULL) at once.
+static void playlist_remove_all_except(struct playlist *pl,
+                                       struct playlist_entry *keep)
+{
+    struct playlist_entry **entries = tree_get_entries(NULL, pl);
+    int num_entries = pl->num_entries;
+    tree_set_entries(pl, &keep, keep ? 1 : 0);
+    for (int n = 0; n < num_entries; n++) {
+        if (entries[n] != keep)
+            playlist_entry_release(entries[n]);
+    }
+    talloc_free(entries);
 }
 
 void playlist_clear(struct playlist *pl)
 {
-    for (int n = pl->num_entries - 1; n >= 0; n--)
-        playlist_remove(pl, pl->entries[n]);
-    mp_assert(!pl->current);
+    playlist_remove_all_except(pl, NULL);
+    pl->current = NULL;
     pl->current_was_replaced = false;
     pl->playlist_completed = false;
     pl->playlist_started = false;
@@ -122,10 +318,7 @@ void playlist_clear(struct playlist *pl)
 
 void playlist_clear_except_current(struct playlist *pl)
 {
-    for (int n = pl->num_entries - 1; n >= 0; n--) {
-        if (pl->entries[n] != pl->current)
-            playlist_remove(pl, pl->entries[n]);
-    }
+    playlist_remove_all_except(pl, pl->current);
     pl->playlist_completed = false;
     pl->playlist_started = false;
 }
@@ -140,16 +333,10 @@ void playlist_move(struct playlist *pl, struct playlist_entry *entry,
     mp_assert(entry && entry->pl == pl);
     mp_assert(!at || at->pl == pl);
 
-    int index = at ? at->pl_index : pl->num_entries;
-    MP_TARRAY_INSERT_AT(pl, pl->entries, pl->num_entries, index, entry);
-
-    int old_index = entry->pl_index;
-    if (old_index >= index)
-        old_index += 1;
-    MP_TARRAY_REMOVE_AT(pl->entries, pl->num_entries, old_index);
-
-    playlist_update_indexes(pl, MPMIN(index - 1, old_index - 1),
-                                MPMAX(index + 1, old_index + 1));
+    tree_unlink(pl, entry);
+    tree_update(entry);
+    int index = at ? playlist_entry_to_index(pl, at) : pl->num_entries - 1;
+    tree_insert(pl, index, entry);
 }
 
 void playlist_append_file(struct playlist *pl, const char *filename)
@@ -160,62 +347,79 @@ void playlist_append_file(struct playlist *pl, const char *filename)
 void playlist_populate_playlist_path(struct playlist *pl, const char *path)
 {
     char *playlist_path = talloc_strdup(pl, path);
-    for (int n = 0; n < pl->num_entries; n++) {
-        struct playlist_entry *e = pl->entries[n];
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
         e->playlist_path = playlist_path;
-    }
 }
 
 void playlist_shuffle(struct playlist *pl)
 {
-    for (int n = 0; n < pl->num_entries; n++)
-        pl->entries[n]->original_index = n;
+    struct playlist_entry **entries = tree_get_entries(NULL, pl);
+    int num_entries = pl->num_entries;
+    for (int n = 0; n < num_entries; n++)
+        entries[n]->original_index = n;
     mp_rand_state s = mp_rand_seed(0);
-    for (int n = 0; n < pl->num_entries - 1; n++) {
-        size_t j = mp_rand_in_range32(&s, n, pl->num_entries);
-        MPSWAP(struct playlist_entry *, pl->entries[n], pl->entries[j]);
+    for (int n = 0; n < num_entries - 1; n++) {
+        size_t j = mp_rand_in_range32(&s, n, num_entries);
+        MPSWAP(struct playlist_entry *, entries[n], entries[j]);
     }
-    playlist_update_indexes(pl, 0, -1);
+    tree_set_entries(pl, entries, num_entries);
+    talloc_free(entries);
 }
 
 #define CMP_INT(a, b) ((a) == (b) ? 0 : ((a) > (b) ? 1 : -1))
 
+struct unshuffle_item {
+    struct playlist_entry *e;
+    int index;
+};
+
 static int cmp_unshuffle(const void *a, const void *b)
 {
-    struct playlist_entry *ea = *(struct playlist_entry **)a;
-    struct playlist_entry *eb = *(struct playlist_entry **)b;
+    const struct unshuffle_item *ia = a;
+    const struct unshuffle_item *ib = b;
 
-    if (ea->original_index >= 0 && ea->original_index != eb->original_index)
-        return CMP_INT(ea->original_index, eb->original_index);
-    return CMP_INT(ea->pl_index, eb->pl_index);
+    if (ia->e->original_index >= 0 &&
+        ia->e->original_index != ib->e->original_index)
+        return CMP_INT(ia->e->original_index, ib->e->original_index);
+    return CMP_INT(ia->index, ib->index);
 }
 
 void playlist_unshuffle(struct playlist *pl)
 {
-    if (pl->num_entries)
-        qsort(pl->entries, pl->num_entries, sizeof(pl->entries[0]), cmp_unshuffle);
-    playlist_update_indexes(pl, 0, -1);
+    struct playlist_entry **entries = tree_get_entries(NULL, pl);
+    int num_entries = pl->num_entries;
+    struct unshuffle_item *items =
+        talloc_array(entries, struct unshuffle_item, num_entries);
+    for (int n = 0; n < num_entries; n++)
+        items[n] = (struct unshuffle_item){entries[n], n};
+    if (num_entries)
+        qsort(items, num_entries, sizeof(items[0]), cmp_unshuffle);
+    for (int n = 0; n < num_entries; n++)
+        entries[n] = items[n].e;
+    tree_set_entries(pl, entries, num_entries);
+    talloc_free(entries);
 }
 
 // (Explicitly ignores current_was_replaced.)
 struct playlist_entry *playlist_get_first(struct playlist *pl)
 {
-    return pl->num_entries ? pl->entries[0] : NULL;
+    return tree_first(pl->tree_root);
 }
 
 // (Explicitly ignores current_was_replaced.)
 struct playlist_entry *playlist_get_last(struct playlist *pl)
 {
-    return pl->num_entries ? pl->entries[pl->num_entries - 1] : NULL;
+    return tree_last(pl->tree_root);
 }
 
 struct playlist_entry *playlist_get_next(struct playlist *pl, int direction)
 {
     mp_assert(direction == -1 || direction == +1);
     if (!pl->current && pl->playlist_completed && direction < 0) {
-        return playlist_entry_from_index(pl, pl->num_entries - 1);
+        return playlist_get_last(pl);
     } else if (!pl->current && !pl->playlist_started && direction > 0) {
-        return playlist_entry_from_index(pl, 0);
+        return playlist_get_first(pl);
     } else if (!pl->current) {
         return NULL;
     }
@@ -227,13 +431,25 @@ struct playlist_entry *playlist_get_next(struct playlist *pl, int direction)
 }
 
 // (Explicitly ignores current_was_replaced.)
+// Iterating over the whole playlist with this is O(n).
 struct playlist_entry *playlist_entry_get_rel(struct playlist_entry *e,
                                               int direction)
 {
     mp_assert(direction == -1 || direction == +1);
     if (!e->pl)
         return NULL;
-    return playlist_entry_from_index(e->pl, e->pl_index + direction);
+    if (direction > 0) {
+        if (e->tree_right)
+            return tree_first(e->tree_right);
+        while (e->tree_parent && e->tree_parent->tree_right == e)
+            e = e->tree_parent;
+    } else {
+        if (e->tree_left)
+            return tree_last(e->tree_left);
+        while (e->tree_parent && e->tree_parent->tree_left == e)
+            e = e->tree_parent;
+    }
+    return e->tree_parent;
 }
 
 struct playlist_entry *playlist_get_first_in_next_playlist(struct playlist *pl,
@@ -308,8 +524,9 @@ void playlist_add_base_path(struct playlist *pl, bstr base_path)
 {
     if (base_path.len == 0 || bstrcmp0(base_path, ".") == 0)
         return;
-    for (int n = 0; n < pl->num_entries; n++) {
-        struct playlist_entry *e = pl->entries[n];
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
+    {
         if (!mp_is_url(bstr0(e->filename))) {
             char *new_file = mp_path_join_bstr(e, base_path, bstr0(e->filename));
             talloc_free(e->filename);
@@ -320,30 +537,34 @@ void playlist_add_base_path(struct playlist *pl, bstr base_path)
 
 void playlist_set_stream_flags(struct playlist *pl, int flags)
 {
-    for (int n = 0; n < pl->num_entries; n++)
-        pl->entries[n]->stream_flags = flags;
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
+        e->stream_flags = flags;
 }
 
 int64_t playlist_transfer_entries_to(struct playlist *pl, int dst_index,
                                      struct playlist *source_pl)
 {
     mp_assert(pl != source_pl);
+    mp_assert(dst_index >= 0 && dst_index <= pl->num_entries);
     struct playlist_entry *first = playlist_get_first(source_pl);
 
     int count = source_pl->num_entries;
-    MP_TARRAY_INSERT_N_AT(pl, pl->entries, pl->num_entries, dst_index, count);
-
+    struct playlist_entry **entries = tree_get_entries(NULL, source_pl);
     for (int n = 0; n < count; n++) {
-        struct playlist_entry *e = source_pl->entries[n];
+        struct playlist_entry *e = entries[n];
         e->pl = pl;
-        e->pl_index = dst_index + n;
         e->id = ++pl->id_alloc;
-        pl->entries[e->pl_index] = e;
         talloc_steal(pl, e);
         talloc_steal(pl, e->playlist_path);
     }
 
-    playlist_update_indexes(pl, dst_index + count, -1);
+    // Rebuilding the transferred entries as one subtree makes this O(m + log n).
+    tree_insert(pl, dst_index, tree_build(pl, entries, count));
+    pl->num_entries += count;
+    talloc_free(entries);
+
+    source_pl->tree_root = NULL;
     source_pl->num_entries = 0;
 
     pl->playlist_completed = source_pl->playlist_completed;
@@ -362,7 +583,7 @@ int64_t playlist_transfer_entries(struct playlist *pl, struct playlist *source_p
 
     int add_at = pl->num_entries;
     if (pl->current) {
-        add_at = pl->current->pl_index + 1;
+        add_at = playlist_entry_to_index(pl, pl->current) + 1;
         if (pl->current_was_replaced)
             add_at += 1;
     }
@@ -383,7 +604,12 @@ int playlist_entry_to_index(struct playlist *pl, struct playlist_entry *e)
 {
     if (!e || e->pl != pl)
         return -1;
-    return e->pl_index;
+    int index = tree_size(e->tree_left);
+    for (; e->tree_parent; e = e->tree_parent) {
+        if (e->tree_parent->tree_right == e)
+            index += tree_size(e->tree_parent->tree_left) + 1;
+    }
+    return index;
 }
 
 int playlist_entry_count(struct playlist *pl)
@@ -395,7 +621,20 @@ int playlist_entry_count(struct playlist *pl)
 // Return NULL if not found.
 struct playlist_entry *playlist_entry_from_index(struct playlist *pl, int index)
 {
-    return index >= 0 && index < pl->num_entries ? pl->entries[index] : NULL;
+    if (index < 0 || index >= pl->num_entries)
+        return NULL;
+    struct playlist_entry *e = pl->tree_root;
+    while (1) {
+        int left = tree_size(e->tree_left);
+        if (index == left)
+            return e;
+        if (index < left) {
+            e = e->tree_left;
+        } else {
+            index -= left + 1;
+            e = e->tree_right;
+        }
+    }
 }
 
 struct playlist *playlist_parse_file(const char *file, struct mp_cancel *cancel,
@@ -445,17 +684,19 @@ void playlist_set_current(struct playlist *pl)
     if (!pl->playlist_dir)
         return;
 
-    for (int i = 0; i < pl->num_entries; ++i) {
-        if (!pl->entries[i]->playlist_path)
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
+    {
+        if (!e->playlist_path)
             continue;
-        char *path = pl->entries[i]->playlist_path;
+        char *path = e->playlist_path;
         if (path[0] != '.')
-            path = mp_path_join(NULL, pl->playlist_dir, mp_basename(pl->entries[i]->playlist_path));
-        bool same = !strcmp(pl->entries[i]->filename, path);
-        if (path != pl->entries[i]->playlist_path)
+            path = mp_path_join(NULL, pl->playlist_dir, mp_basename(e->playlist_path));
+        bool same = !strcmp(e->filename, path);
+        if (path != e->playlist_path)
             talloc_free(path);
         if (same) {
-            pl->current = pl->entries[i];
+            pl->current = e;
             break;
         }
     }
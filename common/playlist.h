@@ -19,6 +19,7 @@
 #define MPLAYER_PLAYLIST_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "misc/bstr.h"
 
 struct playlist_param {
@@ -26,9 +27,14 @@ struct playlist_param {
 };
 
 struct playlist_entry {
-    // Invariant: (pl && pl->entries[pl_index] == this) || (!pl && pl_index < 0)
+    // Invariant: pl is set iff the entry is part of pl's tree.
     struct playlist *pl;
-    int pl_index;
+
+    // Node in the playlist's implicit treap (see playlist.c). The position in
+    // the playlist is given by the sizes of the subtrees left of the entry.
+    struct playlist_entry *tree_left, *tree_right, *tree_parent;
+    int tree_size;
+    uint32_t tree_prio;
 
     uint64_t id;
 
@@ -40,7 +46,7 @@ struct playlist_entry {
 
     char *title;
 
-    // Used for unshuffling: the pl_index before it was shuffled. -1 => unknown.
+    // Used for unshuffling: the index before it was shuffled. -1 => unknown.
     int original_index;
 
     // Set to true if this playlist entry was selected while trying to go backwards
@@ -62,8 +68,11 @@ struct playlist_entry {
 };
 
 struct playlist {
-    struct playlist_entry **entries;
+    // Root of the tree of entries, in playlist order. Use playlist_get_first()
+    // and playlist_entry_get_rel() to iterate.
+    struct playlist_entry *tree_root;
     int num_entries;
+    uint32_t rand_state;
 
     // This provides some sort of stable iterator. If this entry is removed from
     // the playlist, current is set to the next element (or NULL), and
@@ -45,6 +45,7 @@
 #include "stream/stream.h"
 #include "demux.h"
 #include "packet_pool.h"
+#include "probe_cache.h"
 #include "timeline.h"
 #include "stheader.h"
 #include "cue.h"
@@ -124,6 +125,7 @@ const struct m_sub_options demux_conf = {
         {"metadata-codepage", OPT_STRING(meta_cp)},
         {"autocreate-playlist", OPT_CHOICE(autocreate_playlist,
             {"no", 0}, {"filter", 1}, {"same", 2})},
+        {"demuxer-probe-cache", OPT_BOOL(probe_cache)},
         {0}
     },
     .size = sizeof(struct demux_opts),
@@ -198,6 +200,7 @@ struct demux_internal {
     bool hyst_active;
     size_t max_bytes;
     size_t max_bytes_bw;
+    int64_t cache_limit; // demux_set_cache_limit(), 0 if unset
     bool seekable_cache;
     bool using_network_cache_opts;
     char *record_filename;
@@ -451,6 +454,7 @@ static struct demux_packet *find_seek_target(struct demux_queue *queue,
                                              double pts, int flags);
 static void prune_old_packets(struct demux_internal *in);
 static void dumper_close(struct demux_internal *in);
+static void update_opts(struct demuxer *demuxer);
 static void demux_convert_tags_charset(struct demuxer *demuxer);
 
 static uint64_t get_forward_buffered_bytes(struct demux_stream *ds)
@@ -1233,6 +1237,22 @@ void demux_start_prefetch(struct demuxer *demuxer)
     mp_mutex_unlock(&in->lock);
 }
 
+// Limit the packet cache to max_bytes (0 removes the limit), e.g. while the
+// demuxer is only prefetching. This is applied on top of the options.
+void demux_set_cache_limit(struct demuxer *demuxer, int64_t max_bytes)
+{
+    struct demux_internal *in = demuxer->in;
+    mp_assert(demuxer == in->d_user);
+
+    mp_mutex_lock(&in->lock);
+    if (in->cache_limit != max_bytes) {
+        in->cache_limit = max_bytes;
+        update_opts(demuxer);
+        mp_cond_signal(&in->wakeup);
+    }
+    mp_mutex_unlock(&in->lock);
+}
+
 const char *stream_type_name(enum stream_type type)
 {
     switch (type) {
@@ -2477,6 +2497,11 @@ static void update_opts(struct demuxer *demuxer)
     if (!in->seekable_cache)
         in->max_bytes_bw = 0;
 
+    if (in->cache_limit) {
+        in->max_bytes = MPMIN(in->max_bytes, in->cache_limit);
+        in->max_bytes_bw = MPMIN(in->max_bytes_bw, in->cache_limit);
+    }
+
     if (!in->can_cache) {
         in->seekable_cache = false;
         in->min_secs = 0;
@@ -2983,6 +3008,7 @@ static void demux_copy(struct demuxer *dst, struct demuxer *src)
     dst->num_attachments = src->num_attachments;
     dst->matroska_data = src->matroska_data;
     dst->playlist = src->playlist;
+    dst->playlist_incomplete = src->playlist_incomplete;
     dst->seekable = src->seekable;
     dst->partially_seekable = src->partially_seekable;
     dst->filetype = src->filetype;
@@ -3255,8 +3281,22 @@ struct parent_stream_info {
     int stream_origin;
     struct mp_cancel *cancel;
     char *filename;
+    struct demux_probe_cache *probe_cache;
+    bool use_probe_hints; // let the demuxer use cached results
 };
 
+// Store what the demuxer found out about the file, and drop probe_info.
+static void update_probe_cache(struct demux_probe_cache *cache,
+                               struct demux_internal *in)
+{
+    struct demux_probe_info *info = in->d_thread->probe_info;
+    if (!info)
+        return;
+    demux_probe_cache_put(cache, info);
+    in->d_thread->probe_info = in->d_user->probe_info = NULL;
+    talloc_free(info);
+}
+
 static struct demuxer *open_given_type(struct mpv_global *global,
                                        struct mp_log *log,
                                        const struct demuxer_desc *desc,
@@ -3319,6 +3359,13 @@ static struct demuxer *open_given_type(struct mpv_global *global,
     mp_mutex_init(&in->lock);
     mp_cond_init(&in->wakeup);
 
+    // The timeline demuxer is opened without stream, and is not cached.
+    if (sinfo->probe_cache && stream) {
+        demuxer->probe_info =
+            demux_probe_info_new(demuxer, sinfo->use_probe_hints ?
+                                 sinfo->probe_cache : NULL, desc->name, check);
+    }
+
     *in->d_thread = *demuxer;
 
     in->d_thread->metadata = talloc_zero(in->d_thread, struct mp_tags);
@@ -3348,6 +3395,7 @@ static struct demuxer *open_given_type(struct mpv_global *global,
         demux_init_cuesheet(in->d_thread);
         demux_init_ccs(demuxer, opts);
         demux_convert_tags_charset(in->d_thread);
+        update_probe_cache(sinfo->probe_cache, in);
         demux_copy(in->d_user, in->d_thread);
         in->duration = in->d_thread->duration;
         demuxer_sort_chapters(demuxer);
@@ -3389,6 +3437,35 @@ static struct demuxer *open_given_type(struct mpv_global *global,
     return NULL;
 }
 
+// Try to open the file with the demuxer that succeeded the last time.
+static struct demuxer *open_cached_type(struct mpv_global *global,
+                                        struct mp_log *log,
+                                        struct stream *stream,
+                                        struct parent_stream_info *sinfo,
+                                        struct demuxer_params *params)
+{
+    struct demux_probe_info *info = demux_probe_cache_get(sinfo->probe_cache);
+    if (!info)
+        return NULL;
+    for (int n = 0; demuxer_list[n]; n++) {
+        const struct demuxer_desc *desc = demuxer_list[n];
+        if (strcmp(desc->name, info->demuxer) == 0) {
+            mp_verbose(log, "Trying cached demuxer %s for level=%s.\n",
+                       desc->name, d_level(info->check));
+            sinfo->use_probe_hints = true;
+            struct demuxer *demuxer =
+                open_given_type(global, log, desc, stream, sinfo, params,
+                                info->check);
+            // The hints might be what made it fail.
+            sinfo->use_probe_hints = false;
+            if (!demuxer)
+                mp_verbose(log, "Cached demuxer failed.\n");
+            return demuxer;
+        }
+    }
+    return NULL;
+}
+
 static const int d_normal[]  = {DEMUX_CHECK_NORMAL, DEMUX_CHECK_UNSAFE, -1};
 static const int d_request[] = {DEMUX_CHECK_REQUEST, -1};
 static const int d_force[]   = {DEMUX_CHECK_FORCE, -1};
@@ -3436,6 +3513,22 @@ static struct demuxer *demux_open(struct stream *stream,
         }
     }
 
+    if (!check_desc) {
+        struct demux_opts *opts = mp_get_config_group(NULL, global, &demux_conf);
+        if (opts->probe_cache) {
+            sinfo.probe_cache =
+                demux_probe_cache_open(NULL, global, log, stream);
+        }
+        talloc_free(opts);
+
+        demuxer = open_cached_type(global, log, stream, &sinfo, params);
+        if (demuxer) {
+            talloc_steal(demuxer, log);
+            log = NULL;
+            goto done;
+        }
+    }
+
     // Test demuxers from first to last, one pass for each check_levels[] entry
     for (int pass = 0; check_levels[pass] != -1; pass++) {
         enum demux_check level = check_levels[pass];
@@ -3455,6 +3548,7 @@ static struct demuxer *demux_open(struct stream *stream,
     }
 
 done:
+    talloc_free(sinfo.probe_cache);
     talloc_free(sinfo.filename);
     talloc_free(log);
     return demuxer;
@@ -87,6 +87,7 @@ struct demux_opts {
     char *meta_cp;
     bool force_retry_eof;
     int autocreate_playlist;
+    bool probe_cache;
 };
 
 #define SEEK_FACTOR   (1 << 1)      // argument is in range [0,1]
@@ -124,6 +125,7 @@ enum demux_event {
 
 struct demuxer;
 struct timeline;
+struct demux_probe_info;
 
 /**
  * Demuxer description structure
@@ -215,6 +217,9 @@ struct demuxer_params {
     int stream_flags;
     struct stream *external_stream; // if set, use this, don't open or close streams
     bool allow_playlist_create;
+    // If >0, playlist demuxers can stop reading the file after this number of
+    // entries, and set demuxer.playlist_incomplete.
+    int playlist_entries;
     // result
     bool demuxer_failed;
 };
@@ -262,9 +267,16 @@ typedef struct demuxer {
 
     // If the file is a playlist file
     struct playlist *playlist;
+    // playlist contains only the first entries of the file. The rest can be
+    // read with demux_playlist_read_more().
+    bool playlist_incomplete;
 
     struct mp_tags *metadata;
 
+    // Only valid during open(); NULL if the probe cache is not used. Demuxers
+    // may use the hints in it and store what they probed.
+    struct demux_probe_info *probe_info;
+
     void *priv;   // demuxer-specific internal data
     struct mpv_global *global;
     struct mp_log *log, *glog;
@@ -317,6 +329,7 @@ void demux_start_thread(struct demuxer *demuxer);
 void demux_stop_thread(struct demuxer *demuxer);
 void demux_set_wakeup_cb(struct demuxer *demuxer, void (*cb)(void *ctx), void *ctx);
 void demux_start_prefetch(struct demuxer *demuxer);
+void demux_set_cache_limit(struct demuxer *demuxer, int64_t max_bytes);
 
 bool demux_cancel_test(struct demuxer *demuxer);
 
@@ -344,6 +357,9 @@ void demux_stream_tags_changed(struct demuxer *demuxer, struct sh_stream *sh,
                                struct mp_tags *tags, double pts);
 void demux_close_stream(struct demuxer *demuxer);
 
+bool demux_playlist_read_more(struct demuxer *demuxer, struct playlist *pl,
+                              int max_entries);
+
 void demux_metadata_changed(demuxer_t *demuxer);
 void demux_update(demuxer_t *demuxer, double playback_pts);
 
@@ -50,6 +50,7 @@
 
 #include "stream/stream.h"
 #include "demux.h"
+#include "probe_cache.h"
 #include "stheader.h"
 #include "options/m_config.h"
 #include "options/m_option.h"
@@ -451,6 +452,9 @@ static int lavf_check_file(demuxer_t *demuxer, enum demux_check check)
         format = s->lavf_type;
     if (!format)
         format = avdevice_format;
+    // Skip probing if the format is known from the probe cache.
+    if (!format && demuxer->probe_info)
+        format = demuxer->probe_info->format;
     if (format) {
         if (strcmp(format, "help") == 0) {
             list_formats(demuxer);
@@ -547,6 +551,10 @@ static int lavf_check_file(demuxer_t *demuxer, enum demux_check check)
         priv->linearize_ts = 0;
 
     demuxer->filetype = priv->avif->name;
+    if (demuxer->probe_info && !demuxer->probe_info->format) {
+        demuxer->probe_info->format =
+            talloc_strdup(demuxer->probe_info, priv->avif->name);
+    }
 
     if (priv->format_hack.detect_charset)
         convert_charset(demuxer);
@@ -55,6 +55,7 @@
 #include "video/csputils.h"
 #include "video/mp_image.h"
 #include "demux.h"
+#include "probe_cache.h"
 #include "packet_pool.h"
 #include "stheader.h"
 #include "ebml.h"
@@ -2521,8 +2522,17 @@ static int demux_mkv_open(demuxer_t *demuxer, enum demux_check check)
     process_tags(demuxer);
 
     probe_first_timestamp(demuxer);
-    if (mkv_d->opts->probe_duration)
-        probe_last_timestamp(demuxer, start_pos);
+    if (mkv_d->opts->probe_duration) {
+        struct demux_probe_info *info = demuxer->probe_info;
+        if (info && info->duration >= 0) {
+            MP_VERBOSE(demuxer, "Using cached duration.\n");
+            mkv_d->duration = demuxer->duration = info->duration;
+        } else {
+            probe_last_timestamp(demuxer, start_pos);
+            if (info)
+                info->duration = demuxer->duration;
+        }
+    }
     probe_x264_garbage(demuxer);
     probe_if_image(demuxer);
 
@@ -21,6 +21,7 @@
 #include <libavutil/common.h>
 
 #include "common/common.h"
+#include "common/dir_cache.h"
 #include "options/options.h"
 #include "options/m_config.h"
 #include "common/msg.h"
@@ -36,6 +37,10 @@
 
 #define PROBE_SIZE (8 * 1024)
 
+// Size of the blocks read from the stream, and maximum line length.
+#define READ_SIZE (64 * 1024)
+#define MAX_LINE_SIZE (2 * 1024 * 1024)
+
 enum dir_mode {
     DIR_AUTO,
     DIR_LAZY,
@@ -95,7 +100,11 @@ struct pl_parser {
     struct mpv_global *global;
     struct mp_log *log;
     struct stream *s;
-    char buffer[2 * 1024 * 1024];
+    // Data read from s, which is split into lines in place. For UTF-16, this
+    // is only used as line buffer.
+    char *buf;
+    int buf_size, buf_pos, buf_len;
+    bool buf_eof;
     int utf16;
     struct playlist *pl;
     bool error;
@@ -110,9 +119,14 @@ struct pl_parser {
     char *codepage;
     struct demux_playlist_opts *opts;
     struct MPOpts *mp_opts;
+    // If >0, stop parsing after this number of entries. read_more continues
+    // parsing the file (NULL if the format doesn't support it).
+    int max_entries;
+    void (*read_more)(struct pl_parser *p);
+    char *title;            // m3u: title for the next entry
+    const char *ini_entry;  // pls/url: key of the entries
 };
 
-
 static uint16_t stream_read_word_endian(stream_t *s, bool big_endian)
 {
     unsigned int y = stream_read_char(s);
@@ -122,43 +136,30 @@ static uint16_t stream_read_word_endian(stream_t *s, bool big_endian)
     return y;
 }
 
-// Read characters until the next '\n' (including), or until the buffer in s is
-// exhausted.
+// Read UTF-16 characters until the next '\n' (including), converted to UTF-8.
 static int read_characters(stream_t *s, uint8_t *dst, int dstsize, int utf16)
 {
-    if (utf16 == 1 || utf16 == 2) {
-        uint8_t *cur = dst;
-        while (1) {
-            if ((cur - dst) + 8 >= dstsize) // PUT_UTF8 writes max. 8 bytes
-                return -1; // line too long
-            uint32_t c;
-            uint8_t tmp;
-            GET_UTF16(c, stream_read_word_endian(s, utf16 == 2), return -1;)
-            if (s->eof)
-                break; // legitimate EOF; ignore the case of partial reads
-            PUT_UTF8(c, tmp, *cur++ = tmp;)
-            if (c == '\n')
-                break;
-        }
-        return cur - dst;
-    } else {
-        uint8_t buf[1024];
-        int buf_len = stream_read_peek(s, buf, sizeof(buf));
-        uint8_t *end = memchr(buf, '\n', buf_len);
-        int len = end ? end - buf + 1 : buf_len;
-        if (len > dstsize)
+    uint8_t *cur = dst;
+    while (1) {
+        if ((cur - dst) + 8 >= dstsize) // PUT_UTF8 writes max. 8 bytes
             return -1; // line too long
-        memcpy(dst, buf, len);
-        stream_seek_skip(s, stream_tell(s) + len);
-        return len;
+        uint32_t c;
+        uint8_t tmp;
+        GET_UTF16(c, stream_read_word_endian(s, utf16 == 2), return -1;)
+        if (s->eof)
+            break; // legitimate EOF; ignore the case of partial reads
+        PUT_UTF8(c, tmp, *cur++ = tmp;)
+        if (c == '\n')
+            break;
     }
+    return cur - dst;
 }
 
 // On error, or if the line is larger than max-1, return NULL and unset s->eof.
 // On EOF, return NULL, and s->eof will be set.
 // Otherwise, return the line (including \n or \r\n at the end of the line).
 // If the return value is non-NULL, it's always the same as mem.
-// utf16: 0: UTF8 or 8 bit legacy, 1: UTF16-LE, 2: UTF16-BE
+// utf16: 1: UTF16-LE, 2: UTF16-BE
 static char *read_line(stream_t *s, char *mem, int max, int utf16)
 {
     if (max < 1)
@@ -181,9 +182,70 @@ static char *read_line(stream_t *s, char *mem, int max, int utf16)
     return mem;
 }
 
+// Start reading lines at the current position of p->s.
+static void pl_reset_buffer(struct pl_parser *p)
+{
+    int size = p->utf16 > 0 ? MAX_LINE_SIZE : READ_SIZE;
+    if (p->buf_size < size) {
+        talloc_free(p->buf);
+        p->buf = talloc_size(p, size);
+        p->buf_size = size;
+    }
+    p->buf_pos = p->buf_len = 0;
+    p->buf_eof = false;
+}
+
+// Return the next line of an 8 bit file without the line terminator, or NULL
+// on EOF or error. Reads the stream in large blocks, and returns the lines in
+// place, so no per-character work is done except for memchr().
+static char *read_buffered_line(struct pl_parser *p)
+{
+    while (1) {
+        char *start = p->buf + p->buf_pos;
+        int avail = p->buf_len - p->buf_pos;
+        char *end = memchr(start, '\n', avail);
+        if (end || (p->buf_eof && avail)) {
+            int len = end ? end - start : avail;
+            if (memchr(start, '\0', len)) {
+                MP_WARN(p, "error reading line\n");
+                p->error = true;
+                return NULL;
+            }
+            // There is always space for this (see below).
+            start[len] = '\0';
+            p->buf_pos += end ? len + 1 : len;
+            return start;
+        }
+        if (p->buf_eof)
+            return NULL;
+
+        // Move the partial line to the start, and append the next block.
+        memmove(p->buf, start, avail);
+        p->buf_pos = 0;
+        p->buf_len = avail;
+        if (p->buf_size - p->buf_len < READ_SIZE / 2) {
+            if (p->buf_size >= MAX_LINE_SIZE) {
+                MP_WARN(p, "error reading line\n");
+                p->error = true;
+                return NULL;
+            }
+            p->buf_size = MPMIN(p->buf_size * 2, MAX_LINE_SIZE);
+            p->buf = talloc_realloc_size(p, p->buf, p->buf_size);
+        }
+        // Reserve 1 byte for terminating the last line.
+        int len = stream_read_partial(p->s, p->buf + p->buf_len,
+                                      p->buf_size - p->buf_len - 1);
+        p->buf_len += len;
+        p->buf_eof = len <= 0;
+    }
+}
+
 static char *pl_get_line0(struct pl_parser *p)
 {
-    char *res = read_line(p->s, p->buffer, sizeof(p->buffer), p->utf16);
+    if (p->utf16 <= 0)
+        return read_buffered_line(p);
+
+    char *res = read_line(p->s, p->buf, p->buf_size, p->utf16);
     if (res) {
         int len = strlen(res);
         if (len > 0 && res[len - 1] == '\n')
@@ -226,9 +288,17 @@ static void pl_add(struct pl_parser *p, bstr entry)
 
 static bool pl_eof(struct pl_parser *p)
 {
+    if (p->utf16 <= 0)
+        return p->error || (p->buf_eof && p->buf_pos == p->buf_len);
     return p->error || p->s->eof;
 }
 
+// Whether max_entries were read, and the parser has to stop.
+static bool pl_full(struct pl_parser *p)
+{
+    return p->max_entries > 0 && p->pl->num_entries >= p->max_entries;
+}
+
 static bool maybe_text(bstr d)
 {
     for (int n = 0; n < d.len; n++) {
@@ -239,6 +309,35 @@ static bool maybe_text(bstr d)
     return true;
 }
 
+static void parse_m3u_line(struct pl_parser *p, bstr line)
+{
+    if (bstr_eatstart0(&line, "#EXTINF:")) {
+        bstr duration, btitle;
+        if (bstr_split_tok(line, ",", &duration, &btitle) && btitle.len) {
+            talloc_free(p->title);
+            p->title = bstrto0(p, btitle);
+        }
+    } else if (bstr_startswith0(line, "#EXT-X-")) {
+        p->format = "hls";
+    } else if (line.len > 0 && !bstr_startswith0(line, "#")) {
+        char *fn = bstrto0(NULL, line);
+        struct playlist_entry *e = playlist_entry_new(fn);
+        talloc_free(fn);
+        e->title = talloc_steal(e, p->title);
+        p->title = NULL;
+        playlist_insert_at(p->pl, e, NULL);
+    }
+}
+
+static void read_m3u(struct pl_parser *p)
+{
+    while (!pl_eof(p) && !pl_full(p)) {
+        bstr line = pl_get_line(p);
+        parse_m3u_line(p, line);
+        pl_free_line(p, line);
+    }
+}
+
 static int parse_m3u(struct pl_parser *p)
 {
     bstr line = pl_get_line(p);
@@ -267,30 +366,11 @@ ok:
         return 0;
     }
 
-    char *title = NULL;
-    while (line.len || !pl_eof(p)) {
-        bstr line_dup = line;
-        if (bstr_eatstart0(&line_dup, "#EXTINF:")) {
-            bstr duration, btitle;
-            if (bstr_split_tok(line_dup, ",", &duration, &btitle) && btitle.len) {
-                talloc_free(title);
-                title = bstrto0(NULL, btitle);
-            }
-        } else if (bstr_startswith0(line_dup, "#EXT-X-")) {
-            p->format = "hls";
-        } else if (line_dup.len > 0 && !bstr_startswith0(line_dup, "#")) {
-            char *fn = bstrto0(NULL, line_dup);
-            struct playlist_entry *e = playlist_entry_new(fn);
-            talloc_free(fn);
-            e->title = talloc_steal(e, title);
-            title = NULL;
-            playlist_insert_at(p->pl, e, NULL);
-        }
-        pl_free_line(p, line);
-        line = pl_get_line(p);
-    }
+    // A headerless file's first line can be an entry.
+    parse_m3u_line(p, line);
     pl_free_line(p, line);
-    talloc_free(title);
+    p->read_more = read_m3u;
+    read_m3u(p);
     return 0;
 }
 
@@ -331,6 +411,23 @@ static int parse_ref_init(struct pl_parser *p)
     return 0;
 }
 
+static void read_ini_entries(struct pl_parser *p)
+{
+    while (!pl_eof(p) && !pl_full(p)) {
+        bstr line = pl_get_line(p);
+        bstr key, value;
+        if (bstr_split_tok(line, "=", &key, &value) &&
+            bstr_case_startswith(key, bstr0(p->ini_entry)))
+        {
+            value = bstr_strip(value);
+            if (bstr_startswith0(value, "\"") && bstr_endswith0(value, "\""))
+                value = bstr_splice(value, 1, -1);
+            pl_add(p, value);
+        }
+        pl_free_line(p, line);
+    }
+}
+
 static int parse_ini_thing(struct pl_parser *p, const char *header,
                            const char *entry)
 {
@@ -346,19 +443,9 @@ static int parse_ini_thing(struct pl_parser *p, const char *header,
         return 0;
     }
     pl_free_line(p, line);
-    while (!pl_eof(p)) {
-        line = pl_get_line(p);
-        bstr key, value;
-        if (bstr_split_tok(line, "=", &key, &value) &&
-            bstr_case_startswith(key, bstr0(entry)))
-        {
-            value = bstr_strip(value);
-            if (bstr_startswith0(value, "\"") && bstr_endswith0(value, "\""))
-                value = bstr_splice(value, 1, -1);
-            pl_add(p, value);
-        }
-        pl_free_line(p, line);
-    }
+    p->ini_entry = entry;
+    p->read_more = read_ini_entries;
+    read_ini_entries(p);
     return 0;
 }
 
@@ -372,20 +459,26 @@ static int parse_url(struct pl_parser *p)
     return parse_ini_thing(p, "[InternetShortcut]", "URL");
 }
 
-static int parse_txt(struct pl_parser *p)
+static void read_txt(struct pl_parser *p)
 {
-    if (!p->force)
-        return -1;
-    if (p->probing)
-        return 0;
-    MP_WARN(p, "Reading plaintext playlist.\n");
-    while (!pl_eof(p)) {
+    while (!pl_eof(p) && !pl_full(p)) {
         bstr line = pl_get_line(p);
         if (line.len == 0)
             continue;
         pl_add(p, line);
         pl_free_line(p, line);
     }
+}
+
+static int parse_txt(struct pl_parser *p)
+{
+    if (!p->force)
+        return -1;
+    if (p->probing)
+        return 0;
+    MP_WARN(p, "Reading plaintext playlist.\n");
+    p->read_more = read_txt;
+    read_txt(p);
     return 0;
 }
 
@@ -448,15 +541,20 @@ static bool test_path(struct pl_parser *p, char *path, int autocreate)
     return false;
 }
 
-// Return true if this was a readable directory.
+// Return true if this was a readable directory. listing is the directory's
+// listing if it was read already, and is released by this function.
 static bool scan_dir(struct pl_parser *p, char *path,
+                     struct mp_dir_listing *listing,
                      struct stat *dir_stack, int num_dir_stack, int autocreate)
 {
-    if (strlen(path) >= 8192 || num_dir_stack == MAX_DIR_STACK)
+    if (strlen(path) >= 8192 || num_dir_stack == MAX_DIR_STACK) {
+        mp_dir_listing_release(listing);
         return false; // things like mount bind loops
+    }
 
-    DIR *dp = opendir(path);
-    if (!dp) {
+    if (!listing)
+        listing = mp_dir_cache_get(p->global, path, MP_DIR_STAT);
+    if (!listing) {
         MP_ERR(p, "Could not read directory.\n");
         return false;
     }
@@ -466,27 +564,26 @@ static bool scan_dir(struct pl_parser *p, char *path,
     int path_len = strlen(path);
     int dir_mode = p->opts->dir_mode;
 
-    struct dirent *ep;
-    while ((ep = readdir(dp))) {
-        if (ep->d_name[0] == '.')
+    for (int i = 0; i < listing->num_entries; i++) {
+        struct mp_dir_entry *de = &listing->entries[i];
+        if (de->name[0] == '.')
             continue;
 
         if (mp_cancel_test(p->s->cancel))
             break;
 
-        char *file = mp_path_join(p, path, ep->d_name);
+        char *file = mp_path_join(p, path, de->name);
 
-        struct stat st;
-        if (stat(file, &st) == 0 && S_ISDIR(st.st_mode)) {
+        if (de->is_dir) {
             if (dir_mode != DIR_IGNORE) {
                 for (int n = 0; n < num_dir_stack; n++) {
-                    if (same_st(&dir_stack[n], &st)) {
+                    if (same_st(&dir_stack[n], &de->st)) {
                         MP_VERBOSE(p, "Skip recursive entry: %s\n", file);
                         goto skip;
                     }
                 }
 
-                struct pl_dir_entry d = {file, &file[path_len], st, true};
+                struct pl_dir_entry d = {file, &file[path_len], de->st, true};
                 MP_TARRAY_APPEND(p, dir_entries, num_dir_entries, d);
             }
         } else {
@@ -496,22 +593,42 @@ static bool scan_dir(struct pl_parser *p, char *path,
 
         skip: ;
     }
-    closedir(dp);
+    mp_dir_listing_release(listing);
 
     if (dir_entries)
         qsort(dir_entries, num_dir_entries, sizeof(dir_entries[0]), cmp_dir_entry);
 
+    // Read all subdirectories in parallel before descending into them. The
+    // listings are passed on directly, as there can be more than the cache
+    // holds.
+    char **subdirs = NULL;
+    struct mp_dir_listing **sublistings = NULL;
+    int num_subdirs = 0;
+    if (dir_mode == DIR_RECURSIVE) {
+        for (int n = 0; n < num_dir_entries; n++) {
+            if (dir_entries[n].is_dir)
+                MP_TARRAY_APPEND(p, subdirs, num_subdirs, dir_entries[n].path);
+        }
+        sublistings = talloc_zero_array(p, struct mp_dir_listing *, num_subdirs);
+        mp_dir_cache_prefetch(p->global, subdirs, num_subdirs, MP_DIR_STAT,
+                              sublistings);
+    }
+
+    int subdir = 0;
     for (int n = 0; n < num_dir_entries; n++) {
         char *file = dir_entries[n].path;
         if (dir_mode == DIR_RECURSIVE && dir_entries[n].is_dir) {
             dir_stack[num_dir_stack] = dir_entries[n].st;
-            scan_dir(p, file, dir_stack, num_dir_stack + 1, autocreate);
+            scan_dir(p, file, sublistings[subdir++], dir_stack,
+                     num_dir_stack + 1, autocreate);
         }
         else {
             if (dir_entries[n].is_dir || test_path(p, file, autocreate))
                 playlist_append_file(p->pl, dir_entries[n].path);
         }
     }
+    talloc_free(subdirs);
+    talloc_free(sublistings);
 
     return true;
 }
@@ -593,7 +710,7 @@ static int parse_dir(struct pl_parser *p)
         talloc_free(opts);
     }
 
-    scan_dir(p, path, dir_stack, 0, autocreate);
+    scan_dir(p, path, NULL, dir_stack, 0, autocreate);
 
     p->add_base = false;
     ret = p->pl->num_entries > 0 ? 0 : -1;
@@ -635,6 +752,7 @@ static const struct pl_format *probe_pl(struct pl_parser *p, const struct pl_for
     const struct pl_format *fmt = fmts;
     while (fmt->name) {
         stream_seek(p->s, start);
+        pl_reset_buffer(p);
         if (check_mimetype(p->s, fmt->mime_types)) {
             MP_VERBOSE(p, "forcing format by mime-type.\n");
             p->force = true;
@@ -650,6 +768,21 @@ static const struct pl_format *probe_pl(struct pl_parser *p, const struct pl_for
 extern const demuxer_desc_t demuxer_desc_playlist;
 extern const demuxer_desc_t demuxer_desc_directory;
 
+static void pl_finish_entries(struct pl_parser *p, struct demuxer *demuxer)
+{
+    if (p->add_base) {
+        bstr proto = mp_split_proto(bstr0(demuxer->filename), NULL);
+        // Don't add base path to self-expanding protocols
+        if (bstrcasecmp0(proto, "memory") && bstrcasecmp0(proto, "lavf") &&
+            bstrcasecmp0(proto, "hex") && bstrcasecmp0(proto, "data") &&
+            bstrcasecmp0(proto, "fd"))
+        {
+            playlist_add_base_path(p->pl, mp_dirname(demuxer->filename));
+        }
+    }
+    playlist_set_stream_flags(p->pl, demuxer->stream_origin);
+}
+
 static int open_file(struct demuxer *demuxer, enum demux_check check)
 {
     if (!demuxer->access_references)
@@ -672,6 +805,7 @@ static int open_file(struct demuxer *demuxer, enum demux_check check)
     p->s = stream_memory_open(demuxer->global, probe, probe_len);
     p->s->mime_type = demuxer->stream->mime_type;
     p->utf16 = stream_skip_bom(p->s);
+    pl_reset_buffer(p);
     p->force = force;
     p->check_level = check;
     p->probing = true;
@@ -695,27 +829,49 @@ static int open_file(struct demuxer *demuxer, enum demux_check check)
     p->error = false;
     p->s = demuxer->stream;
     p->utf16 = stream_skip_bom(p->s);
+    pl_reset_buffer(p);
+    p->max_entries = demuxer->params->playlist_entries;
     bool ok = fmt->parse(p) >= 0 && !p->error;
-    if (p->add_base) {
-        bstr proto = mp_split_proto(bstr0(demuxer->filename), NULL);
-        // Don't add base path to self-expanding protocols
-        if (bstrcasecmp0(proto, "memory") && bstrcasecmp0(proto, "lavf") &&
-            bstrcasecmp0(proto, "hex") && bstrcasecmp0(proto, "data") &&
-            bstrcasecmp0(proto, "fd"))
-        {
-            playlist_add_base_path(p->pl, mp_dirname(demuxer->filename));
-        }
-    }
-    playlist_set_stream_flags(p->pl, demuxer->stream_origin);
+    pl_finish_entries(p, demuxer);
     demuxer->playlist = talloc_steal(demuxer, p->pl);
     demuxer->filetype = p->format ? p->format : fmt->name;
     demuxer->fully_read = true;
+    if (ok && p->read_more && pl_full(p) && !pl_eof(p)) {
+        // Keep the parser and the stream for demux_playlist_read_more().
+        MP_VERBOSE(demuxer, "Read the first %d entries.\n", p->max_entries);
+        demuxer->playlist_incomplete = true;
+        demuxer->priv = talloc_steal(demuxer, p);
+        p->pl = NULL;
+        return 0;
+    }
     talloc_free(p);
     if (ok)
         demux_close_stream(demuxer);
     return ok ? 0 : -1;
 }
 
+// Read up to max_entries further entries if demuxer->playlist_incomplete is
+// set, and append them to pl. Returns false if the end of the file was reached
+// (or on errors). This accesses the stream, so the demuxer must not be used
+// concurrently.
+bool demux_playlist_read_more(struct demuxer *demuxer, struct playlist *pl,
+                              int max_entries)
+{
+    if (!demuxer->playlist_incomplete)
+        return false;
+
+    struct pl_parser *p = demuxer->priv;
+    p->pl = talloc_zero(NULL, struct playlist);
+    p->max_entries = max_entries;
+    p->read_more(p);
+    bool more = pl_full(p) && !pl_eof(p) && !mp_cancel_test(p->s->cancel);
+    pl_finish_entries(p, demuxer);
+    playlist_append_entries(pl, p->pl);
+    TA_FREEP(&p->pl);
+    demuxer->playlist_incomplete = more;
+    return more;
+}
+
 const demuxer_desc_t demuxer_desc_directory = {
     .name = "directory",
     .desc = "Playlist dir",
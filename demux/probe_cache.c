@@ -0,0 +1,264 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include <libavutil/mem.h>
+#include <libavutil/sha.h>
+
+#include "osdep/io.h"
+
+#include "common/common.h"
+#include "common/msg.h"
+#include "misc/bstr.h"
+#include "misc/io_utils.h"
+#include "misc/path_utils.h"
+#include "options/path.h"
+#include "stream/stream.h"
+
+#include "probe_cache.h"
+
+#define PROBE_CACHE_HEADER "mpv probe cache v1\n"
+
+// Maximum number of cache files. When writing one makes the directory exceed
+// this, the least recently used ones are removed.
+#define PROBE_CACHE_MAX_FILES 1000
+
+struct demux_probe_cache {
+    struct mpv_global *global;
+    struct mp_log *log;
+    char *path;         // normalized path of the file
+    struct stat st;
+    char *dir;
+    char *cache_file;
+    struct demux_probe_info *cached;
+};
+
+// Each file has a single cache file, named after the hash of its path.
+static char *cache_file_name(void *ta_parent, const char *dir, const char *path)
+{
+    uint8_t hash[32];
+    struct AVSHA *sha = av_sha_alloc();
+    MP_HANDLE_OOM(sha);
+    av_sha_init(sha, 256);
+    av_sha_update(sha, path, strlen(path));
+    av_sha_final(sha, hash);
+    av_free(sha);
+
+    char hashstr[33];
+    for (int n = 0; n < 16; n++)
+        snprintf(hashstr + n * 2, sizeof(hashstr) - n * 2, "%02x", hash[n]);
+    return mp_path_join(ta_parent, dir, hashstr);
+}
+
+static bool info_equals(struct demux_probe_info *a, struct demux_probe_info *b)
+{
+    return strcmp(a->demuxer, b->demuxer) == 0 && a->check == b->check &&
+           !a->format == !b->format &&
+           (!a->format || strcmp(a->format, b->format) == 0) &&
+           a->duration == b->duration;
+}
+
+static struct demux_probe_info *read_cache_file(struct demux_probe_cache *c)
+{
+    if (stat(c->cache_file, &(struct stat){0}))
+        return NULL;
+
+    void *tmp = talloc_new(NULL);
+    bstr data = stream_read_file2(c->cache_file, tmp,
+                                  STREAM_READ_FILE_FLAGS_DEFAULT | STREAM_SILENT,
+                                  c->global, 64 * 1024);
+    struct demux_probe_info *info = NULL;
+    if (!bstr_eatstart0(&data, PROBE_CACHE_HEADER))
+        goto done;
+
+    info = talloc_zero(c, struct demux_probe_info);
+    info->duration = -1;
+    // All of path, size, mtime and inode must match the file.
+    int keys = 0;
+    while (data.len) {
+        bstr key, value;
+        bstr line = bstr_strip_linebreaks(bstr_getline(data, &data));
+        if (!bstr_split_tok(line, "=", &key, &value))
+            continue;
+        if (bstr_equals0(key, "path")) {
+            keys |= bstr_equals0(value, c->path) << 0;
+        } else if (bstr_equals0(key, "size")) {
+            keys |= (bstrtoll(value, NULL, 10) == c->st.st_size) << 1;
+        } else if (bstr_equals0(key, "mtime")) {
+            keys |= (bstrtoll(value, NULL, 10) == c->st.st_mtime) << 2;
+        } else if (bstr_equals0(key, "inode")) {
+            keys |= (bstrtoll(value, NULL, 10) == c->st.st_ino) << 3;
+        } else if (bstr_equals0(key, "demuxer")) {
+            info->demuxer = bstrto0(info, value);
+        } else if (bstr_equals0(key, "check")) {
+            info->check = bstrtoll(value, NULL, 10);
+        } else if (bstr_equals0(key, "format")) {
+            info->format = bstrto0(info, value);
+        } else if (bstr_equals0(key, "duration")) {
+            info->duration = bstrtod(value, NULL);
+        }
+    }
+
+    if (keys != 0xF || !info->demuxer) {
+        MP_DBG(c, "Ignoring stale cache file %s\n", c->cache_file);
+        TA_FREEP(&info);
+    } else {
+        // The modification time tells prune_cache_dir() when it was last used.
+        utime(c->cache_file, NULL);
+    }
+
+done:
+    talloc_free(tmp);
+    return info;
+}
+
+struct cache_file {
+    char *path;
+    time_t mtime;
+};
+
+static int compare_mtime(const void *a, const void *b)
+{
+    time_t ta = ((const struct cache_file *)a)->mtime;
+    time_t tb = ((const struct cache_file *)b)->mtime;
+    return ta < tb ? -1 : ta > tb;
+}
+
+// Remove the least recently used cache files if there are too many.
+static void prune_cache_dir(struct demux_probe_cache *c)
+{
+    DIR *d = opendir(c->dir);
+    if (!d)
+        return;
+
+    void *tmp = talloc_new(NULL);
+    struct cache_file *files = NULL;
+    int num_files = 0;
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (de->d_name[0] == '.')
+            continue;
+        char *path = mp_path_join(tmp, c->dir, de->d_name);
+        struct stat st;
+        if (stat(path, &st) || !S_ISREG(st.st_mode))
+            continue;
+        MP_TARRAY_APPEND(tmp, files, num_files,
+                         (struct cache_file){path, st.st_mtime});
+    }
+    closedir(d);
+
+    if (num_files > PROBE_CACHE_MAX_FILES) {
+        qsort(files, num_files, sizeof(files[0]), compare_mtime);
+        for (int n = 0; n < num_files - PROBE_CACHE_MAX_FILES; n++) {
+            MP_DBG(c, "Removing %s\n", files[n].path);
+            unlink(files[n].path);
+        }
+    }
+    talloc_free(tmp);
+}
+
+struct demux_probe_cache *demux_probe_cache_open(void *ta_parent,
+                                                 struct mpv_global *global,
+                                                 struct mp_log *log,
+                                                 struct stream *s)
+{
+    if (!s->is_local_fs || !s->path || s->is_directory)
+        return NULL;
+
+    struct demux_probe_cache *c = talloc_zero(ta_parent, struct demux_probe_cache);
+    c->global = global;
+    c->log = mp_log_new(c, log, "probe_cache");
+    c->path = mp_normalize_path(c, s->path);
+    // Newlines would break the line based format.
+    if (stat(c->path, &c->st) || !S_ISREG(c->st.st_mode) ||
+        strchr(c->path, '\n'))
+        goto fail;
+
+    c->dir = mp_find_user_file(c, global, "cache", "probe");
+    if (!c->dir || !c->dir[0])
+        goto fail;
+    c->cache_file = cache_file_name(c, c->dir, c->path);
+
+    c->cached = read_cache_file(c);
+    MP_DBG(c, "%s %s\n", c->cached ? "Hit" : "Miss", c->cache_file);
+    return c;
+
+fail:
+    talloc_free(c);
+    return NULL;
+}
+
+struct demux_probe_info *demux_probe_cache_get(struct demux_probe_cache *c)
+{
+    return c ? c->cached : NULL;
+}
+
+struct demux_probe_info *demux_probe_info_new(void *ta_parent,
+                                              struct demux_probe_cache *c,
+                                              const char *demuxer, int check)
+{
+    struct demux_probe_info *info = talloc_zero(ta_parent, struct demux_probe_info);
+    info->demuxer = talloc_strdup(info, demuxer);
+    info->check = check;
+    info->duration = -1;
+
+    struct demux_probe_info *cached = demux_probe_cache_get(c);
+    if (cached && strcmp(cached->demuxer, demuxer) == 0 && cached->check == check) {
+        info->format = talloc_strdup(info, cached->format);
+        info->duration = cached->duration;
+    }
+    return info;
+}
+
+void demux_probe_cache_put(struct demux_probe_cache *c,
+                           struct demux_probe_info *info)
+{
+    if (!c || (c->cached && info_equals(c->cached, info)))
+        return;
+
+    char *data = talloc_asprintf(NULL, PROBE_CACHE_HEADER
+                                 "path=%s\nsize=%lld\nmtime=%lld\ninode=%llu\n"
+                                 "demuxer=%s\ncheck=%d\n", c->path,
+                                 (long long)c->st.st_size,
+                                 (long long)c->st.st_mtime,
+                                 (unsigned long long)c->st.st_ino,
+                                 info->demuxer, info->check);
+    if (info->format)
+        ta_xasprintf_append(&data, "format=%s\n", info->format);
+    ta_xasprintf_append(&data, "duration=%.17g\n", info->duration);
+
+    mp_mkdirp(c->dir);
+    if (mp_save_to_file(c->cache_file, data, strlen(data))) {
+        MP_DBG(c, "Wrote %s\n", c->cache_file);
+        // Rewriting a valid entry doesn't add a file.
+        if (!c->cached)
+            prune_cache_dir(c);
+    } else {
+        MP_VERBOSE(c, "Could not write %s\n", c->cache_file);
+    }
+    talloc_free(data);
+}
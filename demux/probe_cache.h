@@ -0,0 +1,55 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+struct mpv_global;
+struct mp_log;
+struct stream;
+
+// What was found out about a file while opening it. Demuxers can read hints
+// from a cached copy and add their own results via demuxer->probe_info.
+struct demux_probe_info {
+    char *demuxer;      // demuxer_desc.name
+    int check;          // enum demux_check the demuxer succeeded with
+    char *format;       // libavformat input format name, or NULL
+    double duration;    // probed duration, -1 if not probed
+};
+
+struct demux_probe_cache;
+
+// Look up the file opened by s in the on-disk probe cache. Returns NULL if
+// the stream is not a regular local file, which can't be cached.
+struct demux_probe_cache *demux_probe_cache_open(void *ta_parent,
+                                                 struct mpv_global *global,
+                                                 struct mp_log *log,
+                                                 struct stream *s);
+
+// Return the cached information, or NULL if there is none for the current
+// state (path, size, mtime, inode) of the file. c can be NULL.
+struct demux_probe_info *demux_probe_cache_get(struct demux_probe_cache *c);
+
+// Return a new info for the given demuxer, with hints copied from the cached
+// info if it was created by the same demuxer at the same check level. c can
+// be NULL, in which case nothing is copied.
+struct demux_probe_info *demux_probe_info_new(void *ta_parent,
+                                              struct demux_probe_cache *c,
+                                              const char *demuxer, int check);
+
+// Write info to the cache, unless it's equal to the cached one. c can be NULL.
+void demux_probe_cache_put(struct demux_probe_cache *c,
+                           struct demux_probe_info *info);
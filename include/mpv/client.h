@@ -248,7 +248,7 @@ extern "C" {
  * relational operators (<, >, <=, >=).
  */
 #define MPV_MAKE_VERSION(major, minor) (((major) << 16) | (minor) | 0UL)
-#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(2, 5)
+#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(2, 8)
 
 /**
  * The API user is allowed to "#define MPV_ENABLE_DEPRECATED 0" before
@@ -1169,6 +1169,45 @@ MPV_EXPORT char *mpv_get_property_osd_string(mpv_handle *ctx, const char *name);
 MPV_EXPORT int mpv_get_property_async(mpv_handle *ctx, uint64_t reply_userdata,
                                       const char *name, mpv_format format);
 
+/**
+ * Read the values of several properties at once. This is like calling
+ * mpv_get_property() with MPV_FORMAT_NODE for each property, but the core is
+ * locked only once for all of them, so the values are consistent with each
+ * other, and the cost per property is lower.
+ *
+ * Properties which are unavailable, or which can't be retrieved, are set to
+ * MPV_FORMAT_NONE in the result. Use mpv_get_property() if you want
+ * fine-grained error reporting.
+ *
+ * Available since API version 2.7.
+ *
+ * @param[in] names NULL-terminated array of property names.
+ * @param[out] result Set to a MPV_FORMAT_NODE_MAP, which maps each property
+ *                    name to its value, in the order of the names array.
+ *                    A name which appears more than once has a single entry,
+ *                    at the position of its first occurrence.
+ *                    Free it with mpv_free_node_contents().
+ * @return error code (the result is not set on error)
+ */
+MPV_EXPORT int mpv_get_properties(mpv_handle *ctx, const char **names,
+                                  mpv_node *result);
+
+/**
+ * Set several properties at once. This is like calling mpv_set_property()
+ * with MPV_FORMAT_NODE for each entry of the map (in order), except that all
+ * properties are set while the core is locked, so no other client and no
+ * playback loop iteration can observe only part of the changes.
+ *
+ * Setting stops on the first error, and the error is returned. Properties set
+ * before the failing one keep their new values.
+ *
+ * Available since API version 2.7.
+ *
+ * @param[in] values A MPV_FORMAT_NODE_MAP mapping property names to values.
+ * @return error code
+ */
+MPV_EXPORT int mpv_set_properties(mpv_handle *ctx, mpv_node *values);
+
 /**
  * Get a notification whenever the given property changes. You will receive
  * updates as MPV_EVENT_PROPERTY_CHANGE. Note that this is not very precise:
@@ -1239,6 +1278,39 @@ MPV_EXPORT int mpv_observe_property(mpv_handle *mpv, uint64_t reply_userdata,
  */
 MPV_EXPORT int mpv_unobserve_property(mpv_handle *mpv, uint64_t registered_reply_userdata);
 
+/**
+ * Change how change events of observed properties are sent. This affects all
+ * properties for which the given number was passed as reply_userdata to
+ * mpv_observe_property().
+ *
+ * The options are a MPV_FORMAT_NODE_MAP with the following optional entries:
+ *
+ *  "max-rate" (MPV_FORMAT_INT64 or MPV_FORMAT_DOUBLE)
+ *      Send at most this many change events per second. Changes in between
+ *      are coalesced, and the property is not even read until the next event
+ *      can be sent. The last change is always sent eventually. 0 (the
+ *      default) means no limit.
+ *  "delta" (MPV_FORMAT_FLAG)
+ *      Only for properties observed with MPV_FORMAT_NODE. If enabled, the
+ *      value in the change event is replaced with a MPV_FORMAT_NODE_MAP, which
+ *      either has a "value" entry with the full new value, or a "patch" entry
+ *      with a list of changes relative to the value of the previous change
+ *      event for this property. The changes follow JSON patch (RFC 6902): each
+ *      is a map with an "op" ("add", "remove" or "replace"), a "path" (a JSON
+ *      pointer, e.g. "/3/title"), and for "add" and "replace", the new
+ *      "value". This is useful for large properties like "playlist", where
+ *      most changes affect only a few entries.
+ *
+ * Available since API version 2.8.
+ *
+ * @param reply_userdata ID that was passed to mpv_observe_property
+ * @param options see above
+ * @return negative value is an error code, >=0 is number of affected
+ *         properties on success
+ */
+MPV_EXPORT int mpv_observe_property_options(mpv_handle *mpv, uint64_t reply_userdata,
+                                            mpv_node *options);
+
 typedef enum mpv_event_id {
     /**
      * Nothing happened. Happens on timeouts or sporadic wakeups.
@@ -1996,10 +2068,16 @@ MPV_DEFINE_SYM_PTR(mpv_get_property_osd_string)
 #define mpv_get_property_osd_string pfn_mpv_get_property_osd_string
 MPV_DEFINE_SYM_PTR(mpv_get_property_async)
 #define mpv_get_property_async pfn_mpv_get_property_async
+MPV_DEFINE_SYM_PTR(mpv_get_properties)
+#define mpv_get_properties pfn_mpv_get_properties
+MPV_DEFINE_SYM_PTR(mpv_set_properties)
+#define mpv_set_properties pfn_mpv_set_properties
 MPV_DEFINE_SYM_PTR(mpv_observe_property)
 #define mpv_observe_property pfn_mpv_observe_property
 MPV_DEFINE_SYM_PTR(mpv_unobserve_property)
 #define mpv_unobserve_property pfn_mpv_unobserve_property
+MPV_DEFINE_SYM_PTR(mpv_observe_property_options)
+#define mpv_observe_property_options pfn_mpv_observe_property_options
 MPV_DEFINE_SYM_PTR(mpv_event_name)
 #define mpv_event_name pfn_mpv_event_name
 MPV_DEFINE_SYM_PTR(mpv_event_to_node)
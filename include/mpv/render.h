@@ -138,11 +138,13 @@ extern "C" {
  * MPV_RENDER_PARAM_SW_STRIDE, MPV_RENDER_PARAM_SW_POINTER.
  *
  * This method of rendering is very slow, because everything, including color
- * conversion, scaling, and OSD rendering, is done on the CPU, single-threaded.
+ * conversion, scaling, and OSD rendering, is done on the CPU. Only scaling is
+ * multi-threaded, and only if zimg is used.
  * In particular, large video or display sizes, as well as presence of OSD or
  * subtitles can make it too slow for realtime. As with other software rendering
  * VOs, setting "sw-fast" may help. Enabling or disabling zimg may help,
- * depending on the platform.
+ * depending on the platform. MPV_RENDER_PARAM_SW_RENDER_AHEAD can hide some
+ * of the scaling cost.
  *
  * In addition, certain multimedia job creation measures like HDR may not work
  * properly, and will have to be manually handled by for example inserting
@@ -432,6 +434,19 @@ typedef enum mpv_render_param_type {
      *   "gpu-next"
      */
     MPV_RENDER_PARAM_BACKEND = 21,
+    /**
+     * MPV_RENDER_API_TYPE_SW only: if set to 1, scale the next video frame on
+     * a background thread after mpv_render_context_render() returns, while the
+     * API user presents the current frame. If the next render call is for this
+     * frame, and the target size and format did not change, the pre-scaled
+     * frame is copied to the target surface instead of scaling it again. OSD
+     * and subtitles are still rendered synchronously.
+     * This costs memory for one additional target-sized frame, and some CPU
+     * time if the pre-scaled frame ends up not being used (e.g. on seeks).
+     * Valid for MPV_RENDER_API_TYPE_SW & mpv_render_context_create().
+     * Type: int*: 0 for disable (default), 1 for enable
+     */
+    MPV_RENDER_PARAM_SW_RENDER_AHEAD = 22,
 } mpv_render_param_type;
 
 /**
@@ -244,8 +244,48 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
 
         rc = mpv_set_property(client, cmd_node->u.list->values[1].u.string,
                               MPV_FORMAT_NODE, &cmd_node->u.list->values[2]);
+    } else if (cmd && !strcmp("get_properties", cmd)) {
+        if (cmd_node->u.list->num != 2) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        if (cmd_node->u.list->values[1].format != MPV_FORMAT_NODE_ARRAY) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        struct mpv_node_list *list = cmd_node->u.list->values[1].u.list;
+        const char **names = talloc_zero_array(ta_parent, const char *,
+                                               list->num + 1);
+        for (int n = 0; n < list->num; n++) {
+            if (list->values[n].format != MPV_FORMAT_STRING) {
+                rc = MPV_ERROR_INVALID_PARAMETER;
+                goto error;
+            }
+            names[n] = list->values[n].u.string;
+        }
+
+        mpv_node result_node;
+        rc = mpv_get_properties(client, names, &result_node);
+        if (rc >= 0) {
+            mpv_node_map_add(ta_parent, &reply_node, "data", &result_node);
+            mpv_free_node_contents(&result_node);
+        }
+    } else if (cmd && !strcmp("set_properties", cmd)) {
+        if (cmd_node->u.list->num != 2) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        if (cmd_node->u.list->values[1].format != MPV_FORMAT_NODE_MAP) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        rc = mpv_set_properties(client, &cmd_node->u.list->values[1]);
     } else if (cmd && !strcmp("observe_property", cmd)) {
-        if (cmd_node->u.list->num != 3) {
+        if (cmd_node->u.list->num != 3 && cmd_node->u.list->num != 4) {
             rc = MPV_ERROR_INVALID_PARAMETER;
             goto error;
         }
@@ -264,8 +304,13 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
                                   cmd_node->u.list->values[1].u.int64,
                                   cmd_node->u.list->values[2].u.string,
                                   MPV_FORMAT_NODE);
+        if (rc >= 0 && cmd_node->u.list->num == 4) {
+            rc = mpv_observe_property_options(client,
+                                              cmd_node->u.list->values[1].u.int64,
+                                              &cmd_node->u.list->values[3]);
+        }
     } else if (cmd && !strcmp("observe_property_string", cmd)) {
-        if (cmd_node->u.list->num != 3) {
+        if (cmd_node->u.list->num != 3 && cmd_node->u.list->num != 4) {
             rc = MPV_ERROR_INVALID_PARAMETER;
             goto error;
         }
@@ -284,6 +329,11 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
                                   cmd_node->u.list->values[1].u.int64,
                                   cmd_node->u.list->values[2].u.string,
                                   MPV_FORMAT_STRING);
+        if (rc >= 0 && cmd_node->u.list->num == 4) {
+            rc = mpv_observe_property_options(client,
+                                              cmd_node->u.list->values[1].u.int64,
+                                              &cmd_node->u.list->values[3]);
+        }
     } else if (cmd && !strcmp("unobserve_property", cmd)) {
         if (cmd_node->u.list->num != 2) {
             rc = MPV_ERROR_INVALID_PARAMETER;
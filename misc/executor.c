@@ -0,0 +1,227 @@
+/* Copyright (C) 2026 the mpv developers
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdatomic.h>
+
+#include <libavutil/cpu.h>
+
+#include "common/common.h"
+#include "osdep/threads.h"
+
+#include "executor.h"
+#include "thread_tools.h"
+
+// Upper bound for the number of worker threads.
+#define MAX_WORKERS 63
+
+// Capacity of each worker's deque. If a deque is full, the submitting thread
+// runs the task itself.
+#define DEQUE_SIZE 256
+
+struct job {
+    void (*fn)(void *fn_ctx, int index);
+    void *fn_ctx;
+    atomic_int pending;         // number of unfinished tasks
+    struct mp_waiter done;      // woken up when pending reaches 0
+};
+
+struct task {
+    struct job *job;
+    int index;
+};
+
+struct worker {
+    mp_mutex lock;
+    // Ring buffer. The owner pushes and pops at the bottom (LIFO), thieves
+    // take from the top (FIFO). Both counters only increase; the actual array
+    // index is the counter modulo DEQUE_SIZE.
+    struct task tasks[DEQUE_SIZE];
+    unsigned top, bottom;
+};
+
+static mp_once exec_init_once = MP_STATIC_ONCE_INITIALIZER;
+
+static struct worker *workers;
+static int num_workers;         // number of deques
+static int num_threads;         // number of worker threads actually running
+static atomic_uint next_worker; // round-robin target for external submitters
+static atomic_int num_queued;   // tasks in all deques (approximately)
+static mp_mutex wakeup_lock;
+static mp_cond wakeup;
+
+// Index of the worker this thread is, or -1 if it's not a worker thread.
+static thread_local int current_worker = -1;
+
+static bool deque_push(struct worker *w, struct task task)
+{
+    mp_mutex_lock(&w->lock);
+    bool ok = w->bottom - w->top < DEQUE_SIZE;
+    if (ok)
+        w->tasks[w->bottom++ % DEQUE_SIZE] = task;
+    mp_mutex_unlock(&w->lock);
+    return ok;
+}
+
+static bool deque_pop(struct worker *w, struct task *task)
+{
+    mp_mutex_lock(&w->lock);
+    bool ok = w->bottom != w->top;
+    if (ok)
+        *task = w->tasks[--w->bottom % DEQUE_SIZE];
+    mp_mutex_unlock(&w->lock);
+    return ok;
+}
+
+static bool deque_steal(struct worker *w, struct task *task)
+{
+    mp_mutex_lock(&w->lock);
+    bool ok = w->bottom != w->top;
+    if (ok)
+        *task = w->tasks[w->top++ % DEQUE_SIZE];
+    mp_mutex_unlock(&w->lock);
+    return ok;
+}
+
+static void run_task(struct task task)
+{
+    struct job *job = task.job;
+
+    job->fn(job->fn_ctx, task.index);
+
+    // job can be deallocated as soon as this wakes up the submitter.
+    if (atomic_fetch_sub(&job->pending, 1) == 1)
+        mp_waiter_wakeup(&job->done, 0);
+}
+
+// Run a single task from the own deque, or steal one from another worker.
+// self is the index of the calling worker, or -1. Returns false if no task
+// was found.
+static bool run_one(int self)
+{
+    struct task task;
+
+    if (self >= 0 && deque_pop(&workers[self], &task))
+        goto found;
+
+    unsigned start = self >= 0 ? self + 1 : atomic_load(&next_worker);
+    for (int n = 0; n < num_workers; n++) {
+        int victim = (start + n) % num_workers;
+        if (victim != self && deque_steal(&workers[victim], &task))
+            goto found;
+    }
+
+    return false;
+
+found:
+    atomic_fetch_sub(&num_queued, 1);
+    run_task(task);
+    return true;
+}
+
+static MP_THREAD_VOID worker_thread(void *arg)
+{
+    current_worker = (intptr_t)arg;
+
+    mp_thread_set_name("executor");
+
+    while (1) {
+        if (run_one(current_worker))
+            continue;
+
+        mp_mutex_lock(&wakeup_lock);
+        while (atomic_load(&num_queued) <= 0)
+            mp_cond_wait(&wakeup, &wakeup_lock);
+        mp_mutex_unlock(&wakeup_lock);
+    }
+
+    MP_THREAD_RETURN();
+}
+
+static void exec_init(void)
+{
+    mp_mutex_init(&wakeup_lock);
+    mp_cond_init(&wakeup);
+
+    // The thread calling mp_parallel_for() does work as well.
+    num_workers = MPCLAMP(av_cpu_count() - 1, 0, MAX_WORKERS);
+    if (!num_workers)
+        return;
+
+    workers = talloc_zero_array(NULL, struct worker, num_workers);
+    for (int n = 0; n < num_workers; n++)
+        mp_mutex_init(&workers[n].lock);
+
+    // If thread creation fails, the deques of the missing threads are still
+    // emptied by stealing, so it's fine to have fewer threads than deques.
+    for (int n = 0; n < num_workers; n++) {
+        mp_thread thread;
+        if (mp_thread_create(&thread, worker_thread, (void *)(intptr_t)n))
+            break;
+        mp_thread_detach(thread);
+        num_threads++;
+    }
+}
+
+int mp_executor_get_num_threads(void)
+{
+    mp_exec_once(&exec_init_once, exec_init);
+    return num_threads + 1;
+}
+
+void mp_parallel_for(int count, void (*fn)(void *fn_ctx, int index),
+                     void *fn_ctx)
+{
+    mp_exec_once(&exec_init_once, exec_init);
+
+    if (count <= 1 || !num_threads) {
+        for (int n = 0; n < count; n++)
+            fn(fn_ctx, n);
+        return;
+    }
+
+    struct job job = {
+        .fn = fn,
+        .fn_ctx = fn_ctx,
+        .done = MP_WAITER_INITIALIZER,
+    };
+    atomic_init(&job.pending, count);
+
+    // Workers push to their own deque (and other workers steal from it),
+    // other threads distribute the tasks round-robin. Index 0 is always run
+    // by the calling thread itself.
+    int self = current_worker;
+    for (int n = 1; n < count; n++) {
+        struct task task = {&job, n};
+        int target = self >= 0 ? self
+                   : atomic_fetch_add(&next_worker, 1) % num_workers;
+        atomic_fetch_add(&num_queued, 1);
+        if (!deque_push(&workers[target], task)) {
+            atomic_fetch_sub(&num_queued, 1);
+            run_task(task);
+        }
+    }
+
+    mp_mutex_lock(&wakeup_lock);
+    mp_cond_broadcast(&wakeup);
+    mp_mutex_unlock(&wakeup_lock);
+
+    run_task((struct task){&job, 0});
+
+    // Help out until nothing is left to steal, then wait for the tasks
+    // still running on other threads.
+    while (atomic_load(&job.pending) > 0 && run_one(self)) {}
+
+    mp_waiter_wait(&job.done);
+}
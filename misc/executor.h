@@ -0,0 +1,27 @@
+#ifndef MPV_MP_EXECUTOR_H
+#define MPV_MP_EXECUTOR_H
+
+// Process-wide executor for short-lived, CPU-bound data-parallel work (such as
+// converting image slices). Unlike mp_thread_pool, there is only one instance,
+// its worker threads are created on first use and persist until process exit,
+// and the number of workers is bounded by the number of CPU cores. Each worker
+// has its own task deque; idle workers steal tasks from other workers.
+//
+// Do not run blocking operations (I/O, waiting on other threads) on it. Use a
+// private mp_thread_pool for these.
+
+// Run fn(fn_ctx, i) for every i in [0, count). The calls may happen
+// concurrently on worker threads and the calling thread, in any order. Returns
+// once all calls have returned. The calling thread helps with executing tasks,
+// so this can be called from within a task (nested parallel loops are fine).
+// If count is 1, or the executor has no worker threads, everything is run on
+// the calling thread.
+void mp_parallel_for(int count, void (*fn)(void *fn_ctx, int index),
+                     void *fn_ctx);
+
+// Return the number of threads that can execute tasks in parallel, including
+// the calling thread. Useful for deciding how many slices to split work into.
+// This initializes the executor if it wasn't yet.
+int mp_executor_get_num_threads(void);
+
+#endif
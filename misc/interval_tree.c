@@ -0,0 +1,198 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+
+#include "common/common.h"
+
+#include "interval_tree.h"
+
+// Treap ordered by (start, id), where every node also stores the maximum end
+// of its subtree. Nodes are stored in an array indexed by ID, and refer to
+// each other by index (-1 for none).
+struct node {
+    int64_t start, end;
+    int64_t max_end;
+    int left, right;
+    uint32_t prio;
+    bool used;
+};
+
+struct mp_interval_tree {
+    struct node *nodes;
+    int num_nodes;
+    int root;
+    uint32_t rand_state;
+};
+
+struct mp_interval_tree *mp_interval_tree_new(void *ta_parent)
+{
+    struct mp_interval_tree *t = talloc_zero(ta_parent, struct mp_interval_tree);
+    t->root = -1;
+    t->rand_state = 0x9e3779b9;
+    return t;
+}
+
+void mp_interval_tree_clear(struct mp_interval_tree *t)
+{
+    t->num_nodes = 0;
+    t->root = -1;
+}
+
+int mp_interval_tree_num(struct mp_interval_tree *t)
+{
+    return t->num_nodes;
+}
+
+static uint32_t next_prio(struct mp_interval_tree *t)
+{
+    // xorshift32
+    uint32_t x = t->rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return t->rand_state = x;
+}
+
+static void update(struct mp_interval_tree *t, int n)
+{
+    struct node *node = &t->nodes[n];
+    node->max_end = node->end;
+    if (node->left >= 0)
+        node->max_end = MPMAX(node->max_end, t->nodes[node->left].max_end);
+    if (node->right >= 0)
+        node->max_end = MPMAX(node->max_end, t->nodes[node->right].max_end);
+}
+
+// Whether node a sorts before the key (start, id).
+static bool less(struct mp_interval_tree *t, int a, int64_t start, int id)
+{
+    struct node *node = &t->nodes[a];
+    return node->start < start || (node->start == start && a < id);
+}
+
+// Split the subtree n into nodes before the key (*l) and the rest (*r).
+static void split(struct mp_interval_tree *t, int n, int64_t start, int id,
+                  int *l, int *r)
+{
+    if (n < 0) {
+        *l = *r = -1;
+        return;
+    }
+    struct node *node = &t->nodes[n];
+    if (less(t, n, start, id)) {
+        split(t, node->right, start, id, &node->right, r);
+        *l = n;
+    } else {
+        split(t, node->left, start, id, l, &node->left);
+        *r = n;
+    }
+    update(t, n);
+}
+
+// Merge two subtrees, where all nodes in l sort before all nodes in r.
+static int merge(struct mp_interval_tree *t, int l, int r)
+{
+    if (l < 0)
+        return r;
+    if (r < 0)
+        return l;
+    if (t->nodes[l].prio > t->nodes[r].prio) {
+        t->nodes[l].right = merge(t, t->nodes[l].right, r);
+        update(t, l);
+        return l;
+    } else {
+        t->nodes[r].left = merge(t, l, t->nodes[r].left);
+        update(t, r);
+        return r;
+    }
+}
+
+static void remove_node(struct mp_interval_tree *t, int id)
+{
+    struct node *node = &t->nodes[id];
+    int l, m, r;
+    split(t, t->root, node->start, id, &l, &r);
+    split(t, r, node->start, id + 1, &m, &r);
+    mp_assert(m == id);
+    t->root = merge(t, l, r);
+}
+
+void mp_interval_tree_set(struct mp_interval_tree *t, int id,
+                          int64_t start, int64_t end)
+{
+    mp_assert(id >= 0);
+
+    if (id >= t->num_nodes) {
+        MP_TARRAY_GROW(t, t->nodes, id);
+        for (int n = t->num_nodes; n <= id; n++)
+            t->nodes[n] = (struct node){0};
+        t->num_nodes = id + 1;
+    }
+
+    struct node *node = &t->nodes[id];
+    if (node->used) {
+        if (node->start == start && node->end == end)
+            return;
+        remove_node(t, id);
+    }
+
+    *node = (struct node){
+        .start = start,
+        .end = end,
+        .max_end = end,
+        .left = -1,
+        .right = -1,
+        .prio = next_prio(t),
+        .used = true,
+    };
+
+    int l, r;
+    split(t, t->root, start, id, &l, &r);
+    t->root = merge(t, merge(t, l, id), r);
+}
+
+static void query(struct mp_interval_tree *t, int n, int64_t lo, int64_t hi,
+                  void *ta_parent, int **ids, int *num_ids)
+{
+    while (n >= 0) {
+        struct node *node = &t->nodes[n];
+        if (node->max_end <= lo)
+            return;
+        query(t, node->left, lo, hi, ta_parent, ids, num_ids);
+        if (node->start > hi)
+            return;
+        if (node->end > lo)
+            MP_TARRAY_APPEND(ta_parent, *ids, *num_ids, n);
+        n = node->right;
+    }
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    int ia = *(const int *)a, ib = *(const int *)b;
+    return ia < ib ? -1 : ia > ib;
+}
+
+void mp_interval_tree_query(struct mp_interval_tree *t, int64_t lo, int64_t hi,
+                            void *ta_parent, int **ids, int *num_ids)
+{
+    int first = *num_ids;
+    query(t, t->root, lo, hi, ta_parent, ids, num_ids);
+    if (*num_ids - first > 1)
+        qsort(*ids + first, *num_ids - first, sizeof(int), cmp_int);
+}
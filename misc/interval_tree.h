@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// Index over half-open intervals [start, end), each identified by a dense
+// integer ID (0..n-1, e.g. an array index). Finding all intervals overlapping
+// a range is O(log n + k), adding or changing an interval is O(log n)
+// (expected; it's a treap).
+struct mp_interval_tree;
+
+struct mp_interval_tree *mp_interval_tree_new(void *ta_parent);
+
+// Remove all intervals.
+void mp_interval_tree_clear(struct mp_interval_tree *t);
+
+// Return 1 + the highest ID ever set since the last clear.
+int mp_interval_tree_num(struct mp_interval_tree *t);
+
+// Add the interval with the given ID, or replace it if it already exists.
+// id must be >= 0. Using sparse IDs wastes memory, but is allowed.
+void mp_interval_tree_set(struct mp_interval_tree *t, int id,
+                          int64_t start, int64_t end);
+
+// Find all intervals with start <= hi && end > lo, i.e. overlapping the closed
+// range [lo, hi]. Pass lo == hi to find intervals containing a point.
+// The IDs are appended to *ids (a talloc array with *num_ids entries, using
+// ta_parent as talloc parent), in ascending ID order.
+void mp_interval_tree_query(struct mp_interval_tree *t, int64_t lo, int64_t hi,
+                            void *ta_parent, int **ids, int *num_ids);
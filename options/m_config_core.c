@@ -44,6 +44,9 @@ struct m_config_shadow {
     // Invariant: a parent is always at a lower index than any of its children.
     struct m_config_group *groups;
     int num_groups;
+    // Value of ts after the last change in each group. Stored before ts, so
+    // caches can skip unchanged groups without taking the lock.
+    _Atomic uint64_t *group_ts;
     // -- protected by lock
     struct m_config_data *data; // protected shadow copy of the option data
     struct config_cache **listeners;
@@ -98,17 +101,14 @@ struct config_cache {
     void *wakeup_cb_ctx;
 };
 
-struct force_update {
-    char *name;
-    uint64_t ts;
-};
-
 // Per m_config_data state for each m_config_group.
 struct m_group_data {
     char *udata;                        // pointer to group user option struct
     uint64_t ts;                        // timestamp of the data copy
-    struct force_update **force_update; // tracks opts that are written with force update
-    int force_update_len;
+    // Only for the shadow data: timestamp of the last write of each option,
+    // indexed like m_config_group.group->opts, or NULL if none was written.
+    // An option changed for a copy if its timestamp is newer than the copy.
+    uint64_t *opt_ts;
 };
 
 static void add_sub_group(struct m_config_shadow *shadow, const char *name_prefix,
@@ -446,6 +446,8 @@ struct m_config_shadow *m_config_shadow_new(const struct m_sub_options *root)
     mp_mutex_init(&shadow->lock);
 
     add_sub_group(shadow, NULL, -1, -1, root);
+    shadow->group_ts = talloc_zero_array(shadow, _Atomic uint64_t,
+                                         shadow->num_groups);
 
     if (!root->size)
         return shadow;
@@ -607,34 +609,6 @@ struct m_config_cache *m_config_cache_alloc(void *ta_parent,
     return m_config_cache_from_shadow(ta_parent, global->config, group);
 }
 
-static void append_force_update(struct m_config_cache *cache, struct m_group_data *gdata,
-                                const char *opt_name)
-{
-    for (int i = 0; i < gdata->force_update_len; ++i) {
-        if (strcmp(opt_name, gdata->force_update[i]->name) == 0) {
-            gdata->force_update[i]->ts = gdata->ts;
-            return;
-        }
-    }
-    struct force_update *new_update = talloc_zero(cache, struct force_update);
-    new_update->name = talloc_strdup(cache, opt_name);
-    new_update->ts = gdata->ts;
-    MP_TARRAY_APPEND(cache, gdata->force_update, gdata->force_update_len, new_update);
-}
-
-static bool check_force_update(struct m_group_data *gdata, const char *opt_name,
-                               uint64_t timestamp)
-{
-    for (int i = 0; i < gdata->force_update_len; ++i) {
-        if ((strcmp(opt_name, gdata->force_update[i]->name) == 0) &&
-            gdata->force_update[i]->ts == timestamp)
-        {
-            return true;
-        }
-    }
-    return false;
-}
-
 static void update_next_option(struct m_config_cache *cache, void **p_opt)
 {
     struct config_cache *in = cache->internal;
@@ -654,16 +628,15 @@ static void update_next_option(struct m_config_cache *cache, void **p_opt)
             struct m_config_group *g = &dst->shadow->groups[in->upd_group];
             const struct m_option *opts = g->group->opts;
 
-            while (opts && opts[in->upd_opt].name) {
+            // Only the options written since the last update are compared.
+            while (gsrc->opt_ts && in->upd_opt < g->opt_count) {
                 const struct m_option *opt = &opts[in->upd_opt];
                 void *dsrc = gsrc->udata + opt->offset;
                 void *ddst = gdst->udata + opt->offset;
 
-                if (opt->offset >= 0 && opt->type->size) {
+                if (gsrc->opt_ts[in->upd_opt] > gdst->ts) {
                     bool opt_equal = m_option_equal(opt, ddst, dsrc);
-                    bool force_update = opt->force_update &&
-                                        check_force_update(gsrc, opt->name, in->ts);
-                    if (!opt_equal || force_update) {
+                    if (!opt_equal || opt->force_update) {
                         uint64_t ch = get_opt_change_mask(dst->shadow,
                                         in->upd_group, dst->group_index, opt);
 
@@ -704,13 +677,20 @@ static bool cache_check_update(struct m_config_cache *cache)
     struct config_cache *in = cache->internal;
     struct m_config_shadow *shadow = in->shadow;
 
-    // Using atomics and checking outside of the lock - it's unknown whether
-    // this makes it faster or slower. Just cargo culting it.
+    // Check outside of the lock, so that changes to options this cache does
+    // not include are cheap.
     uint64_t new_ts = atomic_load(&shadow->ts);
     if (in->ts >= new_ts)
         return false;
 
+    bool changed = false;
+    for (int n = in->group_start; n < in->group_end; n++)
+        changed |= atomic_load(&shadow->group_ts[n]) > in->ts;
+
     in->ts = new_ts;
+    if (!changed)
+        return false;
+
     in->upd_group = in->data->group_index;
     in->upd_opt = 0;
     return true;
@@ -804,7 +784,14 @@ bool m_config_cache_write_opt(struct m_config_cache *cache, void *ptr)
     if (changed) {
         m_option_copy(opt, gsrc->udata + opt->offset, ptr);
 
-        gsrc->ts = atomic_fetch_add(&shadow->ts, 1) + 1;
+        // Writers are serialized by the lock.
+        uint64_t ts = atomic_load(&shadow->ts) + 1;
+        if (!gsrc->opt_ts)
+            gsrc->opt_ts = talloc_zero_array(in->src, uint64_t, g->opt_count);
+        gsrc->opt_ts[opt_idx] = ts;
+        gsrc->ts = ts;
+        atomic_store(&shadow->group_ts[group_idx], ts);
+        atomic_store(&shadow->ts, ts);
 
         for (int n = 0; n < shadow->num_listeners; n++) {
             struct config_cache *listener = shadow->listeners[n];
@@ -813,9 +800,6 @@ bool m_config_cache_write_opt(struct m_config_cache *cache, void *ptr)
         }
     }
 
-    if (opt->force_update)
-        append_force_update(cache, gsrc, opt->name);
-
     mp_mutex_unlock(&shadow->lock);
 
     return changed;
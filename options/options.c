@@ -345,6 +345,7 @@ const struct m_sub_options mp_subtitle_sub_opts = {
         {"sub-lavc-o", OPT_KEYVALUELIST(sub_avopts), .flags = UPDATE_SUB_HARD},
         {"sub-glyph-limit", OPT_INT(sub_glyph_limit)},
         {"sub-bitmap-max-size", OPT_INT(sub_bitmap_max_size)},
+        {"sub-render-ahead", OPT_INT(sub_render_ahead), M_RANGE(0, 8)},
         {0}
     },
     .size = sizeof(OPT_BASE_STRUCT),
@@ -419,6 +420,7 @@ const struct m_sub_options mp_osd_render_sub_opts = {
         {"osd-prune-delay", OPT_DOUBLE(osd_ass_prune_delay), M_RANGE(-1.0, 10000.0)},
         {"osd-glyph-limit", OPT_INT(osd_glyph_limit)},
         {"osd-bitmap-max-size", OPT_INT(osd_bitmap_max_size)},
+        {"ass-cache-budget", OPT_INT(ass_cache_budget), M_RANGE(0, INT_MAX)},
         {"osd-shaper", OPT_CHOICE(osd_shaper, {"simple", 0}, {"complex", 1})},
         {0}
     },
@@ -550,6 +552,8 @@ static const m_option_t mp_opts[] = {
     {"script-opts", OPT_KEYVALUELIST(script_opts)},
     {"script-opt", OPT_CLI_ALIAS("script-opts-append")},
     {"load-scripts", OPT_BOOL(auto_load_scripts)},
+    {"lazy-load-scripts", OPT_BOOL(lazy_load_scripts)},
+    {"script-bytecode-cache", OPT_BOOL(script_bytecode_cache)},
 #endif
 #if HAVE_JAVASCRIPT
     {"js-memory-report", OPT_BOOL(js_memory_report)},
@@ -604,6 +608,8 @@ static const m_option_t mp_opts[] = {
 
     {"playlist-start", OPT_CHOICE(playlist_pos, {"auto", -1}, {"no", -1}),
         M_RANGE(0, INT_MAX)},
+    {"playlist-initial-entries", OPT_INT(playlist_initial_entries),
+        M_RANGE(0, INT_MAX)},
 
     {"pause", OPT_BOOL(pause)},
     {"keep-open", OPT_CHOICE(keep_open,
@@ -656,6 +662,9 @@ static const m_option_t mp_opts[] = {
     {"demuxer-termination-timeout", OPT_DOUBLE(demux_termination_timeout)},
     {"demuxer-cache-wait", OPT_BOOL(demuxer_cache_wait)},
     {"prefetch-playlist", OPT_BOOL(prefetch_open)},
+    {"prefetch-playlist-entries", OPT_INT(prefetch_entries), M_RANGE(1, 16)},
+    {"prefetch-playlist-max-bytes", OPT_BYTE_SIZE(prefetch_max_bytes),
+        M_RANGE(0, M_MAX_MEM_BYTES)},
     {"cache-pause", OPT_BOOL(cache_pause)},
     {"cache-pause-initial", OPT_BOOL(cache_pause_initial)},
     {"cache-pause-wait", OPT_FLOAT(cache_pause_wait), M_RANGE(0, FLT_MAX)},
@@ -897,6 +906,7 @@ static const m_option_t mp_opts[] = {
 
     {"input-ipc-server", OPT_STRING(ipc_path), .flags = M_OPT_FILE},
     {"input-ipc-client", OPT_STRING(ipc_client)},
+    {"property-snapshot", OPT_STRINGLIST(property_snapshot)},
 
     {"screenshot", OPT_SUBSTRUCT(screenshot_image_opts, screenshot_conf)},
     {"screenshot-template", OPT_STRING(screenshot_template)},
@@ -1012,6 +1022,7 @@ static const struct MPOpts mp_default_opts = {
 #endif
 #endif
     .auto_load_scripts = true,
+    .script_bytecode_cache = true,
     .loop_times = 1,
     .ordered_chapters = true,
     .chapter_merge_threshold = 100,
@@ -1040,6 +1051,8 @@ static const struct MPOpts mp_default_opts = {
     .term_osd_bar_chars = "[-+-]",
     .consolecontrols = true,
     .playlist_pos = -1,
+    .playlist_initial_entries = 1000,
+    .prefetch_entries = 1,
     .play_frames = -1,
     .rebase_start_time = true,
     .keep_open_pause = true,
@@ -1083,6 +1096,10 @@ static const struct MPOpts mp_default_opts = {
     .playlist_exts = (char *[]){
         "cue", "edl", "m3u", "m3u8", "pls", NULL
     },
+    .property_snapshot = (char *[]){
+        "time-pos", "percent-pos", "playback-time", "time-remaining",
+        "demuxer-cache-state", "estimated-vf-fps", NULL
+    },
 
     .sub_auto_exts = (char *[]){
         "ass",
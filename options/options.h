@@ -131,6 +131,7 @@ struct mp_subtitle_opts {
     bool sub_past_video_end;
     int sub_glyph_limit;
     int sub_bitmap_max_size;
+    int sub_render_ahead;
     char **sub_avopts;
 };
 
@@ -153,6 +154,7 @@ struct mp_osd_render_opts {
     double osd_ass_prune_delay;
     int osd_glyph_limit;
     int osd_bitmap_max_size;
+    int ass_cache_budget;
     int osd_shaper;
 };
 
@@ -193,6 +195,8 @@ typedef struct MPOpts {
     bool lua_load_context_menu;
 
     bool auto_load_scripts;
+    bool lazy_load_scripts;
+    bool script_bytecode_cache;
 
     bool audio_exclusive;
     bool ao_null_fallback;
@@ -279,6 +283,7 @@ typedef struct MPOpts {
     char **input_commands;
     bool consolecontrols;
     int playlist_pos;
+    int playlist_initial_entries;
     struct m_rel_time play_start;
     struct m_rel_time play_end;
     struct m_rel_time play_length;
@@ -318,6 +323,8 @@ typedef struct MPOpts {
     double demux_termination_timeout;
     bool demuxer_cache_wait;
     bool prefetch_open;
+    int prefetch_entries;
+    int64_t prefetch_max_bytes;
     char *audio_demuxer_name;
     char *sub_demuxer_name;
 
@@ -390,6 +397,7 @@ typedef struct MPOpts {
 
     char *ipc_path;
     char *ipc_client;
+    char **property_snapshot;
 
     struct mp_resample_opts *resample_opts;
 
@@ -81,6 +81,15 @@ struct mp_client_api {
     int num_custom_protocols;
 
     struct mpv_render_context *render_context;
+
+    // -- property snapshot, see mp_client_publish_properties()
+    struct prop_snapshot *_Atomic snapshot;
+    atomic_bool snapshot_stale;
+    atomic_uint snapshot_epoch;
+    atomic_int snapshot_readers[2];     // by epoch parity
+    // -- only accessed by the core
+    struct prop_snapshot *retired;      // replaced in the current epoch
+    struct prop_snapshot *retired_prev; // replaced in the previous epoch
 };
 
 struct observe_property {
@@ -100,7 +109,12 @@ struct observe_property {
     union m_option_value value;
     uint64_t value_ret_ts;  // logical timestamp of value returned to user
     union m_option_value value_ret;
+    bool value_ret_valid;   // value_ret was the value of the last event
     bool waiting_for_hook;  // flag for draining old property changes on a hook
+    int64_t min_interval;   // minimum time between change events (0: none)
+    int64_t next_update;    // mp_time_ns() before which no event is sent
+    bool delta;             // return changes as patch (MPV_FORMAT_NODE only)
+    struct mpv_node delta_ret; // event data returned to user in delta mode
 };
 
 struct mpv_handle {
@@ -156,6 +170,7 @@ struct mpv_handle {
 
     bool fuzzy_initialized; // see scripting.c wait_loaded()
     bool is_weak;           // can not keep core alive on its own
+    struct mp_script_profile *profile; // gets the time until initialized
     struct mp_log_buffer *messages;
     int messages_level;
 };
@@ -163,6 +178,7 @@ struct mpv_handle {
 static bool gen_log_message_event(struct mpv_handle *ctx);
 static bool gen_property_change_event(struct mpv_handle *ctx);
 static void notify_property_events(struct mpv_handle *ctx, int event);
+static void snapshot_free(struct prop_snapshot *snap);
 
 // Must be called with prop->owner->lock held.
 static void prop_unref(struct observe_property *prop)
@@ -199,6 +215,10 @@ void mp_clients_destroy(struct MPContext *mpctx)
         abort();
     }
 
+    snapshot_free(atomic_load(&mpctx->clients->snapshot));
+    snapshot_free(mpctx->clients->retired);
+    snapshot_free(mpctx->clients->retired_prev);
+
     mp_mutex_destroy(&mpctx->clients->lock);
     talloc_free(mpctx->clients);
     mpctx->clients = NULL;
@@ -320,6 +340,15 @@ void mp_client_set_weak(struct mpv_handle *ctx)
     mp_mutex_unlock(&ctx->lock);
 }
 
+// The profile must outlive the client.
+void mp_client_set_profile(struct mpv_handle *ctx,
+                           struct mp_script_profile *profile)
+{
+    mp_mutex_lock(&ctx->lock);
+    ctx->profile = profile;
+    mp_mutex_unlock(&ctx->lock);
+}
+
 const char *mpv_client_name(mpv_handle *ctx)
 {
     return ctx->name;
@@ -895,8 +924,13 @@ mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout)
 
     mp_mutex_lock(&ctx->lock);
 
-    if (!ctx->fuzzy_initialized)
+    if (!ctx->fuzzy_initialized) {
         mp_wakeup_core(ctx->clients->mpctx);
+        if (ctx->profile) {
+            atomic_store(&ctx->profile->init_ns,
+                         MPMAX(mp_time_ns() - ctx->profile->start, 1));
+        }
+    }
     ctx->fuzzy_initialized = true;
 
     if (timeout < 0)
@@ -1034,6 +1068,7 @@ int mpv_set_option(mpv_handle *ctx, const char *name, mpv_format format,
     }
     lock_core(ctx);
     int err = m_config_set_option_node(ctx->mpctx->mconfig, bstr0(name), data, 0);
+    mp_client_invalidate_properties(ctx->mpctx);
     unlock_core(ctx);
     switch (err) {
     case M_OPT_MISSING_PARAM:
@@ -1293,6 +1328,7 @@ static void setproperty_fn(void *arg)
     }
 
     int err = mp_property_do(req->name, M_PROPERTY_SET_NODE, node, req->mpctx);
+    mp_client_invalidate_properties(req->mpctx);
 
     req->status = translate_property_error(err);
 
@@ -1377,6 +1413,55 @@ int mpv_set_property_async(mpv_handle *ctx, uint64_t ud, const char *name,
     return run_async(ctx, setproperty_fn, req);
 }
 
+struct setproperties_request {
+    struct MPContext *mpctx;
+    struct mpv_node_list *values;
+    int status;
+};
+
+static void setproperties_fn(void *arg)
+{
+    struct setproperties_request *req = arg;
+
+    req->status = 0;
+    for (int n = 0; n < req->values->num; n++) {
+        int err = mp_property_do(req->values->keys[n], M_PROPERTY_SET_NODE,
+                                 &req->values->values[n], req->mpctx);
+        if (err <= 0) {
+            req->status = translate_property_error(err);
+            break;
+        }
+    }
+    mp_client_invalidate_properties(req->mpctx);
+}
+
+int mpv_set_properties(mpv_handle *ctx, mpv_node *values)
+{
+    if (!values || values->format != MPV_FORMAT_NODE_MAP)
+        return MPV_ERROR_INVALID_PARAMETER;
+    struct mpv_node_list *list = values->u.list;
+
+    if (!ctx->mpctx->initialized) {
+        for (int n = 0; list && n < list->num; n++) {
+            int r = mpv_set_property(ctx, list->keys[n], MPV_FORMAT_NODE,
+                                     &list->values[n]);
+            if (r < 0)
+                return r;
+        }
+        return MPV_ERROR_SUCCESS;
+    }
+
+    if (!list)
+        return MPV_ERROR_SUCCESS;
+
+    struct setproperties_request req = {
+        .mpctx = ctx->mpctx,
+        .values = list,
+    };
+    run_locked(ctx, setproperties_fn, &req);
+    return req.status;
+}
+
 struct getproperty_request {
     struct MPContext *mpctx;
     const char *name;
@@ -1394,6 +1479,23 @@ static void free_prop_data(void *ptr)
     m_option_free(type, prop->data);
 }
 
+// Get the property as mpv_node. Properties without node support are returned
+// as string node.
+static int get_property_node(struct MPContext *mpctx, const char *name,
+                             struct mpv_node *node)
+{
+    int err = mp_property_do(name, M_PROPERTY_GET_NODE, node, mpctx);
+    if (err == M_PROPERTY_NOT_IMPLEMENTED) {
+        // Go through explicit string conversion. Same reasoning as on the
+        // GET code path.
+        char *s = NULL;
+        err = mp_property_do(name, M_PROPERTY_GET_STRING, &s, mpctx);
+        if (err == M_PROPERTY_OK)
+            *node = (struct mpv_node){.format = MPV_FORMAT_STRING, .u.string = s};
+    }
+    return err;
+}
+
 static void getproperty_fn(void *arg)
 {
     struct getproperty_request *req = arg;
@@ -1419,18 +1521,8 @@ static void getproperty_fn(void *arg)
     case MPV_FORMAT_INT64:
     case MPV_FORMAT_DOUBLE: {
         struct mpv_node node = {{0}};
-        err = mp_property_do(req->name, M_PROPERTY_GET_NODE, &node, req->mpctx);
-        if (err == M_PROPERTY_NOT_IMPLEMENTED) {
-            // Go through explicit string conversion. Same reasoning as on the
-            // GET code path.
-            char *s = NULL;
-            err = mp_property_do(req->name, M_PROPERTY_GET_STRING, &s,
-                                 req->mpctx);
-            if (err != M_PROPERTY_OK)
-                break;
-            node.format = MPV_FORMAT_STRING;
-            node.u.string = s;
-        } else if (err <= 0)
+        err = get_property_node(req->mpctx, req->name, &node);
+        if (err <= 0)
             break;
         if (req->format == MPV_FORMAT_NODE) {
             *(struct mpv_node *)data = node;
@@ -1468,6 +1560,247 @@ static void getproperty_fn(void *arg)
     }
 }
 
+/*
+ * Property snapshots
+ *
+ * At the end of each playloop iteration, the core publishes the values of the
+ * properties listed in --property-snapshot, and mpv_get_property() returns
+ * them without stopping the core. Published snapshots are immutable (except
+ * for the "used" flags). They are freed with an epoch scheme: readers
+ * register in the counter of the current epoch parity, and the core frees
+ * replaced snapshots only after flipping the epoch and seeing the old parity's
+ * reader count drop to 0.
+ *
+ * A snapshot is stale after a client or input command changed the core state,
+ * until the next one is published. Readers use the core in this case, so that
+ * they always see their own changes.
+ */
+
+// Forms of a property value in a snapshot.
+enum {
+    SNAPSHOT_NODE,      // MPV_FORMAT_NODE/FLAG/INT64/DOUBLE
+    SNAPSHOT_STRING,    // MPV_FORMAT_STRING
+    SNAPSHOT_OSD,       // MPV_FORMAT_OSD_STRING
+    SNAPSHOT_FORMS,
+};
+
+// How long a form is published after it was last read.
+#define SNAPSHOT_KEEP MP_TIME_S_TO_NS(1)
+
+struct prop_snapshot_entry {
+    char *name;
+    unsigned published;         // bit mask of forms which are set
+    int err[SNAPSHOT_FORMS];    // M_PROPERTY_* result of each published form
+    struct mpv_node node;
+    char *string;
+    char *osd;
+    int64_t keep_until[SNAPSHOT_FORMS];
+    atomic_uint used;           // forms read (or wanted) by clients
+};
+
+struct prop_snapshot {
+    struct prop_snapshot_entry *entries;
+    int num_entries;
+    struct prop_snapshot *next; // in a retire list
+};
+
+static void snapshot_free(struct prop_snapshot *snap)
+{
+    while (snap) {
+        struct prop_snapshot *next = snap->next;
+        for (int n = 0; n < snap->num_entries; n++) {
+            struct prop_snapshot_entry *e = &snap->entries[n];
+            if ((e->published & (1 << SNAPSHOT_NODE)) &&
+                e->err[SNAPSHOT_NODE] > 0)
+                mpv_free_node_contents(&e->node);
+        }
+        talloc_free(snap);
+        snap = next;
+    }
+}
+
+static struct prop_snapshot_entry *snapshot_find(struct prop_snapshot *snap,
+                                                 const char *name)
+{
+    for (int n = 0; snap && n < snap->num_entries; n++) {
+        if (strcmp(snap->entries[n].name, name) == 0)
+            return &snap->entries[n];
+    }
+    return NULL;
+}
+
+static void snapshot_get_form(struct MPContext *mpctx, struct prop_snapshot *snap,
+                              struct prop_snapshot_entry *e, int form)
+{
+    char *s = NULL;
+    switch (form) {
+    case SNAPSHOT_NODE:
+        e->err[form] = get_property_node(mpctx, e->name, &e->node);
+        break;
+    case SNAPSHOT_STRING:
+        e->err[form] = mp_property_do(e->name, M_PROPERTY_GET_STRING, &s, mpctx);
+        e->string = talloc_steal(snap, s);
+        break;
+    case SNAPSHOT_OSD:
+        e->err[form] = mp_property_do(e->name, M_PROPERTY_PRINT, &s, mpctx);
+        e->osd = talloc_steal(snap, s);
+        break;
+    }
+    e->published |= 1 << form;
+}
+
+// Free the retired snapshots which no reader can access anymore.
+static void snapshot_reclaim(struct mp_client_api *api)
+{
+    unsigned epoch = atomic_load(&api->snapshot_epoch);
+    if (api->retired_prev && !atomic_load(&api->snapshot_readers[(epoch - 1) & 1])) {
+        snapshot_free(api->retired_prev);
+        api->retired_prev = NULL;
+    }
+    // Readers of the previous-but-one epoch use the same counter as the next
+    // epoch, so flip only if they're gone.
+    if (!api->retired_prev && api->retired &&
+        !atomic_load(&api->snapshot_readers[(epoch + 1) & 1]))
+    {
+        atomic_store(&api->snapshot_epoch, epoch + 1);
+        api->retired_prev = api->retired;
+        api->retired = NULL;
+    }
+}
+
+// Publish a new snapshot. Called by the core at the end of each playloop
+// iteration.
+void mp_client_publish_properties(struct MPContext *mpctx)
+{
+    struct mp_client_api *api = mpctx->clients;
+    char **names = mpctx->opts->property_snapshot;
+    struct prop_snapshot *old = atomic_load(&api->snapshot);
+    int64_t now = mp_time_ns();
+
+    snapshot_reclaim(api);
+
+    // Nothing to do if no client is interested, and the old snapshot has no
+    // values which could be out of date.
+    bool needed = false;
+    int num_names = 0;
+    for (int n = 0; names && names[n]; n++) {
+        struct prop_snapshot_entry *e = snapshot_find(old, names[n]);
+        if (!e || e->published || atomic_load(&e->used))
+            needed = true;
+        for (int f = 0; e && f < SNAPSHOT_FORMS; f++)
+            needed |= e->keep_until[f] > now;
+        num_names++;
+    }
+    if (!needed && (!old || old->num_entries == num_names)) {
+        atomic_store(&api->snapshot_stale, false);
+        return;
+    }
+
+    struct prop_snapshot *snap = talloc_zero(NULL, struct prop_snapshot);
+    snap->entries = talloc_zero_array(snap, struct prop_snapshot_entry, num_names);
+    snap->num_entries = num_names;
+    for (int n = 0; n < num_names; n++) {
+        struct prop_snapshot_entry *e = &snap->entries[n];
+        e->name = talloc_strdup(snap, names[n]);
+        struct prop_snapshot_entry *o = snapshot_find(old, names[n]);
+        unsigned used = o ? atomic_load(&o->used) : 0;
+        for (int f = 0; f < SNAPSHOT_FORMS; f++) {
+            e->keep_until[f] = o ? o->keep_until[f] : 0;
+            if (used & (1 << f))
+                e->keep_until[f] = now + SNAPSHOT_KEEP;
+            if (e->keep_until[f] > now)
+                snapshot_get_form(mpctx, snap, e, f);
+        }
+    }
+
+    old = atomic_exchange(&api->snapshot, snap);
+    atomic_store(&api->snapshot_stale, false);
+    if (old) {
+        old->next = api->retired;
+        api->retired = old;
+    }
+    snapshot_reclaim(api);
+}
+
+// Mark the published snapshot as out of date. Called with the core locked.
+void mp_client_invalidate_properties(struct MPContext *mpctx)
+{
+    atomic_store(&mpctx->clients->snapshot_stale, true);
+}
+
+static unsigned snapshot_enter(struct mp_client_api *api)
+{
+    while (1) {
+        unsigned epoch = atomic_load(&api->snapshot_epoch);
+        atomic_fetch_add(&api->snapshot_readers[epoch & 1], 1);
+        if (atomic_load(&api->snapshot_epoch) == epoch)
+            return epoch;
+        atomic_fetch_sub(&api->snapshot_readers[epoch & 1], 1);
+    }
+}
+
+static void snapshot_leave(struct mp_client_api *api, unsigned epoch)
+{
+    atomic_fetch_sub(&api->snapshot_readers[epoch & 1], 1);
+}
+
+// Read the property from the published snapshot. Returns false if it's not
+// there, and the core must be used.
+static bool get_snapshot_property(mpv_handle *ctx, const char *name,
+                                  mpv_format format, void *data, int *status)
+{
+    struct mp_client_api *api = ctx->clients;
+    if (atomic_load(&api->snapshot_stale))
+        return false;
+
+    int form = SNAPSHOT_NODE;
+    if (format == MPV_FORMAT_STRING)
+        form = SNAPSHOT_STRING;
+    if (format == MPV_FORMAT_OSD_STRING)
+        form = SNAPSHOT_OSD;
+    unsigned bit = 1 << form;
+
+    bool found = false, wakeup = false;
+    unsigned epoch = snapshot_enter(api);
+    struct prop_snapshot_entry *e = snapshot_find(atomic_load(&api->snapshot), name);
+    if (e && !(atomic_load(&e->used) & bit)) {
+        // Avoid writing to the shared cache line on every read.
+        unsigned prev = atomic_fetch_or(&e->used, bit);
+        wakeup = !(prev & bit) && !(e->published & bit);
+    }
+    if (e && (e->published & bit)) {
+        int err = e->err[form];
+        if (err > 0) {
+            switch (form) {
+            case SNAPSHOT_NODE:
+                if (format == MPV_FORMAT_NODE) {
+                    *(struct mpv_node *)data = (struct mpv_node){0};
+                    m_option_copy(get_mp_type(format), data, &e->node);
+                } else {
+                    struct mpv_node node = e->node;
+                    if (!conv_node_to_format(data, format, &node))
+                        err = M_PROPERTY_INVALID_FORMAT;
+                }
+                break;
+            case SNAPSHOT_STRING:
+                *(char **)data = talloc_strdup(NULL, e->string);
+                break;
+            case SNAPSHOT_OSD:
+                *(char **)data = talloc_strdup(NULL, e->osd);
+                break;
+            }
+        }
+        *status = translate_property_error(err);
+        found = true;
+    }
+    snapshot_leave(api, epoch);
+
+    // Get the value published in the next iteration.
+    if (wakeup)
+        mp_wakeup_core(ctx->mpctx);
+    return found;
+}
+
 int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
                      void *data)
 {
@@ -1478,6 +1811,10 @@ int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
     if (!get_mp_type_get(format))
         return MPV_ERROR_PROPERTY_FORMAT;
 
+    int status;
+    if (get_snapshot_property(ctx, name, format, data, &status))
+        return status;
+
     struct getproperty_request req = {
         .mpctx = ctx->mpctx,
         .name = name,
@@ -1521,6 +1858,48 @@ int mpv_get_property_async(mpv_handle *ctx, uint64_t ud, const char *name,
     return run_async(ctx, getproperty_fn, req);
 }
 
+struct getproperties_request {
+    struct MPContext *mpctx;
+    const char **names;
+    struct mpv_node *res;
+};
+
+static void getproperties_fn(void *arg)
+{
+    struct getproperties_request *req = arg;
+
+    node_init(req->res, MPV_FORMAT_NODE_MAP, NULL);
+    for (int n = 0; req->names[n]; n++) {
+        // Map keys must be unique, so repeated names are returned once.
+        if (node_map_get(req->res, req->names[n]))
+            continue;
+        struct mpv_node node = {{0}};
+        int err = get_property_node(req->mpctx, req->names[n], &node);
+        struct mpv_node *dst =
+            node_map_add(req->res, req->names[n], MPV_FORMAT_NONE);
+        if (err > 0) {
+            *dst = node;
+            talloc_steal(req->res->u.list, node_get_alloc(dst));
+        }
+    }
+}
+
+int mpv_get_properties(mpv_handle *ctx, const char **names, mpv_node *result)
+{
+    if (!ctx->mpctx->initialized)
+        return MPV_ERROR_UNINITIALIZED;
+    if (!names || !result)
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    struct getproperties_request req = {
+        .mpctx = ctx->mpctx,
+        .names = names,
+        .res = result,
+    };
+    run_locked(ctx, getproperties_fn, &req);
+    return MPV_ERROR_SUCCESS;
+}
+
 static void property_free(void *p)
 {
     struct observe_property *prop = p;
@@ -1531,6 +1910,7 @@ static void property_free(void *p)
         m_option_free(prop->type, &prop->value);
         m_option_free(prop->type, &prop->value_ret);
     }
+    m_option_free(get_mp_type(MPV_FORMAT_NODE), &prop->delta_ret);
 }
 
 int mpv_observe_property(mpv_handle *ctx, uint64_t userdata,
@@ -1591,6 +1971,56 @@ int mpv_unobserve_property(mpv_handle *ctx, uint64_t userdata)
     return count;
 }
 
+int mpv_observe_property_options(mpv_handle *ctx, uint64_t reply_userdata,
+                                 mpv_node *options)
+{
+    if (!options || options->format != MPV_FORMAT_NODE_MAP)
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    double max_rate = -1;
+    int delta = -1;
+    for (int n = 0; options->u.list && n < options->u.list->num; n++) {
+        const char *key = options->u.list->keys[n];
+        struct mpv_node *val = &options->u.list->values[n];
+        if (strcmp(key, "max-rate") == 0) {
+            if (val->format == MPV_FORMAT_INT64) {
+                max_rate = val->u.int64;
+            } else if (val->format == MPV_FORMAT_DOUBLE) {
+                max_rate = val->u.double_;
+            } else {
+                return MPV_ERROR_INVALID_PARAMETER;
+            }
+            if (!(max_rate >= 0))
+                return MPV_ERROR_INVALID_PARAMETER;
+        } else if (strcmp(key, "delta") == 0) {
+            if (val->format != MPV_FORMAT_FLAG)
+                return MPV_ERROR_INVALID_PARAMETER;
+            delta = val->u.flag;
+        } else {
+            return MPV_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    mp_mutex_lock(&ctx->lock);
+    int count = 0;
+    for (int n = 0; n < ctx->num_properties; n++) {
+        struct observe_property *prop = ctx->properties[n];
+        if (prop->reply_id != reply_userdata)
+            continue;
+        if (max_rate >= 0) {
+            prop->min_interval = max_rate ? MP_TIME_S_TO_NS(1 / max_rate) : 0;
+            prop->next_update = 0;
+        }
+        if (delta >= 0)
+            prop->delta = delta;
+        count++;
+    }
+    mp_mutex_unlock(&ctx->lock);
+    if (count)
+        mp_wakeup_core(ctx->mpctx);
+    return count;
+}
+
 static bool property_shared_prefix(const char *a0, const char *b0)
 {
     bstr a = bstr0(a0);
@@ -1622,6 +2052,8 @@ void mp_client_property_change(struct MPContext *mpctx, const char *name)
     int id = mp_get_property_id(mpctx, name);
     bool any_pending = false;
 
+    mp_client_invalidate_properties(mpctx);
+
     mp_mutex_lock(&clients->lock);
 
     for (int n = 0; n < clients->num_clients; n++) {
@@ -1666,9 +2098,13 @@ static void notify_property_events(struct mpv_handle *ctx, int event)
 }
 
 // Call with ctx->lock held (only). May temporarily drop the lock.
-static void send_client_property_changes(struct mpv_handle *ctx)
+// *next_update is lowered to the time rate limited properties must be
+// checked again.
+static void send_client_property_changes(struct mpv_handle *ctx,
+                                         int64_t *next_update)
 {
     uint64_t cur_ts = ctx->properties_change_ts;
+    int64_t now = mp_time_ns();
 
     ctx->has_pending_properties = false;
 
@@ -1678,6 +2114,13 @@ static void send_client_property_changes(struct mpv_handle *ctx)
         if (prop->value_ts == prop->change_ts)
             continue;
 
+        // Don't even read the property if no event would be sent yet.
+        if (prop->next_update > now) {
+            ctx->has_pending_properties = true;
+            *next_update = MPMIN(*next_update, prop->next_update);
+            continue;
+        }
+
         bool changed = false;
         if (prop->format) {
             const struct m_option *type = prop->type;
@@ -1741,6 +2184,8 @@ static void send_client_property_changes(struct mpv_handle *ctx)
             prop->waiting_for_hook = false;
         } else {
             ctx->new_property_events = true;
+            if (prop->min_interval)
+                prop->next_update = now + prop->min_interval;
         }
 
         prop->value_ts = prop->change_ts;
@@ -1756,6 +2201,7 @@ void mp_client_send_property_changes(struct MPContext *mpctx)
 
     mp_mutex_lock(&clients->lock);
     uint64_t cur_ts = clients->clients_list_change_ts;
+    int64_t next_update = INT64_MAX;
 
     for (int n = 0; n < clients->num_clients; n++) {
         struct mpv_handle *ctx = clients->clients[n];
@@ -1767,7 +2213,7 @@ void mp_client_send_property_changes(struct MPContext *mpctx)
         }
         // Keep ctx->lock locked (unlock order does not matter).
         mp_mutex_unlock(&clients->lock);
-        send_client_property_changes(ctx);
+        send_client_property_changes(ctx, &next_update);
         mp_mutex_unlock(&ctx->lock);
         mp_mutex_lock(&clients->lock);
         if (cur_ts != clients->clients_list_change_ts) {
@@ -1778,6 +2224,137 @@ void mp_client_send_property_changes(struct MPContext *mpctx)
     }
 
     mp_mutex_unlock(&clients->lock);
+
+    if (next_update < INT64_MAX)
+        mp_set_timeout(mpctx, MPMAX(MP_TIME_NS_TO_S(next_update - mp_time_ns()), 0));
+}
+
+// Append a copy of val to the map dst.
+static void node_map_add_copy(struct mpv_node *dst, const char *key,
+                              struct mpv_node *val)
+{
+    struct mpv_node *entry = node_map_add(dst, key, MPV_FORMAT_NONE);
+    m_option_copy(get_mp_type(MPV_FORMAT_NODE), entry, val);
+    talloc_steal(dst->u.list, node_get_alloc(entry));
+}
+
+static void add_patch_op(struct mpv_node *patch, const char *op,
+                         const char *path, struct mpv_node *val)
+{
+    struct mpv_node *entry = node_array_add(patch, MPV_FORMAT_NODE_MAP);
+    node_map_add_string(entry, "op", op);
+    node_map_add_string(entry, "path", path);
+    if (val)
+        node_map_add_copy(entry, "value", val);
+}
+
+// Append the JSON pointer reference token for key to path.
+static char *append_path_key(void *ta_parent, const char *path, const char *key)
+{
+    char *res = talloc_asprintf(ta_parent, "%s/", path);
+    for (const char *c = key; *c; c++) {
+        if (*c == '~' || *c == '/') {
+            res = talloc_asprintf_append_buffer(res, "~%c", *c == '~' ? '0' : '1');
+        } else {
+            res = talloc_strndup_append_buffer(res, c, 1);
+        }
+    }
+    return res;
+}
+
+// Append JSON patch (RFC 6902) style operations to patch, which turn old into
+// new. Arrays and maps are compared entry by entry down to the given depth;
+// below that, changed values are replaced as a whole. Changes in the middle
+// of arrays are found by skipping the common prefix and suffix, so that an
+// insertion or removal results in a single operation.
+static void diff_node(void *ta_parent, struct mpv_node *patch, const char *path,
+                      struct mpv_node *old, struct mpv_node *new, int depth)
+{
+    if (equal_mpv_node(old, new))
+        return;
+
+    if (depth > 0 && old->format == MPV_FORMAT_NODE_ARRAY &&
+        new->format == MPV_FORMAT_NODE_ARRAY)
+    {
+        struct mpv_node_list *a = old->u.list, *b = new->u.list;
+        int min_num = MPMIN(a->num, b->num);
+        int prefix = 0, suffix = 0;
+        while (prefix < min_num &&
+               equal_mpv_node(&a->values[prefix], &b->values[prefix]))
+            prefix++;
+        while (suffix < min_num - prefix &&
+               equal_mpv_node(&a->values[a->num - 1 - suffix],
+                              &b->values[b->num - 1 - suffix]))
+            suffix++;
+        int num_a = a->num - prefix - suffix, num_b = b->num - prefix - suffix;
+        int pos = prefix;
+        for (int n = 0; n < MPMIN(num_a, num_b); n++, pos++) {
+            char *p = talloc_asprintf(ta_parent, "%s/%d", path, pos);
+            diff_node(ta_parent, patch, p, &a->values[pos], &b->values[pos],
+                      depth - 1);
+        }
+        for (int n = num_a; n < num_b; n++, pos++) {
+            char *p = talloc_asprintf(ta_parent, "%s/%d", path, pos);
+            add_patch_op(patch, "add", p, &b->values[pos]);
+        }
+        for (int n = num_b; n < num_a; n++) {
+            char *p = talloc_asprintf(ta_parent, "%s/%d", path, pos);
+            add_patch_op(patch, "remove", p, NULL);
+        }
+        return;
+    }
+
+    if (depth > 0 && old->format == MPV_FORMAT_NODE_MAP &&
+        new->format == MPV_FORMAT_NODE_MAP)
+    {
+        struct mpv_node_list *b = new->u.list;
+        for (int n = 0; n < b->num; n++) {
+            char *p = append_path_key(ta_parent, path, b->keys[n]);
+            struct mpv_node *val = node_map_get(old, b->keys[n]);
+            if (val) {
+                diff_node(ta_parent, patch, p, val, &b->values[n], depth - 1);
+            } else {
+                add_patch_op(patch, "add", p, &b->values[n]);
+            }
+        }
+        struct mpv_node_list *a = old->u.list;
+        for (int n = 0; n < a->num; n++) {
+            if (!node_map_get(new, a->keys[n])) {
+                char *p = append_path_key(ta_parent, path, a->keys[n]);
+                add_patch_op(patch, "remove", p, NULL);
+            }
+        }
+        return;
+    }
+
+    add_patch_op(patch, "replace", path, new);
+}
+
+// Set dst to the event data in delta mode: a map with either the "patch"
+// from old (the value last returned, or NULL) to new, or the full "value"
+// if there's nothing to patch or the patch wouldn't be much smaller.
+static void make_property_delta(struct mpv_node *dst, struct mpv_node *old,
+                                struct mpv_node *new)
+{
+    node_init(dst, MPV_FORMAT_NODE_MAP, NULL);
+
+    bool list = new->format == MPV_FORMAT_NODE_ARRAY ||
+                new->format == MPV_FORMAT_NODE_MAP;
+    if (old && list && old->format == new->format) {
+        void *tmp = talloc_new(NULL);
+        struct mpv_node patch;
+        node_init(&patch, MPV_FORMAT_NODE_ARRAY, NULL);
+        diff_node(tmp, &patch, "", old, new, 2);
+        talloc_free(tmp);
+        if (patch.u.list->num * 2 <= MPMAX(new->u.list->num, 1)) {
+            *node_map_add(dst, "patch", MPV_FORMAT_NONE) = patch;
+            talloc_steal(dst->u.list, patch.u.list);
+            return;
+        }
+        talloc_free(patch.u.list);
+    }
+
+    node_map_add_copy(dst, "value", new);
 }
 
 // Set ctx->cur_event to a generated property change event, if there is any
@@ -1807,13 +2384,25 @@ static bool gen_property_change_event(struct mpv_handle *ctx)
             ctx->cur_property = prop;
             prop->refcount += 1;
 
+            void *data = &prop->value_ret;
+            if (prop->value_valid && prop->delta &&
+                prop->format == MPV_FORMAT_NODE)
+            {
+                m_option_free(get_mp_type(MPV_FORMAT_NODE), &prop->delta_ret);
+                make_property_delta(&prop->delta_ret,
+                    prop->value_ret_valid ? (struct mpv_node *)&prop->value_ret : NULL,
+                    (struct mpv_node *)&prop->value);
+                data = &prop->delta_ret;
+            }
+
             if (prop->value_valid)
                 m_option_copy(prop->type, &prop->value_ret, &prop->value);
+            prop->value_ret_valid = prop->value_valid;
 
             ctx->cur_property_event = (struct mpv_event_property){
                 .name = prop->name,
                 .format = prop->value_valid ? prop->format : 0,
-                .data = prop->value_valid ? &prop->value_ret : NULL,
+                .data = prop->value_valid ? data : NULL,
             };
             *ctx->cur_event = (struct mpv_event){
                 .event_id = MPV_EVENT_PROPERTY_CHANGE,
@@ -1848,6 +2437,7 @@ int mpv_load_config_file(mpv_handle *ctx, const char *filename)
 {
     lock_core(ctx);
     int r = m_config_parse_config_file(ctx->mpctx->mconfig, ctx->mpctx->global, filename, NULL, 0);
+    mp_client_invalidate_properties(ctx->mpctx);
     unlock_core(ctx);
     if (r == 0)
         return MPV_ERROR_INVALID_PARAMETER;
@@ -30,9 +30,14 @@ int mp_client_send_event_dup(struct MPContext *mpctx, const char *client_name,
                              int event, void *data);
 void mp_client_property_change(struct MPContext *mpctx, const char *name);
 void mp_client_send_property_changes(struct MPContext *mpctx);
+void mp_client_publish_properties(struct MPContext *mpctx);
+void mp_client_invalidate_properties(struct MPContext *mpctx);
 
 struct mpv_handle *mp_new_client(struct mp_client_api *clients, const char *name);
 void mp_client_set_weak(struct mpv_handle *ctx);
+struct mp_script_profile;
+void mp_client_set_profile(struct mpv_handle *ctx,
+                           struct mp_script_profile *profile);
 struct mp_log *mp_client_get_log(struct mpv_handle *ctx);
 struct mpv_global *mp_client_get_global(struct mpv_handle *ctx);
 
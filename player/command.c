@@ -46,6 +46,7 @@
 #include "common/common.h"
 #include "input/input.h"
 #include "input/keycodes.h"
+#include "sub/ass_mp.h"
 #include "sub/osd_state.h"
 #include "stream/stream.h"
 #include "demux/demux.h"
@@ -3051,6 +3052,28 @@ static int mp_property_osd_ass(void *ctx, struct m_property *prop,
     return m_property_read_sub(props, action, arg);
 }
 
+static int mp_property_ass_cache(void *ctx, struct m_property *prop,
+                                 int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    struct mp_ass_cache_stats st;
+    mp_ass_cache_get_stats(mpctx->global, &st);
+
+    struct m_sub_property props[] = {
+        {"renderers",           SUB_PROP_INT(st.renderers)},
+        {"idle-renderers",      SUB_PROP_INT(st.idle_renderers)},
+        {"budget",              SUB_PROP_INT(st.budget)},
+        {"bitmap-share",        SUB_PROP_INT(st.bitmap_share),
+                                .unavailable = !st.bitmap_share},
+        {"renderers-created",   SUB_PROP_INT64(st.renderers_created)},
+        {"renderers-reused",    SUB_PROP_INT64(st.renderers_reused)},
+        {"frames",              SUB_PROP_INT64(st.frames)},
+        {"frames-unchanged",    SUB_PROP_INT64(st.frames_unchanged)},
+        {0}
+    };
+    return m_property_read_sub(props, action, arg);
+}
+
 static int mp_property_term_clip(void *ctx, struct m_property *prop,
                                int action, void *arg)
 {
@@ -3450,11 +3473,28 @@ static int mp_property_playlist_pos_1(void *ctx, struct m_property *prop,
     return mp_property_playlist_pos_x(ctx, prop, action, arg, 1);
 }
 
+// Remembers the last entry looked up, so that reading the whole list is O(n).
+struct playlist_cursor {
+    struct MPContext *mpctx;
+    struct playlist_entry *e;
+    int index;
+};
+
 static int get_playlist_entry(int item, int action, void *arg, void *ctx)
 {
-    struct MPContext *mpctx = ctx;
+    struct playlist_cursor *cur = ctx;
+    struct MPContext *mpctx = cur->mpctx;
 
-    struct playlist_entry *e = playlist_entry_from_index(mpctx->playlist, item);
+    struct playlist_entry *e;
+    if (cur->e && item == cur->index) {
+        e = cur->e;
+    } else if (cur->e && item == cur->index + 1) {
+        e = playlist_entry_get_rel(cur->e, 1);
+    } else {
+        e = playlist_entry_from_index(mpctx->playlist, item);
+    }
+    cur->e = e;
+    cur->index = item;
     if (!e)
         return M_PROPERTY_ERROR;
 
@@ -3492,8 +3532,9 @@ static int mp_property_playlist(void *ctx, struct m_property *prop,
         struct playlist *pl = mpctx->playlist;
         char *res = talloc_strdup(NULL, "");
 
-        for (int n = 0; n < pl->num_entries; n++) {
-            struct playlist_entry *e = pl->entries[n];
+        for (struct playlist_entry *e = playlist_get_first(pl); e;
+             e = playlist_entry_get_rel(e, 1))
+        {
             if (pl->current == e)
                 res = append_selected_style(mpctx, res);
             const char *reset = pl->current == e ? get_style_reset(mpctx) : "";
@@ -3507,9 +3548,9 @@ static int mp_property_playlist(void *ctx, struct m_property *prop,
                 }
             }
             if (!e->title || p == e->title || mpctx->opts->playlist_entry_name == 1) {
-                res = talloc_asprintf_append(res, "%s%s\n", p, reset);
+                res = talloc_asprintf_append_buffer(res, "%s%s\n", p, reset);
             } else {
-                res = talloc_asprintf_append(res, "%s (%s)%s\n", e->title, p, reset);
+                res = talloc_asprintf_append_buffer(res, "%s (%s)%s\n", e->title, p, reset);
             }
         }
 
@@ -3518,8 +3559,9 @@ static int mp_property_playlist(void *ctx, struct m_property *prop,
         return M_PROPERTY_OK;
     }
 
+    struct playlist_cursor cur = {.mpctx = mpctx};
     return m_property_read_list(action, arg, playlist_entry_count(mpctx->playlist),
-                                get_playlist_entry, mpctx);
+                                get_playlist_entry, &cur);
 }
 
 static char *print_obj_osd_list(struct m_obj_settings *list)
@@ -3994,6 +4036,43 @@ static int mp_property_commands(void *ctx, struct m_property *prop,
     return M_PROPERTY_NOT_IMPLEMENTED;
 }
 
+static int mp_property_script_load_times(void *ctx, struct m_property *prop,
+                                         int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    switch (action) {
+    case M_PROPERTY_GET_TYPE:
+        *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_NODE};
+        return M_PROPERTY_OK;
+    case M_PROPERTY_GET: {
+        struct mpv_node *root = arg;
+        node_init(root, MPV_FORMAT_NODE_ARRAY, NULL);
+
+        for (int n = 0; n < mpctx->num_script_profiles; n++) {
+            struct mp_script_profile *p = mpctx->script_profiles[n];
+            struct mpv_node *entry = node_array_add(root, MPV_FORMAT_NODE_MAP);
+
+            node_map_add_string(entry, "name", p->name);
+            node_map_add_string(entry, "filename", p->filename);
+            node_map_add_string(entry, "backend", p->backend);
+            node_map_add_flag(entry, "lazy", p->lazy);
+            node_map_add_flag(entry, "started", p->start > 0);
+            int64_t compile_ns = atomic_load(&p->compile_ns);
+            if (compile_ns) {
+                node_map_add_double(entry, "compile-time",
+                                    compile_ns / 1e9);
+            }
+            int64_t init_ns = atomic_load(&p->init_ns);
+            if (init_ns)
+                node_map_add_double(entry, "init-time", init_ns / 1e9);
+        }
+
+        return M_PROPERTY_OK;
+    }
+    }
+    return M_PROPERTY_NOT_IMPLEMENTED;
+}
+
 static int mp_property_bindings(void *ctx, struct m_property *prop,
                                 int action, void *arg)
 {
@@ -4467,6 +4546,7 @@ static const struct m_property mp_properties_base[] = {
 
     {"osd-sym-cc", mp_property_osd_sym},
     {"osd-ass-cc", mp_property_osd_ass},
+    {"ass-cache", mp_property_ass_cache},
 
     {"term-clip-cc", mp_property_term_clip},
 
@@ -4540,6 +4620,7 @@ static const struct m_property mp_properties_base[] = {
     {"profile-list", mp_profile_list},
     {"command-list", mp_property_commands},
     {"input-bindings", mp_property_bindings},
+    {"script-load-times", mp_property_script_load_times},
 
     {"menu-data", mp_property_mdata},
 
@@ -5542,6 +5623,8 @@ void run_command(struct MPContext *mpctx, struct mp_cmd *cmd,
     if (!ctx->abort && cmd->def->can_abort)
         ctx->abort = talloc_zero(ctx, struct mp_abort_entry);
 
+    mp_client_invalidate_properties(mpctx);
+
     mp_assert(cmd->def->can_abort == !!ctx->abort);
 
     if (ctx->abort) {
@@ -6762,6 +6845,9 @@ static void cmd_script_binding(void *p)
     }
     char *scale_s = mp_format_double(NULL, scale, 6, false, false, false);
 
+    if (target)
+        mp_load_lazy_script(mpctx, target);
+
     for (int i = 0; i < scale_units; i++) {
         event.num_args = 7;
         event.args = (const char*[7]){"key-binding", name, state,
@@ -6791,6 +6877,7 @@ static void cmd_script_message_to(void *p)
         MP_TARRAY_APPEND(event, event->args, event->num_args,
                          talloc_strdup(event, cmd->args[n].v.s));
     }
+    mp_load_lazy_script(mpctx, cmd->args[0].v.s);
     if (mp_client_send_event(mpctx, cmd->args[0].v.s, 0,
                                 MPV_EVENT_CLIENT_MESSAGE, event) < 0)
     {
@@ -6809,6 +6896,8 @@ static void cmd_script_message(void *p)
     mpv_event_client_message event = {.args = args};
     for (int n = 0; n < cmd->num_args; n++)
         event.args[event.num_args++] = cmd->args[n].v.s;
+    if (event.num_args)
+        mp_lazy_scripts_notify_message(mpctx, event.args[0]);
     mp_client_broadcast_event(mpctx, MPV_EVENT_CLIENT_MESSAGE, &event);
     talloc_free(args);
 }
@@ -7752,6 +7841,9 @@ static void command_event(struct MPContext *mpctx, int event, void *arg)
     if (event == MP_EVENT_WIN_STATE2)
         ctx->cached_window_scale = 0;
 
+    if (event == MP_EVENT_CHANGE_PLAYLIST)
+        prune_prefetch(mpctx);
+
     if (event == MP_EVENT_METADATA_UPDATE) {
         struct playlist_entry *const pe = mpctx->playing;
         if (pe && !pe->title) {
@@ -7802,6 +7894,9 @@ void mp_notify(struct MPContext *mpctx, int event, void *arg)
 
     command_event(mpctx, event, arg);
 
+    if (mpctx->num_lazy_scripts)
+        mp_lazy_scripts_notify_event(mpctx, event);
+
     mp_client_broadcast_event(mpctx, event, arg);
 }
 
@@ -7984,7 +8079,7 @@ void mp_option_run_callback(struct MPContext *mpctx, struct mp_option_callback *
     }
 
     if (flags & UPDATE_DEMUXER)
-        mpctx->demuxer_changed = true;
+        mpctx->demuxer_opts_gen++;
 
     if (flags & UPDATE_AD && mpctx->ao_chain) {
         uninit_audio_chain(mpctx);
@@ -281,6 +281,8 @@ typedef struct MPContext {
     char *stream_open_filename;
     char **playlist_paths; // used strictly for playlist validation
     int playlist_paths_len;
+    // Reads the rest of a playlist file in the background.
+    struct playlist_loader *playlist_loader;
     enum stop_play_reason stop_play;
     bool playback_initialized; // playloop can be run/is running
     int error_playing;
@@ -445,6 +447,12 @@ typedef struct MPContext {
     struct mp_ipc_ctx *ipc_ctx;
 
     int64_t builtin_script_ids[9];
+    // Scripts waiting for a trigger, see scripting.c.
+    struct mp_lazy_script **lazy_scripts;
+    int num_lazy_scripts;
+    // For the "script-load-times" property. Appended to on every script load.
+    struct mp_script_profile **script_profiles;
+    int num_script_profiles;
 
     mp_mutex abort_lock;
 
@@ -454,21 +462,15 @@ typedef struct MPContext {
     bool abort_all; // during final termination
 
     // --- Owned by MPContext
-    mp_thread open_thread;
-    bool open_active; // open_thread is a valid thread handle, all setup
-    atomic_bool open_done;
-    // --- All fields below are immutable while open_active is true.
-    //     Otherwise, they're owned by MPContext.
-    struct mp_cancel *open_cancel;
-    char *open_url;
-    char *open_format;
-    int open_url_flags;
-    bool open_for_prefetch;
-    bool demuxer_changed;
-    // --- All fields below are owned by open_thread, unless open_done was set
-    //     to true.
-    struct demuxer *open_res_demuxer;
-    int open_res_error;
+    // Prefetched next playlist entries (see prefetch_next()).
+    struct mp_opener **openers;
+    int num_openers;
+    // Cancelled openers, freed once they're done (see drop_opener()).
+    struct mp_opener **dropped_openers;
+    int num_dropped_openers;
+    // Incremented when demuxer options change; openers started with an older
+    // value are dropped.
+    uint64_t demuxer_opts_gen;
 } MPContext;
 
 // Contains information about an asynchronous work item, how it can be aborted,
@@ -555,6 +557,8 @@ void autoload_external_files(struct MPContext *mpctx, struct mp_cancel *cancel);
 struct track *select_default_track(struct MPContext *mpctx, int order,
                                    enum stream_type type);
 void prefetch_next(struct MPContext *mpctx);
+void prune_prefetch(struct MPContext *mpctx);
+void update_playlist_loader(struct MPContext *mpctx);
 void update_lavfi_complex(struct MPContext *mpctx);
 
 // main.c
@@ -631,6 +635,15 @@ void update_ab_loop_clip(struct MPContext *mpctx);
 bool get_internal_paused(struct MPContext *mpctx);
 
 // scripting.c
+struct mp_script_profile {
+    char *name;
+    char *filename;
+    const char *backend;        // e.g. "lua script"
+    bool lazy;                  // waiting for a trigger (core thread only)
+    int64_t start;              // mp_time_ns() when the script was started
+    _Atomic int64_t compile_ns; // time spent compiling code (if supported)
+    _Atomic int64_t init_ns;    // time until the first mpv_wait_event(), or 0
+};
 struct mp_script_args {
     const struct mp_scripting *backend;
     struct MPContext *mpctx;
@@ -638,6 +651,8 @@ struct mp_script_args {
     struct mpv_handle *client;
     const char *filename;
     const char *path;
+    struct mp_script_profile *profile;
+    const char *cache_dir;      // for compiled code, NULL if disabled
 };
 struct mp_scripting {
     const char *name;       // e.g. "lua script"
@@ -648,6 +663,9 @@ struct mp_scripting {
 bool mp_load_scripts(struct MPContext *mpctx);
 void mp_load_builtin_scripts(struct MPContext *mpctx);
 int64_t mp_load_user_script(struct MPContext *mpctx, const char *fname);
+bool mp_load_lazy_script(struct MPContext *mpctx, const char *name);
+void mp_lazy_scripts_notify_message(struct MPContext *mpctx, const char *msg);
+void mp_lazy_scripts_notify_event(struct MPContext *mpctx, int event);
 
 // sub.c
 void redraw_subs(struct MPContext *mpctx);
@@ -22,12 +22,13 @@
 #include "osdep/io.h"
 
 #include "common/common.h"
+#include "common/dir_cache.h"
 #include "common/global.h"
 #include "common/msg.h"
 #include "misc/charset_conv.h"
-#include "misc/language.h"
 #include "options/options.h"
 #include "options/path.h"
+#include "osdep/timer.h"
 #include "player/core.h"
 #include "external_files.h"
 
@@ -86,12 +87,12 @@ static int compare_sub_priority(const void *a, const void *b)
 }
 
 static void append_dir_subtitles(struct mpv_global *global, struct MPOpts *opts,
+                                 struct mp_log *log,
                                  struct subfn **slist, int *nsub,
                                  struct bstr path, const char *fname,
                                  int limit_fuzziness, int limit_type)
 {
     void *tmpmem = talloc_new(NULL);
-    struct mp_log *log = mp_log_new(tmpmem, global->log, "find_files");
 
     struct bstr f_fbname = bstr0(mp_basename(fname));
     struct bstr f_fname = mp_iconv_to_utf8(log, f_fbname,
@@ -107,24 +108,18 @@ static void append_dir_subtitles(struct mpv_global *global, struct MPOpts *opts,
     if (mp_is_url(bstr0(path0)))
         goto out;
 
-    DIR *d = opendir(path0);
-    if (!d)
+    struct mp_dir_listing *listing = mp_dir_cache_get(global, path0, 0);
+    if (!listing)
         goto out;
     mp_verbose(log, "Loading external files in %.*s\n", BSTR_P(path));
-    struct dirent *de;
-    while ((de = readdir(d))) {
-        void *tmpmem2 = talloc_new(tmpmem);
-        struct bstr den = bstr0(de->d_name);
-        struct bstr dename = mp_iconv_to_utf8(log, den,
-                                              "UTF-8-MAC", MP_NO_LATIN1_FALLBACK);
+    for (int i = 0; i < listing->num_entries; i++) {
+        struct mp_dir_entry *de = &listing->entries[i];
+        struct bstr dename = de->utf8_name;
         // retrieve various parts of the filename
-        struct bstr tmp_fname_noext = bstrdup(tmpmem2, bstr_strip_ext(dename));
+        struct bstr tmp_fname_noext = bstr_strip_ext(dename);
         struct bstr tmp_fname_ext = bstr_get_ext(dename);
         struct bstr tmp_fname_trim = bstr_strip(tmp_fname_noext);
 
-        if (den.start != dename.start)
-            talloc_steal(tmpmem2, dename.start);
-
         // check what it is (most likely)
         int type = test_ext(opts, tmp_fname_ext);
         char **langs = NULL;
@@ -144,7 +139,7 @@ static void append_dir_subtitles(struct mpv_global *global, struct MPOpts *opts,
         }
 
         if (fuzz < 0 || (limit_type >= 0 && limit_type != type))
-            goto next_sub;
+            continue;
 
         // we have a (likely) subtitle file
         // higher prio -> auto-selection may prefer it (0 = not loaded)
@@ -153,10 +148,9 @@ static void append_dir_subtitles(struct mpv_global *global, struct MPOpts *opts,
         if (bstrcasecmp(tmp_fname_trim, f_fname_trim) == 0)
             prio |= 32; // exact movie name match
 
-        bstr lang = {0};
-        int start = 0;
-        enum track_flags flags = 0;
-        lang = mp_guess_lang_from_filename(dename, &start, &flags);
+        bstr lang = de->lang;
+        int start = de->lang_start;
+        enum track_flags flags = de->lang_flags;
         if (bstr_case_startswith(tmp_fname_trim, f_fname_trim)) {
             if (lang.len && start == f_fname_trim.len)
                 prio |= 16; // exact movie name + followed by lang
@@ -185,7 +179,7 @@ static void append_dir_subtitles(struct mpv_global *global, struct MPOpts *opts,
             prio |= 1;
 
         mp_trace(log, "Potential external file: \"%s\"  Priority: %d\n",
-               de->d_name, prio);
+               de->name, prio);
 
         if (prio) {
             char *subpath = mp_path_join_bstr(*slist, path, dename);
@@ -205,11 +199,8 @@ static void append_dir_subtitles(struct mpv_global *global, struct MPOpts *opts,
             } else
                 talloc_free(subpath);
         }
-
-    next_sub:
-        talloc_free(tmpmem2);
     }
-    closedir(d);
+    mp_dir_listing_release(listing);
 
  out:
     talloc_free(tmpmem);
@@ -242,27 +233,32 @@ static void filter_subidx(struct subfn **slist, int *nsub)
     }
 }
 
-static void load_paths(struct mpv_global *global, struct MPOpts *opts,
-                       struct subfn **slist, int *nsubs, const char *fname,
-                       char **paths, char *cfg_path, int type)
+struct search_dir {
+    char *path;
+    int limit_fuzziness;
+    int limit_type;
+};
+
+static void add_paths(struct mpv_global *global, void *ta_parent,
+                      struct search_dir **dirs, int *num_dirs,
+                      const char *fname, char **paths, char *cfg_path, int type)
 {
     for (int i = 0; paths && paths[i]; i++) {
         char *expanded_path = mp_get_user_path(NULL, global, paths[i]);
         char *path = mp_path_join_bstr(
-            *slist, mp_dirname(fname),
+            ta_parent, mp_dirname(fname),
             bstr0(expanded_path ? expanded_path : paths[i]));
-        append_dir_subtitles(global, opts, slist, nsubs, bstr0(path),
-                             fname, 0, type);
+        struct search_dir dir = {path, 0, type};
+        MP_TARRAY_APPEND(ta_parent, *dirs, *num_dirs, dir);
         talloc_free(expanded_path);
     }
 
     // Load subtitles in ~/.mpv/sub (or similar) limiting sub fuzziness
-    char *mp_subdir = mp_find_config_file(NULL, global, cfg_path);
+    char *mp_subdir = mp_find_config_file(ta_parent, global, cfg_path);
     if (mp_subdir) {
-        append_dir_subtitles(global, opts, slist, nsubs, bstr0(mp_subdir),
-                             fname, 1, type);
+        struct search_dir dir = {mp_subdir, 1, type};
+        MP_TARRAY_APPEND(ta_parent, *dirs, *num_dirs, dir);
     }
-    talloc_free(mp_subdir);
 }
 
 // Return a list of subtitles and audio files found, sorted by priority.
@@ -270,23 +266,48 @@ static void load_paths(struct mpv_global *global, struct MPOpts *opts,
 struct subfn *find_external_files(struct mpv_global *global, const char *fname,
                                   struct MPOpts *opts)
 {
+    void *tmp = talloc_new(NULL);
+    struct mp_log *log = mp_log_new(tmp, global->log, "find_files");
     struct subfn *slist = talloc_array_ptrtype(NULL, slist, 1);
     int n = 0;
 
+    struct search_dir *dirs = NULL;
+    int num_dirs = 0;
+
     // Load subtitles from current media directory
-    append_dir_subtitles(global, opts, &slist, &n, mp_dirname(fname), fname, 0, -1);
+    struct search_dir dir = {bstrdup0(tmp, mp_dirname(fname)), 0, -1};
+    MP_TARRAY_APPEND(tmp, dirs, num_dirs, dir);
 
     // Load subtitles in dirs specified by sub-paths option
     if (opts->sub_auto >= 0) {
-        load_paths(global, opts, &slist, &n, fname, opts->sub_paths, "sub",
-                   STREAM_SUB);
+        add_paths(global, tmp, &dirs, &num_dirs, fname, opts->sub_paths,
+                  "sub", STREAM_SUB);
     }
 
     if (opts->audiofile_auto >= 0) {
-        load_paths(global, opts, &slist, &n, fname, opts->audiofile_paths,
-                   "audio", STREAM_AUDIO);
+        add_paths(global, tmp, &dirs, &num_dirs, fname, opts->audiofile_paths,
+                  "audio", STREAM_AUDIO);
     }
 
+    // Read all directories in parallel, which helps with network filesystems.
+    int64_t start = mp_time_ns();
+    char **paths = NULL;
+    int num_paths = 0;
+    for (int i = 0; i < num_dirs; i++) {
+        if (!mp_is_url(bstr0(dirs[i].path)))
+            MP_TARRAY_APPEND(tmp, paths, num_paths, dirs[i].path);
+    }
+    mp_dir_cache_prefetch(global, paths, num_paths, 0, NULL);
+
+    for (int i = 0; i < num_dirs; i++) {
+        append_dir_subtitles(global, opts, log, &slist, &n, bstr0(dirs[i].path),
+                             fname, dirs[i].limit_fuzziness, dirs[i].limit_type);
+    }
+
+    mp_verbose(log, "Searched %d directories for external files in %.1f ms.\n",
+               num_dirs, MP_TIME_NS_TO_MS(mp_time_ns() - start));
+    talloc_free(tmp);
+
     // Sort by name for filter_subidx()
     qsort(slist, n, sizeof(*slist), compare_sub_filename);
 
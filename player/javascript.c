@@ -672,6 +672,16 @@ static void script_set_property_native(js_State *J, void *af)
     push_status(J, e);
 }
 
+// args: object mapping names to native values
+static void script_set_properties(js_State *J, void *af)
+{
+    mpv_node node;
+    makenode(af, &node, J, 1);
+    if (node.format != MPV_FORMAT_NODE_MAP)
+        js_error(J, "set_properties: object expected");
+    push_status(J, mpv_set_properties(jclient(J), &node));
+}
+
 // args: name [,def]
 static void script_get_property(js_State *J, void *af)
 {
@@ -721,6 +731,25 @@ static void script_get_property_native(js_State *J, void *af)
         pushnode(J, presult_node);
 }
 
+// args: array of names [,def]
+static void script_get_properties(js_State *J, void *af)
+{
+    if (!js_isarray(J, 1))
+        js_error(J, "get_properties: array of property names expected");
+    int length = js_getlength(J, 1);
+    const char **names = talloc_zero_array(af, const char *, length + 1);
+    for (int n = 0; n < length; n++) {
+        js_getindex(J, 1, n);
+        names[n] = talloc_strdup(af, js_tostring(J, -1));
+        js_pop(J, 1);
+    }
+
+    mpv_node *presult_node = new_af_mpv_node(af);
+    int e = mpv_get_properties(jclient(J), names, presult_node);
+    if (!pushed_error(J, e, 2))
+        pushnode(J, presult_node);
+}
+
 // args: name [,def]
 static void script_get_property_osd(js_State *J, void *af)
 {
@@ -1168,12 +1197,14 @@ static const struct fn_entry main_fns[] = {
     FN_ENTRY(get_property_bool, 2),
     FN_ENTRY(get_property_number, 2),
     AF_ENTRY(get_property_native, 2),
+    AF_ENTRY(get_properties, 2),
     AF_ENTRY(get_property, 2),
     AF_ENTRY(get_property_osd, 2),
     FN_ENTRY(set_property, 2),
     FN_ENTRY(set_property_bool, 2),
     FN_ENTRY(set_property_number, 2),
     AF_ENTRY(set_property_native, 2),
+    AF_ENTRY(set_properties, 1),
     FN_ENTRY(_observe_property, 3),
     FN_ENTRY(_unobserve_property, 1),
     FN_ENTRY(get_time_ms, 0),
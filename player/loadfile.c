@@ -819,53 +819,92 @@ bool mp_remove_track(struct MPContext *mpctx, struct track *track)
     return true;
 }
 
-// Add the given file as additional track. The filter argument controls how or
-// if tracks are auto-selected at any point.
-// To be run on a worker thread, locked (temporarily unlocks core).
-// cancel will generally be used to abort the loading process, but on success
-// the demuxer is changed to be slaved to mpctx->playback_abort instead.
-int mp_add_external_file(struct MPContext *mpctx, char *filename,
-                         enum stream_type filter, struct mp_cancel *cancel,
-                         enum track_flags flags)
+// State for opening one external file. The demuxer is opened with the core
+// unlocked, which can happen concurrently for several files.
+struct external_load {
+    struct MPContext *mpctx;
+    char *filename;
+    char *disp_filename;
+    enum stream_type filter;
+    enum track_flags flags;
+    struct mp_cancel *cancel;
+    struct demuxer_params params;
+    struct demuxer *demuxer;
+    struct mp_waiter waiter;
+};
+
+// Called locked. Returns NULL if the file should not be opened at all.
+static struct external_load *external_load_new(struct MPContext *mpctx,
+                                               void *ta_parent, char *filename,
+                                               enum stream_type filter,
+                                               struct mp_cancel *cancel,
+                                               enum track_flags flags)
 {
     struct MPOpts *opts = mpctx->opts;
     if (!filename || mp_cancel_test(cancel))
-        return -1;
-
-    void *unescaped_url = NULL;
-    char *disp_filename = filename;
-    if (strncmp(disp_filename, "memory://", 9) == 0) {
-        disp_filename = "memory://"; // avoid noise
-    } else if (mp_is_url(bstr0(disp_filename))) {
-        disp_filename = unescaped_url = mp_url_unescape(NULL, disp_filename);
-    }
+        return NULL;
 
-    struct demuxer_params params = {
-        .is_top_level = true,
-        .stream_flags = STREAM_ORIGIN_DIRECT,
-        .allow_playlist_create = false,
+    struct external_load *l = talloc_ptrtype(ta_parent, l);
+    *l = (struct external_load){
+        .mpctx = mpctx,
+        .filename = talloc_strdup(ta_parent, filename),
+        .filter = filter,
+        .flags = flags,
+        .cancel = cancel,
+        .params = {
+            .is_top_level = true,
+            .stream_flags = STREAM_ORIGIN_DIRECT,
+            .allow_playlist_create = false,
+        },
+        .waiter = MP_WAITER_INITIALIZER,
     };
 
+    if (strncmp(filename, "memory://", 9) == 0) {
+        l->disp_filename = "memory://"; // avoid noise
+    } else if (mp_is_url(bstr0(filename))) {
+        l->disp_filename = mp_url_unescape(ta_parent, filename);
+    } else {
+        l->disp_filename = l->filename;
+    }
+
     switch (filter) {
     case STREAM_SUB:
-        params.force_format = opts->sub_demuxer_name;
+        l->params.force_format = talloc_strdup(ta_parent, opts->sub_demuxer_name);
         break;
     case STREAM_AUDIO:
-        params.force_format = opts->audio_demuxer_name;
+        l->params.force_format = talloc_strdup(ta_parent, opts->audio_demuxer_name);
         break;
     }
 
-    mp_core_unlock(mpctx);
+    return l;
+}
 
-    char *path = mp_get_user_path(NULL, mpctx->global, filename);
-    struct demuxer *demuxer =
-        demux_open_url(path, &params, cancel, mpctx->global);
+// Called unlocked, possibly on a worker thread. This does all the slow parts:
+// I/O, probing, and the demuxer's initial parsing (for subtitles this is
+// usually reading the whole file and converting its charset).
+static void external_load_open(void *p)
+{
+    struct external_load *l = p;
+    struct MPContext *mpctx = l->mpctx;
+
+    char *path = mp_get_user_path(NULL, mpctx->global, l->filename);
+    l->demuxer = demux_open_url(path, &l->params, l->cancel, mpctx->global);
     talloc_free(path);
 
-    if (demuxer)
-        enable_demux_thread(mpctx, demuxer);
+    if (l->demuxer)
+        enable_demux_thread(mpctx, l->demuxer);
 
-    mp_core_lock(mpctx);
+    mp_waiter_wakeup(&l->waiter, 0);
+}
+
+// Called locked. Add the tracks of the opened file; returns the index of the
+// first added track matching the filter, or -1.
+static int external_load_finish(struct MPContext *mpctx, struct external_load *l)
+{
+    struct MPOpts *opts = mpctx->opts;
+    struct demuxer *demuxer = l->demuxer;
+    enum stream_type filter = l->filter;
+    l->demuxer = NULL;
 
     // The command could have overlapped with playback exiting. (We don't care
     // if playback has started again meanwhile - weird, but not a problem.)
@@ -891,7 +930,7 @@ int mp_add_external_file(struct MPContext *mpctx, char *filename,
         char *tname = mp_tprintf(20, "%s ", stream_type_name(filter));
         if (filter == STREAM_TYPE_COUNT)
             tname = "";
-        MP_ERR(mpctx, "No %sstreams in file %s.\n", tname, disp_filename);
+        MP_ERR(mpctx, "No %sstreams in file %s.\n", tname, l->disp_filename);
         goto err_out;
     }
 
@@ -906,50 +945,107 @@ int mp_add_external_file(struct MPContext *mpctx, char *filename,
             bstr parent = {0};
             if (mpctx->filename)
                 parent = bstr_strip_ext(bstr0(mp_basename(mpctx->filename)));
-            bstr title = bstr0(mp_basename(disp_filename));
+            bstr title = bstr0(mp_basename(l->disp_filename));
             bstr_eatstart(&title, parent);
             bstr_eatstart(&title, bstr0("."));
             if (title.len)
                 t->title = bstrdup0(t, title);
         }
-        t->external_filename = mp_normalize_user_path(t, mpctx->global, filename);
+        t->external_filename = mp_normalize_user_path(t, mpctx->global, l->filename);
         t->no_default = sh->type != filter;
         t->no_auto_select = t->no_default;
-        t->hearing_impaired_track = flags & TRACK_HEARING_IMPAIRED;
-        t->visual_impaired_track = flags & TRACK_VISUAL_IMPAIRED;
-        t->forced_track = flags & TRACK_FORCED;
-        t->default_track = flags & TRACK_DEFAULT;
+        t->hearing_impaired_track = l->flags & TRACK_HEARING_IMPAIRED;
+        t->visual_impaired_track = l->flags & TRACK_VISUAL_IMPAIRED;
+        t->forced_track = l->flags & TRACK_FORCED;
+        t->default_track = l->flags & TRACK_DEFAULT;
         // if we found video, and we are loading cover art, flag as such.
-        t->attached_picture = t->type == STREAM_VIDEO && (flags & TRACK_ATTACHED_PICTURE);
+        t->attached_picture = t->type == STREAM_VIDEO && (l->flags & TRACK_ATTACHED_PICTURE);
         if (first_num < 0 && (filter == STREAM_TYPE_COUNT || sh->type == filter))
             first_num = mpctx->num_tracks - 1;
     }
 
     mp_cancel_set_parent(demuxer->cancel, mpctx->playback_abort);
 
-    talloc_free(unescaped_url);
     return first_num;
 
 err_out:
     demux_cancel_and_free(demuxer);
-    if (!mp_cancel_test(cancel))
-        MP_ERR(mpctx, "Can not open external file %s.\n", disp_filename);
-    talloc_free(unescaped_url);
+    if (!mp_cancel_test(l->cancel))
+        MP_ERR(mpctx, "Can not open external file %s.\n", l->disp_filename);
     return -1;
 }
 
+// Open all files in parallel (temporarily unlocks core). Each one is opened on
+// a separate thread of the core's thread pool if one is available, otherwise
+// on the calling thread. The tracks are added in the order of the array
+// afterwards, so the result does not depend on which file was opened first.
+static void external_load_all(struct MPContext *mpctx, struct external_load **l,
+                              int num)
+{
+    if (!num)
+        return;
+
+    bool *async = talloc_zero_array(NULL, bool, num);
+
+    mp_core_unlock(mpctx);
+
+    // The last file is always opened on this thread, which is busy anyway.
+    for (int n = 0; n < num - 1; n++)
+        async[n] = mp_thread_pool_run(mpctx->thread_pool, external_load_open, l[n]);
+    for (int n = 0; n < num; n++) {
+        if (!async[n])
+            external_load_open(l[n]);
+    }
+    for (int n = 0; n < num; n++)
+        mp_waiter_wait(&l[n]->waiter);
+
+    mp_core_lock(mpctx);
+
+    talloc_free(async);
+}
+
+// Add the given file as additional track. The filter argument controls how or
+// if tracks are auto-selected at any point.
+// To be run on a worker thread, locked (temporarily unlocks core).
+// cancel will generally be used to abort the loading process, but on success
+// the demuxer is changed to be slaved to mpctx->playback_abort instead.
+int mp_add_external_file(struct MPContext *mpctx, char *filename,
+                         enum stream_type filter, struct mp_cancel *cancel,
+                         enum track_flags flags)
+{
+    void *tmp = talloc_new(NULL);
+    struct external_load *l =
+        external_load_new(mpctx, tmp, filename, filter, cancel, flags);
+    int first = -1;
+    if (l) {
+        external_load_all(mpctx, &l, 1);
+        first = external_load_finish(mpctx, l);
+    }
+    talloc_free(tmp);
+    return first;
+}
+
 // to be run on a worker thread, locked (temporarily unlocks core)
 static void open_external_files(struct MPContext *mpctx, char **files,
                                 enum stream_type filter)
 {
-    // Need a copy, because the option value could be mutated during iteration.
     void *tmp = talloc_new(NULL);
-    files = mp_dup_str_array(tmp, files);
+    struct external_load **loads = NULL;
+    int num_loads = 0;
 
-    for (int n = 0; files && files[n]; n++)
-        // when given filter is set to video, we are loading up cover art
-        mp_add_external_file(mpctx, files[n], filter, mpctx->playback_abort,
-                             filter == STREAM_VIDEO ? TRACK_ATTACHED_PICTURE : 0);
+    // when given filter is set to video, we are loading up cover art
+    enum track_flags flags = filter == STREAM_VIDEO ? TRACK_ATTACHED_PICTURE : 0;
+    for (int n = 0; files && files[n]; n++) {
+        struct external_load *l = external_load_new(mpctx, tmp, files[n], filter,
+                                                    mpctx->playback_abort, flags);
+        if (l)
+            MP_TARRAY_APPEND(tmp, loads, num_loads, l);
+    }
+
+    external_load_all(mpctx, loads, num_loads);
+
+    for (int n = 0; n < num_loads; n++)
+        external_load_finish(mpctx, loads[n]);
 
     talloc_free(tmp);
 }
@@ -974,6 +1070,11 @@ void autoload_external_files(struct MPContext *mpctx, struct mp_cancel *cancel)
             sc[mpctx->tracks[n]->type]++;
     }
 
+    struct external_load **loads = NULL;
+    int num_loads = 0;
+    struct subfn **entries = NULL;
+    int num_entries = 0;
+
     for (int i = 0; list && list[i].fname; i++) {
         struct subfn *e = &list[i];
 
@@ -982,6 +1083,11 @@ void autoload_external_files(struct MPContext *mpctx, struct mp_cancel *cancel)
             if (t->demuxer && strcmp(t->demuxer->filename, e->fname) == 0)
                 goto skip;
         }
+        // (Files are added only after all of them were opened.)
+        for (int n = 0; n < num_loads; n++) {
+            if (strcmp(loads[n]->filename, e->fname) == 0)
+                goto skip;
+        }
         if (e->type == STREAM_SUB && !sc[STREAM_VIDEO] && !sc[STREAM_AUDIO])
             goto skip;
         if (e->type == STREAM_AUDIO && !sc[STREAM_VIDEO])
@@ -992,17 +1098,28 @@ void autoload_external_files(struct MPContext *mpctx, struct mp_cancel *cancel)
         enum track_flags flags = e->flags;
         // when given filter is set to video, we are loading up cover art
         flags |= e->type == STREAM_VIDEO ? TRACK_ATTACHED_PICTURE : 0;
-        int first = mp_add_external_file(mpctx, e->fname, e->type, cancel, flags);
-        if (first < 0)
+        struct external_load *l =
+            external_load_new(mpctx, tmp, e->fname, e->type, cancel, flags);
+        if (!l)
             goto skip;
+        MP_TARRAY_APPEND(tmp, loads, num_loads, l);
+        MP_TARRAY_APPEND(tmp, entries, num_entries, e);
+    skip:;
+    }
+
+    external_load_all(mpctx, loads, num_loads);
+
+    for (int i = 0; i < num_loads; i++) {
+        int first = external_load_finish(mpctx, loads[i]);
+        if (first < 0)
+            continue;
 
         for (int n = first; n < mpctx->num_tracks; n++) {
             struct track *t = mpctx->tracks[n];
             t->auto_loaded = true;
             if (!t->lang)
-                t->lang = talloc_strdup(t, e->lang);
+                t->lang = talloc_strdup(t, entries[i]->lang);
         }
-    skip:;
     }
 
     talloc_free(tmp);
@@ -1058,6 +1175,139 @@ static void transfer_playlist(struct MPContext *mpctx, struct playlist *pl,
     }
 }
 
+// Number of entries the playlist loader adds at once.
+#define PLAYLIST_LOADER_BATCH 1000
+
+struct playlist_loader {
+    struct MPContext *mpctx;
+    struct demuxer *demuxer;
+    char *playlist_path;
+    // Last entry added from the file; further entries are inserted after it.
+    // It's reserved, so that its removal can be detected.
+    struct playlist_entry *anchor;
+    mp_thread thread;
+
+    mp_mutex lock;
+    // --- Protected by lock
+    struct playlist *pending;   // entries read, but not added yet
+    bool done;                  // end of file reached, thread exited
+};
+
+static MP_THREAD_VOID playlist_loader_thread(void *ctx)
+{
+    struct playlist_loader *l = ctx;
+
+    mp_thread_set_name("playlist");
+
+    bool more = true;
+    while (more) {
+        struct playlist *pl = talloc_zero(NULL, struct playlist);
+        more = demux_playlist_read_more(l->demuxer, pl, PLAYLIST_LOADER_BATCH);
+        mp_mutex_lock(&l->lock);
+        playlist_append_entries(l->pending, pl);
+        l->done = !more;
+        mp_mutex_unlock(&l->lock);
+        talloc_free(pl);
+        mp_wakeup_core(l->mpctx);
+    }
+
+    MP_THREAD_RETURN();
+}
+
+// Read the rest of the playlist file opened by mpctx->demuxer in the
+// background. anchor is the last entry that was added from it.
+static void start_playlist_loader(struct MPContext *mpctx,
+                                  struct playlist_entry *anchor)
+{
+    mp_assert(!mpctx->playlist_loader);
+
+    struct playlist_loader *l = talloc_zero(NULL, struct playlist_loader);
+    l->mpctx = mpctx;
+    l->demuxer = mpctx->demuxer;
+    l->playlist_path = talloc_strdup(l, mpctx->filename);
+    l->pending = talloc_zero(l, struct playlist);
+    mp_mutex_init(&l->lock);
+
+    // Reading continues after playback of the playlist file ends.
+    mp_cancel_set_parent(l->demuxer->cancel, NULL);
+
+    if (mp_thread_create(&l->thread, playlist_loader_thread, l)) {
+        MP_ERR(mpctx, "Could not read the rest of the playlist.\n");
+        mp_mutex_destroy(&l->lock);
+        talloc_free(l);
+        return;
+    }
+
+    l->anchor = anchor;
+    anchor->reserved += 1;
+    mpctx->demuxer = NULL;
+    mpctx->playlist_loader = l;
+}
+
+static void stop_playlist_loader(struct MPContext *mpctx)
+{
+    struct playlist_loader *l = mpctx->playlist_loader;
+    if (!l)
+        return;
+
+    mp_cancel_trigger(l->demuxer->cancel);
+    mp_thread_join(l->thread);
+    demux_free(l->demuxer);
+    playlist_entry_unref(l->anchor);
+    mp_mutex_destroy(&l->lock);
+    talloc_free(l);
+    mpctx->playlist_loader = NULL;
+}
+
+// Add the entries read by the playlist loader to the playlist.
+void update_playlist_loader(struct MPContext *mpctx)
+{
+    struct playlist_loader *l = mpctx->playlist_loader;
+    if (!l)
+        return;
+
+    if (l->anchor->pl != mpctx->playlist) {
+        MP_VERBOSE(mpctx, "Playlist was changed, stop reading playlist file.\n");
+        stop_playlist_loader(mpctx);
+        return;
+    }
+
+    mp_mutex_lock(&l->lock);
+    struct playlist_entry *last = playlist_get_last(l->pending);
+    if (last) {
+        playlist_populate_playlist_path(l->pending, l->playlist_path);
+        int index = playlist_entry_to_index(mpctx->playlist, l->anchor) + 1;
+        playlist_transfer_entries_to(mpctx->playlist, index, l->pending);
+        last->reserved += 1;
+        playlist_entry_unref(l->anchor);
+        l->anchor = last;
+        mp_notify_property(mpctx, "playlist");
+    }
+    bool done = l->done;
+    mp_mutex_unlock(&l->lock);
+
+    if (done) {
+        MP_VERBOSE(mpctx, "Done reading playlist file.\n");
+        stop_playlist_loader(mpctx);
+    }
+}
+
+static bool stop_play_next_entry(struct MPContext *mpctx)
+{
+    return mpctx->stop_play == PT_NEXT_ENTRY || mpctx->stop_play == PT_ERROR ||
+           mpctx->stop_play == AT_END_OF_FILE;
+}
+
+// If the last entry read so far from a playlist file was played, wait for the
+// following entries, so that playback doesn't end early. Returns early if the
+// user decides something else (quit, stop, or playing a specific entry).
+static void wait_playlist_loader(struct MPContext *mpctx)
+{
+    while (mpctx->playlist_loader && stop_play_next_entry(mpctx) &&
+           mpctx->playlist->current == mpctx->playlist_loader->anchor)
+        mp_idle(mpctx);
+}
+
 static void process_hooks(struct MPContext *mpctx, char *name)
 {
     mp_hook_start(mpctx, name);
@@ -1120,28 +1370,53 @@ static void load_per_file_options(m_config_t *conf,
     }
 }
 
-static MP_THREAD_VOID open_demux_thread(void *ctx)
+// Upper bound of --prefetch-playlist-entries.
+#define MAX_PREFETCH_ENTRIES 16
+
+// An asynchronous open of a URL on the thread pool, either for playback of
+// the current playlist entry, or for prefetching one of the next entries.
+struct mp_opener {
+    struct MPContext *mpctx;
+    // --- Immutable while the opener is queued or running.
+    struct mp_cancel *cancel;
+    char *url;
+    char *format;
+    int url_flags;
+    int playlist_entries;
+    bool allow_playlist_create;
+    bool for_prefetch;
+    uint64_t opts_gen; // MPContext.demuxer_opts_gen at start
+    // --- Protected by lock.
+    mp_mutex lock;
+    mp_cond wakeup;
+    bool done;
+    int64_t cache_limit; // for demux_set_cache_limit()
+    // --- Owned by the worker, unless done was set to true.
+    struct demuxer *res_demuxer;
+    int res_error;
+};
+
+static void open_demux_work(void *ctx)
 {
-    struct MPContext *mpctx = ctx;
-
-    mp_thread_set_name("opener");
+    struct mp_opener *op = ctx;
+    struct MPContext *mpctx = op->mpctx;
 
     struct demuxer_params p = {
-        .force_format = mpctx->open_format,
-        .stream_flags = mpctx->open_url_flags,
+        .force_format = op->format,
+        .stream_flags = op->url_flags,
         .stream_record = true,
         .is_top_level = true,
-        .allow_playlist_create = mpctx->playlist->num_entries <= 1 &&
-                                 !mpctx->playlist->playlist_dir,
+        .allow_playlist_create = op->allow_playlist_create,
+        .playlist_entries = op->playlist_entries,
     };
     struct demuxer *demux =
-        demux_open_url(mpctx->open_url, &p, mpctx->open_cancel, mpctx->global);
-    mpctx->open_res_demuxer = demux;
+        demux_open_url(op->url, &p, op->cancel, mpctx->global);
+    op->res_demuxer = demux;
 
     if (demux) {
-        MP_VERBOSE(mpctx, "Opening done: %s\n", mpctx->open_url);
+        MP_VERBOSE(mpctx, "Opening done: %s\n", op->url);
 
-        if (mpctx->open_for_prefetch && !demux->fully_read) {
+        if (op->for_prefetch && !demux->fully_read) {
             int num_streams = demux_get_num_stream(demux);
             for (int n = 0; n < num_streams; n++) {
                 struct sh_stream *sh = demux_get_stream(demux, n);
@@ -1150,139 +1425,288 @@ static MP_THREAD_VOID open_demux_thread(void *ctx)
 
             demux_set_wakeup_cb(demux, wakeup_demux, mpctx);
             demux_start_thread(demux);
-            demux_start_prefetch(demux);
         }
     } else {
-        MP_VERBOSE(mpctx, "Opening failed or was aborted: %s\n", mpctx->open_url);
+        MP_VERBOSE(mpctx, "Opening failed or was aborted: %s\n", op->url);
 
         if (p.demuxer_failed) {
-            mpctx->open_res_error = MPV_ERROR_UNKNOWN_FORMAT;
+            op->res_error = MPV_ERROR_UNKNOWN_FORMAT;
         } else {
-            mpctx->open_res_error = MPV_ERROR_LOADING_FAILED;
+            op->res_error = MPV_ERROR_LOADING_FAILED;
         }
     }
 
-    atomic_store(&mpctx->open_done, true);
+    // The cache limit can change until the demuxer is handed over.
+    mp_mutex_lock(&op->lock);
+    if (demux && op->for_prefetch && !demux->fully_read) {
+        demux_set_cache_limit(demux, op->cache_limit);
+        demux_start_prefetch(demux);
+    }
+    op->done = true;
+    mp_cond_signal(&op->wakeup);
+    mp_mutex_unlock(&op->lock);
     mp_wakeup_core(mpctx);
-    MP_THREAD_RETURN();
 }
 
-static void cancel_open(struct MPContext *mpctx)
+static bool opener_done(struct mp_opener *op)
 {
-    if (mpctx->open_cancel)
-        mp_cancel_trigger(mpctx->open_cancel);
+    mp_mutex_lock(&op->lock);
+    bool done = op->done;
+    mp_mutex_unlock(&op->lock);
+    return done;
+}
 
-    if (mpctx->open_active)
-        mp_thread_join(mpctx->open_thread);
-    mpctx->open_active = false;
+// Abort the opener if it's still running, and free it and its result.
+static void free_opener(struct mp_opener *op)
+{
+    mp_cancel_trigger(op->cancel);
 
-    if (mpctx->open_res_demuxer)
-        demux_cancel_and_free(mpctx->open_res_demuxer);
-    mpctx->open_res_demuxer = NULL;
+    mp_mutex_lock(&op->lock);
+    while (!op->done)
+        mp_cond_wait(&op->wakeup, &op->lock);
+    mp_mutex_unlock(&op->lock);
 
-    TA_FREEP(&mpctx->open_cancel);
-    TA_FREEP(&mpctx->open_url);
-    TA_FREEP(&mpctx->open_format);
+    if (op->res_demuxer)
+        demux_cancel_and_free(op->res_demuxer);
 
-    atomic_store(&mpctx->open_done, false);
+    mp_cond_destroy(&op->wakeup);
+    mp_mutex_destroy(&op->lock);
+    talloc_free(op);
 }
 
-// Setup all the field to open this url, and make sure a thread is running.
-static void start_open(struct MPContext *mpctx, char *url, int url_flags,
-                       bool for_prefetch)
+// Remove the opener of the given URL from the list and return it, or NULL.
+static struct mp_opener *take_opener(struct MPContext *mpctx, const char *url)
 {
-    cancel_open(mpctx);
+    for (int n = 0; n < mpctx->num_openers; n++) {
+        struct mp_opener *op = mpctx->openers[n];
+        if (strcmp(op->url, url) == 0) {
+            MP_TARRAY_REMOVE_AT(mpctx->openers, mpctx->num_openers, n);
+            return op;
+        }
+    }
+    return NULL;
+}
+
+// Free the dropped openers which are done.
+static void reap_dropped_openers(struct MPContext *mpctx)
+{
+    for (int n = mpctx->num_dropped_openers - 1; n >= 0; n--) {
+        struct mp_opener *op = mpctx->dropped_openers[n];
+        if (opener_done(op)) {
+            MP_TARRAY_REMOVE_AT(mpctx->dropped_openers,
+                                mpctx->num_dropped_openers, n);
+            free_opener(op);
+        }
+    }
+}
 
-    mp_assert(!mpctx->open_active);
-    mp_assert(!mpctx->open_cancel);
-    mp_assert(!mpctx->open_res_demuxer);
-    mp_assert(!atomic_load(&mpctx->open_done));
+// Abort the opener without waiting for it. It's freed later by
+// reap_dropped_openers() or cancel_open().
+static void drop_opener(struct MPContext *mpctx, struct mp_opener *op)
+{
+    mp_cancel_trigger(op->cancel);
+    MP_TARRAY_APPEND(mpctx, mpctx->dropped_openers, mpctx->num_dropped_openers,
+                     op);
+    reap_dropped_openers(mpctx);
+}
 
-    mpctx->open_cancel = mp_cancel_new(NULL);
-    mpctx->open_url = talloc_strdup(NULL, url);
-    mpctx->open_format = talloc_strdup(NULL, mpctx->opts->demuxer_name);
-    mpctx->open_url_flags = url_flags;
-    mpctx->open_for_prefetch = for_prefetch && mpctx->opts->demuxer_thread;
-    mpctx->demuxer_changed = false;
+static void cancel_open(struct MPContext *mpctx)
+{
+    for (int n = 0; n < mpctx->num_openers; n++)
+        drop_opener(mpctx, mpctx->openers[n]);
+    mpctx->num_openers = 0;
+    for (int n = 0; n < mpctx->num_dropped_openers; n++)
+        free_opener(mpctx->dropped_openers[n]);
+    mpctx->num_dropped_openers = 0;
+}
 
-    if (mp_thread_create(&mpctx->open_thread, open_demux_thread, mpctx)) {
-        cancel_open(mpctx);
+// Drop openers which were started before demuxer options changed.
+static void drop_stale_openers(struct MPContext *mpctx)
+{
+    for (int n = mpctx->num_openers - 1; n >= 0; n--) {
+        struct mp_opener *op = mpctx->openers[n];
+        if (op->opts_gen != mpctx->demuxer_opts_gen) {
+            MP_VERBOSE(mpctx, "Dropping prefetch of %s because demuxer "
+                       "options changed.\n", op->url);
+            MP_TARRAY_REMOVE_AT(mpctx->openers, mpctx->num_openers, n);
+            drop_opener(mpctx, op);
+        }
+    }
+}
+
+// Setup an opener for this url, and queue it on the thread pool. The caller
+// takes ownership. Returns NULL on failure.
+static struct mp_opener *start_open(struct MPContext *mpctx, char *url,
+                                    int url_flags, bool for_prefetch)
+{
+    struct MPOpts *opts = mpctx->opts;
+
+    struct mp_opener *op = talloc_zero(NULL, struct mp_opener);
+    *op = (struct mp_opener){
+        .mpctx = mpctx,
+        .cancel = mp_cancel_new(op),
+        .url = talloc_strdup(op, url),
+        .format = talloc_strdup(op, opts->demuxer_name),
+        .url_flags = url_flags,
+        .allow_playlist_create = mpctx->playlist->num_entries <= 1 &&
+                                 !mpctx->playlist->playlist_dir,
+        .for_prefetch = for_prefetch && opts->demuxer_thread,
+        .opts_gen = mpctx->demuxer_opts_gen,
+    };
+    mp_mutex_init(&op->lock);
+    mp_cond_init(&op->wakeup);
+    // Playlist files are read incrementally only if their entries are played
+    // in order, starting with the first one.
+    bool reorder = opts->shuffle || opts->merge_files || opts->playlist_pos >= 0;
+    op->playlist_entries = reorder || mpctx->playlist_loader ? 0 :
+                           opts->playlist_initial_entries;
+
+    if (!mp_thread_pool_queue(mpctx->thread_pool, open_demux_work, op)) {
+        op->done = true;
+        free_opener(op);
+        return NULL;
+    }
+
+    return op;
+}
+
+// Return the entries after the current one which should be prefetched.
+static int get_prefetch_entries(struct MPContext *mpctx,
+                                struct playlist_entry **entries)
+{
+    struct MPOpts *opts = mpctx->opts;
+    if (!opts->prefetch_open)
+        return 0;
+
+    int num = 0;
+    struct playlist_entry *e = mp_next_file(mpctx, +1, false, false);
+    while (e && num < opts->prefetch_entries) {
+        entries[num++] = e;
+        e = playlist_entry_get_rel(e, 1);
+    }
+    return num;
+}
+
+// Split the prefetch cache budget evenly between the prefetched demuxers.
+static void update_prefetch_budget(struct MPContext *mpctx)
+{
+    int64_t budget = mpctx->opts->prefetch_max_bytes;
+    if (!budget || !mpctx->num_openers)
         return;
+
+    int64_t max_bytes = MPMAX(budget / mpctx->num_openers, 1);
+    MP_DBG(mpctx, "Prefetch cache limit: %"PRId64" bytes for each of %d "
+           "entries.\n", max_bytes, mpctx->num_openers);
+    for (int n = 0; n < mpctx->num_openers; n++) {
+        struct mp_opener *op = mpctx->openers[n];
+        mp_mutex_lock(&op->lock);
+        op->cache_limit = max_bytes;
+        if (op->done && op->res_demuxer)
+            demux_set_cache_limit(op->res_demuxer, max_bytes);
+        mp_mutex_unlock(&op->lock);
     }
+}
 
-    mpctx->open_active = true;
+// Drop prefetched entries which are not going to be played next anymore. The
+// current entry is kept too, since it's the one about to be opened if the user
+// switched to it while it was being prefetched.
+void prune_prefetch(struct MPContext *mpctx)
+{
+    reap_dropped_openers(mpctx);
+    if (!mpctx->num_openers)
+        return;
+
+    struct playlist_entry *entries[MAX_PREFETCH_ENTRIES + 1];
+    int num_entries = get_prefetch_entries(mpctx, entries);
+    if (mpctx->playlist->current)
+        entries[num_entries++] = mpctx->playlist->current;
+
+    for (int n = mpctx->num_openers - 1; n >= 0; n--) {
+        struct mp_opener *op = mpctx->openers[n];
+        bool keep = false;
+        for (int i = 0; i < num_entries; i++) {
+            char *filename = entries[i]->filename;
+            keep |= filename && strcmp(filename, op->url) == 0;
+        }
+        if (!keep) {
+            MP_VERBOSE(mpctx, "Dropping prefetch of %s\n", op->url);
+            MP_TARRAY_REMOVE_AT(mpctx->openers, mpctx->num_openers, n);
+            drop_opener(mpctx, op);
+        }
+    }
+    update_prefetch_budget(mpctx);
 }
 
 static void open_demux_reentrant(struct MPContext *mpctx)
 {
     char *url = mpctx->stream_open_filename;
 
-    if (mpctx->open_active) {
-        bool done = atomic_load(&mpctx->open_done);
-        bool failed = done && !mpctx->open_res_demuxer;
-        bool correct_url = strcmp(mpctx->open_url, url) == 0;
+    drop_stale_openers(mpctx);
 
-        if (correct_url && !mpctx->demuxer_changed && !failed) {
-            MP_VERBOSE(mpctx, "Using prefetched/prefetching URL.\n");
-        } else {
-            if (correct_url && failed) {
-                MP_VERBOSE(mpctx, "Prefetched URL failed, retrying.\n");
-            } else if (mpctx->demuxer_changed) {
-                if (done) {
-                    MP_VERBOSE(mpctx, "Dropping finished prefetch because demuxer options changed.\n");
-                } else {
-                    MP_VERBOSE(mpctx, "Aborting ongoing prefetch because demuxer options changed.\n");
-                }
-            } else {
-                if (done) {
-                    MP_VERBOSE(mpctx, "Dropping finished prefetch of wrong URL.\n");
-                } else {
-                    MP_VERBOSE(mpctx, "Aborting ongoing prefetch of wrong URL.\n");
-                }
-            }
-            cancel_open(mpctx);
-        }
+    struct mp_opener *op = take_opener(mpctx, url);
+    if (op && opener_done(op) && !op->res_demuxer) {
+        MP_VERBOSE(mpctx, "Prefetched URL failed, retrying.\n");
+        free_opener(op);
+        op = NULL;
+    } else if (op) {
+        MP_VERBOSE(mpctx, "Using prefetched/prefetching URL.\n");
     }
+    prune_prefetch(mpctx);
 
-    if (!mpctx->open_active)
-        start_open(mpctx, url, mpctx->playing->stream_flags, false);
+    if (!op)
+        op = start_open(mpctx, url, mpctx->playing->stream_flags, false);
 
-    // If thread failed to start, cancel the playback
-    if (!mpctx->open_active)
-        goto cancel;
+    // If the opener failed to start, cancel the playback
+    if (!op)
+        return;
 
     // User abort should cancel the opener now.
-    mp_cancel_set_parent(mpctx->open_cancel, mpctx->playback_abort);
+    mp_cancel_set_parent(op->cancel, mpctx->playback_abort);
 
-    while (!atomic_load(&mpctx->open_done)) {
+    while (!opener_done(op)) {
         mp_idle(mpctx);
 
         if (mpctx->stop_play)
             mp_abort_playback_async(mpctx);
     }
 
-    if (mpctx->open_res_demuxer) {
-        mpctx->demuxer = mpctx->open_res_demuxer;
-        mpctx->open_res_demuxer = NULL;
+    if (op->res_demuxer) {
+        mpctx->demuxer = op->res_demuxer;
+        op->res_demuxer = NULL;
+        demux_set_cache_limit(mpctx->demuxer, 0);
         mp_cancel_set_parent(mpctx->demuxer->cancel, mpctx->playback_abort);
     } else {
-        mpctx->error_playing = mpctx->open_res_error;
+        mpctx->error_playing = op->res_error;
     }
 
-cancel:
-    cancel_open(mpctx); // cleanup
+    free_opener(op); // cleanup
 }
 
 void prefetch_next(struct MPContext *mpctx)
 {
-    if (!mpctx->opts->prefetch_open || mpctx->open_active)
-        return;
-
-    struct playlist_entry *new_entry = mp_next_file(mpctx, +1, false, false);
-    if (new_entry && new_entry->filename) {
-        MP_VERBOSE(mpctx, "Prefetching: %s\n", new_entry->filename);
-        start_open(mpctx, new_entry->filename, new_entry->stream_flags, true);
-    }
+    struct playlist_entry *entries[MAX_PREFETCH_ENTRIES];
+    int num_entries = get_prefetch_entries(mpctx, entries);
+
+    int num_openers = mpctx->num_openers;
+    drop_stale_openers(mpctx);
+    bool changed = num_openers != mpctx->num_openers;
+    for (int n = 0; n < num_entries; n++) {
+        struct playlist_entry *e = entries[n];
+        if (!e->filename)
+            continue;
+        bool found = false;
+        for (int i = 0; i < mpctx->num_openers; i++)
+            found |= strcmp(mpctx->openers[i]->url, e->filename) == 0;
+        if (found)
+            continue;
+        MP_VERBOSE(mpctx, "Prefetching: %s\n", e->filename);
+        struct mp_opener *op = start_open(mpctx, e->filename, e->stream_flags, true);
+        if (op)
+            MP_TARRAY_APPEND(mpctx, mpctx->openers, mpctx->num_openers, op);
+        changed = true;
+    }
+    if (changed)
+        prune_prefetch(mpctx);
 }
 
 static void clear_playlist_paths(struct MPContext *mpctx)
@@ -1294,7 +1718,7 @@ static void clear_playlist_paths(struct MPContext *mpctx)
 static bool infinite_playlist_loading_loop(struct MPContext *mpctx, struct playlist *pl)
 {
     if (pl->num_entries) {
-        struct playlist_entry *e = pl->entries[0];
+        struct playlist_entry *e = playlist_get_first(pl);
         for (int n = 0; n < mpctx->playlist_paths_len; n++) {
             if (strcmp(mpctx->playlist_paths[n], e->filename) == 0) {
                 clear_playlist_paths(mpctx);
@@ -1751,15 +2175,21 @@ static void play_current_file(struct MPContext *mpctx)
         // the parent file. In this case, mpctx->filename points to real file.
         if (watch_later && !pl->playlist_dir)
             mp_delete_watch_later_conf(mpctx, mpctx->filename);
+        // Only one playlist file is read in the background at a time.
+        if (mpctx->playlist_loader)
+            demux_playlist_read_more(mpctx->demuxer, pl, 0);
         playlist_populate_playlist_path(pl, mpctx->filename);
         if (infinite_playlist_loading_loop(mpctx, pl)) {
             mpctx->stop_play = PT_STOP;
             MP_ERR(mpctx, "Infinite playlist loading loop detected.\n");
             goto terminate_playback;
         }
+        struct playlist_entry *last = playlist_get_last(pl);
         transfer_playlist(mpctx, pl, &end_event.playlist_insert_id,
                           &end_event.playlist_insert_num_entries);
         mp_notify_property(mpctx, "playlist");
+        if (mpctx->demuxer->playlist_incomplete && last)
+            start_playlist_loader(mpctx, last);
         mpctx->error_playing = 2;
         goto terminate_playback;
     }
@@ -2063,11 +2493,9 @@ struct playlist_entry *mp_next_file(struct MPContext *mpctx, int direction,
         if (!force && next && next->init_failed && !ignore_failures) {
             // Don't endless loop if no file in playlist is playable
             bool all_failed = true;
-            for (int n = 0; n < mpctx->playlist->num_entries; n++) {
-                all_failed &= mpctx->playlist->entries[n]->init_failed;
-                if (!all_failed)
-                    break;
-            }
+            for (struct playlist_entry *e = playlist_get_first(mpctx->playlist);
+                 e && all_failed; e = playlist_entry_get_rel(e, 1))
+                all_failed &= e->init_failed;
             if (all_failed)
                 next = NULL;
         }
@@ -2103,13 +2531,14 @@ void mp_play_files(struct MPContext *mpctx)
         if (mpctx->playlist->current)
             play_current_file(mpctx);
 
+        // This can change stop_play, so do it before deciding what to play.
+        wait_playlist_loader(mpctx);
+
         if (mpctx->stop_play == PT_QUIT)
             break;
 
         struct playlist_entry *new_entry = NULL;
-        if (mpctx->stop_play == PT_NEXT_ENTRY || mpctx->stop_play == PT_ERROR ||
-            mpctx->stop_play == AT_END_OF_FILE)
-        {
+        if (stop_play_next_entry(mpctx)) {
             new_entry = mp_next_file(mpctx, +1, false, true);
         } else if (mpctx->stop_play == PT_CURRENT_ENTRY) {
             new_entry = mpctx->playlist->current;
@@ -2127,6 +2556,7 @@ void mp_play_files(struct MPContext *mpctx)
     }
 
     cancel_open(mpctx);
+    stop_playlist_loader(mpctx);
 
     if (mpctx->encode_lavc_ctx) {
         // Make sure all streams get finished.
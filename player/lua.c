@@ -25,6 +25,9 @@
 #include <lualib.h>
 #include <lauxlib.h>
 
+#include <libavutil/mem.h>
+#include <libavutil/sha.h>
+
 #include "osdep/io.h"
 
 #include "mpv_talloc.h"
@@ -38,7 +41,9 @@
 #include "input/input.h"
 #include "options/path.h"
 #include "misc/bstr.h"
+#include "misc/io_utils.h"
 #include "misc/json.h"
+#include "misc/path_utils.h"
 #include "osdep/subprocess.h"
 #include "osdep/timer.h"
 #include "osdep/threads.h"
@@ -110,6 +115,8 @@ struct script_ctx {
     lua_Alloc lua_allocf;
     void *lua_alloc_ud;
     struct stats_ctx *stats;
+    struct mp_script_profile *profile;
+    const char *cache_dir; // for compiled chunks, or NULL
 };
 
 #if LUA_VERSION_NUM <= 501
@@ -257,6 +264,95 @@ static int check_error(lua_State *L, int err)
 
 static void add_functions(struct script_ctx *ctx);
 
+#define BYTECODE_CACHE_HEADER "mpv lua bytecode v1\n"
+
+static void sha256(uint8_t hash[32], const char *data, size_t len)
+{
+    struct AVSHA *sha = av_sha_alloc();
+    MP_HANDLE_OOM(sha);
+    av_sha_init(sha, 256);
+    av_sha_update(sha, data, len);
+    av_sha_final(sha, hash);
+    av_free(sha);
+}
+
+// Each chunk has a single cache file, which is overwritten when its source
+// changes.
+static char *bytecode_cache_file(void *ta_parent, struct script_ctx *ctx,
+                                 const char *chunkname)
+{
+    char *key = talloc_asprintf(NULL, "%s\n%s", LUA_RELEASE, chunkname);
+    uint8_t hash[32];
+    sha256(hash, key, strlen(key));
+    talloc_free(key);
+
+    char hashstr[17];
+    for (int n = 0; n < 8; n++)
+        snprintf(hashstr + n * 2, sizeof(hashstr) - n * 2, "%02x", hash[n]);
+    return mp_path_join(ta_parent, ctx->cache_dir,
+                        mp_tprintf(40, "lua_%s", hashstr));
+}
+
+static int bytecode_writer(lua_State *L, const void *p, size_t sz, void *ud)
+{
+    bstr *buf = ud;
+    bstr_xappend(NULL, buf, (bstr){(unsigned char *)p, sz});
+    return 0;
+}
+
+// Like luaL_loadbuffer(), but use and update the bytecode cache if enabled.
+static int load_chunk(lua_State *L, const char *src, size_t len,
+                      const char *chunkname)
+{
+    struct script_ctx *ctx = get_ctx(L);
+    int64_t start = mp_time_ns();
+    int r = -1;
+
+    void *tmp = talloc_new(ctx);
+    char *cache_file = NULL;
+    uint8_t hash[32];
+    if (ctx->cache_dir) {
+        cache_file = bytecode_cache_file(tmp, ctx, chunkname);
+        sha256(hash, src, len);
+        bstr data = {0};
+        if (!stat(cache_file, &(struct stat){0}))
+            data = stream_read_file(cache_file, tmp, ctx->mpctx->global,
+                                    100000000);
+        if (bstr_eatstart0(&data, BYTECODE_CACHE_HEADER) && data.len > 32 &&
+            memcmp(data.start, hash, 32) == 0)
+        {
+            data = bstr_cut(data, 32);
+            r = luaL_loadbuffer(L, (char *)data.start, data.len, chunkname);
+            if (r) {
+                MP_WARN(ctx, "Ignoring broken cache file %s\n", cache_file);
+                lua_pop(L, 1);
+            } else {
+                MP_DBG(ctx, "Loaded %s from %s\n", chunkname, cache_file);
+            }
+        }
+    }
+
+    if (r) {
+        r = luaL_loadbuffer(L, src, len, chunkname);
+        if (!r && cache_file) {
+            bstr data = {0};
+            bstr_xappend(NULL, &data, bstr0(BYTECODE_CACHE_HEADER));
+            bstr_xappend(NULL, &data, (bstr){hash, 32});
+            if (!lua_dump(L, bytecode_writer, &data)) {
+                mp_mkdirp(ctx->cache_dir);
+                if (!mp_save_to_file(cache_file, data.start, data.len))
+                    MP_DBG(ctx, "Could not write %s\n", cache_file);
+            }
+            talloc_free(data.start);
+        }
+    }
+
+    talloc_free(tmp);
+    if (ctx->profile)
+        atomic_fetch_add(&ctx->profile->compile_ns, mp_time_ns() - start);
+    return r;
+}
+
 static void load_file(lua_State *L, const char *fname)
 {
     struct script_ctx *ctx = get_ctx(L);
@@ -267,7 +363,7 @@ static void load_file(lua_State *L, const char *fname)
     struct bstr s = stream_read_file(fname, tmp, ctx->mpctx->global, 100000000);
     if (!s.start)
         luaL_error(L, "Could not read file.\n");
-    if (luaL_loadbuffer(L, s.start, s.len, dispname))
+    if (load_chunk(L, s.start, s.len, dispname))
         lua_error(L);
     lua_call(L, 0, 1);
     talloc_free(tmp);
@@ -281,7 +377,7 @@ static int load_builtin(lua_State *L)
     for (int n = 0; builtin_lua_scripts[n][0]; n++) {
         if (strcmp(name, builtin_lua_scripts[n][0]) == 0) {
             const char *script = builtin_lua_scripts[n][1];
-            if (luaL_loadbuffer(L, script, strlen(script), dispname))
+            if (load_chunk(L, script, strlen(script), dispname))
                 lua_error(L);
             lua_call(L, 0, 1);
             return 1;
@@ -461,6 +557,8 @@ static int load_lua(struct mp_script_args *args)
         .path = args->path,
         .stats = stats_ctx_create(ctx, args->mpctx->global,
                     mp_tprintf(80, "script/%s", mpv_client_name(args->client))),
+        .profile = args->profile,
+        .cache_dir = args->cache_dir,
     };
 
     stats_register_thread_cputime(ctx->stats, "cpu");
@@ -947,6 +1045,50 @@ static int script_get_property_native(lua_State *L, void *tmp)
     return 2;
 }
 
+static int script_get_properties(lua_State *L, void *tmp)
+{
+    struct script_ctx *ctx = get_ctx(L);
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    struct mpv_node names;
+    makenode(tmp, &names, L, 1);
+    int num = names.u.list ? names.u.list->num : 0;
+    if (names.format != MPV_FORMAT_NODE_ARRAY && num)
+        luaL_error(L, "array of property names expected");
+    const char **list = talloc_zero_array(tmp, const char *, num + 1);
+    for (int n = 0; n < num; n++) {
+        if (names.u.list->values[n].format != MPV_FORMAT_STRING)
+            luaL_error(L, "property name must be a string");
+        list[n] = names.u.list->values[n].u.string;
+    }
+
+    mpv_node node;
+    int err = mpv_get_properties(ctx->client, list, &node);
+    if (err >= 0) {
+        steal_node_allocations(tmp, &node);
+        pushnode(L, &node);
+        return 1;
+    }
+    lua_pushnil(L);
+    lua_pushstring(L, mpv_error_string(err));
+    return 2;
+}
+
+static int script_set_properties(lua_State *L, void *tmp)
+{
+    struct script_ctx *ctx = get_ctx(L);
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    struct mpv_node node;
+    makenode(tmp, &node, L, 1);
+    if (node.format != MPV_FORMAT_NODE_MAP) {
+        if (node.u.list && node.u.list->num)
+            luaL_error(L, "table mapping property names to values expected");
+        node = (struct mpv_node){.format = MPV_FORMAT_NODE_MAP};
+    }
+    return check_error(L, mpv_set_properties(ctx->client, &node));
+}
+
 static mpv_format check_property_format(lua_State *L, int arg)
 {
     if (lua_isnil(L, arg))
@@ -1241,11 +1383,13 @@ static const struct fn_entry main_fns[] = {
     FN_ENTRY(get_property_bool),
     FN_ENTRY(get_property_number),
     AF_ENTRY(get_property_native),
+    AF_ENTRY(get_properties),
     FN_ENTRY(del_property),
     FN_ENTRY(set_property),
     FN_ENTRY(set_property_bool),
     FN_ENTRY(set_property_number),
     AF_ENTRY(set_property_native),
+    AF_ENTRY(set_properties),
     FN_ENTRY(raw_observe_property),
     FN_ENTRY(raw_unobserve_property),
     FN_ENTRY(get_time),
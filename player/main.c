@@ -40,6 +40,7 @@
 
 #include "common/av_log.h"
 #include "common/codecs.h"
+#include "common/dir_cache.h"
 #include "common/encode.h"
 #include "options/m_config.h"
 #include "options/m_option.h"
@@ -61,6 +62,7 @@
 
 #include "audio/out/ao.h"
 #include "misc/thread_tools.h"
+#include "sub/ass_mp.h"
 #include "sub/osd.h"
 #include "video/out/vo.h"
 
@@ -287,6 +289,7 @@ struct MPContext *mp_create(void)
     mpctx->global = talloc_zero(mpctx, struct mpv_global);
 
     demux_packet_pool_init(mpctx->global);
+    mp_ass_cache_init(mpctx->global);
     stats_global_init(mpctx->global);
 
     // Nothing must call mp_msg*() and related before this
@@ -296,6 +299,8 @@ struct MPContext *mp_create(void)
 
     mpctx->stats = stats_ctx_create(mpctx, mpctx->global, "main");
 
+    mp_dir_cache_init(mpctx->global);
+
     // Create the config context and register the options
     mpctx->mconfig = m_config_new(mpctx, mpctx->log, &mp_opt_root);
     mpctx->opts = mpctx->mconfig->optstruct;
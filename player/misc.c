@@ -316,9 +316,9 @@ void merge_playlist_files(struct playlist *pl)
     if (!pl->num_entries)
         return;
     char *edl = talloc_strdup(NULL, "edl://");
-    for (int n = 0; n < pl->num_entries; n++) {
-        struct playlist_entry *e = pl->entries[n];
-        if (n)
+    struct playlist_entry *first = playlist_get_first(pl);
+    for (struct playlist_entry *e = first; e; e = playlist_entry_get_rel(e, 1)) {
+        if (e != first)
             edl = talloc_strdup_append_buffer(edl, ";");
         // Escape if needed
         if (e->filename[strcspn(e->filename, "=%,;\n")] ||
@@ -53,6 +53,7 @@
 void mp_wait_events(struct MPContext *mpctx)
 {
     mp_client_send_property_changes(mpctx);
+    mp_client_publish_properties(mpctx);
 
     stats_event(mpctx->stats, "iterations");
 
@@ -1306,6 +1307,8 @@ void run_playloop(struct MPContext *mpctx)
 
     handle_update_cache(mpctx);
 
+    update_playlist_loader(mpctx);
+
     mp_process_input(mpctx);
 
     handle_option_callbacks(mpctx);
@@ -1324,6 +1327,7 @@ void mp_idle(struct MPContext *mpctx)
     handle_option_callbacks(mpctx);
     handle_command_updates(mpctx);
     handle_update_cache(mpctx);
+    update_playlist_loader(mpctx);
     handle_cursor_autohide(mpctx);
     handle_vo_events(mpctx);
     update_osd_msg(mpctx);
@@ -25,6 +25,7 @@
 #include "osdep/io.h"
 #include "osdep/subprocess.h"
 #include "osdep/threads.h"
+#include "osdep/timer.h"
 
 #include "common/common.h"
 #include "common/msg.h"
@@ -35,6 +36,7 @@
 #include "misc/bstr.h"
 #include "core.h"
 #include "client.h"
+#include "command.h"
 #include "mpv/client.h"
 #include "mpv/render.h"
 #include "mpv/stream_cb.h"
@@ -79,6 +81,33 @@ static char *script_name_from_filename(void *talloc_ctx, const char *fname)
     return talloc_asprintf(talloc_ctx, "%s", name);
 }
 
+// A script which is only started once one of its triggers fires.
+struct mp_lazy_script {
+    char *name;             // name of the client it will get
+    char *filename;
+    char *path;
+    const struct mp_scripting *backend;
+    int builtin_slot;       // index into builtin_script_ids, or -1
+    char **messages;        // script-message names
+    int num_messages;
+    int *events;            // mpv_event_id
+    int num_events;
+    struct mp_script_profile *profile;
+};
+
+// Builtin scripts which mostly act when addressed by name with script-binding
+// or script-message-to, so they can be loaded lazily. See stats_needs_start()
+// for the exception.
+static const char *const lazy_builtin_scripts[] = {
+    "@stats.lua",
+    "@console.lua",
+    "@select.lua",
+    "@positioning.lua",
+    "@commands.lua",
+    "@context_menu.lua",
+    NULL
+};
+
 static void run_script(struct mp_script_args *arg)
 {
     char *name = talloc_asprintf(NULL, "%s/%s", arg->backend->name,
@@ -102,7 +131,289 @@ static MP_THREAD_VOID script_thread(void *p)
     MP_THREAD_RETURN();
 }
 
-static int64_t mp_load_script(struct MPContext *mpctx, const char *fname)
+static struct mp_script_profile *add_profile(struct MPContext *mpctx,
+                                             const char *name,
+                                             const char *fname,
+                                             const struct mp_scripting *backend)
+{
+    struct mp_script_profile *profile = talloc_ptrtype(mpctx, profile);
+    *profile = (struct mp_script_profile){
+        .name = talloc_strdup(profile, name),
+        .filename = talloc_strdup(profile, fname),
+        .backend = backend->name,
+    };
+    MP_TARRAY_APPEND(mpctx, mpctx->script_profiles, mpctx->num_script_profiles,
+                     profile);
+    return profile;
+}
+
+static int64_t start_script(struct MPContext *mpctx, const char *fname,
+                            const char *path, const char *script_name,
+                            const struct mp_scripting *backend,
+                            struct mp_script_profile *profile)
+{
+    profile->start = mp_time_ns();
+
+    struct mp_script_args *arg = talloc_ptrtype(NULL, arg);
+    *arg = (struct mp_script_args){
+        .mpctx = mpctx,
+        .filename = talloc_strdup(arg, fname),
+        .path = talloc_strdup(arg, path),
+        .backend = backend,
+        .profile = profile,
+        // Create the client before creating the thread; otherwise a race
+        // condition could happen, where MPContext is destroyed while the
+        // thread tries to create the client.
+        .client = mp_new_client(mpctx->clients, script_name),
+    };
+
+    if (!arg->client) {
+        MP_ERR(mpctx, "Failed to create client for script: %s\n", arg->filename);
+        talloc_free(arg);
+        return -1;
+    }
+
+    if (mpctx->opts->script_bytecode_cache) {
+        char *dir = mp_find_user_file(arg, mpctx->global, "cache", "");
+        if (dir && dir[0])
+            arg->cache_dir = dir;
+    }
+
+    talloc_free(profile->name);
+    profile->name = talloc_strdup(profile, mpv_client_name(arg->client));
+
+    mp_client_set_weak(arg->client);
+    mp_client_set_profile(arg->client, profile);
+    arg->log = mp_client_get_log(arg->client);
+    int64_t id = mpv_client_id(arg->client);
+
+    MP_DBG(arg, "Loading %s script %s...\n", backend->name, arg->filename);
+
+    if (backend->no_thread) {
+        run_script(arg);
+    } else {
+        mp_thread thread;
+        if (mp_thread_create(&thread, script_thread, arg)) {
+            mpv_destroy(arg->client);
+            talloc_free(arg);
+            return -1;
+        }
+        mp_thread_detach(thread);
+    }
+
+    return id;
+}
+
+static int find_event(bstr name)
+{
+    for (int n = 0; n < INTERNAL_EVENT_BASE; n++) {
+        const char *event = mpv_event_name(n);
+        if (event && bstr_equals0(name, event))
+            return n;
+    }
+    return -1;
+}
+
+// Read the triggers declared in the comment block at the start of the script,
+// e.g. "-- mpv-lazy-key: Ctrl+l toggle-lyrics". Returns false if there are
+// none, i.e. the script must be started right away.
+static bool read_lazy_triggers(struct MPContext *mpctx, struct mp_lazy_script *s,
+                               char **keys)
+{
+    if (strcmp(s->backend->file_ext, "lua") != 0 &&
+        strcmp(s->backend->file_ext, "js") != 0)
+        return false;
+
+    FILE *f = fopen(s->filename, "rb");
+    if (!f)
+        return false;
+    char buf[4096];
+    size_t len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+
+    bstr data = {(unsigned char *)buf, len};
+    // Ignore a line cut off by the buffer size.
+    if (len == sizeof(buf)) {
+        int end = bstrrchr(data, '\n');
+        data.len = end < 0 ? 0 : end;
+    }
+
+    bool found = false;
+    while (data.len) {
+        bstr line = bstr_strip(bstr_getline(data, &data));
+        if (!line.len)
+            continue;
+        if (!bstr_eatstart0(&line, "--") && !bstr_eatstart0(&line, "//"))
+            break;
+        line = bstr_lstrip(line);
+        if (bstr_eatstart0(&line, "mpv-lazy-key:")) {
+            bstr key, binding;
+            if (!bstr_split_tok(bstr_strip(line), " ", &key, &binding) ||
+                !key.len || !bstr_strip(binding).len)
+            {
+                MP_WARN(mpctx, "%s: invalid mpv-lazy-key directive.\n",
+                        s->filename);
+                continue;
+            }
+            *keys = talloc_asprintf_append(*keys, "%.*s script-binding %s/%.*s\n",
+                                           BSTR_P(key), s->name,
+                                           BSTR_P(bstr_strip(binding)));
+            found = true;
+        } else if (bstr_eatstart0(&line, "mpv-lazy-message:")) {
+            MP_TARRAY_APPEND(s, s->messages, s->num_messages,
+                             bstrdup0(s, bstr_strip(line)));
+            found = true;
+        } else if (bstr_eatstart0(&line, "mpv-lazy-event:")) {
+            int event = find_event(bstr_strip(line));
+            if (event < 0) {
+                MP_WARN(mpctx, "%s: unknown event '%.*s'.\n", s->filename,
+                        BSTR_P(bstr_strip(line)));
+                continue;
+            }
+            MP_TARRAY_APPEND(s, s->events, s->num_events, event);
+            found = true;
+        }
+    }
+    return found;
+}
+
+// stats.lua prints the key bindings at startup if its bindlist option is set.
+// Options from the config file aren't parsed here, so its presence is enough.
+static bool stats_needs_start(struct MPContext *mpctx)
+{
+    char **opts = mpctx->opts->script_opts;
+    for (int n = 0; opts && opts[n * 2]; n++) {
+        if (strcmp(opts[n * 2], "stats-bindlist") == 0 &&
+            strcmp(opts[n * 2 + 1], "no") != 0)
+            return true;
+    }
+
+    void *tmp = talloc_new(NULL);
+    bool found = mp_find_config_file(tmp, mpctx->global,
+                                     "script-opts/stats.conf") ||
+                 mp_find_config_file(tmp, mpctx->global,
+                                     "lua-settings/stats.conf");
+    talloc_free(tmp);
+    return found;
+}
+
+// Register the script as lazy if it is eligible. Returns false if it must be
+// started right away.
+static bool add_lazy_script(struct MPContext *mpctx, const char *fname,
+                            const char *path, const char *script_name,
+                            const struct mp_scripting *backend,
+                            int builtin_slot)
+{
+    if (!mpctx->opts->lazy_load_scripts)
+        return false;
+
+    struct mp_lazy_script *s = talloc_ptrtype(NULL, s);
+    *s = (struct mp_lazy_script){
+        .name = talloc_strdup(s, script_name),
+        .filename = talloc_strdup(s, fname),
+        .path = talloc_strdup(s, path),
+        .backend = backend,
+        .builtin_slot = builtin_slot,
+    };
+
+    bool lazy = false;
+    char *keys = talloc_strdup(s, "");
+    if (builtin_slot >= 0) {
+        for (int n = 0; lazy_builtin_scripts[n]; n++)
+            lazy |= strcmp(lazy_builtin_scripts[n], fname) == 0;
+        if (lazy && strcmp(fname, "@stats.lua") == 0)
+            lazy = !stats_needs_start(mpctx);
+    } else {
+        lazy = read_lazy_triggers(mpctx, s, &keys);
+    }
+    if (!lazy) {
+        talloc_free(s);
+        return false;
+    }
+
+    // Same section as the bindings the script defines once it's running, so
+    // they replace these.
+    if (keys[0]) {
+        char *section = talloc_asprintf(s, "input_%s", s->name);
+        mp_input_define_section(mpctx->input, section, s->filename, keys,
+                                true, s->name);
+        mp_input_enable_section(mpctx->input, section,
+                                MP_INPUT_ALLOW_VO_DRAGGING |
+                                MP_INPUT_ALLOW_HIDE_CURSOR);
+    }
+
+    s->profile = add_profile(mpctx, script_name, fname, backend);
+    s->profile->lazy = true;
+    MP_TARRAY_APPEND(mpctx, mpctx->lazy_scripts, mpctx->num_lazy_scripts, s);
+    MP_VERBOSE(mpctx, "Deferring loading of script %s.\n", fname);
+    return true;
+}
+
+static void remove_lazy_script(struct MPContext *mpctx, int index)
+{
+    struct mp_lazy_script *s = mpctx->lazy_scripts[index];
+    MP_TARRAY_REMOVE_AT(mpctx->lazy_scripts, mpctx->num_lazy_scripts, index);
+    s->profile->lazy = false;
+    talloc_free(s);
+}
+
+static void start_lazy_script(struct MPContext *mpctx, int index,
+                              const char *reason)
+{
+    struct mp_lazy_script *s = mpctx->lazy_scripts[index];
+    MP_VERBOSE(mpctx, "Loading script %s (%s).\n", s->filename, reason);
+    int64_t id = start_script(mpctx, s->filename, s->path, s->name, s->backend,
+                              s->profile);
+    if (s->builtin_slot >= 0)
+        mpctx->builtin_script_ids[s->builtin_slot] = id;
+    remove_lazy_script(mpctx, index);
+}
+
+// Start the lazy script which will get the given client name, if any. Returns
+// whether a script was started.
+bool mp_load_lazy_script(struct MPContext *mpctx, const char *name)
+{
+    for (int n = 0; n < mpctx->num_lazy_scripts; n++) {
+        if (strcmp(mpctx->lazy_scripts[n]->name, name) == 0) {
+            start_lazy_script(mpctx, n, "addressed by name");
+            return true;
+        }
+    }
+    return false;
+}
+
+// Start the lazy scripts which declared the given script-message.
+void mp_lazy_scripts_notify_message(struct MPContext *mpctx, const char *msg)
+{
+    for (int n = mpctx->num_lazy_scripts - 1; n >= 0; n--) {
+        struct mp_lazy_script *s = mpctx->lazy_scripts[n];
+        for (int i = 0; i < s->num_messages; i++) {
+            if (strcmp(s->messages[i], msg) == 0) {
+                start_lazy_script(mpctx, n, "script-message");
+                break;
+            }
+        }
+    }
+}
+
+// Start the lazy scripts which declared the given event.
+void mp_lazy_scripts_notify_event(struct MPContext *mpctx, int event)
+{
+    for (int n = mpctx->num_lazy_scripts - 1; n >= 0; n--) {
+        struct mp_lazy_script *s = mpctx->lazy_scripts[n];
+        for (int i = 0; i < s->num_events; i++) {
+            if (s->events[i] == event) {
+                start_lazy_script(mpctx, n, mpv_event_name(event));
+                break;
+            }
+        }
+    }
+}
+
+// Returns the client ID, 0 if the script is disabled or deferred, and -1 on
+// errors.
+static int64_t mp_load_script(struct MPContext *mpctx, const char *fname,
+                              bool allow_lazy, int builtin_slot)
 {
     char *ext = mp_splitext(fname, NULL);
     if (ext && strcasecmp(ext, "disable") == 0)
@@ -158,56 +469,33 @@ static int64_t mp_load_script(struct MPContext *mpctx, const char *fname)
         return -1;
     }
 
-    struct mp_script_args *arg = talloc_ptrtype(NULL, arg);
-    *arg = (struct mp_script_args){
-        .mpctx = mpctx,
-        .filename = talloc_strdup(arg, fname),
-        .path = talloc_strdup(arg, path),
-        .backend = backend,
-        // Create the client before creating the thread; otherwise a race
-        // condition could happen, where MPContext is destroyed while the
-        // thread tries to create the client.
-        .client = mp_new_client(mpctx->clients, script_name),
-    };
-
-    talloc_free(tmp);
-    fname = NULL; // might have been freed so don't touch anymore
-
-    if (!arg->client) {
-        MP_ERR(mpctx, "Failed to create client for script: %s\n", arg->filename);
-        talloc_free(arg);
-        return -1;
-    }
-
-    mp_client_set_weak(arg->client);
-    arg->log = mp_client_get_log(arg->client);
-    int64_t id = mpv_client_id(arg->client);
-
-    MP_DBG(arg, "Loading %s script %s...\n", backend->name, arg->filename);
-
-    if (backend->no_thread) {
-        run_script(arg);
-    } else {
-        mp_thread thread;
-        if (mp_thread_create(&thread, script_thread, arg)) {
-            mpv_destroy(arg->client);
-            talloc_free(arg);
-            return -1;
-        }
-        mp_thread_detach(thread);
+    int64_t id = 0;
+    if (!allow_lazy || !add_lazy_script(mpctx, fname, path, script_name,
+                                        backend, builtin_slot))
+    {
+        struct mp_script_profile *profile =
+            add_profile(mpctx, script_name, fname, backend);
+        id = start_script(mpctx, fname, path, script_name, backend, profile);
     }
 
+    talloc_free(tmp);
     return id;
 }
 
-int64_t mp_load_user_script(struct MPContext *mpctx, const char *fname)
+static int64_t load_user_script(struct MPContext *mpctx, const char *fname,
+                                bool allow_lazy)
 {
     char *path = mp_get_user_path(NULL, mpctx->global, fname);
-    int64_t ret = mp_load_script(mpctx, path);
+    int64_t ret = mp_load_script(mpctx, path, allow_lazy, -1);
     talloc_free(path);
     return ret;
 }
 
+int64_t mp_load_user_script(struct MPContext *mpctx, const char *fname)
+{
+    return load_user_script(mpctx, fname, false);
+}
+
 static int compare_filename(const void *pa, const void *pb)
 {
     char *a = (char *)pa;
@@ -247,9 +535,17 @@ static void load_builtin_script(struct MPContext *mpctx, int slot, bool enable,
         MP_DBG(mpctx, "Client for script %s is no longer alive. Marking as unloaded.\n", fname);
         *pid = 0; // died
     }
-    if ((*pid > 0) != enable) {
+    int lazy = -1;
+    for (int n = 0; n < mpctx->num_lazy_scripts; n++) {
+        if (mpctx->lazy_scripts[n]->builtin_slot == slot)
+            lazy = n;
+    }
+    if ((*pid > 0 || lazy >= 0) != enable) {
         if (enable) {
-            *pid = mp_load_script(mpctx, fname);
+            *pid = mp_load_script(mpctx, fname, true, slot);
+        } else if (lazy >= 0) {
+            MP_DBG(mpctx, "Not loading script %s (disabled by option)\n", fname);
+            remove_lazy_script(mpctx, lazy);
         } else {
             char *name = mp_tprintf(22, "@%"PRIi64, *pid);
             MP_DBG(mpctx, "Unloading script %s (disabled by option)\n", fname);
@@ -281,7 +577,7 @@ bool mp_load_scripts(struct MPContext *mpctx)
     char **files = mpctx->opts->script_files;
     for (int n = 0; files && files[n]; n++) {
         if (files[n][0])
-            ok &= mp_load_user_script(mpctx, files[n]) >= 0;
+            ok &= load_user_script(mpctx, files[n], true) >= 0;
     }
     if (!mpctx->opts->auto_load_scripts)
         return ok;
@@ -292,7 +588,7 @@ bool mp_load_scripts(struct MPContext *mpctx)
     for (int i = 0; scriptsdir && scriptsdir[i]; i++) {
         files = list_script_files(tmp, scriptsdir[i]);
         for (int n = 0; files && files[n]; n++)
-            ok &= mp_load_script(mpctx, files[n]) >= 0;
+            ok &= mp_load_script(mpctx, files[n], true, -1) >= 0;
     }
     talloc_free(tmp);
 
@@ -350,8 +646,11 @@ static void init_sym_table(struct mp_script_args *args, void *lib) {
     INIT_SYM(mpv_get_property_string);
     INIT_SYM(mpv_get_property_osd_string);
     INIT_SYM(mpv_get_property_async);
+    INIT_SYM(mpv_get_properties);
+    INIT_SYM(mpv_set_properties);
     INIT_SYM(mpv_observe_property);
     INIT_SYM(mpv_unobserve_property);
+    INIT_SYM(mpv_observe_property_options);
     INIT_SYM(mpv_event_name);
     INIT_SYM(mpv_event_to_node);
     INIT_SYM(mpv_request_event);
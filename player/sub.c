@@ -117,7 +117,8 @@ static bool update_subtitle(struct MPContext *mpctx, double video_pts,
 
     if (track->demuxer->fully_read && sub_can_preload(dec_sub)) {
         // Assume fully_read implies no interleaved audio/video streams.
-        // (Reading packets will change the demuxer position.)
+        // (Reading packets will change the demuxer position.) This starts
+        // a background job, which reports progress via sub_updated.
         demux_seek(track->demuxer, 0, 0);
         sub_preload(dec_sub);
     }
@@ -153,6 +154,12 @@ static bool update_subtitle(struct MPContext *mpctx, double video_pts,
                 osd_query_and_reset_want_redraw(mpctx->osd);
                 vo_redraw(mpctx->video_out);
             }
+        } else if (sub_updated && mpctx->paused && mpctx->video_out) {
+            // Events may have been decoded in the background after the
+            // current frame was drawn.
+            int order = get_order(mpctx, track);
+            if (order >= 0)
+                osd_set_sub(mpctx->osd, order, dec_sub);
         }
     }
 
@@ -206,6 +213,8 @@ static bool init_subdec(struct MPContext *mpctx, struct track *track)
     if (!track->d_sub)
         return false;
 
+    sub_set_wakeup_cb(track->d_sub, mp_wakeup_core_cb, mpctx);
+
     struct track *vtrack = mpctx->current_track[0][STREAM_VIDEO];
     struct mp_codec_params *v_c =
         vtrack && vtrack->stream ? vtrack->stream->codec : NULL;
@@ -1272,6 +1272,15 @@ void write_video(struct MPContext *mpctx)
 
     vo_queue_frame(vo, frame);
 
+    // Let the subtitle renderer start on the frame just queued, and the ones
+    // following it.
+    double ahead_pts[MP_ARRAY_SIZE(mpctx->next_frames) + 1];
+    int num_ahead_pts = 0;
+    ahead_pts[num_ahead_pts++] = mpctx->video_pts;
+    for (int n = 0; n < mpctx->num_next_frames; n++)
+        ahead_pts[num_ahead_pts++] = mpctx->next_frames[n]->pts;
+    osd_render_ahead(mpctx->osd, ahead_pts, num_ahead_pts);
+
     check_framedrop(mpctx, vo_c);
 
     // The frames were shifted down; "initialize" the new first entry.
@@ -18,6 +18,8 @@
  */
 
 #include <inttypes.h>
+#include <limits.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -29,12 +31,16 @@
 #include <ass/ass_types.h>
 
 #include "common/common.h"
+#include "common/global.h"
 #include "common/msg.h"
+#include "common/stats.h"
+#include "osdep/threads.h"
 #include "options/path.h"
 #include "ass_mp.h"
 #include "img_convert.h"
 #include "osd.h"
 #include "stream/stream.h"
+#include "options/m_config.h"
 #include "options/options.h"
 #include "video/out/bitmap_packer.h"
 #include "video/mp_image.h"
@@ -145,6 +151,196 @@ ASS_Library *mp_ass_init(struct mpv_global *global,
     return priv;
 }
 
+// Registry of all libass renderers in the process. libass keeps its font,
+// glyph and bitmap caches per ASS_Renderer, so they can't be shared between
+// renderers; instead, --ass-cache-budget is split among the live renderers,
+// and every render call goes through here to apply the current share. Idle
+// renderers (kept for reuse) don't render, so they don't get a share.
+struct mp_ass_cache {
+    mp_mutex lock;
+    struct mpv_global *global;
+    struct m_config_cache *opts_cache; // created by the first client
+    struct mp_osd_render_opts *opts;
+    int num_renderers;          // excluding idle ones
+    int num_idle_renderers;
+    int64_t renderers_created;
+    int64_t renderers_reused;
+    _Atomic int64_t frames;
+    _Atomic int64_t frames_unchanged;
+};
+
+struct mp_ass_cache_client {
+    struct mp_ass_cache *cache; // NULL if there is no registry
+    int glyph_limit, bitmap_max_size;   // requested by the owner
+    int set_glyph_limit, set_bitmap_max_size; // last set on the renderer
+    bool idle;
+};
+
+static void cache_destroy(void *p)
+{
+    struct mp_ass_cache *cache = p;
+    mp_assert(!cache->num_renderers && !cache->num_idle_renderers);
+    mp_mutex_destroy(&cache->lock);
+}
+
+void mp_ass_cache_init(struct mpv_global *global)
+{
+    struct mp_ass_cache *cache = talloc_zero(global, struct mp_ass_cache);
+    talloc_set_destructor(cache, cache_destroy);
+    mp_mutex_init(&cache->lock);
+    cache->global = global;
+
+    mp_assert(!global->ass_cache);
+    global->ass_cache = cache;
+}
+
+static void client_destroy(void *p)
+{
+    struct mp_ass_cache_client *c = p;
+    if (!c->cache)
+        return;
+    mp_mutex_lock(&c->cache->lock);
+    if (c->idle) {
+        c->cache->num_idle_renderers--;
+    } else {
+        c->cache->num_renderers--;
+    }
+    mp_mutex_unlock(&c->cache->lock);
+}
+
+// Register a new renderer. The caller must render all frames with
+// mp_ass_render_frame(), and free the client with talloc_free() along with
+// the renderer.
+struct mp_ass_cache_client *mp_ass_cache_register(void *ta_parent,
+                                                  struct mpv_global *global)
+{
+    struct mp_ass_cache_client *c =
+        talloc_zero(ta_parent, struct mp_ass_cache_client);
+    c->cache = global->ass_cache;
+    c->set_glyph_limit = c->set_bitmap_max_size = -1;
+    talloc_set_destructor(c, client_destroy);
+
+    struct mp_ass_cache *cache = c->cache;
+    if (cache) {
+        mp_mutex_lock(&cache->lock);
+        if (!cache->opts_cache) {
+            cache->opts_cache = m_config_cache_alloc(cache, cache->global,
+                                                     &mp_osd_render_sub_opts);
+            cache->opts = cache->opts_cache->opts;
+        }
+        cache->num_renderers++;
+        cache->renderers_created++;
+        mp_mutex_unlock(&cache->lock);
+    }
+    return c;
+}
+
+// Set the limits as with ass_set_cache_limits(). The bitmap cache size can be
+// further reduced by the global budget.
+void mp_ass_cache_set_limits(struct mp_ass_cache_client *c, int glyph_limit,
+                             int bitmap_max_size)
+{
+    c->glyph_limit = glyph_limit;
+    c->bitmap_max_size = bitmap_max_size;
+}
+
+// Mark the renderer as kept for reuse, so that it's not counted when
+// splitting the budget.
+void mp_ass_cache_set_idle(struct mp_ass_cache_client *c)
+{
+    mp_assert(!c->idle);
+    c->idle = true;
+    if (!c->cache)
+        return;
+    mp_mutex_lock(&c->cache->lock);
+    c->cache->num_renderers--;
+    c->cache->num_idle_renderers++;
+    mp_mutex_unlock(&c->cache->lock);
+}
+
+// Record that the idle renderer was reused instead of creating a new one.
+void mp_ass_cache_reused(struct mp_ass_cache_client *c)
+{
+    mp_assert(c->idle);
+    c->idle = false;
+    if (!c->cache)
+        return;
+    mp_mutex_lock(&c->cache->lock);
+    c->cache->num_idle_renderers--;
+    c->cache->num_renderers++;
+    c->cache->renderers_reused++;
+    mp_mutex_unlock(&c->cache->lock);
+}
+
+// Return the bitmap cache size (in MB) each renderer gets from the budget, or
+// 0 if there is no budget. Call with cache->lock held.
+static int get_budget_share(struct mp_ass_cache *cache)
+{
+    m_config_cache_update(cache->opts_cache);
+    int budget = cache->opts->ass_cache_budget;
+    if (budget <= 0)
+        return 0;
+    return MPMAX(budget / MPMAX(cache->num_renderers, 1), 1);
+}
+
+// Like ass_render_frame(), but with the cache limits applied first.
+ASS_Image *mp_ass_render_frame(struct mp_ass_cache_client *c,
+                               ASS_Renderer *renderer, ASS_Track *track,
+                               long long now, int *detect_change)
+{
+    int bitmap_max_size = c->bitmap_max_size;
+    struct mp_ass_cache *cache = c->cache;
+    if (cache) {
+        mp_mutex_lock(&cache->lock);
+        int share = get_budget_share(cache);
+        mp_mutex_unlock(&cache->lock);
+        if (share && (bitmap_max_size <= 0 || bitmap_max_size > share))
+            bitmap_max_size = share;
+    }
+
+    if (c->set_glyph_limit != c->glyph_limit ||
+        c->set_bitmap_max_size != bitmap_max_size)
+    {
+        ass_set_cache_limits(renderer, c->glyph_limit, bitmap_max_size);
+        c->set_glyph_limit = c->glyph_limit;
+        c->set_bitmap_max_size = bitmap_max_size;
+    }
+
+    int changed;
+    ASS_Image *imgs = ass_render_frame(renderer, track, now, &changed);
+
+    if (cache) {
+        atomic_fetch_add(&cache->frames, 1);
+        if (!changed)
+            atomic_fetch_add(&cache->frames_unchanged, 1);
+    }
+
+    if (detect_change)
+        *detect_change = changed;
+    return imgs;
+}
+
+void mp_ass_cache_get_stats(struct mpv_global *global,
+                            struct mp_ass_cache_stats *st)
+{
+    *st = (struct mp_ass_cache_stats){0};
+    struct mp_ass_cache *cache = global->ass_cache;
+    if (!cache)
+        return;
+    mp_mutex_lock(&cache->lock);
+    st->renderers = cache->num_renderers;
+    st->idle_renderers = cache->num_idle_renderers;
+    st->renderers_created = cache->renderers_created;
+    st->renderers_reused = cache->renderers_reused;
+    if (cache->opts_cache) {
+        st->budget = MPMAX(cache->opts->ass_cache_budget, 0);
+        st->bitmap_share = get_budget_share(cache);
+    }
+    mp_mutex_unlock(&cache->lock);
+    st->frames = atomic_load(&cache->frames);
+    st->frames_unchanged = atomic_load(&cache->frames_unchanged);
+}
+
 void mp_ass_flush_old_events(ASS_Track *track, long long ts)
 {
     int n = 0;
@@ -199,8 +395,13 @@ struct mp_ass_packer {
     bool cached_subs_valid;
     struct sub_bitmap rgba_imgs[MP_SUB_BB_LIST_MAX];
     struct bitmap_packer *packer;
+    uint64_t packed_version; // of cached_img contents, 0 if unknown
+    struct stats_ctx *stats;
 };
 
+// Globally unique, so that VOs never confuse versions of different packers.
+static _Atomic uint64_t packed_version_counter;
+
 // Free with talloc_free().
 struct mp_ass_packer *mp_ass_packer_alloc(void *ta_parent)
 {
@@ -210,12 +411,34 @@ struct mp_ass_packer *mp_ass_packer_alloc(void *ta_parent)
     return p;
 }
 
-static bool pack(struct mp_ass_packer *p, struct sub_bitmaps *res, int imgfmt)
+// Report packing statistics to the given context (optional).
+void mp_ass_packer_set_stats(struct mp_ass_packer *p, struct stats_ctx *stats)
+{
+    p->stats = stats;
+}
+
+// If use_keys is set, the packer tries to keep parts with the same bitmap
+// pointer at the same place as in the previous call, using the incremental
+// packer mode. *out_reuse is set to whether the previous contents of
+// res->packed can be used at all.
+static bool pack(struct mp_ass_packer *p, struct sub_bitmaps *res, int imgfmt,
+                 bool use_keys, bool *out_reuse)
 {
+    // The mode decides which arrays the packer allocates, so start over.
+    if (p->packer->incremental != use_keys) {
+        p->packer->incremental = use_keys;
+        packer_reset(p->packer);
+    }
+
     packer_set_size(p->packer, res->num_parts);
 
-    for (int n = 0; n < res->num_parts; n++)
+    for (int n = 0; n < res->num_parts; n++) {
         p->packer->in[n] = (struct pos){res->parts[n].w, res->parts[n].h};
+        if (use_keys)
+            p->packer->keys[n] = (uintptr_t)res->parts[n].bitmap;
+    }
+
+    *out_reuse = false;
 
     if (p->packer->count == 0 || packer_pack(p->packer) < 0)
         return false;
@@ -232,6 +455,7 @@ static bool pack(struct mp_ass_packer *p, struct sub_bitmaps *res, int imgfmt)
     {
         talloc_free(p->cached_img);
         p->cached_img = mp_image_alloc(imgfmt, p->packer->w, p->packer->h);
+        p->packed_version = 0;
         if (!p->cached_img) {
             packer_reset(p->packer);
             return false;
@@ -239,11 +463,16 @@ static bool pack(struct mp_ass_packer *p, struct sub_bitmaps *res, int imgfmt)
         talloc_steal(p, p->cached_img);
     }
 
+    // If the image is still referenced (e.g. by the VO), this copies it, so
+    // the contents are preserved either way.
     if (!mp_image_make_writeable(p->cached_img)) {
         packer_reset(p->packer);
+        p->packed_version = 0;
         return false;
     }
 
+    *out_reuse = use_keys && p->packed_version;
+
     res->packed = p->cached_img;
 
     for (int n = 0; n < res->num_parts; n++) {
@@ -305,25 +534,71 @@ static void fill_padding_4(uint8_t *base, int w, int h, int stride, int padding)
         memcpy(base + (h + i) * stride - padding * 4, last_row, row_bytes);
 }
 
+static bool bitmap_equal(const uint8_t *a, int a_stride,
+                         const uint8_t *b, int b_stride, int w, int h)
+{
+    for (int y = 0; y < h; y++) {
+        if (memcmp(a + y * a_stride, b + y * b_stride, w))
+            return false;
+    }
+    return true;
+}
+
 static bool pack_libass(struct mp_ass_packer *p, struct sub_bitmaps *res)
 {
-    if (!pack(p, res, IMGFMT_Y8))
+    // libass caches glyph bitmaps, so parts that stay on screen usually keep
+    // their bitmap pointer, which is used as key for reusing their position.
+    bool reuse;
+    if (!pack(p, res, IMGFMT_Y8, true, &reuse))
         return false;
 
     int padding = p->packer->padding;
     uint8_t *base = res->packed->planes[0];
     int stride = res->packed->stride[0];
+    struct mp_rect dirty = {INT_MAX, INT_MAX, INT_MIN, INT_MIN};
+    int num_reused = 0;
 
     for (int n = 0; n < res->num_parts; n++) {
         struct sub_bitmap *b = &res->parts[n];
         void *pdata = base + b->src_y * stride + b->src_x;
-        memcpy_pic(pdata, b->bitmap, b->w, b->h, stride, b->stride);
-        fill_padding_1(pdata, b->w, b->h, stride, padding);
+
+        // libass may have freed the old bitmap and allocated a new one at the
+        // same address, so the contents still need to be compared. This is
+        // cheaper than copying, and avoids marking the area as changed.
+        if (reuse && p->packer->reused[n] &&
+            bitmap_equal(pdata, stride, b->bitmap, b->stride, b->w, b->h))
+        {
+            num_reused++;
+        } else {
+            memcpy_pic(pdata, b->bitmap, b->w, b->h, stride, b->stride);
+            fill_padding_1(pdata, b->w, b->h, stride, padding);
+            mp_rect_union(&dirty, &(struct mp_rect){
+                b->src_x - padding, b->src_y - padding,
+                b->src_x + b->w + padding, b->src_y + b->h + padding});
+        }
 
         b->bitmap = pdata;
         b->stride = stride;
     }
 
+    if (dirty.x0 >= dirty.x1)
+        dirty = (struct mp_rect){0};
+
+    res->packed_version = atomic_fetch_add(&packed_version_counter, 1) + 1;
+    res->packed_base_version = reuse ? p->packed_version : 0;
+    res->packed_dirty = dirty;
+    p->packed_version = res->packed_version;
+
+    if (p->stats) {
+        stats_value(p->stats, "efficiency",
+                    packer_get_efficiency(p->packer) * 100);
+        stats_value(p->stats, "reused",
+                    num_reused * 100.0 / MPMAX(res->num_parts, 1));
+        stats_size_value(p->stats, "upload",
+                         reuse ? mp_rect_w(dirty) * mp_rect_h(dirty)
+                               : res->packed_w * res->packed_h);
+    }
+
     return true;
 }
 
@@ -344,8 +619,12 @@ static bool pack_rgba(struct mp_ass_packer *p, struct sub_bitmaps *res)
         imgs.parts[n].h = bb_list[n].y1 - bb_list[n].y0;
     }
 
-    if (!pack(p, &imgs, IMGFMT_BGRA))
+    // The bounding boxes are composited from several parts, so there is
+    // nothing to reuse.
+    bool reuse;
+    if (!pack(p, &imgs, IMGFMT_BGRA, false, &reuse))
         return false;
+    p->packed_version = 0;
 
     int padding = p->packer->padding;
     uint8_t *base = imgs.packed->planes[0];
@@ -53,9 +53,35 @@ void mp_ass_configure_fonts(ASS_Renderer *priv, struct osd_style_opts *opts,
 ASS_Library *mp_ass_init(struct mpv_global *global,
                          struct osd_style_opts *opts, struct mp_log *log);
 
+struct mp_ass_cache_client;
+struct mp_ass_cache_stats {
+    int renderers;          // currently used renderers
+    int idle_renderers;     // renderers kept for reuse
+    int budget;             // --ass-cache-budget (MB), 0 if unlimited
+    int bitmap_share;       // bitmap cache size per renderer (MB), or 0
+    int64_t renderers_created;
+    int64_t renderers_reused;
+    int64_t frames;         // ass_render_frame() calls
+    int64_t frames_unchanged; // ... which libass reported as unchanged
+};
+void mp_ass_cache_init(struct mpv_global *global);
+struct mp_ass_cache_client *mp_ass_cache_register(void *ta_parent,
+                                                  struct mpv_global *global);
+void mp_ass_cache_set_limits(struct mp_ass_cache_client *c, int glyph_limit,
+                             int bitmap_max_size);
+void mp_ass_cache_set_idle(struct mp_ass_cache_client *c);
+void mp_ass_cache_reused(struct mp_ass_cache_client *c);
+ASS_Image *mp_ass_render_frame(struct mp_ass_cache_client *c,
+                               ASS_Renderer *renderer, ASS_Track *track,
+                               long long now, int *detect_change);
+void mp_ass_cache_get_stats(struct mpv_global *global,
+                            struct mp_ass_cache_stats *st);
+
 struct sub_bitmaps;
 struct mp_ass_packer;
 struct mp_ass_packer *mp_ass_packer_alloc(void *ta_parent);
+struct stats_ctx;
+void mp_ass_packer_set_stats(struct mp_ass_packer *p, struct stats_ctx *stats);
 void mp_ass_packer_pack(struct mp_ass_packer *p, ASS_Image **image_lists,
                         int num_image_lists, bool changed, bool video_color_space,
                         int preferred_osd_format, struct sub_bitmaps *out);
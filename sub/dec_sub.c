@@ -21,6 +21,7 @@
 #include <math.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdatomic.h>
 
 #include "demux/demux.h"
 #include "demux/packet_pool.h"
@@ -31,8 +32,12 @@
 #include "common/global.h"
 #include "common/msg.h"
 #include "common/recorder.h"
+#include "common/stats.h"
 #include "misc/dispatch.h"
+#include "misc/thread_pool.h"
 #include "osdep/threads.h"
+#include "osdep/timer.h"
+#include "video/mp_image.h"
 
 extern const struct sd_functions sd_ass;
 extern const struct sd_functions sd_lavc;
@@ -43,6 +48,23 @@ static const struct sd_functions *const sd_list[] = {
     NULL
 };
 
+// Maximum number of frames rendered in advance (--sub-render-ahead), and the
+// number of cached results (the frames rendered in advance, plus the last
+// ones which were actually displayed).
+#define MAX_RENDER_AHEAD 8
+#define AHEAD_CACHE_SIZE (MAX_RENDER_AHEAD + 2)
+
+struct ahead_entry {
+    bool valid;
+    double pts;                 // subtitle PTS
+    struct mp_osd_res dim;
+    int format;
+    struct sub_bitmaps *imgs;   // can be NULL (nothing to display)
+    uint64_t serial;            // render_serial of the render which made it
+    bool changed;               // differs from the result of render serial-1
+    uint64_t last_use;
+};
+
 struct dec_sub {
     mp_mutex lock;
 
@@ -63,6 +85,17 @@ struct dec_sub {
     int order;
     double last_pkt_pts;
     bool preload_attempted;
+
+    // Background preload (sub_preload()), protected by lock. While the job is
+    // running, only the job reads packets from the demuxer stream.
+    struct mp_thread_pool *preload_pool;
+    struct mp_dispatch_queue *preload_waiter;
+    bool preload_busy;          // job queued or running
+    bool preload_stop;          // job should exit as soon as possible
+    bool preload_changed;       // new events since the last sub_read_packets()
+    void (*wakeup_cb)(void *ctx);
+    void *wakeup_ctx;
+
     double video_fps;
     double sub_speed;
     bool sub_visible;
@@ -73,10 +106,35 @@ struct dec_sub {
     double last_vo_pts;
     struct sd *sd;
 
+    struct mp_image_params video_params; // last SD_CTRL_SET_VIDEO_PARAMS
+
     struct demux_packet *new_segment;
     struct demux_packet **cached_pkts;
     int cached_pkt_pos;
     int num_cached_pkts;
+
+    // Render-ahead result cache, protected by lock. Cleared on any change
+    // that could change the rendered output. Since all rendering happens
+    // with lock held, the entries always match the current state.
+    struct ahead_entry ahead_cache[AHEAD_CACHE_SIZE];
+    uint64_t ahead_use_counter;
+    uint64_t render_serial;     // incremented on each get_bitmaps() call
+    uint64_t shown_serial;      // serial of the last result returned to the VO
+    uint64_t ahead_hits, ahead_misses;
+    struct stats_ctx *stats;
+
+    // Render-ahead request, protected by ahead_lock (so that it can be
+    // updated without waiting for the renderer).
+    mp_mutex ahead_lock;
+    atomic_bool ahead_enabled;  // copy of can_render_ahead()
+    struct mp_thread_pool *ahead_pool;
+    bool ahead_busy;            // worker job queued or running
+    bool ahead_destroy;
+    struct mp_osd_res ahead_dim;
+    int ahead_format;
+    double ahead_pts[MAX_RENDER_AHEAD]; // video PTS
+    int ahead_num_pts;
+    int ahead_pos;              // next entry in ahead_pts to render
 };
 
 static void update_subtitle_speed(struct dec_sub *sub)
@@ -137,16 +195,52 @@ static void destroy_cached_pkts(struct dec_sub *sub)
     sub->num_cached_pkts = 0;
 }
 
+static bool can_render_ahead(struct dec_sub *sub)
+{
+    return sub->opts->sub_render_ahead > 0 && sub->sd->driver->render_ahead;
+}
+
+// Called locked (or during init/destruction).
+static void ahead_invalidate(struct dec_sub *sub)
+{
+    atomic_store(&sub->ahead_enabled, sub->sd && can_render_ahead(sub));
+    for (int n = 0; n < AHEAD_CACHE_SIZE; n++) {
+        struct ahead_entry *e = &sub->ahead_cache[n];
+        talloc_free(e->imgs);
+        *e = (struct ahead_entry){0};
+    }
+}
+
+// Called locked.
+static void preload_cancel(struct dec_sub *sub)
+{
+    if (sub->preload_busy) {
+        sub->preload_stop = true;
+        mp_dispatch_interrupt(sub->preload_waiter);
+    }
+}
+
 void sub_destroy(struct dec_sub *sub)
 {
     if (!sub)
         return;
+    mp_mutex_lock(&sub->lock);
+    preload_cancel(sub);
+    mp_mutex_unlock(&sub->lock);
+    // Waits for a running preload job.
+    talloc_free(sub->preload_pool);
+    mp_mutex_lock(&sub->ahead_lock);
+    sub->ahead_destroy = true;
+    mp_mutex_unlock(&sub->ahead_lock);
+    // Waits for a running render-ahead job.
+    talloc_free(sub->ahead_pool);
     demux_set_stream_wakeup_cb(sub->sh, NULL, NULL);
     if (sub->sd) {
         sub_reset(sub);
         sub->sd->driver->uninit(sub->sd);
     }
     talloc_free(sub->sd);
+    mp_mutex_destroy(&sub->ahead_lock);
     mp_mutex_destroy(&sub->lock);
     talloc_free(sub);
 }
@@ -208,11 +302,15 @@ struct dec_sub *sub_create(struct mpv_global *global, struct track *track,
     };
     sub->opts = sub->opts_cache->opts;
     sub->shared_opts = sub->shared_opts_cache->opts;
+    sub->stats = stats_ctx_create(sub, global, order == 1 ? "sub2" : "sub");
+    sub->preload_waiter = mp_dispatch_create(sub);
     mp_mutex_init(&sub->lock);
+    mp_mutex_init(&sub->ahead_lock);
 
     sub->sd = init_decoder(sub);
     if (sub->sd) {
         update_subtitle_speed(sub);
+        ahead_invalidate(sub);
         return sub;
     }
 
@@ -246,6 +344,7 @@ static void update_segment(struct dec_sub *sub)
         sub->sd->driver->decode(sub->sd, sub->new_segment);
         talloc_free(sub->new_segment);
         sub->new_segment = NULL;
+        ahead_invalidate(sub);
     }
 }
 
@@ -253,39 +352,114 @@ bool sub_can_preload(struct dec_sub *sub)
 {
     bool r;
     mp_mutex_lock(&sub->lock);
-    r = sub->sd->driver->accept_packets_in_advance && !sub->preload_attempted;
+    r = sub->sd->driver->accept_packets_in_advance && !sub->preload_attempted &&
+        !sub->preload_busy;
     mp_mutex_unlock(&sub->lock);
     return r;
 }
 
-void sub_preload(struct dec_sub *sub)
+// Called locked.
+static void preload_notify(struct dec_sub *sub)
 {
-    mp_mutex_lock(&sub->lock);
+    sub->preload_changed = true;
+    if (sub->wakeup_cb)
+        sub->wakeup_cb(sub->wakeup_ctx);
+}
 
-    struct mp_dispatch_queue *demux_waiter = mp_dispatch_create(NULL);
-    demux_set_stream_wakeup_cb(sub->sh, wakeup_demux, demux_waiter);
+static void preload_work(void *ctx)
+{
+    struct dec_sub *sub = ctx;
 
-    sub->preload_attempted = true;
+    stats_time_start(sub->stats, "preload");
+
+    int64_t last_notify = mp_time_ns();
+    mp_mutex_lock(&sub->lock);
+    while (!sub->preload_stop) {
+        mp_mutex_unlock(&sub->lock);
 
-    for (;;) {
+        // Reading may parse or convert the file, so don't hold the lock.
         struct demux_packet *pkt = NULL;
         int r = demux_read_packet_async(sub->sh, &pkt);
         if (r == 0) {
-            mp_dispatch_queue_process(demux_waiter, INFINITY);
+            mp_dispatch_queue_process(sub->preload_waiter, INFINITY);
+            mp_mutex_lock(&sub->lock);
             continue;
         }
+
+        mp_mutex_lock(&sub->lock);
         if (!pkt)
             break;
+        if (sub->preload_stop) {
+            demux_packet_pool_push(sub->packet_pool, pkt);
+            break;
+        }
         sub->sd->driver->decode(sub->sd, pkt);
         MP_TARRAY_APPEND(sub, sub->cached_pkts, sub->num_cached_pkts, pkt);
+        ahead_invalidate(sub);
+        sub->preload_changed = true;
+
+        // Let the player show the events decoded so far, without waking it
+        // up for every single packet.
+        if (mp_time_ns() - last_notify > MP_TIME_MS_TO_NS(50)) {
+            preload_notify(sub);
+            last_notify = mp_time_ns();
+        }
     }
 
     demux_set_stream_wakeup_cb(sub->sh, NULL, NULL);
-    talloc_free(demux_waiter);
+    if (sub->preload_stop) {
+        // Interrupted by a seek or reset; the player restarts it from the
+        // beginning. (Decoders skip packets they have already seen.)
+        sub->preload_attempted = false;
+        MP_VERBOSE(sub, "Preloading interrupted.\n");
+    } else {
+        MP_VERBOSE(sub, "Preloaded %d packets.\n", sub->num_cached_pkts);
+    }
+    sub->preload_busy = false;
+    sub->preload_stop = false;
+    preload_notify(sub);
+    mp_mutex_unlock(&sub->lock);
+
+    stats_time_end(sub->stats, "preload");
+}
+
+// Read and decode all packets of the stream on a worker thread. This returns
+// immediately; the decoded events become visible progressively. The demuxer
+// must have been seeked to the start of the file.
+void sub_preload(struct dec_sub *sub)
+{
+    mp_mutex_lock(&sub->lock);
+
+    sub->preload_attempted = true;
+
+    if (!sub->preload_pool)
+        sub->preload_pool = mp_thread_pool_create(NULL, 1, 1, 1);
+
+    demux_set_stream_wakeup_cb(sub->sh, wakeup_demux, sub->preload_waiter);
+
+    if (sub->preload_pool &&
+        mp_thread_pool_queue(sub->preload_pool, preload_work, sub))
+    {
+        sub->preload_busy = true;
+        sub->preload_stop = false;
+    } else {
+        demux_set_stream_wakeup_cb(sub->sh, NULL, NULL);
+        sub->preload_attempted = false;
+    }
 
     mp_mutex_unlock(&sub->lock);
 }
 
+// Set a callback that is invoked from a worker thread when a background
+// preload decoded new events. sub_read_packets() reports them as update.
+void sub_set_wakeup_cb(struct dec_sub *sub, void (*cb)(void *ctx), void *ctx)
+{
+    mp_mutex_lock(&sub->lock);
+    sub->wakeup_cb = cb;
+    sub->wakeup_ctx = ctx;
+    mp_mutex_unlock(&sub->lock);
+}
+
 static bool is_new_segment(struct dec_sub *sub, struct demux_packet *p)
 {
     return p->segmented &&
@@ -339,7 +513,9 @@ void sub_read_packets(struct dec_sub *sub, double video_pts, bool force,
     *packets_read = true;
     mp_mutex_lock(&sub->lock);
     video_pts = pts_to_subtitle(sub, video_pts);
-    while (1) {
+    // The preload job owns the demuxer stream, and the events it decodes are
+    // shown as soon as they arrive, so never wait for it.
+    while (!sub->preload_busy) {
         bool read_more = true;
         if (sub->sd->driver->accepts_packet)
             read_more = sub->sd->driver->accepts_packet(sub->sd, video_pts);
@@ -385,14 +561,20 @@ void sub_read_packets(struct dec_sub *sub, double video_pts, bool force,
             break;
         }
 
-        if (!(sub->preload_attempted && sub->sd->preload_ok))
+        if (!(sub->preload_attempted && sub->sd->preload_ok)) {
             sub->sd->driver->decode(sub->sd, pkt);
+            ahead_invalidate(sub);
+        }
     }
     if (sub->cached_pkts && sub->num_cached_pkts) {
         bool visible = is_packet_visible(sub->cached_pkts[sub->cached_pkt_pos], video_pts);
         *sub_updated = update_pkt_cache(sub, video_pts) || sub->sub_visible != visible;
         sub->sub_visible = visible;
     }
+    if (sub->preload_changed) {
+        *sub_updated = true;
+        sub->preload_changed = false;
+    }
     mp_mutex_unlock(&sub->lock);
 }
 
@@ -406,9 +588,96 @@ void sub_redecode_cached_packets(struct dec_sub *sub)
         sub->sd->driver->decode(sub->sd, sub->cached_pkts[index]);
         ++index;
     }
+    ahead_invalidate(sub);
     mp_mutex_unlock(&sub->lock);
 }
 
+static struct ahead_entry *ahead_find(struct dec_sub *sub, double pts,
+                                      struct mp_osd_res dim, int format)
+{
+    for (int n = 0; n < AHEAD_CACHE_SIZE; n++) {
+        struct ahead_entry *e = &sub->ahead_cache[n];
+        if (e->valid && e->pts == pts && e->format == format &&
+            osd_res_equals(e->dim, dim))
+            return e;
+    }
+    return NULL;
+}
+
+// Give imgs its own copy of the packed image. The decoder keeps a reference to
+// the image it packed into, and would have to copy all of it on the next
+// render if a cache entry still referenced it. Only the bounding box is copied.
+static void ahead_detach(struct sub_bitmaps *imgs)
+{
+    struct mp_image *src = imgs->packed;
+    if (!src || !imgs->packed_w || !imgs->packed_h)
+        return;
+
+    struct mp_image *dst = mp_image_alloc(src->imgfmt, imgs->packed_w,
+                                          imgs->packed_h);
+    if (!dst)
+        return; // keep sharing the image
+    memcpy_pic(dst->planes[0], src->planes[0],
+               imgs->packed_w * src->fmt.bpp[0] / 8, imgs->packed_h,
+               dst->stride[0], src->stride[0]);
+
+    for (int n = 0; n < imgs->num_parts; n++) {
+        struct sub_bitmap *b = &imgs->parts[n];
+        ptrdiff_t offset = (uint8_t *)b->bitmap - src->planes[0];
+        ptrdiff_t y = offset / src->stride[0];
+        b->bitmap = dst->planes[0] + y * dst->stride[0] +
+                    (offset - y * src->stride[0]);
+        b->stride = dst->stride[0];
+    }
+
+    talloc_free(src);
+    imgs->packed = talloc_steal(imgs, dst);
+}
+
+// Render and add the result to the cache. Called locked.
+static struct ahead_entry *ahead_render(struct dec_sub *sub, double pts,
+                                        struct mp_osd_res dim, int format)
+{
+    struct ahead_entry *e = &sub->ahead_cache[0];
+    for (int n = 1; n < AHEAD_CACHE_SIZE; n++) {
+        if (sub->ahead_cache[n].last_use < e->last_use)
+            e = &sub->ahead_cache[n];
+    }
+    talloc_free(e->imgs);
+
+    struct sub_bitmaps *imgs = sub->sd->driver->get_bitmaps(sub->sd, dim, format, pts);
+    if (imgs)
+        ahead_detach(imgs);
+    *e = (struct ahead_entry){
+        .valid = true,
+        .pts = pts,
+        .dim = dim,
+        .format = format,
+        .imgs = imgs,
+        .serial = ++sub->render_serial,
+        .changed = !imgs || imgs->change_id,
+        .last_use = ++sub->ahead_use_counter,
+    };
+    return e;
+}
+
+// Return a copy of the cached result. Called locked.
+static struct sub_bitmaps *ahead_get(struct dec_sub *sub, struct ahead_entry *e)
+{
+    e->last_use = ++sub->ahead_use_counter;
+
+    struct sub_bitmaps *res = e->imgs ? sub_bitmaps_copy(NULL, e->imgs) : NULL;
+    // The change_id returned by the decoder is relative to the previous
+    // get_bitmaps() call, which is not necessarily the frame shown last.
+    if (res) {
+        bool same = e->serial == sub->shown_serial ||
+                    (e->serial == sub->shown_serial + 1 && !e->changed);
+        res->change_id = same ? 0 : 1;
+    }
+    sub->shown_serial = e->serial;
+    return res;
+}
+
 // Unref sub_bitmaps.rc to free the result. May return NULL.
 struct sub_bitmaps *sub_get_bitmaps(struct dec_sub *sub, struct mp_osd_res dim,
                                     int format, double pts)
@@ -424,12 +693,89 @@ struct sub_bitmaps *sub_get_bitmaps(struct dec_sub *sub, struct mp_osd_res dim,
 
     if (!(sub->end != MP_NOPTS_VALUE && pts >= sub->end) &&
         sub->sd->driver->get_bitmaps)
-        res = sub->sd->driver->get_bitmaps(sub->sd, dim, format, pts);
+    {
+        if (can_render_ahead(sub) && pts != MP_NOPTS_VALUE) {
+            struct ahead_entry *e = ahead_find(sub, pts, dim, format);
+            if (e) {
+                sub->ahead_hits++;
+                stats_event(sub->stats, "render-ahead-hit");
+            } else {
+                sub->ahead_misses++;
+                stats_event(sub->stats, "render-ahead-miss");
+                e = ahead_render(sub, pts, dim, format);
+            }
+            stats_value(sub->stats, "render-ahead-hit-rate", 100.0 *
+                        sub->ahead_hits / (sub->ahead_hits + sub->ahead_misses));
+            res = ahead_get(sub, e);
+        } else {
+            res = sub->sd->driver->get_bitmaps(sub->sd, dim, format, pts);
+            sub->shown_serial = ++sub->render_serial;
+        }
+    }
 
     mp_mutex_unlock(&sub->lock);
     return res;
 }
 
+static void ahead_work(void *ctx)
+{
+    struct dec_sub *sub = ctx;
+
+    mp_mutex_lock(&sub->ahead_lock);
+    while (!sub->ahead_destroy && sub->ahead_pos < sub->ahead_num_pts) {
+        struct mp_osd_res dim = sub->ahead_dim;
+        int format = sub->ahead_format;
+        int index = sub->ahead_pos++;
+        double pts = sub->ahead_pts[index];
+        mp_mutex_unlock(&sub->ahead_lock);
+
+        mp_mutex_lock(&sub->lock);
+        pts = pts_to_subtitle(sub, pts);
+        // Don't render past segment boundaries; this needs a decoder switch.
+        bool ok = can_render_ahead(sub) && index < sub->opts->sub_render_ahead &&
+                  pts != MP_NOPTS_VALUE && !ahead_find(sub, pts, dim, format) &&
+                  !(sub->end != MP_NOPTS_VALUE && pts >= sub->end) &&
+                  !(sub->new_segment && pts >= sub->new_segment->start);
+        if (ok) {
+            stats_time_start(sub->stats, "render-ahead");
+            ahead_render(sub, pts, dim, format);
+            stats_time_end(sub->stats, "render-ahead");
+        }
+        mp_mutex_unlock(&sub->lock);
+
+        mp_mutex_lock(&sub->ahead_lock);
+    }
+    sub->ahead_busy = false;
+    mp_mutex_unlock(&sub->ahead_lock);
+}
+
+// Render the given video PTS values on a worker thread (in the given order),
+// so that sub_get_bitmaps() calls with the same parameters can return the
+// cached result. This replaces previously requested PTS values that were not
+// rendered yet. Does nothing if disabled with --sub-render-ahead. This never
+// waits for rendering to finish.
+void sub_render_ahead(struct dec_sub *sub, struct mp_osd_res dim, int format,
+                      const double *pts, int num_pts)
+{
+    if (!atomic_load(&sub->ahead_enabled) || dim.w <= 0 || dim.h <= 0)
+        return;
+
+    mp_mutex_lock(&sub->ahead_lock);
+    sub->ahead_dim = dim;
+    sub->ahead_format = format;
+    sub->ahead_num_pts = MPMIN(num_pts, MAX_RENDER_AHEAD);
+    for (int n = 0; n < sub->ahead_num_pts; n++)
+        sub->ahead_pts[n] = pts[n];
+    sub->ahead_pos = 0;
+    if (!sub->ahead_busy && sub->ahead_num_pts && !sub->ahead_destroy) {
+        if (!sub->ahead_pool)
+            sub->ahead_pool = mp_thread_pool_create(NULL, 1, 1, 1);
+        if (sub->ahead_pool && mp_thread_pool_queue(sub->ahead_pool, ahead_work, sub))
+            sub->ahead_busy = true;
+    }
+    mp_mutex_unlock(&sub->ahead_lock);
+}
+
 // The returned string is talloc'ed.
 char *sub_get_text(struct dec_sub *sub, double pts, enum sd_text_type type)
 {
@@ -481,11 +827,13 @@ struct sd_times sub_get_times(struct dec_sub *sub, double pts)
 void sub_reset(struct dec_sub *sub)
 {
     mp_mutex_lock(&sub->lock);
+    preload_cancel(sub);
     if (sub->sd->driver->reset)
         sub->sd->driver->reset(sub->sd);
     sub->last_pkt_pts = MP_NOPTS_VALUE;
     sub->last_vo_pts = MP_NOPTS_VALUE;
     destroy_cached_pkts(sub);
+    ahead_invalidate(sub);
     demux_packet_pool_push(sub->packet_pool, sub->new_segment);
     sub->new_segment = NULL;
     mp_mutex_unlock(&sub->lock);
@@ -496,6 +844,7 @@ void sub_select(struct dec_sub *sub, bool selected)
     mp_mutex_lock(&sub->lock);
     if (sub->sd->driver->select)
         sub->sd->driver->select(sub->sd, selected);
+    ahead_invalidate(sub);
     mp_mutex_unlock(&sub->lock);
 }
 
@@ -504,10 +853,14 @@ int sub_control(struct dec_sub *sub, enum sd_ctrl cmd, void *arg)
     int r = CONTROL_UNKNOWN;
     mp_mutex_lock(&sub->lock);
     bool propagate = false;
+    // Whether this can change the rendered subtitles. (Some of these are
+    // called on every playloop iteration.)
+    bool invalidate = false;
     switch (cmd) {
     case SD_CTRL_SET_VIDEO_DEF_FPS:
         sub->video_fps = *(double *)arg;
         update_subtitle_speed(sub);
+        invalidate = true;
         break;
     case SD_CTRL_SUB_STEP: {
         double *a = arg;
@@ -531,6 +884,14 @@ int sub_control(struct dec_sub *sub, enum sd_ctrl cmd, void *arg)
             // that clears all preloaded sub packets
             sub->preload_attempted = false;
         }
+        invalidate = true;
+        break;
+    }
+    case SD_CTRL_SET_VIDEO_PARAMS: {
+        struct mp_image_params *params = arg;
+        invalidate = !mp_image_params_equal(&sub->video_params, params);
+        sub->video_params = *params;
+        propagate = true;
         break;
     }
     default:
@@ -538,6 +899,8 @@ int sub_control(struct dec_sub *sub, enum sd_ctrl cmd, void *arg)
     }
     if (propagate && sub->sd->driver->control)
         r = sub->sd->driver->control(sub->sd, cmd, arg);
+    if (invalidate)
+        ahead_invalidate(sub);
     mp_mutex_unlock(&sub->lock);
     return r;
 }
@@ -553,6 +916,7 @@ void sub_set_play_dir(struct dec_sub *sub, int dir)
 {
     mp_mutex_lock(&sub->lock);
     sub->play_dir = dir;
+    ahead_invalidate(sub);
     mp_mutex_unlock(&sub->lock);
 }
 
@@ -44,11 +44,14 @@ void sub_destroy(struct dec_sub *sub);
 
 bool sub_can_preload(struct dec_sub *sub);
 void sub_preload(struct dec_sub *sub);
+void sub_set_wakeup_cb(struct dec_sub *sub, void (*cb)(void *ctx), void *ctx);
 void sub_redecode_cached_packets(struct dec_sub *sub);
 void sub_read_packets(struct dec_sub *sub, double video_pts, bool force,
                       bool *packets_read, bool *sub_updated);
 struct sub_bitmaps *sub_get_bitmaps(struct dec_sub *sub, struct mp_osd_res dim,
                                     int format, double pts);
+void sub_render_ahead(struct dec_sub *sub, struct mp_osd_res dim, int format,
+                      const double *pts, int num_pts);
 char *sub_get_text(struct dec_sub *sub, double pts, enum sd_text_type type);
 char *sub_ass_get_extradata(struct dec_sub *sub);
 struct sd_times sub_get_times(struct dec_sub *sub, double pts);
@@ -55,15 +55,42 @@ static const char *get_err(js_State *J)
 }
 
 
+// global[JOINED_REGEX] is all regexes which could be joined, as one regex
+#define JOINED_REGEX -1
+
 struct priv {
     js_State *J;
     int num_regexes;
-    int offset;
+    bool *joined;   // joined[n]: global[n] is part of global[JOINED_REGEX]
+    bool have_joined;
+    char *plain;    // plaintext buffer, reused
 };
 
 static void destruct_priv(void *p)
 {
     js_freestate(((struct priv *)p)->J);
+    talloc_free(((struct priv *)p)->plain);
+}
+
+static void join_regexes(struct sd_filter *ft, char **items)
+{
+    struct priv *p = ft->priv;
+
+    p->joined = talloc_zero_array(p, bool, p->num_regexes);
+    char *re = sd_filter_join_regexes(NULL, items, p->num_regexes, "(?:",
+                                      p->joined);
+    if (!re)
+        return;
+
+    if (p_regcomp(p->J, JOINED_REGEX, re, JS_REGEXP_I | JS_REGEXP_M)) {
+        MP_VERBOSE(ft, "jsre: could not join regexes: %s\n", get_err(p->J));
+        js_pop(p->J, 1);
+        for (int n = 0; n < p->num_regexes; n++)
+            p->joined[n] = false;
+    } else {
+        p->have_joined = true;
+    }
+    talloc_free(re);
 }
 
 static bool jsre_init(struct sd_filter *ft)
@@ -87,6 +114,8 @@ static bool jsre_init(struct sd_filter *ft)
     }
     talloc_set_destructor(p, destruct_priv);
 
+    char **items = NULL;
+
     for (int n = 0; ft->opts->jsre_items[n]; n++) {
         char *item = ft->opts->jsre_items[n];
 
@@ -97,44 +126,62 @@ static bool jsre_init(struct sd_filter *ft)
             continue;
         }
 
+        MP_TARRAY_GROW(p, items, p->num_regexes);
+        items[p->num_regexes] = item;
         p->num_regexes += 1;
     }
 
     if (!p->num_regexes)
         return false;
 
-    p->offset = sd_ass_fmt_offset(ft->event_format);
+    join_regexes(ft, items);
+    talloc_free(items);
     return true;
 }
 
-static struct demux_packet *jsre_filter(struct sd_filter *ft,
-                                      struct demux_packet *pkt)
+static bool match(struct sd_filter *ft, int n, const char *text)
 {
     struct priv *p = ft->priv;
-    char *text = bstrto0(NULL, sd_ass_pkt_text(ft, pkt, p->offset));
-    bool drop = false;
+    int found, err = p_regexec(p->J, n, text, &found);
+    if (err) {
+        MP_WARN(ft, "jsre: test regex %d: %s.\n", n, get_err(p->J));
+        js_pop(p->J, 1);
+    }
+    return !err && found;
+}
+
+static bool jsre_filter_text(struct sd_filter *ft, char *text)
+{
+    struct priv *p = ft->priv;
+    int level = ft->opts->rf_warn ? MSGL_WARN : MSGL_V;
 
     if (ft->opts->rf_plain)
-        sd_ass_to_plaintext(&text, text);
-
-    for (int n = 0; n < p->num_regexes; n++) {
-        int found, err = p_regexec(p->J, n, text, &found);
-        if (err == 0 && found) {
-            int level = ft->opts->rf_warn ? MSGL_WARN : MSGL_V;
-            MP_MSG(ft, level, "jsre: regex %d => drop: '%s'\n", n, text);
-            drop = true;
-            break;
-        } else if (err) {
-            MP_WARN(ft, "jsre: test regex %d: %s.\n", n, get_err(p->J));
-            js_pop(p->J, 1);
+        text = sd_ass_to_plaintext(&p->plain, text).start;
+
+    int found = -1;
+    if (p->have_joined && match(ft, JOINED_REGEX, text)) {
+        found = 0;
+        // Find out which one matched, only needed for the log message.
+        if (mp_msg_test(ft->log, level)) {
+            for (int n = 0; n < p->num_regexes; n++) {
+                if (p->joined[n] && match(ft, n, text)) {
+                    found = n;
+                    break;
+                }
+            }
         }
     }
+    for (int n = 0; n < p->num_regexes && found < 0; n++) {
+        if (!p->joined[n] && match(ft, n, text))
+            found = n;
+    }
 
-    talloc_free(text);
-    return drop ? NULL : pkt;
+    if (found >= 0)
+        MP_MSG(ft, level, "jsre: regex %d => drop: '%s'\n", found, text);
+    return found < 0;
 }
 
 const struct sd_filter_functions sd_filter_jsre = {
-    .init   = jsre_init,
-    .filter = jsre_filter,
+    .init        = jsre_init,
+    .filter_text = jsre_filter_text,
 };
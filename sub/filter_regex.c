@@ -8,11 +8,38 @@
 #include "sd.h"
 
 struct priv {
-    int offset;
     regex_t *regexes;
     int num_regexes;
+    // All regexes which could be joined, as one regex (if any).
+    regex_t joined_regex;
+    bool *joined;   // joined[n]: regexes[n] is part of joined_regex
+    bool have_joined;
+    char *plain;    // plaintext buffer, reused
 };
 
+static void join_regexes(struct sd_filter *ft, char **items)
+{
+    struct priv *p = ft->priv;
+
+    p->joined = talloc_zero_array(p, bool, p->num_regexes);
+    char *re = sd_filter_join_regexes(NULL, items, p->num_regexes, "(",
+                                      p->joined);
+    if (!re)
+        return;
+
+    int err = regcomp(&p->joined_regex, re,
+                      REG_ICASE | REG_EXTENDED | REG_NOSUB | REG_NEWLINE);
+    if (err) {
+        MP_VERBOSE(ft, "Could not join regular expressions, matching them "
+                   "separately.\n");
+        for (int n = 0; n < p->num_regexes; n++)
+            p->joined[n] = false;
+    } else {
+        p->have_joined = true;
+    }
+    talloc_free(re);
+}
+
 static bool rf_init(struct sd_filter *ft)
 {
     if (strcmp(ft->codec, "ass") != 0)
@@ -24,6 +51,8 @@ static bool rf_init(struct sd_filter *ft)
     struct priv *p = talloc_zero(ft, struct priv);
     ft->priv = p;
 
+    char **items = NULL;
+
     for (int n = 0; ft->opts->rf_items && ft->opts->rf_items[n]; n++) {
         char *item = ft->opts->rf_items[n];
 
@@ -38,13 +67,16 @@ static bool rf_init(struct sd_filter *ft)
             continue;
         }
 
+        MP_TARRAY_GROW(p, items, p->num_regexes);
+        items[p->num_regexes] = item;
         p->num_regexes += 1;
     }
 
     if (!p->num_regexes)
         return false;
 
-    p->offset = sd_ass_fmt_offset(ft->event_format);
+    join_regexes(ft, items);
+    talloc_free(items);
     return true;
 }
 
@@ -54,36 +86,52 @@ static void rf_uninit(struct sd_filter *ft)
 
     for (int n = 0; n < p->num_regexes; n++)
         regfree(&p->regexes[n]);
+    if (p->have_joined)
+        regfree(&p->joined_regex);
+    talloc_free(p->plain);
 }
 
-static struct demux_packet *rf_filter(struct sd_filter *ft,
-                                      struct demux_packet *pkt)
+static bool match(struct sd_filter *ft, regex_t *preg, int n, const char *text)
+{
+    int err = regexec(preg, text, 0, NULL, 0);
+    if (err && err != REG_NOMATCH)
+        MP_WARN(ft, "Error on regexec() on regex %d.\n", n);
+    return err == 0;
+}
+
+static bool rf_filter_text(struct sd_filter *ft, char *text)
 {
     struct priv *p = ft->priv;
-    char *text = bstrto0(NULL, sd_ass_pkt_text(ft, pkt, p->offset));
-    bool drop = false;
+    int level = ft->opts->rf_warn ? MSGL_WARN : MSGL_V;
 
     if (ft->opts->rf_plain)
-        sd_ass_to_plaintext(&text, text);
-
-    for (int n = 0; n < p->num_regexes; n++) {
-        int err = regexec(&p->regexes[n], text, 0, NULL, 0);
-        if (err == 0) {
-            int level = ft->opts->rf_warn ? MSGL_WARN : MSGL_V;
-            MP_MSG(ft, level, "Matching regex %d => drop: '%s'\n", n, text);
-            drop = true;
-            break;
-        } else if (err != REG_NOMATCH) {
-            MP_WARN(ft, "Error on regexec() on regex %d.\n", n);
+        text = sd_ass_to_plaintext(&p->plain, text).start;
+
+    int found = -1;
+    if (p->have_joined && match(ft, &p->joined_regex, -1, text)) {
+        found = 0;
+        // Find out which one matched, only needed for the log message.
+        if (mp_msg_test(ft->log, level)) {
+            for (int n = 0; n < p->num_regexes; n++) {
+                if (p->joined[n] && match(ft, &p->regexes[n], n, text)) {
+                    found = n;
+                    break;
+                }
+            }
         }
     }
+    for (int n = 0; n < p->num_regexes && found < 0; n++) {
+        if (!p->joined[n] && match(ft, &p->regexes[n], n, text))
+            found = n;
+    }
 
-    talloc_free(text);
-    return drop ? NULL : pkt;
+    if (found >= 0)
+        MP_MSG(ft, level, "Matching regex %d => drop: '%s'\n", found, text);
+    return found < 0;
 }
 
 const struct sd_filter_functions sd_filter_regex = {
-    .init   = rf_init,
-    .uninit = rf_uninit,
-    .filter = rf_filter,
+    .init        = rf_init,
+    .uninit      = rf_uninit,
+    .filter_text = rf_filter_text,
 };
@@ -39,9 +39,13 @@ struct buffer {
     int pos;
 };
 
-static void init_buf(struct buffer *buf, int length)
+struct priv {
+    struct buffer buf; // write buffer, reused between events
+};
+
+static void init_buf(struct sd_filter *sd, struct buffer *buf, int length)
 {
-    buf->string = talloc_size(NULL, length);
+    MP_TARRAY_GROW(sd->priv, buf->string, length - 1);
     buf->pos = 0;
     buf->length = length;
 }
@@ -334,26 +338,21 @@ static void remove_leading_hyphen_space(struct sd_filter *sd, int start_pos,
 // Filter ASS formatted string for SDH
 //
 // Parameters:
-//     data         ASS line
-//     length       length of ASS line
-//     toff         Text offset from data. required: 0 <= toff <= length
+//     text         ASS "Text" field, \0-terminated
+//     length       length of text
 //
-// Returns  a talloc allocated string with filtered ASS data (may be the same
-// content as original if no SDH was found) which must be released
-// by caller using talloc_free.
+// The filtered ASS data (may be the same content as original if no SDH was
+// found) is written back to text, which it never exceeds.
 //
-// Returns NULL if filtering resulted in all of ASS data being removed so no
+// Returns false if filtering resulted in all of ASS data being removed so no
 // subtitle should be output
-static char *filter_SDH(struct sd_filter *sd, char *data, int length, ptrdiff_t toff)
+static bool filter_SDH(struct sd_filter *sd, char *text, int length)
 {
-    struct buffer writebuf;
-    struct buffer *buf = &writebuf;
-    init_buf(buf, length + 1); // with room for terminating '\0'
+    struct priv *p = sd->priv;
+    struct buffer *buf = &p->buf;
+    init_buf(sd, buf, length + 1); // with room for terminating '\0'
 
-    // pre-text headers into buf, rp is the (null-terminated) remaining text
-    char *ass = talloc_strndup(NULL, data, length), *rp = ass;
-    while (rp - ass < toff)
-        append(sd, buf, *rp++);
+    char *rp = text;
 
     bool contains_text = false;  // true if non SDH text was found
     bool line_with_text = false; // if last line contained text
@@ -425,16 +424,15 @@ static char *filter_SDH(struct sd_filter *sd, char *data, int length, ptrdiff_t
     } else {
         contains_text = true;
     }
-    talloc_free(ass);
 
     if (contains_text) {
         // the ASS data contained normal text after filtering
         append(sd, buf, '\0'); // '\0' terminate
-        return buf->string;
+        memcpy(text, buf->string, buf->pos);
+        return true;
     } else {
         // all data removed by filtering
-        talloc_free(buf->string);
-        return NULL;
+        return false;
     }
 }
 
@@ -451,37 +449,20 @@ static bool sdh_init(struct sd_filter *ft)
         return false;
     }
 
+    ft->priv = talloc_zero(ft, struct priv);
     return true;
 }
 
-static struct demux_packet *sdh_filter(struct sd_filter *ft,
-                                       struct demux_packet *pkt)
+static bool sdh_filter_text(struct sd_filter *ft, char *text)
 {
-    bstr text = sd_ass_pkt_text(ft, pkt, sd_ass_fmt_offset(ft->event_format));
-    if (!text.start || !text.len || pkt->len >= INT_MAX)
-        return pkt;  // we don't touch it
-
-    ptrdiff_t toff = text.start - pkt->buffer;
-    char *line = filter_SDH(ft, (char *)pkt->buffer, (int)pkt->len, toff);
-    if (!line)
-        return NULL;
-    if (0 == bstrcmp0((bstr){(char *)pkt->buffer, pkt->len}, line)) {
-        talloc_free(line);
-        return pkt;  // unmodified, no need to allocate new packet
-    }
-
-    // Stupidly, this copies it again. One could possibly allocate the packet
-    // for writing in the first place (new_demux_packet()) and use
-    // demux_packet_shorten().
-    struct demux_packet *npkt = new_demux_packet_from(ft->packet_pool, line, strlen(line));
-    if (npkt)
-        demux_packet_copy_attribs(npkt, pkt);
+    size_t len = strlen(text);
+    if (!len || len >= INT_MAX)
+        return true;  // we don't touch it
 
-    talloc_free(line);
-    return npkt;
+    return filter_SDH(ft, text, len);
 }
 
 const struct sd_filter_functions sd_filter_sdh = {
-    .init   = sdh_init,
-    .filter = sdh_filter,
+    .init        = sdh_init,
+    .filter_text = sdh_filter_text,
 };
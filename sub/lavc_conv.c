@@ -17,6 +17,7 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <inttypes.h>
 
 #include <libavcodec/avcodec.h>
 #include <libavutil/intreadwrite.h>
@@ -30,6 +31,13 @@
 #include "misc/bstr.h"
 #include "sd.h"
 
+enum native_format {
+    NATIVE_NONE,
+    NATIVE_SRT,
+    NATIVE_WEBVTT,
+    NATIVE_WEBVTT_WEBM,
+};
+
 struct lavc_conv {
     struct mp_log *log;
     struct mp_subtitle_opts *opts;
@@ -41,8 +49,28 @@ struct lavc_conv {
     char *extradata;
     AVSubtitle cur;
     char **cur_list;
+
+    // For formats converted without libavcodec in the common case. The
+    // ReadOrder field of all events is set from our own counter, so that
+    // events converted in either way never get the same one.
+    enum native_format native;
+    int readorder;
+    bstr line;          // event produced by the native converter
+    void *lavc_lines;   // talloc parent of renumbered libavcodec events
+    int64_t num_native, num_lavc;
 };
 
+static enum native_format get_native_format(const char *format)
+{
+    if (strcmp(format, "subrip") == 0 || strcmp(format, "text") == 0)
+        return NATIVE_SRT;
+    if (strcmp(format, "webvtt") == 0)
+        return NATIVE_WEBVTT;
+    if (strcmp(format, "webvtt-webm") == 0)
+        return NATIVE_WEBVTT_WEBM;
+    return NATIVE_NONE;
+}
+
 static const char *get_lavc_format(const char *format)
 {
     // For the hack involving parse_webvtt().
@@ -61,6 +89,7 @@ struct lavc_conv *lavc_conv_create(struct sd *sd)
     priv->opts = sd->opts;
     priv->cur_list = talloc_array(priv, char*, 0);
     priv->codec = sd->codec->codec;
+    priv->native = get_native_format(priv->codec);
     AVCodecContext *avctx = NULL;
     AVDictionary *opts = NULL;
     const char *fmt = get_lavc_format(priv->codec);
@@ -224,6 +253,46 @@ static int parse_webvtt(AVPacket *in, AVPacket *pkt)
     return 0;
 }
 
+// Convert the packet to a single event without libavcodec. Returns false if
+// libavcodec needs to be used.
+static bool decode_native(struct lavc_conv *priv, struct demux_packet *packet,
+                          double *sub_pts, double *sub_duration)
+{
+    bstr data = {packet->buffer, packet->len};
+    if (!data.len)
+        return false;
+
+    priv->line.len = 0;
+    bstr_xappend_asprintf(priv, &priv->line, "%d,0,Default,,0,0,0,,",
+                          priv->readorder);
+
+    bool ok = false;
+    switch (priv->native) {
+    case NATIVE_SRT:
+        ok = sd_srt_to_ass(priv, &priv->line, data);
+        break;
+    case NATIVE_WEBVTT_WEBM:
+        data = sd_webvtt_webm_text(data);
+        if (!data.len)
+            return false; // let the libavcodec path report the error
+        MP_FALLTHROUGH;
+    case NATIVE_WEBVTT:
+        ok = sd_webvtt_to_ass(priv, &priv->line, data);
+        break;
+    }
+    if (!ok)
+        return false;
+
+    priv->readorder++;
+    // Same as with the libavcodec path, including the rounding of the
+    // duration to the {1, 1000} time base.
+    AVRational tb = priv->avctx->time_base;
+    *sub_pts = packet->pts;
+    *sub_duration = packet->duration > 0 ?
+        mp_pts_from_av((int64_t)(packet->duration / av_q2d(tb)), &tb) : 0;
+    return true;
+}
+
 // Return a NULL-terminated list of ASS event lines and have
 // the AVSubtitle display PTS and duration set to input
 // double variables.
@@ -236,6 +305,13 @@ char **lavc_conv_decode(struct lavc_conv *priv, struct demux_packet *packet,
     int num_cur = 0;
 
     avsubtitle_free(&priv->cur);
+    TA_FREEP(&priv->lavc_lines);
+
+    if (priv->native && decode_native(priv, packet, sub_pts, sub_duration)) {
+        priv->num_native++;
+        MP_TARRAY_APPEND(priv, priv->cur_list, num_cur, priv->line.start);
+        goto done;
+    }
 
     mp_set_av_packet(priv->avpkt, packet, &avctx->time_base);
     if (priv->avpkt->pts < 0)
@@ -282,8 +358,17 @@ char **lavc_conv_decode(struct lavc_conv *priv, struct demux_packet *packet,
             char *ass_line = priv->cur.rects[i]->ass;
             if (!ass_line)
                 continue;
+            if (priv->native) {
+                // Replace libavcodec's ReadOrder with our own.
+                if (!priv->lavc_lines)
+                    priv->lavc_lines = talloc_new(NULL);
+                char *text = strchr(ass_line, ',');
+                ass_line = talloc_asprintf(priv->lavc_lines, "%d%s",
+                                           priv->readorder++, text ? text : ",");
+            }
             MP_TARRAY_APPEND(priv, priv->cur_list, num_cur, ass_line);
         }
+        priv->num_lavc += priv->native && priv->cur.num_rects;
     }
 
 done:
@@ -304,6 +389,11 @@ void lavc_conv_reset(struct lavc_conv *priv)
 
 void lavc_conv_uninit(struct lavc_conv *priv)
 {
+    if (priv->native) {
+        MP_DBG(priv, "Converted %"PRId64" events natively, %"PRId64" with "
+               "libavcodec.\n", priv->num_native, priv->num_lavc);
+    }
+    talloc_free(priv->lavc_lines);
     avsubtitle_free(&priv->cur);
     avcodec_free_context(&priv->avctx);
     mp_free_av_packet(&priv->avpkt);
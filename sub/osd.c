@@ -33,6 +33,7 @@
 #include "common/global.h"
 #include "common/msg.h"
 #include "common/stats.h"
+#include "misc/thread_pool.h"
 #include "player/client.h"
 #include "player/command.h"
 #include "osd.h"
@@ -167,7 +168,11 @@ struct osd_state *osd_create(struct mpv_global *global)
         .stats = stats_ctx_create(osd, global, "osd"),
     };
     mp_mutex_init(&osd->lock);
+    mp_mutex_init(&osd->ass_lock);
     osd->opts = osd->opts_cache->opts;
+    // Rendering waits on object and subtitle decoder locks, so it can't use
+    // the shared executor. Threads are created on demand.
+    osd->render_pool = mp_thread_pool_create(osd, 0, 0, MAX_OSD_PARTS - 1);
 
     for (int n = 0; n < MAX_OSD_PARTS; n++) {
         struct osd_object *obj = talloc(osd, struct osd_object);
@@ -177,6 +182,7 @@ struct osd_state *osd_create(struct mpv_global *global)
             .progbar_state = {.type = -1},
             .vo_change_id = 1,
         };
+        mp_mutex_init(&obj->lock);
         osd->objs[n] = obj;
     }
 
@@ -190,37 +196,50 @@ void osd_free(struct osd_state *osd)
 {
     if (!osd)
         return;
+    talloc_free(osd->render_pool);
     osd_destroy_backend(osd);
     talloc_free(osd->objs[OSDTYPE_EXTERNAL2]->external2);
+    for (int n = 0; n < MAX_OSD_PARTS; n++) {
+        talloc_free(osd->objs[n]->last_imgs);
+        mp_mutex_destroy(&osd->objs[n]->lock);
+    }
+    mp_mutex_destroy(&osd->ass_lock);
     mp_mutex_destroy(&osd->lock);
     talloc_free(osd);
 }
 
+// Call with obj->lock held, after changing the object.
+void osd_object_changed(struct osd_state *osd, struct osd_object *obj)
+{
+    atomic_fetch_add(&obj->change_gen, 1);
+    atomic_store(&osd->want_redraw_notification, true);
+}
+
 void osd_set_text(struct osd_state *osd, const char *text)
 {
-    mp_mutex_lock(&osd->lock);
     struct osd_object *osd_obj = osd->objs[OSDTYPE_OSD];
+    mp_mutex_lock(&osd_obj->lock);
     if (!text)
         text = "";
     if (strcmp(osd_obj->text, text) != 0) {
         talloc_free(osd_obj->text);
         osd_obj->text = talloc_strdup(osd_obj, text);
         osd_obj->osd_changed = true;
-        osd->want_redraw_notification = true;
+        osd_object_changed(osd, osd_obj);
     }
-    mp_mutex_unlock(&osd->lock);
+    mp_mutex_unlock(&osd_obj->lock);
 }
 
 void osd_set_sub(struct osd_state *osd, int index, struct dec_sub *dec_sub)
 {
-    mp_mutex_lock(&osd->lock);
     if (index >= 0 && index < 2) {
         struct osd_object *obj = osd->objs[OSDTYPE_SUB + index];
+        mp_mutex_lock(&obj->lock);
         obj->sub = dec_sub;
         obj->vo_change_id += 1;
+        mp_mutex_unlock(&obj->lock);
     }
-    osd->want_redraw_notification = true;
-    mp_mutex_unlock(&osd->lock);
+    atomic_store(&osd->want_redraw_notification, true);
 }
 
 bool osd_get_render_subs_in_filter(struct osd_state *osd)
@@ -237,11 +256,17 @@ void osd_set_render_subs_in_filter(struct osd_state *osd, bool s)
     if (osd->render_subs_in_filter != s) {
         osd->render_subs_in_filter = s;
 
+        for (int n = 0; n < MAX_OSD_PARTS; n++)
+            mp_mutex_lock(&osd->objs[n]->lock);
         int change_id = 0;
         for (int n = 0; n < MAX_OSD_PARTS; n++)
             change_id = MPMAX(change_id, osd->objs[n]->vo_change_id);
-        for (int n = 0; n < MAX_OSD_PARTS; n++)
+        for (int n = 0; n < MAX_OSD_PARTS; n++) {
             osd->objs[n]->vo_change_id = change_id + 1;
+            osd->objs[n]->last_valid = false;
+        }
+        for (int n = MAX_OSD_PARTS - 1; n >= 0; n--)
+            mp_mutex_unlock(&osd->objs[n]->lock);
     }
     mp_mutex_unlock(&osd->lock);
 }
@@ -258,8 +283,8 @@ double osd_get_force_video_pts(struct osd_state *osd)
 
 void osd_set_progbar(struct osd_state *osd, struct osd_progbar_state *s)
 {
-    mp_mutex_lock(&osd->lock);
     struct osd_object *osd_obj = osd->objs[OSDTYPE_OSD];
+    mp_mutex_lock(&osd_obj->lock);
     osd_obj->progbar_state.type = s->type;
     osd_obj->progbar_state.value = s->value;
     osd_obj->progbar_state.num_stops = s->num_stops;
@@ -269,27 +294,29 @@ void osd_set_progbar(struct osd_state *osd, struct osd_progbar_state *s)
                sizeof(osd_obj->progbar_state.stops[0]) * s->num_stops);
     }
     osd_obj->osd_changed = true;
-    osd->want_redraw_notification = true;
-    mp_mutex_unlock(&osd->lock);
+    osd_object_changed(osd, osd_obj);
+    mp_mutex_unlock(&osd_obj->lock);
 }
 
 void osd_set_external2(struct osd_state *osd, struct sub_bitmaps *imgs)
 {
-    mp_mutex_lock(&osd->lock);
     struct osd_object *obj = osd->objs[OSDTYPE_EXTERNAL2];
+    mp_mutex_lock(&obj->lock);
     talloc_free(obj->external2);
     obj->external2 = sub_bitmaps_copy(NULL, imgs);
     obj->vo_change_id += 1;
-    osd->want_redraw_notification = true;
-    mp_mutex_unlock(&osd->lock);
+    osd_object_changed(osd, obj);
+    mp_mutex_unlock(&obj->lock);
 }
 
+// Call with obj->lock held.
 static void check_obj_resize(struct osd_state *osd, struct mp_osd_res res,
                              struct osd_object *obj)
 {
     if (!osd_res_equals(res, obj->vo_res)) {
         obj->vo_res = res;
         obj->osd_changed = true;
+        atomic_fetch_add(&obj->change_gen, 1);
         mp_client_broadcast_event_external(osd->global->client_api,
                                            MP_EVENT_WIN_RESIZE, NULL);
     }
@@ -304,30 +331,31 @@ static void check_obj_resize(struct osd_state *osd, struct mp_osd_res res,
 // Unnecessary for anything else.
 void osd_resize(struct osd_state *osd, struct mp_osd_res res)
 {
-    mp_mutex_lock(&osd->lock);
     int types[] = {OSDTYPE_OSD, OSDTYPE_EXTERNAL, OSDTYPE_EXTERNAL2, -1};
-    for (int n = 0; types[n] >= 0; n++)
-        check_obj_resize(osd, res, osd->objs[types[n]]);
-    mp_mutex_unlock(&osd->lock);
+    for (int n = 0; types[n] >= 0; n++) {
+        struct osd_object *obj = osd->objs[types[n]];
+        mp_mutex_lock(&obj->lock);
+        check_obj_resize(osd, res, obj);
+        mp_mutex_unlock(&obj->lock);
+    }
 }
 
+// Call with obj->lock held.
 static struct sub_bitmaps *render_object(struct osd_state *osd,
                                          struct osd_object *obj,
                                          struct mp_osd_res osdres, double video_pts,
-                                         const bool sub_formats[SUBBITMAP_COUNT])
+                                         int format)
 {
-    int format = SUBBITMAP_LIBASS;
-    if (!sub_formats[format] || osd->opts->force_rgba_osd)
-        format = SUBBITMAP_BGRA;
-
     struct sub_bitmaps *res = NULL;
 
     check_obj_resize(osd, osdres, obj);
 
     if (obj->type == OSDTYPE_SUB) {
+        obj->vo_format = format;
         if (obj->sub && sub_is_primary_visible(obj->sub))
             res = sub_get_bitmaps(obj->sub, obj->vo_res, format, video_pts);
     } else if (obj->type == OSDTYPE_SUB2) {
+        obj->vo_format = format;
         if (obj->sub && sub_is_secondary_visible(obj->sub))
             res = sub_get_bitmaps(obj->sub, obj->vo_res, format, video_pts);
     } else if (obj->type == OSDTYPE_EXTERNAL2) {
@@ -354,6 +382,98 @@ static struct sub_bitmaps *render_object(struct osd_state *osd,
     return res;
 }
 
+static const char *const render_stat_names[OSDTYPE_COUNT] = {
+    [OSDTYPE_SUB]       = "sub-render",
+    [OSDTYPE_SUB2]      = "sub2-render",
+    [OSDTYPE_OSD]       = "osd-render",
+    [OSDTYPE_EXTERNAL]  = "external-render",
+    [OSDTYPE_EXTERNAL2] = "external2-render",
+};
+
+struct render_job;
+
+struct render_task {
+    struct render_job *job;
+    int index;
+};
+
+struct render_job {
+    struct osd_state *osd;
+    struct mp_osd_res res;
+    double video_pts;
+    int format;
+    struct osd_object *objs[MAX_OSD_PARTS];
+    struct sub_bitmaps *imgs[MAX_OSD_PARTS];
+    int change_ids[MAX_OSD_PARTS];
+    struct render_task tasks[MAX_OSD_PARTS];
+
+    mp_mutex lock;
+    mp_cond wakeup;
+    int pending;
+};
+
+// Render one object of the job; run in parallel for independent objects.
+// osd->lock is held by the caller.
+static void render_job_object(struct render_job *job, int index)
+{
+    struct osd_state *osd = job->osd;
+    struct osd_object *obj = job->objs[index];
+
+    // If a non-subtitle object is currently locked by someone updating it
+    // (e.g. a script setting an overlay), don't wait for it if the previous
+    // result is still valid; the update will trigger a redraw anyway.
+    bool can_reuse = !obj->is_sub && obj->last_valid &&
+                     osd_res_equals(obj->last_res, job->res) &&
+                     obj->last_format == job->format &&
+                     obj->last_change_gen == atomic_load(&obj->change_gen);
+    if (!can_reuse) {
+        mp_mutex_lock(&obj->lock);
+    } else if (mp_mutex_trylock(&obj->lock) != 0) {
+        struct sub_bitmaps *imgs = sub_bitmaps_copy(NULL, obj->last_imgs);
+        if (imgs)
+            imgs->change_id = obj->last_vo_change_id;
+        job->imgs[index] = imgs;
+        job->change_ids[index] = obj->last_vo_change_id;
+        return;
+    }
+
+    const char *stat_name = render_stat_names[obj->type];
+    stats_time_start(osd->stats, stat_name);
+
+    struct sub_bitmaps *imgs =
+        render_object(osd, obj, job->res, job->video_pts, job->format);
+
+    stats_time_end(osd->stats, stat_name);
+
+    if (!obj->is_sub) {
+        talloc_free(obj->last_imgs);
+        obj->last_imgs = sub_bitmaps_copy(NULL, imgs);
+        obj->last_res = job->res;
+        obj->last_format = job->format;
+        obj->last_change_gen = atomic_load(&obj->change_gen);
+        obj->last_vo_change_id = obj->vo_change_id;
+        obj->last_valid = true;
+    }
+
+    job->change_ids[index] = obj->vo_change_id;
+
+    mp_mutex_unlock(&obj->lock);
+
+    job->imgs[index] = imgs;
+}
+
+static void render_task_work(void *ptr)
+{
+    struct render_task *task = ptr;
+    struct render_job *job = task->job;
+    render_job_object(job, task->index);
+
+    mp_mutex_lock(&job->lock);
+    job->pending--;
+    mp_cond_signal(&job->wakeup);
+    mp_mutex_unlock(&job->lock);
+}
+
 // Render OSD to a list of bitmap and return it. The returned object is
 // refcounted. Typically you should hold it only for a short time, and then
 // release it.
@@ -378,6 +498,18 @@ struct sub_bitmap_list *osd_render(struct osd_state *osd, struct mp_osd_res res,
     if (draw_flags & OSD_DRAW_SUB_FILTER)
         draw_flags |= OSD_DRAW_SUB_ONLY;
 
+    int format = SUBBITMAP_LIBASS;
+    if (!formats[format] || osd->opts->force_rgba_osd)
+        format = SUBBITMAP_BGRA;
+
+    struct render_job job = {
+        .osd = osd,
+        .res = res,
+        .video_pts = video_pts,
+        .format = format,
+    };
+    int num_objs = 0;
+
     for (int n = 0; n < MAX_OSD_PARTS; n++) {
         struct osd_object *obj = osd->objs[n];
 
@@ -390,13 +522,34 @@ struct sub_bitmap_list *osd_render(struct osd_state *osd, struct mp_osd_res res,
         if ((draw_flags & OSD_DRAW_OSD_ONLY) && obj->is_sub)
             continue;
 
-        char *stat_type_render = obj->is_sub ? "sub-render" : "osd-render";
-        stats_time_start(osd->stats, stat_type_render);
-
-        struct sub_bitmaps *imgs =
-            render_object(osd, obj, res, video_pts, formats);
+        job.objs[num_objs++] = obj;
+    }
 
-        stats_time_end(osd->stats, stat_type_render);
+    // The objects don't share any state (other than osd->lock, which stays
+    // held, and the OSD libass library, which osd_libass.c serializes), so
+    // render them concurrently. The first one is rendered on the
+    // calling thread.
+    mp_mutex_init(&job.lock);
+    mp_cond_init(&job.wakeup);
+    job.pending = MPMAX(num_objs - 1, 0);
+    for (int n = 1; n < num_objs; n++) {
+        job.tasks[n] = (struct render_task){&job, n};
+        if (!osd->render_pool ||
+            !mp_thread_pool_queue(osd->render_pool, render_task_work, &job.tasks[n]))
+            render_task_work(&job.tasks[n]);
+    }
+    if (num_objs)
+        render_job_object(&job, 0);
+    mp_mutex_lock(&job.lock);
+    while (job.pending)
+        mp_cond_wait(&job.wakeup, &job.lock);
+    mp_mutex_unlock(&job.lock);
+    mp_cond_destroy(&job.wakeup);
+    mp_mutex_destroy(&job.lock);
+
+    for (int n = 0; n < num_objs; n++) {
+        struct osd_object *obj = job.objs[n];
+        struct sub_bitmaps *imgs = job.imgs[n];
 
         if (imgs && imgs->num_parts > 0) {
             if (formats[imgs->format]) {
@@ -409,7 +562,7 @@ struct sub_bitmap_list *osd_render(struct osd_state *osd, struct mp_osd_res res,
             }
         }
 
-        list->change_id += obj->vo_change_id;
+        list->change_id += job.change_ids[n];
 
         talloc_free(imgs);
     }
@@ -423,6 +576,23 @@ struct sub_bitmap_list *osd_render(struct osd_state *osd, struct mp_osd_res res,
     return list;
 }
 
+// Tell the subtitle renderers the video PTS values of the frames that are going
+// to be rendered next (in order), so that they can render them in advance. The
+// last OSD size used by osd_render() is assumed.
+void osd_render_ahead(struct osd_state *osd, const double *pts, int num_pts)
+{
+    if (atomic_load(&osd->force_video_pts) != MP_NOPTS_VALUE)
+        return;
+
+    for (int n = OSDTYPE_SUB; n <= OSDTYPE_SUB2; n++) {
+        struct osd_object *obj = osd->objs[n];
+        mp_mutex_lock(&obj->lock);
+        if (obj->sub && obj->vo_res.w > 0)
+            sub_render_ahead(obj->sub, obj->vo_res, obj->vo_format, pts, num_pts);
+        mp_mutex_unlock(&obj->lock);
+    }
+}
+
 // Warning: this function should be considered legacy. Use osd_render() instead.
 void osd_draw(struct osd_state *osd, struct mp_osd_res res,
               double video_pts, int draw_flags,
@@ -503,28 +673,30 @@ struct mp_osd_res osd_res_from_image_params(const struct mp_image_params *p)
 void osd_changed(struct osd_state *osd)
 {
     mp_mutex_lock(&osd->lock);
+    for (int n = 0; n < MAX_OSD_PARTS; n++)
+        mp_mutex_lock(&osd->objs[n]->lock);
     osd->objs[OSDTYPE_OSD]->osd_changed = true;
-    osd->want_redraw_notification = true;
     // Done here for a lack of a better place.
     m_config_cache_update(osd->opts_cache);
+    for (int n = MAX_OSD_PARTS - 1; n >= 0; n--) {
+        osd_object_changed(osd, osd->objs[n]);
+        mp_mutex_unlock(&osd->objs[n]->lock);
+    }
     mp_mutex_unlock(&osd->lock);
 }
 
 bool osd_query_and_reset_want_redraw(struct osd_state *osd)
 {
-    mp_mutex_lock(&osd->lock);
-    bool r = osd->want_redraw_notification;
-    osd->want_redraw_notification = false;
-    mp_mutex_unlock(&osd->lock);
-    return r;
+    return atomic_exchange(&osd->want_redraw_notification, false);
 }
 
 struct mp_osd_res osd_get_vo_res(struct osd_state *osd)
 {
-    mp_mutex_lock(&osd->lock);
     // Any OSDTYPE is fine; but it mustn't be a subtitle one (can have lower res.)
-    struct mp_osd_res res = osd->objs[OSDTYPE_OSD]->vo_res;
-    mp_mutex_unlock(&osd->lock);
+    struct osd_object *obj = osd->objs[OSDTYPE_OSD];
+    mp_mutex_lock(&obj->lock);
+    struct mp_osd_res res = obj->vo_res;
+    mp_mutex_unlock(&obj->lock);
     return res;
 }
 
@@ -73,6 +73,14 @@ struct sub_bitmaps {
     // box. (The origin of the box is at (0,0).)
     int packed_w, packed_h;
 
+    // Optional versioning of the packed image contents, which allows updating
+    // only the changed parts of a copy (like a texture). packed_version is a
+    // globally unique ID of the contents, or 0 if unknown. If
+    // packed_base_version is not 0, the contents are the same as the
+    // contents with that version, except within packed_dirty.
+    uint64_t packed_version, packed_base_version;
+    struct mp_rect packed_dirty;
+
     int change_id;  // Incremented on each change (0 is never used)
 
     bool video_color_space; // True if the bitmap is in video color space
@@ -217,6 +225,8 @@ struct sub_bitmap_list *osd_render(struct osd_state *osd, struct mp_osd_res res,
                                    double video_pts, int draw_flags,
                                    const bool formats[SUBBITMAP_COUNT]);
 
+void osd_render_ahead(struct osd_state *osd, const double *pts, int num_pts);
+
 struct mp_image;
 void osd_draw_on_image(struct osd_state *osd, struct mp_osd_res res,
                        double video_pts, int draw_flags, struct mp_image *dest);
@@ -41,55 +41,90 @@ static const char osd_font_pfb[] =
 static void append_ass(struct ass_state *ass, struct mp_osd_res *res,
                        ASS_Image **img_list, bool *changed);
 
+// Call with osd->ass_lock held.
 static void create_ass_renderer(struct osd_state *osd, struct ass_state *ass)
 {
     if (ass->render)
         return;
 
-    ass->log = mp_log_new(NULL, osd->log, "libass");
-    ass->library = mp_ass_init(osd->global, osd->opts->osd_style, ass->log);
-    ass_add_font(ass->library, "mpv-osd-symbols", (void *)osd_font_pfb,
-                 sizeof(osd_font_pfb) - 1);
+    if (!osd->ass_library) {
+        osd->ass_log = mp_log_new(osd, osd->log, "libass");
+        osd->ass_library = mp_ass_init(osd->global, osd->opts->osd_style,
+                                       osd->ass_log);
+        ass_add_font(osd->ass_library, "mpv-osd-symbols", (void *)osd_font_pfb,
+                     sizeof(osd_font_pfb) - 1);
+    }
+    if (osd->num_idle_renderers) {
+        struct osd_renderer r = osd->idle_renderers[--osd->num_idle_renderers];
+        ass->render = r.render;
+        ass->cache = r.cache;
+    }
+
+    if (ass->render) {
+        mp_ass_cache_reused(ass->cache);
+        return;
+    }
 
-    ass->render = ass_renderer_init(ass->library);
+    ass->render = ass_renderer_init(osd->ass_library);
     if (!ass->render)
         abort();
+    ass->cache = mp_ass_cache_register(NULL, osd->global);
 
     mp_ass_configure_fonts(ass->render, osd->opts->osd_style,
-                           osd->global, ass->log);
+                           osd->global, osd->ass_log);
     ass_set_pixel_aspect(ass->render, 1.0);
 }
 
-static void destroy_ass_renderer(struct ass_state *ass)
+static void free_renderer(struct osd_renderer r)
+{
+    ass_renderer_done(r.render);
+    talloc_free(r.cache);
+}
+
+// Free the track, and keep the renderer for the next create_ass_renderer().
+// Call with osd->ass_lock held.
+static void destroy_ass_renderer(struct osd_state *osd, struct ass_state *ass)
 {
     if (ass->track)
         ass_free_track(ass->track);
     ass->track = NULL;
-    if (ass->render)
-        ass_renderer_done(ass->render);
+    if (ass->render) {
+        struct osd_renderer r = {ass->render, ass->cache};
+        if (osd->num_idle_renderers < OSD_MAX_IDLE_RENDERERS) {
+            mp_ass_cache_set_idle(r.cache);
+            osd->idle_renderers[osd->num_idle_renderers++] = r;
+        } else {
+            free_renderer(r);
+        }
+    }
     ass->render = NULL;
-    if (ass->library)
-        ass_library_done(ass->library);
-    ass->library = NULL;
-    talloc_free(ass->log);
-    ass->log = NULL;
+    ass->cache = NULL;
 }
 
-static void destroy_external(struct osd_external *ext)
+static void destroy_external(struct osd_state *osd, struct osd_external *ext)
 {
-    destroy_ass_renderer(&ext->ass);
+    destroy_ass_renderer(osd, &ext->ass);
     talloc_free(ext);
 }
 
 void osd_destroy_backend(struct osd_state *osd)
 {
+    mp_mutex_lock(&osd->ass_lock);
     for (int n = 0; n < MAX_OSD_PARTS; n++) {
         struct osd_object *obj = osd->objs[n];
-        destroy_ass_renderer(&obj->ass);
+        destroy_ass_renderer(osd, &obj->ass);
         for (int i = 0; i < obj->num_externals; i++)
-            destroy_external(obj->externals[i]);
+            destroy_external(osd, obj->externals[i]);
         obj->num_externals = 0;
     }
+    for (int n = 0; n < osd->num_idle_renderers; n++)
+        free_renderer(osd->idle_renderers[n]);
+    osd->num_idle_renderers = 0;
+    if (osd->ass_library)
+        ass_library_done(osd->ass_library);
+    osd->ass_library = NULL;
+    TA_FREEP(&osd->ass_log);
+    mp_mutex_unlock(&osd->ass_lock);
 }
 
 static void update_playres(struct ass_state *ass, struct mp_osd_res *vo_res)
@@ -121,7 +156,7 @@ static void create_ass_track(struct osd_state *osd, struct osd_object *obj,
     ASS_Track *track = ass->track;
     struct mp_osd_render_opts *opts = osd->opts;
     if (!track)
-        track = ass->track = ass_new_track(ass->library);
+        track = ass->track = ass_new_track(osd->ass_library);
 
     track->track_type = TRACK_TYPE_ASS;
     track->Timer = 100.;
@@ -135,7 +170,8 @@ static void create_ass_track(struct osd_state *osd, struct osd_object *obj,
 #if LIBASS_VERSION >= 0x01703010
     ass_configure_prune(track, opts->osd_ass_prune_delay * 1000.0);
 #endif
-    ass_set_cache_limits(ass->render, opts->osd_glyph_limit, opts->osd_bitmap_max_size);
+    mp_ass_cache_set_limits(ass->cache, opts->osd_glyph_limit,
+                            opts->osd_bitmap_max_size);
     update_playres(ass, &obj->vo_res);
 }
 
@@ -289,12 +325,14 @@ static void update_osd_text(struct osd_state *osd, struct osd_object *obj)
 
 void osd_get_text_size(struct osd_state *osd, int *out_screen_h, int *out_font_h)
 {
-    mp_mutex_lock(&osd->lock);
     struct osd_object *obj = osd->objs[OSDTYPE_OSD];
+    mp_mutex_lock(&obj->lock);
+    mp_mutex_lock(&osd->ass_lock);
     ASS_Style *style = prepare_osd_ass(osd, obj);
     *out_screen_h = obj->ass.track->PlayResY - style->MarginV;
     *out_font_h = style->FontSize;
-    mp_mutex_unlock(&osd->lock);
+    mp_mutex_unlock(&osd->ass_lock);
+    mp_mutex_unlock(&obj->lock);
 }
 
 // align: -1 .. +1
@@ -557,8 +595,9 @@ static int cmp_zorder(const void *pa, const void *pb)
 
 void osd_set_external(struct osd_state *osd, struct osd_external_ass *ov)
 {
-    mp_mutex_lock(&osd->lock);
     struct osd_object *obj = osd->objs[OSDTYPE_EXTERNAL];
+    mp_mutex_lock(&obj->lock);
+    mp_mutex_lock(&osd->ass_lock);
     bool zorder_changed = false;
     int index = -1;
 
@@ -586,16 +625,16 @@ void osd_set_external(struct osd_state *osd, struct osd_external_ass *ov)
     if (!ov->format) {
         if (!entry->ov.hidden) {
             obj->changed = true;
-            osd->want_redraw_notification = true;
+            osd_object_changed(osd, obj);
         }
-        destroy_external(entry);
+        destroy_external(osd, entry);
         MP_TARRAY_REMOVE_AT(obj->externals, obj->num_externals, index);
         goto done;
     }
 
     if (!entry->ov.hidden || !ov->hidden) {
         obj->changed = true;
-        osd->want_redraw_notification = true;
+        osd_object_changed(osd, obj);
     }
 
     entry->ov.format = ov->format;
@@ -639,23 +678,26 @@ void osd_set_external(struct osd_state *osd, struct osd_external_ass *ov)
     }
 
 done:
-    mp_mutex_unlock(&osd->lock);
+    mp_mutex_unlock(&osd->ass_lock);
+    mp_mutex_unlock(&obj->lock);
 }
 
 void osd_set_external_remove_owner(struct osd_state *osd, void *owner)
 {
-    mp_mutex_lock(&osd->lock);
     struct osd_object *obj = osd->objs[OSDTYPE_EXTERNAL];
+    mp_mutex_lock(&obj->lock);
+    mp_mutex_lock(&osd->ass_lock);
     for (int n = obj->num_externals - 1; n >= 0; n--) {
         struct osd_external *e = obj->externals[n];
         if (e->ov.owner == owner) {
-            destroy_external(e);
+            destroy_external(osd, e);
             MP_TARRAY_REMOVE_AT(obj->externals, obj->num_externals, n);
             obj->changed = true;
-            osd->want_redraw_notification = true;
+            osd_object_changed(osd, obj);
         }
     }
-    mp_mutex_unlock(&osd->lock);
+    mp_mutex_unlock(&osd->ass_lock);
+    mp_mutex_unlock(&obj->lock);
 }
 
 static void append_ass(struct ass_state *ass, struct mp_osd_res *res,
@@ -672,7 +714,8 @@ static void append_ass(struct ass_state *ass, struct mp_osd_res *res,
     ass_set_pixel_aspect(ass->render, res->display_par);
 
     int ass_changed;
-    *img_list = ass_render_frame(ass->render, ass->track, 0, &ass_changed);
+    *img_list = mp_ass_render_frame(ass->cache, ass->render, ass->track, 0,
+                                    &ass_changed);
 
     ass->changed |= ass_changed;
 
@@ -685,15 +728,17 @@ static void append_ass(struct ass_state *ass, struct mp_osd_res *res,
 struct sub_bitmaps *osd_object_get_bitmaps(struct osd_state *osd,
                                            struct osd_object *obj, int format)
 {
-    if (obj->type == OSDTYPE_OSD) {
-        if (obj->osd_changed) {
-            update_osd(osd, obj);
-        } else {
-            mp_require(obj->ass_packer);
-            goto done;
-        }
+    if (obj->type == OSDTYPE_OSD && !obj->osd_changed) {
+        mp_require(obj->ass_packer);
+        goto done;
     }
 
+    // The images stay valid until the next render call of the same renderer,
+    // which is owned by this object, so they can be packed without the lock.
+    mp_mutex_lock(&osd->ass_lock);
+    if (obj->type == OSDTYPE_OSD)
+        update_osd(osd, obj);
+
     if (!obj->ass_packer)
         obj->ass_packer = mp_ass_packer_alloc(obj);
 
@@ -709,6 +754,7 @@ struct sub_bitmaps *osd_object_get_bitmaps(struct osd_state *osd,
                        &obj->ass_imgs[n + 1], &obj->changed);
         }
     }
+    mp_mutex_unlock(&osd->ass_lock);
 
 done:;
     struct sub_bitmaps out_imgs = {0};
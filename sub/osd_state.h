@@ -19,19 +19,29 @@ enum mp_osdtype {
 };
 
 struct ass_state {
-    struct mp_log *log;
     struct ass_track *track;
     struct ass_renderer *render;
-    struct ass_library *library;
+    struct mp_ass_cache_client *cache;
     int res_x, res_y;
     bool changed;
     struct mp_osd_res vo_res; // last known value
 };
 
+// Locking: osd_state.lock protects the fields in osd_state, and is held during
+// osd_render(). Each osd_object has its own lock for its state, so that objects
+// can be updated and rendered independently. Lock order is osd_state.lock
+// before osd_object.lock. osd_state.opts can change only while holding all of
+// these locks, so holding any of them is enough to read it.
 struct osd_object {
+    mp_mutex lock;
+
     int type; // OSDTYPE_*
     bool is_sub;
 
+    // Incremented after each change made by the osd_set_*() functions.
+    // Not used for subtitles, which change with the video PTS anyway.
+    atomic_int change_gen;
+
     // OSDTYPE_OSD
     bool osd_changed;
     char *text;
@@ -50,8 +60,18 @@ struct osd_object {
     // VO cache state
     int vo_change_id;
     struct mp_osd_res vo_res;
+    int vo_format; // last format passed to sub_get_bitmaps()
     bool vo_had_output;
 
+    // Last result of osd_render() for this object, protected by
+    // osd_state.lock instead of the object lock.
+    struct sub_bitmaps *last_imgs;
+    struct mp_osd_res last_res;
+    int last_format;
+    int last_change_gen;
+    int last_vo_change_id;
+    bool last_valid;
+
     // Internally used by osd_libass.c
     bool changed;
     struct ass_state ass;
@@ -65,6 +85,14 @@ struct osd_external {
     struct ass_state ass;
 };
 
+// Maximum number of unused libass renderers kept by osd_state.
+#define OSD_MAX_IDLE_RENDERERS 4
+
+struct osd_renderer {
+    struct ass_renderer *render;
+    struct mp_ass_cache_client *cache;
+};
+
 struct osd_state {
     mp_mutex lock;
 
@@ -74,7 +102,7 @@ struct osd_state {
     _Atomic double force_video_pts;
 
     bool want_redraw;
-    bool want_redraw_notification;
+    atomic_bool want_redraw_notification;
 
     struct m_config_cache *opts_cache;
     struct mp_osd_render_opts *opts;
@@ -83,8 +111,26 @@ struct osd_state {
     struct stats_ctx *stats;
 
     struct mp_draw_sub_cache *draw_cache;
+
+    // Used by osd_render() to render objects in parallel.
+    struct mp_thread_pool *render_pool;
+
+    // Used by osd_libass.c. All OSD renderers use the same library. Renderers
+    // of removed objects are kept for reuse, with their font setup and caches.
+    // libass doesn't allow using objects of one library concurrently, so
+    // ass_lock is held while any of them (renderers, tracks) is used, and
+    // protects these fields. It's acquired after any other OSD lock. Packing
+    // the rendered images happens outside of it.
+    mp_mutex ass_lock;
+    struct mp_log *ass_log;
+    struct ass_library *ass_library;
+    struct osd_renderer idle_renderers[OSD_MAX_IDLE_RENDERERS];
+    int num_idle_renderers;
 };
 
+// defined in osd.c
+void osd_object_changed(struct osd_state *osd, struct osd_object *obj);
+
 // defined in osd_libass.c
 struct sub_bitmaps *osd_object_get_bitmaps(struct osd_state *osd,
                                            struct osd_object *obj, int format);
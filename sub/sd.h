@@ -42,6 +42,9 @@ struct sd {
 struct sd_functions {
     const char *name;
     bool accept_packets_in_advance;
+    // get_bitmaps() can be called for any pts without affecting the result
+    // of later calls, so it's safe to render upcoming frames in advance.
+    bool render_ahead;
     int  (*init)(struct sd *sd);
     void (*decode)(struct sd *sd, struct demux_packet *packet);
     void (*reset)(struct sd *sd);
@@ -67,6 +70,11 @@ bool lavc_conv_is_styled(struct lavc_conv *priv);
 void lavc_conv_reset(struct lavc_conv *priv);
 void lavc_conv_uninit(struct lavc_conv *priv);
 
+// text_conv.c
+bool sd_srt_to_ass(void *ta_parent, bstr *dst, bstr src);
+bool sd_webvtt_to_ass(void *ta_parent, bstr *dst, bstr src);
+bstr sd_webvtt_webm_text(bstr src);
+
 struct mp_sub_filter_opts {
     bool sub_filter_SDH;
     bool sub_filter_SDH_harder;
@@ -81,7 +89,6 @@ struct mp_sub_filter_opts {
 struct sd_filter {
     struct mpv_global *global;
     struct mp_log *log;
-    struct demux_packet_pool *packet_pool;
     struct mp_sub_filter_opts *opts;
     const struct sd_filter_functions *driver;
 
@@ -95,18 +102,11 @@ struct sd_filter {
 struct sd_filter_functions {
     bool (*init)(struct sd_filter *ft);
 
-    // Filter an ASS event (usually in the Matroska format, but event_format
-    // can be used to determine details).
-    // Returning NULL is interpreted as dropping the event completely.
-    // Returning pkt makes it no-op.
-    // If the returned packet is not pkt or NULL, it must have been properly
-    // allocated.
-    // pkt is owned by the caller (and freed by the caller when needed).
-    // Note: as by normal demux_packet rules, you must not modify any fields in
-    //       it, or the data referenced by it. You must create a new demux_packet
-    //       when modifying data.
-    struct demux_packet *(*filter)(struct sd_filter *ft,
-                                   struct demux_packet *pkt);
+    // Filter the "Text" field of an ASS event.
+    // text is a \0-terminated buffer owned by the filter chain. The filter
+    // may modify it in place, but must not make it longer.
+    // Returning false drops the event completely.
+    bool (*filter_text)(struct sd_filter *ft, char *text);
 
     void (*uninit)(struct sd_filter *ft);
 };
@@ -115,16 +115,34 @@ extern const struct sd_filter_functions sd_filter_sdh;
 extern const struct sd_filter_functions sd_filter_regex;
 extern const struct sd_filter_functions sd_filter_jsre;
 
+// All enabled filters for an ASS track. Events are filtered in a single copy
+// (reused between events), which is passed through all filters in place, so
+// filtering an event normally doesn't allocate anything.
+struct sd_filter_chain;
 
-// convenience utils for filters with ass codec
+// opts is referenced, and must stay valid for the lifetime of the chain.
+// Returns a chain with no filters if none are enabled.
+struct sd_filter_chain *sd_filter_chain_create(void *ta_parent,
+                                               struct mpv_global *global,
+                                               struct mp_log *log,
+                                               struct mp_sub_filter_opts *opts,
+                                               const char *event_format);
+
+// Filter an event (in the Matroska format). Returns false if the event was
+// dropped. Otherwise, *event is either unchanged, or set to the filtered
+// event, which stays valid until the next call or the chain is freed.
+bool sd_filter_chain_apply(struct sd_filter_chain *c, bstr *event);
 
-// num commas to skip at an ass-event before the "Text" field (always last)
-// (doesn't change, can be retrieved once on filter init)
-int sd_ass_fmt_offset(const char *event_format);
 
-// the event (pkt->buffer) "Text" content according to the calculated offset.
-// on malformed event: warns and returns (bstr){NULL,0}
-bstr sd_ass_pkt_text(struct sd_filter *ft, struct demux_packet *pkt, int offset);
+// convenience utils for filters with ass codec
+
+// Join regexes into one alternation, so they can be matched in one pass.
+// Each item is enclosed in open and ")", e.g. "(?:a)|(?:b)" for open="(?:".
+// Items with backreferences are left out, as enclosing them into a group could
+// renumber the groups they refer to; joined[n] is set to whether items[n] was
+// included. Returns NULL if less than 2 items could be joined.
+char *sd_filter_join_regexes(void *ta_parent, char **items, int num_items,
+                             const char *open, bool *joined);
 
 // convert \0-terminated "Text" (ass) content to plaintext, possibly in-place.
 // result.start is *out, result.len is strlen(in) or smaller.
@@ -133,4 +151,7 @@ bstr sd_ass_pkt_text(struct sd_filter *ft, struct demux_packet *pkt, int offset)
 // *out will not be reallocated if *out == in.
 bstr sd_ass_to_plaintext(char **out, const char *in);
 
+// Like sd_ass_to_plaintext(), but append the plaintext to *b.
+void sd_ass_append_plaintext(bstr *b, const char *in);
+
 #endif
@@ -32,8 +32,9 @@
 #include "options/path.h"
 #include "common/common.h"
 #include "common/msg.h"
+#include "common/stats.h"
 #include "demux/demux.h"
-#include "demux/packet_pool.h"
+#include "misc/interval_tree.h"
 #include "video/csputils.h"
 #include "video/mp_image.h"
 #include "dec_sub.h"
@@ -43,13 +44,13 @@
 struct sd_ass_priv {
     struct ass_library *ass_library;
     struct ass_renderer *ass_renderer;
+    struct mp_ass_cache_client *ass_cache;
     struct ass_track *ass_track;
     struct ass_track *shadow_track; // for --sub-ass=no rendering
     bool ass_configured;
     bool is_converted;
     struct lavc_conv *converter;
-    struct sd_filter **filters;
-    int num_filters;
+    struct sd_filter_chain *filter_chain;
     bool clear_once;
     struct mp_ass_packer *packer;
     struct sub_bitmap_copy_cache *copy_cache;
@@ -57,16 +58,28 @@ struct sd_ass_priv {
     struct mp_image_params video_params;
     struct mp_image_params last_params;
     struct mp_osd_res osd;
+    // Packets in order of first appearance (demux_packet.seen_pos indexes
+    // into this), and a hash table of indexes into it for lookup by (pos, pts).
     struct seen_packet *seen_packets;
     int num_seen_packets;
-    int *packets_animated;
-    int num_packets_animated;
+    int *seen_hash;         // open addressing, -1 for empty slots
+    unsigned seen_hash_size; // power of 2, or 0
     bool check_animated;
+    // Index of ass_track->events by display time. Covers the first
+    // mp_interval_tree_num() events, and is synced lazily by update_index().
+    struct mp_interval_tree *index;
+    // Incremented whenever events are removed from ass_track, which shifts
+    // the remaining ones. The index is valid only for index_gen == events_gen.
+    uint64_t events_gen;
+    uint64_t index_gen;
+    int *index_ids;             // query result scratch buffer
+    int num_index_ids;
 };
 
 struct seen_packet {
     int64_t pos;
     double pts;
+    int animated; // -1 is unknown
 };
 
 #undef OPT_BASE_STRUCT
@@ -100,18 +113,6 @@ const struct m_sub_options mp_sub_filter_opts = {
 static void mangle_colors(struct sd *sd, struct sub_bitmaps *parts);
 static void fill_plaintext(struct sd *sd, double pts);
 
-static const struct sd_filter_functions *const filters[] = {
-    // Note: list order defines filter order.
-    &sd_filter_sdh,
-#if HAVE_POSIX
-    &sd_filter_regex,
-#endif
-#if HAVE_JAVASCRIPT
-    &sd_filter_jsre,
-#endif
-    NULL,
-};
-
 // Add default styles, if the track does not have any styles yet.
 // Apply style overrides if the user provides any.
 static void mp_ass_add_default_styles(struct sd *sd, ASS_Track *track, struct mp_subtitle_opts *opts,
@@ -195,13 +196,7 @@ static void filters_destroy(struct sd *sd)
 {
     struct sd_ass_priv *ctx = sd->priv;
 
-    for (int n = 0; n < ctx->num_filters; n++) {
-        struct sd_filter *ft = ctx->filters[n];
-        if (ft->driver->uninit)
-            ft->driver->uninit(ft);
-        talloc_free(ft);
-    }
-    ctx->num_filters = 0;
+    TA_FREEP(&ctx->filter_chain);
 }
 
 static void filters_init(struct sd *sd)
@@ -210,23 +205,11 @@ static void filters_init(struct sd *sd)
 
     filters_destroy(sd);
 
-    for (int n = 0; filters[n]; n++) {
-        struct sd_filter *ft = talloc_ptrtype(ctx, ft);
-        *ft = (struct sd_filter){
-            .global = sd->global,
-            .log = sd->log,
-            .packet_pool = demux_packet_pool_get(sd->global),
-            .opts = mp_get_config_group(ft, sd->global, &mp_sub_filter_opts),
-            .driver = filters[n],
-            .codec = "ass",
-            .event_format = talloc_strdup(ft, ctx->ass_track->event_format),
-        };
-        if (ft->driver->init(ft)) {
-            MP_TARRAY_APPEND(ctx, ctx->filters, ctx->num_filters, ft);
-        } else {
-            talloc_free(ft);
-        }
-    }
+    struct mp_sub_filter_opts *opts =
+        mp_get_config_group(NULL, sd->global, &mp_sub_filter_opts);
+    ctx->filter_chain = sd_filter_chain_create(ctx, sd->global, sd->log, opts,
+                                               ctx->ass_track->event_format);
+    talloc_steal(ctx->filter_chain, opts);
 }
 
 static void enable_output(struct sd *sd, bool enable)
@@ -237,8 +220,12 @@ static void enable_output(struct sd *sd, bool enable)
     if (ctx->ass_renderer) {
         ass_renderer_done(ctx->ass_renderer);
         ctx->ass_renderer = NULL;
+        TA_FREEP(&ctx->ass_cache);
     } else {
         ctx->ass_renderer = ass_renderer_init(ctx->ass_library);
+        ctx->ass_cache = mp_ass_cache_register(ctx, sd->global);
+        mp_ass_cache_set_limits(ctx->ass_cache, sd->opts->sub_glyph_limit,
+                                sd->opts->sub_bitmap_max_size);
 
         mp_ass_configure_fonts(ctx->ass_renderer, sd->opts->sub_style,
                                sd->global, sd->log);
@@ -261,6 +248,7 @@ static void assobjects_init(struct sd *sd)
 
     ctx->ass_track = ass_new_track(ctx->ass_library);
     ctx->ass_track->track_type = TRACK_TYPE_ASS;
+    ctx->events_gen++;
 
     ctx->shadow_track = ass_new_track(ctx->ass_library);
     ctx->shadow_track->PlayResX = MP_ASS_FONT_PLAYRESX;
@@ -287,7 +275,6 @@ static void assobjects_init(struct sd *sd)
 #endif
 
     enable_output(sd, true);
-    ass_set_cache_limits(ctx->ass_renderer, sd->opts->sub_glyph_limit, sd->opts->sub_bitmap_max_size);
 }
 
 static void assobjects_destroy(struct sd *sd)
@@ -305,6 +292,8 @@ static int init(struct sd *sd)
     struct sd_ass_priv *ctx = talloc_zero(sd, struct sd_ass_priv);
     sd->priv = ctx;
 
+    ctx->index = mp_interval_tree_new(ctx);
+
     // Note: accept "null" as alias for "ass", so EDL delay_open subtitle
     //       streams work.
     if (strcmp(sd->codec->codec, "ass") != 0 &&
@@ -320,6 +309,8 @@ static int init(struct sd *sd)
     filters_init(sd);
 
     ctx->packer = mp_ass_packer_alloc(ctx);
+    mp_ass_packer_set_stats(ctx->packer, stats_ctx_create(ctx, sd->global,
+                            sd->order == 1 ? "sub2-atlas" : "sub-atlas"));
 
     // Subtitles does not have any profile value, so put the converted type as a profile.
     const char *_Atomic *desc = ctx->converter ? &sd->codec->codec_profile : &sd->codec->codec_desc;
@@ -374,14 +365,17 @@ static void filter_and_add(struct sd *sd, struct demux_packet *pkt)
     ASS_Track *track = ctx->ass_track;
     int old_n_events = track->n_events;
 
-    for (int n = 0; n < ctx->num_filters; n++) {
-        struct sd_filter *ft = ctx->filters[n];
-        struct demux_packet *npkt = ft->driver->filter(ft, pkt);
-        if (pkt != npkt && pkt != orig_pkt)
-            talloc_free(pkt);
-        pkt = npkt;
-        if (!pkt)
-            return;
+    bstr event = {pkt->buffer, pkt->len};
+    if (!sd_filter_chain_apply(ctx->filter_chain, &event))
+        return;
+
+    // The filtered event is in a buffer owned by the filter chain.
+    struct demux_packet filtered_pkt;
+    if (event.start != pkt->buffer) {
+        filtered_pkt = *pkt;
+        filtered_pkt.buffer = event.start;
+        filtered_pkt.len = event.len;
+        pkt = &filtered_pkt;
     }
 
     ass_process_chunk(ctx->ass_track, pkt->buffer, pkt->len,
@@ -391,7 +385,9 @@ static void filter_and_add(struct sd *sd, struct demux_packet *pkt)
     // This bookkeeping only has any practical use for ASS subs
     // over a VO with no video.
     if (!ctx->is_converted) {
-        if (!pkt->seen) {
+        // Filters don't copy the seen fields to packets they create.
+        int *animated = &ctx->seen_packets[orig_pkt->seen_pos].animated;
+        if (!orig_pkt->seen) {
             for (int n = track->n_events - 1; n >= 0; n--) {
                 if (n + 1 == old_n_events || pkt->animated == 1)
                     break;
@@ -401,51 +397,87 @@ static void filter_and_add(struct sd *sd, struct demux_packet *pkt)
                 if (ctx->check_animated && pkt->animated != 1)
                     pkt->animated = is_animated(event->Text);
             }
-            MP_TARRAY_APPEND(ctx, ctx->packets_animated, ctx->num_packets_animated, pkt->animated);
+            *animated = pkt->animated;
         } else {
-            if (ctx->check_animated && ctx->packets_animated[pkt->seen_pos] == -1) {
+            if (ctx->check_animated && *animated == -1) {
                 for (int n = track->n_events - 1; n >= 0; n--) {
                     if (n + 1 == old_n_events || pkt->animated == 1)
                         break;
                     ASS_Event *event = &track->events[n];
-                    ctx->packets_animated[pkt->seen_pos] = is_animated(event->Text);
-                    pkt->animated = ctx->packets_animated[pkt->seen_pos];
+                    *animated = is_animated(event->Text);
+                    pkt->animated = *animated;
                 }
             } else {
-                pkt->animated = ctx->packets_animated[pkt->seen_pos];
+                pkt->animated = *animated;
             }
         }
     }
+}
+
+static unsigned seen_packet_hash(int64_t pos, double pts)
+{
+    uint64_t bits;
+    pts = pts == 0 ? 0 : pts; // -0.0 == 0.0
+    memcpy(&bits, &pts, sizeof(bits));
+    uint64_t h = (uint64_t)pos * 0x9E3779B97F4A7C15ULL ^ bits;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 32);
+}
 
-    if (pkt != orig_pkt)
-        talloc_free(pkt);
+static void clear_seen_packets(struct sd *sd)
+{
+    struct sd_ass_priv *priv = sd->priv;
+    priv->num_seen_packets = 0;
+    for (unsigned n = 0; n < priv->seen_hash_size; n++)
+        priv->seen_hash[n] = -1;
+}
+
+static void grow_seen_hash(struct sd *sd)
+{
+    struct sd_ass_priv *priv = sd->priv;
+    priv->seen_hash_size = MPMAX(priv->seen_hash_size * 2, 256);
+    priv->seen_hash = talloc_realloc(priv, priv->seen_hash, int,
+                                     priv->seen_hash_size);
+    unsigned mask = priv->seen_hash_size - 1;
+    for (unsigned n = 0; n < priv->seen_hash_size; n++)
+        priv->seen_hash[n] = -1;
+    for (int n = 0; n < priv->num_seen_packets; n++) {
+        struct seen_packet *p = &priv->seen_packets[n];
+        unsigned i = seen_packet_hash(p->pos, p->pts) & mask;
+        while (priv->seen_hash[i] >= 0)
+            i = (i + 1) & mask;
+        priv->seen_hash[i] = n;
+    }
 }
 
 // Test if the packet with the given file position and pts was already consumed.
 // Return false if the packet is new (and add it to the internal list), and
-// return true if it was already seen.
+// return true if it was already seen. In both cases, packet->seen_pos is set
+// to the packet's entry in priv->seen_packets.
 static bool check_packet_seen(struct sd *sd, struct demux_packet *packet)
 {
     struct sd_ass_priv *priv = sd->priv;
-    int a = 0;
-    int b = priv->num_seen_packets;
-    while (a < b) {
-        int mid = a + (b - a) / 2;
-        struct seen_packet *seen_packet = &priv->seen_packets[mid];
+
+    // Keep the load factor <= 1/2.
+    if ((priv->num_seen_packets + 1) * 2 > priv->seen_hash_size)
+        grow_seen_hash(sd);
+
+    unsigned mask = priv->seen_hash_size - 1;
+    unsigned i = seen_packet_hash(packet->pos, packet->pts) & mask;
+    while (priv->seen_hash[i] >= 0) {
+        struct seen_packet *seen_packet = &priv->seen_packets[priv->seen_hash[i]];
         if (packet->pos == seen_packet->pos && packet->pts == seen_packet->pts) {
-            packet->seen_pos = mid;
+            packet->seen_pos = priv->seen_hash[i];
             return true;
         }
-        if (packet->pos > seen_packet->pos ||
-            (packet->pos == seen_packet->pos && packet->pts > seen_packet->pts)) {
-            a = mid + 1;
-        } else {
-            b = mid;
-        }
+        i = (i + 1) & mask;
     }
-    packet->seen_pos = a;
-    MP_TARRAY_INSERT_AT(priv, priv->seen_packets, priv->num_seen_packets, a,
-                        (struct seen_packet){packet->pos, packet->pts});
+
+    packet->seen_pos = priv->num_seen_packets;
+    priv->seen_hash[i] = priv->num_seen_packets;
+    MP_TARRAY_APPEND(priv, priv->seen_packets, priv->num_seen_packets,
+                     (struct seen_packet){packet->pos, packet->pts, -1});
     return false;
 }
 
@@ -492,6 +524,13 @@ static void decode(struct sd *sd, struct demux_packet *packet)
                 } else if (track->events[n].Start == track->events[n + 1].Start) {
                     track->events[n].Duration = track->events[n + 1].Duration;
                 }
+                if (ctx->index_gen == ctx->events_gen &&
+                    n < mp_interval_tree_num(ctx->index))
+                {
+                    ASS_Event *event = &track->events[n];
+                    mp_interval_tree_set(ctx->index, n, event->Start,
+                                         event->Start + event->Duration);
+                }
             }
             if (n > 0 && track->events[n].Start != track->events[n - 1].Start)
                 break;
@@ -656,6 +695,39 @@ static bool has_overrides(char *s)
 
 #define END(ev) ((ev)->Start + (ev)->Duration)
 
+// Bring the event index up to date with ass_track. New events are only ever
+// appended to the array, but events can be dropped (flushing, pruning by
+// libass while rendering), which shifts the remaining ones. These places
+// increment events_gen, and the index is rebuilt in this case.
+static void update_index(struct sd *sd)
+{
+    struct sd_ass_priv *ctx = sd->priv;
+    ASS_Track *track = ctx->ass_track;
+    int num = mp_interval_tree_num(ctx->index);
+
+    if (ctx->index_gen != ctx->events_gen || num > track->n_events) {
+        mp_interval_tree_clear(ctx->index);
+        ctx->index_gen = ctx->events_gen;
+        num = 0;
+    }
+
+    for (int n = num; n < track->n_events; n++) {
+        ASS_Event *event = &track->events[n];
+        mp_interval_tree_set(ctx->index, n, event->Start, END(event));
+    }
+}
+
+// Set ctx->index_ids to the indexes of all events with start <= hi && end > lo,
+// in ascending order.
+static void query_index(struct sd *sd, long long lo, long long hi)
+{
+    struct sd_ass_priv *ctx = sd->priv;
+    update_index(sd);
+    ctx->num_index_ids = 0;
+    mp_interval_tree_query(ctx->index, lo, hi, ctx, &ctx->index_ids,
+                           &ctx->num_index_ids);
+}
+
 static long long find_timestamp(struct sd *sd, double pts)
 {
     struct sd_ass_priv *priv = sd->priv;
@@ -676,13 +748,11 @@ static long long find_timestamp(struct sd *sd, double pts)
     // Find the "current" event.
     ASS_Event *ev[2] = {0};
     int n_ev = 0;
-    for (int n = 0; n < track->n_events; n++) {
-        ASS_Event *event = &track->events[n];
-        if (ts >= event->Start - threshold && ts <= END(event) + threshold) {
-            if (n_ev >= MP_ARRAY_SIZE(ev))
-                return ts; // multiple overlaps - give up (probably complex subs)
-            ev[n_ev++] = event;
-        }
+    query_index(sd, ts - threshold - 1, ts + threshold);
+    for (int n = 0; n < priv->num_index_ids; n++) {
+        if (n_ev >= MP_ARRAY_SIZE(ev))
+            return ts; // multiple overlaps - give up (probably complex subs)
+        ev[n_ev++] = &track->events[priv->index_ids[n]];
     }
 
     if (n_ev != 2)
@@ -776,8 +846,13 @@ static struct sub_bitmaps *get_bitmaps(struct sd *sd, struct mp_osd_res dim,
     if (no_ass)
         fill_plaintext(sd, pts);
 
+    // libass only removes events while rendering, if pruning is enabled.
+    int old_n_events = ctx->ass_track->n_events;
     int changed;
-    ASS_Image *imgs = ass_render_frame(renderer, track, ts, &changed);
+    ASS_Image *imgs = mp_ass_render_frame(ctx->ass_cache, renderer, track, ts,
+                                          &changed);
+    if (ctx->ass_track->n_events != old_n_events)
+        ctx->events_gen++;
     mp_ass_packer_pack(ctx->packer, &imgs, 1, changed, !converted, format, res);
 
 done:
@@ -798,51 +873,6 @@ static void append(bstr *b, char c)
     bstr_xappend(NULL, b, (bstr){&c, 1});
 }
 
-static void ass_to_plaintext(bstr *b, const char *in)
-{
-    const char *open_tag_pos = NULL;
-    bool in_drawing = false;
-    while (*in) {
-        if (open_tag_pos) {
-            if (in[0] == '}') {
-                in += 1;
-                open_tag_pos = NULL;
-            } else if (in[0] == '\\' && in[1] == 'p' && in[2] != 'o') {
-                in += 2;
-                // Skip text between \pN and \p0 tags. A \p without a number
-                // is the same as \p0, and leading 0s are also allowed.
-                in_drawing = false;
-                while (in[0] >= '0' && in[0] <= '9') {
-                    if (in[0] != '0')
-                        in_drawing = true;
-                    in += 1;
-                }
-            } else {
-                in += 1;
-            }
-        } else {
-            if (in[0] == '\\' && (in[1] == 'N' || in[1] == 'n')) {
-                in += 2;
-                append(b, '\n');
-            } else if (in[0] == '\\' && in[1] == 'h') {
-                in += 2;
-                append(b, ' ');
-            } else if (in[0] == '{') {
-                open_tag_pos = in;
-                in += 1;
-            } else {
-                if (!in_drawing)
-                    append(b, in[0]);
-                in += 1;
-            }
-        }
-    }
-    // A '{' without a closing '}' is always visible.
-    if (open_tag_pos) {
-        bstr_xappend(NULL, b, bstr0(open_tag_pos));
-    }
-}
-
 // Empty string counts as whitespace.
 static bool is_whitespace_only(bstr b)
 {
@@ -869,43 +899,42 @@ static bstr get_text_buf(struct sd *sd, double pts, enum sd_text_type type)
 
     b->len = 0;
 
-    for (int i = 0; i < track->n_events; ++i) {
-        ASS_Event *event = track->events + i;
-        if (ipts >= event->Start && ipts < event->Start + event->Duration) {
-            if (event->Text) {
-                int start = b->len;
-                if (type == SD_TEXT_TYPE_PLAIN) {
-                    ass_to_plaintext(b, event->Text);
-                } else if (type == SD_TEXT_TYPE_ASS_FULL) {
-                    long long s = event->Start;
-                    long long e = s + event->Duration;
-
-                    ASS_Style *style = (event->Style < 0 || event->Style >= track->n_styles) ? NULL : &track->styles[event->Style];
-
-                    int sh = (s / 60 / 60 / 1000);
-                    int sm = (s / 60 / 1000) % 60;
-                    int ss = (s / 1000) % 60;
-                    int sc = (s / 10) % 100;
-                    int eh = (e / 60 / 60 / 1000);
-                    int em = (e / 60 / 1000) % 60;
-                    int es = (e / 1000) % 60;
-                    int ec = (e / 10) % 100;
-
-                    bstr_xappend_asprintf(NULL, b, "Dialogue: %d,%d:%02d:%02d.%02d,%d:%02d:%02d.%02d,%s,%s,%04d,%04d,%04d,%s,%s",
-                        event->Layer,
-                        sh, sm, ss, sc,
-                        eh, em, es, ec,
-                        (style && style->Name) ? style->Name : "", event->Name,
-                        event->MarginL, event->MarginR, event->MarginV,
-                        event->Effect, event->Text);
-                } else {
-                    bstr_xappend(NULL, b, bstr0(event->Text));
-                }
-                if (is_whitespace_only(bstr_cut(*b, start))) {
-                    b->len = start;
-                } else {
-                    append(b, '\n');
-                }
+    query_index(sd, ipts, ipts);
+    for (int i = 0; i < ctx->num_index_ids; ++i) {
+        ASS_Event *event = track->events + ctx->index_ids[i];
+        if (event->Text) {
+            int start = b->len;
+            if (type == SD_TEXT_TYPE_PLAIN) {
+                sd_ass_append_plaintext(b, event->Text);
+            } else if (type == SD_TEXT_TYPE_ASS_FULL) {
+                long long s = event->Start;
+                long long e = s + event->Duration;
+
+                ASS_Style *style = (event->Style < 0 || event->Style >= track->n_styles) ? NULL : &track->styles[event->Style];
+
+                int sh = (s / 60 / 60 / 1000);
+                int sm = (s / 60 / 1000) % 60;
+                int ss = (s / 1000) % 60;
+                int sc = (s / 10) % 100;
+                int eh = (e / 60 / 60 / 1000);
+                int em = (e / 60 / 1000) % 60;
+                int es = (e / 1000) % 60;
+                int ec = (e / 10) % 100;
+
+                bstr_xappend_asprintf(NULL, b, "Dialogue: %d,%d:%02d:%02d.%02d,%d:%02d:%02d.%02d,%s,%s,%04d,%04d,%04d,%s,%s",
+                    event->Layer,
+                    sh, sm, ss, sc,
+                    eh, em, es, ec,
+                    (style && style->Name) ? style->Name : "", event->Name,
+                    event->MarginL, event->MarginR, event->MarginV,
+                    event->Effect, event->Text);
+            } else {
+                bstr_xappend(NULL, b, bstr0(event->Text));
+            }
+            if (is_whitespace_only(bstr_cut(*b, start))) {
+                b->len = start;
+            } else {
+                append(b, '\n');
             }
         }
     }
@@ -931,19 +960,18 @@ static struct sd_times get_times(struct sd *sd, double pts)
 
     long long ipts = find_timestamp(sd, pts);
 
-    for (int i = 0; i < track->n_events; ++i) {
-        ASS_Event *event = track->events + i;
-        if (ipts >= event->Start && ipts < event->Start + event->Duration) {
-            double start = event->Start / 1000.0;
-            double end = event->Duration == UNKNOWN_DURATION ?
-                MP_NOPTS_VALUE : (event->Start + event->Duration) / 1000.0;
+    query_index(sd, ipts, ipts);
+    for (int i = 0; i < ctx->num_index_ids; ++i) {
+        ASS_Event *event = track->events + ctx->index_ids[i];
+        double start = event->Start / 1000.0;
+        double end = event->Duration == UNKNOWN_DURATION ?
+            MP_NOPTS_VALUE : (event->Start + event->Duration) / 1000.0;
 
-            if (res.start == MP_NOPTS_VALUE || res.start > start)
-                res.start = start;
+        if (res.start == MP_NOPTS_VALUE || res.start > start)
+            res.start = start;
 
-            if (res.end == MP_NOPTS_VALUE || res.end < end)
-                res.end = end;
-        }
+        if (res.end == MP_NOPTS_VALUE || res.end < end)
+            res.end = end;
     }
 
     return res;
@@ -996,7 +1024,8 @@ static void reset(struct sd *sd)
     struct sd_ass_priv *ctx = sd->priv;
     if (sd->opts->sub_clear_on_seek || ctx->clear_once) {
         ass_flush_events(ctx->ass_track);
-        ctx->num_seen_packets = 0;
+        ctx->events_gen++;
+        clear_seen_packets(sd);
         sd->preload_ok = false;
         ctx->clear_once = false;
     }
@@ -1061,6 +1090,7 @@ static int control(struct sd *sd, enum sd_ctrl cmd, void *arg)
 const struct sd_functions sd_ass = {
     .name = "ass",
     .accept_packets_in_advance = true,
+    .render_ahead = true,
     .init = init,
     .decode = decode,
     .get_bitmaps = get_bitmaps,
@@ -1180,36 +1210,3 @@ static void mangle_colors(struct sd *sd, struct sub_bitmaps *parts)
         sb->libass.color = MP_ASS_RGBA(rgb[0], rgb[1], rgb[2], a);
     }
 }
-
-int sd_ass_fmt_offset(const char *evt_fmt)
-{
-    // "Text" is always last (as it's arbitrary content in buf), e.g. format:
-    // "Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text"
-    int n = 0;
-    while (evt_fmt && (evt_fmt = strchr(evt_fmt, ',')))
-         evt_fmt++, n++;
-    return n-1;  // buffer is without the format's Start/End, with ReadOrder
-}
-
-bstr sd_ass_pkt_text(struct sd_filter *ft, struct demux_packet *pkt, int offset)
-{
-    // e.g. pkt->buffer ("4" is ReadOrder): "4,0,Default,,0,0,0,,fifth line"
-    bstr txt = {(char *)pkt->buffer, pkt->len}, t0 = txt;
-    while (offset-- > 0) {
-        int n = bstrchr(txt, ',');
-        if (n < 0) {  // shouldn't happen
-            MP_WARN(ft, "Malformed event '%.*s'\n", BSTR_P(t0));
-            return (bstr){NULL, 0};
-        }
-        txt = bstr_cut(txt, n+1);
-    }
-    return txt;
-}
-
-bstr sd_ass_to_plaintext(char **out, const char *in)
-{
-    bstr b = {*out};
-    ass_to_plaintext(&b, in);
-    *out = b.start;
-    return b;
-}
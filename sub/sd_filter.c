@@ -0,0 +1,241 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+
+#include "config.h"
+#include "common/common.h"
+#include "common/msg.h"
+#include "misc/bstr.h"
+#include "sd.h"
+
+static const struct sd_filter_functions *const filters[] = {
+    // Note: list order defines filter order.
+    &sd_filter_sdh,
+#if HAVE_POSIX
+    &sd_filter_regex,
+#endif
+#if HAVE_JAVASCRIPT
+    &sd_filter_jsre,
+#endif
+    NULL,
+};
+
+struct sd_filter_chain {
+    struct mp_log *log;
+    struct sd_filter **filters;
+    int num_filters;
+    int offset;     // number of fields before "Text"
+    char *buf;      // copy of the current event, reused
+};
+
+// num commas to skip at an ass-event before the "Text" field (always last)
+static int fmt_offset(const char *evt_fmt)
+{
+    // "Text" is always last (as it's arbitrary content in buf), e.g. format:
+    // "Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text"
+    int n = 0;
+    while (evt_fmt && (evt_fmt = strchr(evt_fmt, ',')))
+         evt_fmt++, n++;
+    return n-1;  // buffer is without the format's Start/End, with ReadOrder
+}
+
+// the event "Text" content according to the offset.
+// on malformed event: warns and returns (bstr){NULL,0}
+static bstr event_text(struct sd_filter_chain *c, bstr event)
+{
+    // e.g. event ("4" is ReadOrder): "4,0,Default,,0,0,0,,fifth line"
+    bstr txt = event;
+    for (int offset = c->offset; offset > 0; offset--) {
+        int n = bstrchr(txt, ',');
+        if (n < 0) {  // shouldn't happen
+            MP_WARN(c, "Malformed event '%.*s'\n", BSTR_P(event));
+            return (bstr){NULL, 0};
+        }
+        txt = bstr_cut(txt, n+1);
+    }
+    return txt;
+}
+
+static void destroy_chain(void *ptr)
+{
+    struct sd_filter_chain *c = ptr;
+
+    for (int n = 0; n < c->num_filters; n++) {
+        struct sd_filter *ft = c->filters[n];
+        if (ft->driver->uninit)
+            ft->driver->uninit(ft);
+    }
+}
+
+struct sd_filter_chain *sd_filter_chain_create(void *ta_parent,
+                                               struct mpv_global *global,
+                                               struct mp_log *log,
+                                               struct mp_sub_filter_opts *opts,
+                                               const char *event_format)
+{
+    struct sd_filter_chain *c = talloc_zero(ta_parent, struct sd_filter_chain);
+    c->log = log;
+    c->offset = fmt_offset(event_format);
+    talloc_set_destructor(c, destroy_chain);
+
+    for (int n = 0; filters[n]; n++) {
+        struct sd_filter *ft = talloc_ptrtype(c, ft);
+        *ft = (struct sd_filter){
+            .global = global,
+            .log = log,
+            .opts = opts,
+            .driver = filters[n],
+            .codec = "ass",
+            .event_format = talloc_strdup(ft, event_format),
+        };
+        if (ft->driver->init(ft)) {
+            MP_TARRAY_APPEND(c, c->filters, c->num_filters, ft);
+        } else {
+            talloc_free(ft);
+        }
+    }
+
+    return c;
+}
+
+bool sd_filter_chain_apply(struct sd_filter_chain *c, bstr *event)
+{
+    if (!c || !c->num_filters)
+        return true;
+
+    bstr text = event_text(c, *event);
+    if (!text.start)
+        return true;  // we don't touch it
+
+    // All filters work on the same copy, and can only shorten the text.
+    size_t head = text.start - event->start;
+    MP_TARRAY_GROW(c, c->buf, event->len);
+    memcpy(c->buf, event->start, event->len);
+    c->buf[event->len] = '\0';
+
+    for (int n = 0; n < c->num_filters; n++) {
+        struct sd_filter *ft = c->filters[n];
+        if (!ft->driver->filter_text(ft, c->buf + head))
+            return false;
+    }
+
+    bstr res = {c->buf, head + strlen(c->buf + head)};
+    if (!bstr_equals(res, *event))
+        *event = res;
+    return true;
+}
+
+static bool has_backreference(const char *re)
+{
+    for (; *re; re++) {
+        if (re[0] == '\\') {
+            if (re[1] >= '1' && re[1] <= '9')
+                return true;
+            if (!re[1])
+                break;
+            re++;
+        }
+    }
+    return false;
+}
+
+char *sd_filter_join_regexes(void *ta_parent, char **items, int num_items,
+                             const char *open, bool *joined)
+{
+    char *res = talloc_strdup(ta_parent, "");
+    int num_joined = 0;
+    for (int n = 0; n < num_items; n++) {
+        joined[n] = !has_backreference(items[n]);
+        if (joined[n]) {
+            res = talloc_asprintf_append_buffer(res, "%s%s%s)",
+                                                num_joined ? "|" : "",
+                                                open, items[n]);
+            num_joined++;
+        }
+    }
+    if (num_joined < 2) {
+        for (int n = 0; n < num_items; n++)
+            joined[n] = false;
+        TA_FREEP(&res);
+    }
+    return res;
+}
+
+static void append(bstr *b, char c)
+{
+    bstr_xappend(NULL, b, (bstr){&c, 1});
+}
+
+void sd_ass_append_plaintext(bstr *b, const char *in)
+{
+    const char *open_tag_pos = NULL;
+    bool in_drawing = false;
+    while (*in) {
+        if (open_tag_pos) {
+            if (in[0] == '}') {
+                in += 1;
+                open_tag_pos = NULL;
+            } else if (in[0] == '\\' && in[1] == 'p' && in[2] != 'o') {
+                in += 2;
+                // Skip text between \pN and \p0 tags. A \p without a number
+                // is the same as \p0, and leading 0s are also allowed.
+                in_drawing = false;
+                while (in[0] >= '0' && in[0] <= '9') {
+                    if (in[0] != '0')
+                        in_drawing = true;
+                    in += 1;
+                }
+            } else {
+                in += 1;
+            }
+        } else {
+            if (in[0] == '\\' && (in[1] == 'N' || in[1] == 'n')) {
+                in += 2;
+                append(b, '\n');
+            } else if (in[0] == '\\' && in[1] == 'h') {
+                in += 2;
+                append(b, ' ');
+            } else if (in[0] == '{') {
+                open_tag_pos = in;
+                in += 1;
+            } else {
+                if (!in_drawing)
+                    append(b, in[0]);
+                in += 1;
+            }
+        }
+    }
+    // A '{' without a closing '}' is always visible.
+    if (open_tag_pos) {
+        bstr_xappend(NULL, b, bstr0(open_tag_pos));
+    }
+}
+
+
+bstr sd_ass_to_plaintext(char **out, const char *in)
+{
+    bstr b = {*out};
+    sd_ass_append_plaintext(&b, in);
+    // Nothing was appended if the plaintext is empty.
+    if (!b.start)
+        b.start = talloc_size(NULL, 1);
+    b.start[b.len] = '\0';
+    *out = b.start;
+    return b;
+}
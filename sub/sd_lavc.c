@@ -28,7 +28,9 @@
 #include "common/msg.h"
 #include "common/av_common.h"
 #include "demux/stheader.h"
+#include "misc/thread_pool.h"
 #include "options/options.h"
+#include "osdep/threads.h"
 #include "video/mp_image.h"
 #include "video/out/bitmap_packer.h"
 #include "img_convert.h"
@@ -37,6 +39,13 @@
 
 #define MAX_QUEUE 4
 
+// Options affecting the conversion of the bitmaps, captured when queuing it.
+struct convert_opts {
+    float gauss;
+    bool gray;
+    bool forced_only;
+};
+
 struct sub {
     bool valid;
     AVSubtitle avsub;
@@ -48,6 +57,14 @@ struct sub {
     double pts;
     double endpts;
     int64_t id;
+
+    // Set while the bitmaps are being converted on the worker thread. The
+    // fields written by the conversion (inbitmaps, count, data, bound_w/h,
+    // src_w/h) must not be accessed while this is set. Protected by
+    // sd_lavc_priv.lock.
+    bool converting;
+    struct convert_opts convert_opts;
+    struct sd_lavc_priv *priv;
 };
 
 struct seekpoint {
@@ -56,11 +73,12 @@ struct seekpoint {
 };
 
 struct sd_lavc_priv {
+    struct mp_log *log;
     struct mp_codec_params *codec;
     AVCodecContext *avctx;
     AVPacket *avpkt;
     AVRational pkt_timebase;
-    struct sub subs[MAX_QUEUE]; // most recent event first
+    struct sub *subs[MAX_QUEUE]; // most recent event first
     struct sub_bitmap *outbitmaps;
     struct sub_bitmap *prevret;
     int prevret_num;
@@ -68,9 +86,16 @@ struct sd_lavc_priv {
     int64_t new_id;
     struct mp_image_params video_params;
     double current_pts;
-    struct seekpoint *seekpoints;
+    struct seekpoint *seekpoints; // sorted by pts, unique pts
     int num_seekpoints;
-    struct bitmap_packer *packer;
+    struct bitmap_packer *packer; // used by the conversion only
+
+    // Converting the bitmaps to BGRA can take a while with large bitmaps (e.g.
+    // 4K PGS), so it's done on a worker thread as soon as a subtitle is
+    // decoded, which is normally well before it is displayed.
+    struct mp_thread_pool *convert_pool;
+    mp_mutex lock;
+    mp_cond wakeup;
 };
 
 static int init(struct sd *sd)
@@ -135,9 +160,17 @@ static int init(struct sd *sd)
         goto error;
     priv->avctx = ctx;
     sd->priv = priv;
+    priv->log = sd->log;
     priv->displayed_id = -1;
     priv->current_pts = MP_NOPTS_VALUE;
-    priv->packer = talloc_zero(priv, struct bitmap_packer);
+    // Not a talloc child of priv, because the worker thread reallocates it.
+    priv->packer = talloc_zero(NULL, struct bitmap_packer);
+    for (int n = 0; n < MAX_QUEUE; n++) {
+        priv->subs[n] = talloc_zero(priv, struct sub);
+        priv->subs[n]->priv = priv;
+    }
+    mp_mutex_init(&priv->lock);
+    mp_cond_init(&priv->wakeup);
     return 0;
 
 error:
@@ -149,8 +182,19 @@ error_probe:
     return -1;
 }
 
+// Wait until the conversion of sub's bitmaps is done.
+static void wait_sub(struct sub *sub)
+{
+    struct sd_lavc_priv *priv = sub->priv;
+    mp_mutex_lock(&priv->lock);
+    while (sub->converting)
+        mp_cond_wait(&priv->wakeup, &priv->lock);
+    mp_mutex_unlock(&priv->lock);
+}
+
 static void clear_sub(struct sub *sub)
 {
+    wait_sub(sub);
     sub->count = 0;
     sub->pts = MP_NOPTS_VALUE;
     sub->endpts = MP_NOPTS_VALUE;
@@ -161,17 +205,17 @@ static void clear_sub(struct sub *sub)
 
 static void alloc_sub(struct sd_lavc_priv *priv)
 {
-    clear_sub(&priv->subs[MAX_QUEUE - 1]);
-    struct sub tmp = priv->subs[MAX_QUEUE - 1];
+    clear_sub(priv->subs[MAX_QUEUE - 1]);
+    struct sub *tmp = priv->subs[MAX_QUEUE - 1];
     for (int n = MAX_QUEUE - 1; n > 0; n--)
         priv->subs[n] = priv->subs[n - 1];
     priv->subs[0] = tmp;
     // clear only some fields; the memory allocs can be reused
-    priv->subs[0].valid = false;
-    priv->subs[0].count = 0;
-    priv->subs[0].src_w = 0;
-    priv->subs[0].src_h = 0;
-    priv->subs[0].id = priv->new_id++;
+    priv->subs[0]->valid = false;
+    priv->subs[0]->count = 0;
+    priv->subs[0]->src_w = 0;
+    priv->subs[0]->src_h = 0;
+    priv->subs[0]->id = priv->new_id++;
 }
 
 static void convert_pal(uint32_t *colors, size_t count, bool gray)
@@ -192,20 +236,19 @@ static void convert_pal(uint32_t *colors, size_t count, bool gray)
     }
 }
 
-// Initialize sub from sub->avsub.
-static void read_sub_bitmaps(struct sd *sd, struct sub *sub)
+// Initialize sub from sub->avsub. This runs on the worker thread, and must
+// not access anything but sub and priv->packer. sub->inbitmaps must have
+// been allocated for avsub->num_rects entries.
+static void read_sub_bitmaps(struct sd_lavc_priv *priv, struct sub *sub)
 {
-    struct mp_subtitle_opts *opts = sd->opts;
-    struct sd_lavc_priv *priv = sd->priv;
+    struct convert_opts *opts = &sub->convert_opts;
     AVSubtitle *avsub = &sub->avsub;
 
-    MP_TARRAY_GROW(priv, sub->inbitmaps, avsub->num_rects);
-
     packer_set_size(priv->packer, avsub->num_rects);
 
     // If we blur, we want a transparent region around the bitmap data to
     // avoid "cut off" artifacts on the borders.
-    bool apply_blur = opts->sub_gauss != 0.0f;
+    bool apply_blur = opts->gauss != 0.0f;
     int extend = apply_blur ? 5 : 0;
     // Assume consumers may use bilinear scaling on it (2x2 filter)
     int padding = 1 + extend;
@@ -221,10 +264,10 @@ static void read_sub_bitmaps(struct sd *sd, struct sub *sub)
         struct sub_bitmap *b = &sub->inbitmaps[sub->count];
 
         if (r->type != SUBTITLE_BITMAP) {
-            MP_ERR(sd, "unsupported subtitle type from decoder (%d)\n", r->type);
+            MP_ERR(priv, "unsupported subtitle type from decoder (%d)\n", r->type);
             continue;
         }
-        if (!(r->flags & AV_SUBTITLE_FLAG_FORCED) && opts->sub_forced_events_only)
+        if (!(r->flags & AV_SUBTITLE_FLAG_FORCED) && opts->forced_only)
             continue;
         if (r->w <= 0 || r->h <= 0)
             continue;
@@ -238,7 +281,7 @@ static void read_sub_bitmaps(struct sd *sd, struct sub *sub)
     priv->packer->count = sub->count;
 
     if (packer_pack(priv->packer) < 0) {
-        MP_ERR(sd, "Unable to pack subtitle bitmaps.\n");
+        MP_ERR(priv, "Unable to pack subtitle bitmaps.\n");
         sub->count = 0;
     }
 
@@ -258,7 +301,6 @@ static void read_sub_bitmaps(struct sd *sd, struct sub *sub)
             sub->count = 0;
             return;
         }
-        talloc_steal(priv, sub->data);
     }
 
     if (!mp_image_make_writeable(sub->data)) {
@@ -292,7 +334,7 @@ static void read_sub_bitmaps(struct sd *sd, struct sub *sub)
         mp_assert(r->nb_colors <= 256);
         uint32_t pal[256] = {0};
         memcpy(pal, data[1], r->nb_colors * 4);
-        convert_pal(pal, 256, opts->sub_gray);
+        convert_pal(pal, 256, opts->gray);
 
         for (int y = -padding; y < b->h + padding; y++) {
             uint32_t *out = (uint32_t*)((char*)b->bitmap + y * b->stride);
@@ -318,10 +360,59 @@ static void read_sub_bitmaps(struct sd *sd, struct sub *sub)
         b->h += extend * 2;
 
         if (apply_blur)
-            mp_blur_rgba_sub_bitmap(b, opts->sub_gauss);
+            mp_blur_rgba_sub_bitmap(b, opts->gauss);
     }
 }
 
+static void convert_work(void *ctx)
+{
+    struct sub *sub = ctx;
+    struct sd_lavc_priv *priv = sub->priv;
+
+    read_sub_bitmaps(priv, sub);
+
+    mp_mutex_lock(&priv->lock);
+    sub->converting = false;
+    mp_cond_broadcast(&priv->wakeup);
+    mp_mutex_unlock(&priv->lock);
+}
+
+// Convert the bitmaps of the newly decoded sub in the background.
+static void convert_sub(struct sd *sd, struct sub *sub)
+{
+    struct sd_lavc_priv *priv = sd->priv;
+
+    MP_TARRAY_GROW(priv, sub->inbitmaps, sub->avsub.num_rects);
+    sub->convert_opts = (struct convert_opts){
+        .gauss = sd->opts->sub_gauss,
+        .gray = sd->opts->sub_gray,
+        .forced_only = sd->opts->sub_forced_events_only,
+    };
+
+    if (!priv->convert_pool)
+        priv->convert_pool = mp_thread_pool_create(NULL, 1, 1, 1);
+
+    sub->converting = true;
+    if (!priv->convert_pool || !mp_thread_pool_queue(priv->convert_pool,
+                                                     convert_work, sub))
+        convert_work(sub);
+}
+
+// Return the index of the first seekpoint with seekpoint.pts >= pts.
+static int find_seekpoint(struct sd_lavc_priv *priv, double pts)
+{
+    int lo = 0, hi = priv->num_seekpoints;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (priv->seekpoints[mid].pts < pts) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
 static void decode(struct sd *sd, struct demux_packet *packet)
 {
     struct mp_subtitle_opts *opts = sd->opts;
@@ -369,7 +460,7 @@ static void decode(struct sd *sd, struct demux_packet *packet)
         pts += sub.start_display_time / 1000.0;
 
         // set end time of previous sub
-        struct sub *prev = &priv->subs[0];
+        struct sub *prev = priv->subs[0];
         if (prev->valid) {
             if (prev->endpts == MP_NOPTS_VALUE || prev->endpts > pts)
                 prev->endpts = pts;
@@ -377,12 +468,9 @@ static void decode(struct sd *sd, struct demux_packet *packet)
             if (opts->sub_fix_timing && pts - prev->endpts <= SUB_GAP_THRESHOLD)
                 prev->endpts = pts;
 
-            for (int n = 0; n < priv->num_seekpoints; n++) {
-                if (priv->seekpoints[n].pts == prev->pts) {
-                    priv->seekpoints[n].endpts = prev->endpts;
-                    break;
-                }
-            }
+            int n = find_seekpoint(priv, prev->pts);
+            if (n < priv->num_seekpoints && priv->seekpoints[n].pts == prev->pts)
+                priv->seekpoints[n].endpts = prev->endpts;
         }
 
         // This subtitle packet only signals the end of subtitle display.
@@ -393,26 +481,26 @@ static void decode(struct sd *sd, struct demux_packet *packet)
     }
 
     alloc_sub(priv);
-    struct sub *current = &priv->subs[0];
+    struct sub *current = priv->subs[0];
 
     current->valid = true;
     current->pts = pts;
     current->endpts = endpts;
     current->avsub = sub;
 
-    read_sub_bitmaps(sd, current);
+    convert_sub(sd, current);
 
     if (pts != MP_NOPTS_VALUE) {
-        for (int n = 0; n < priv->num_seekpoints; n++) {
-            if (priv->seekpoints[n].pts == pts)
-                goto skip;
+        int n = find_seekpoint(priv, pts);
+        if (n == priv->num_seekpoints || priv->seekpoints[n].pts != pts) {
+            // Set arbitrary limit as safe-guard against insane files.
+            if (priv->num_seekpoints >= 10000) {
+                MP_TARRAY_REMOVE_AT(priv->seekpoints, priv->num_seekpoints, 0);
+                n = MPMAX(n - 1, 0);
+            }
+            MP_TARRAY_INSERT_AT(priv, priv->seekpoints, priv->num_seekpoints, n,
+                                (struct seekpoint){.pts = pts, .endpts = endpts});
         }
-        // Set arbitrary limit as safe-guard against insane files.
-        if (priv->num_seekpoints >= 10000)
-            MP_TARRAY_REMOVE_AT(priv->seekpoints, priv->num_seekpoints, 0);
-        MP_TARRAY_APPEND(priv, priv->seekpoints, priv->num_seekpoints,
-                         (struct seekpoint){.pts = pts, .endpts = endpts});
-        skip: ;
     }
 }
 
@@ -420,7 +508,7 @@ static struct sub *get_current(struct sd_lavc_priv *priv, double pts)
 {
     struct sub *current = NULL;
     for (int n = 0; n < MAX_QUEUE; n++) {
-        struct sub *sub = &priv->subs[n];
+        struct sub *sub = priv->subs[n];
         if (!sub->valid)
             continue;
         if (pts == MP_NOPTS_VALUE ||
@@ -451,6 +539,8 @@ static struct sub_bitmaps *get_bitmaps(struct sd *sd, struct mp_osd_res d,
     if (!current)
         return NULL;
 
+    wait_sub(current);
+
     MP_TARRAY_GROW(priv, priv->outbitmaps, current->count);
     for (int n = 0; n < current->count; n++)
         priv->outbitmaps[n] = current->inbitmaps[n];
@@ -602,7 +692,7 @@ static bool accepts_packet(struct sd *sd, double min_pts)
 
     int last_needed = -1;
     for (int n = 0; n < MAX_QUEUE; n++) {
-        struct sub *sub = &priv->subs[n];
+        struct sub *sub = priv->subs[n];
         if (!sub->valid)
             continue;
         if (pts == MP_NOPTS_VALUE ||
@@ -622,7 +712,7 @@ static void reset(struct sd *sd)
     struct sd_lavc_priv *priv = sd->priv;
 
     for (int n = 0; n < MAX_QUEUE; n++)
-        clear_sub(&priv->subs[n]);
+        clear_sub(priv->subs[n]);
     // lavc might not do this right for all codecs; may need close+reopen
     avcodec_flush_buffers(priv->avctx);
 
@@ -633,19 +723,20 @@ static void uninit(struct sd *sd)
 {
     struct sd_lavc_priv *priv = sd->priv;
 
-    for (int n = 0; n < MAX_QUEUE; n++)
-        clear_sub(&priv->subs[n]);
+    // Waits for pending conversions.
+    talloc_free(priv->convert_pool);
+    for (int n = 0; n < MAX_QUEUE; n++) {
+        clear_sub(priv->subs[n]);
+        talloc_free(priv->subs[n]->data);
+    }
+    talloc_free(priv->packer);
+    mp_mutex_destroy(&priv->lock);
+    mp_cond_destroy(&priv->wakeup);
     avcodec_free_context(&priv->avctx);
     mp_free_av_packet(&priv->avpkt);
     talloc_free(priv);
 }
 
-static int compare_seekpoint(const void *pa, const void *pb)
-{
-    const struct seekpoint *a = pa, *b = pb;
-    return a->pts == b->pts ? 0 : (a->pts < b->pts ? -1 : +1);
-}
-
 // taken from ass_step_sub(), libass (ISC)
 static double step_sub(struct sd *sd, double now, int movement)
 {
@@ -657,16 +748,15 @@ static double step_sub(struct sd *sd, double now, int movement)
     if (priv->num_seekpoints == 0)
         return MP_NOPTS_VALUE;
 
-    qsort(priv->seekpoints, priv->num_seekpoints, sizeof(priv->seekpoints[0]),
-          compare_seekpoint);
-
     do {
         int closest = -1;
         double closest_time = 0;
-        for (int i = 0; i < priv->num_seekpoints; i++) {
-            struct seekpoint *p = &priv->seekpoints[i];
-            double start = p->pts;
-            if (direction < 0) {
+        if (direction < 0) {
+            // The end times are not sorted, but a seekpoint can only end
+            // before target if it also starts before it.
+            int num = find_seekpoint(priv, target);
+            for (int i = 0; i < num; i++) {
+                struct seekpoint *p = &priv->seekpoints[i];
                 double end = p->endpts == MP_NOPTS_VALUE ? INFINITY : p->endpts;
                 if (end < target) {
                     if (closest < 0 || end > closest_time) {
@@ -674,20 +764,22 @@ static double step_sub(struct sd *sd, double now, int movement)
                         closest_time = end;
                     }
                 }
-            } else if (direction > 0) {
-                if (start > target) {
-                    if (closest < 0 || start < closest_time) {
-                        closest = i;
-                        closest_time = start;
-                    }
-                }
-            } else {
-                if (start < target) {
-                    if (closest < 0 || start >= closest_time) {
-                        closest = i;
-                        closest_time = start;
-                    }
-                }
+            }
+        } else if (direction > 0) {
+            // First seekpoint with start > target.
+            int i = find_seekpoint(priv, target);
+            while (i < priv->num_seekpoints && priv->seekpoints[i].pts <= target)
+                i++;
+            if (i < priv->num_seekpoints) {
+                closest = i;
+                closest_time = priv->seekpoints[i].pts;
+            }
+        } else {
+            // Last seekpoint with start < target.
+            int i = find_seekpoint(priv, target) - 1;
+            if (i >= 0) {
+                closest = i;
+                closest_time = priv->seekpoints[i].pts;
             }
         }
         if (closest < 0)
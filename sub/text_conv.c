@@ -0,0 +1,221 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Native conversion of the common cases of SRT and WebVTT text to ASS. The
+// output is the same as with the libavcodec decoders (subrip, webvtt); input
+// that could be handled differently is rejected, and the caller uses
+// libavcodec instead.
+
+#include <string.h>
+
+#include "common/common.h"
+#include "misc/bstr.h"
+#include "misc/ctype.h"
+#include "sd.h"
+
+#define MAX_TAGS 16
+
+static const char *const tag_names = "biusBIUS";
+
+// Parse a simple formatting tag ("<i>" or "</i>" etc.) at the start of s.
+// Returns the length, or 0 if it's not one.
+static int parse_tag(bstr s, char *name, bool *closing)
+{
+    if (!s.len || s.start[0] != '<')
+        return 0;
+    int pos = 1;
+    *closing = s.len > pos && s.start[pos] == '/';
+    pos += *closing;
+    if (s.len < pos + 2 || s.start[pos + 1] != '>' || !s.start[pos] ||
+        !strchr(tag_names, s.start[pos]))
+        return 0;
+    *name = mp_tolower(s.start[pos]);
+    return pos + 2;
+}
+
+static void append_tag(void *ta_parent, bstr *dst, char name, bool closing)
+{
+    char tag[] = {'{', '\\', name, closing ? '0' : '1', '}'};
+    bstr_xappend(ta_parent, dst, (bstr){tag, sizeof(tag)});
+}
+
+// Convert one line of SRT text (without line break and surrounding spaces).
+// tags is the stack of open tags, which can span lines.
+static bool srt_line(void *ta_parent, bstr *dst, bstr line, char *tags,
+                     int *num_tags)
+{
+    bool line_start = true;
+    while (line.len) {
+        int span = bstrcspn(line, "<{\\&\r");
+        if (span) {
+            bstr_xappend(ta_parent, dst, bstr_splice(line, 0, span));
+            line = bstr_cut(line, span);
+            line_start = false;
+            continue;
+        }
+        char name;
+        bool closing;
+        int len = parse_tag(line, &name, &closing);
+        if (!len)
+            return false;
+        if (closing) {
+            if (!*num_tags || tags[*num_tags - 1] != name)
+                return false;
+            (*num_tags)--;
+        } else {
+            if (*num_tags >= MAX_TAGS)
+                return false;
+            tags[(*num_tags)++] = name;
+        }
+        append_tag(ta_parent, dst, name, closing);
+        line = bstr_cut(line, len);
+        // libavcodec skips spaces at the start of a line; not clear whether
+        // this applies after tags.
+        if (line_start && line.len && line.start[0] == ' ')
+            return false;
+    }
+    return true;
+}
+
+// Append the ASS text for the SRT text src to *dst (a talloc buffer with
+// ta_parent as talloc parent). Returns false if the text uses markup which is
+// not handled here, and should be converted with libavcodec. *dst might have
+// been appended to in this case.
+bool sd_srt_to_ass(void *ta_parent, bstr *dst, bstr src)
+{
+    if (memchr(src.start, '\0', src.len))
+        return false;
+
+    bool final_newline = false;
+    while (src.len && (src.start[src.len - 1] == '\n' ||
+                       src.start[src.len - 1] == '\r'))
+    {
+        final_newline |= src.start[src.len - 1] == '\n';
+        src.len--;
+    }
+
+    char tags[MAX_TAGS];
+    int num_tags = 0;
+    bool first = true;
+    while (src.len) {
+        bstr rest;
+        bstr line = bstr_splitchar(src, &rest, '\n');
+        bool last = !rest.len;
+        line = bstr_strip_linebreaks(line);
+        while (line.len && line.start[0] == ' ')
+            line = bstr_cut(line, 1);
+        // Trailing spaces are stripped before line breaks only.
+        if (!last || final_newline) {
+            while (line.len && line.start[line.len - 1] == ' ')
+                line.len--;
+        } else if (line.len && line.start[line.len - 1] == ' ') {
+            return false;
+        }
+        // An empty line ends the event in libavcodec.
+        if (!line.len)
+            return false;
+        if (!first)
+            bstr_xappend(ta_parent, dst, bstr0("\\N"));
+        if (!srt_line(ta_parent, dst, line, tags, &num_tags))
+            return false;
+        first = false;
+        src = rest;
+    }
+
+    return num_tags == 0;
+}
+
+static const struct {
+    const char *from, *to;
+} webvtt_replace[] = {
+    {"<i>", "{\\i1}"}, {"</i>", "{\\i0}"},
+    {"<b>", "{\\b1}"}, {"</b>", "{\\b0}"},
+    {"<u>", "{\\u1}"}, {"</u>", "{\\u0}"},
+    {"&gt;", ">"}, {"&lt;", "<"},
+    {"&lrm;", "\xe2\x80\x8e"}, {"&rlm;", "\xe2\x80\x8f"},
+    {"&amp;", "&"}, {"&nbsp;", "\\h"},
+};
+
+// Like sd_srt_to_ass(), but for WebVTT cue text. Other tags (classes, voices,
+// timestamps, ruby) are removed.
+bool sd_webvtt_to_ass(void *ta_parent, bstr *dst, bstr src)
+{
+    if (memchr(src.start, '\0', src.len))
+        return false;
+
+    while (src.len) {
+        int span = bstrcspn(src, "<&{\\\r\n");
+        if (span) {
+            bstr_xappend(ta_parent, dst, bstr_splice(src, 0, span));
+            src = bstr_cut(src, span);
+            continue;
+        }
+
+        unsigned char c = src.start[0];
+        if (c == '{' || c == '\\')
+            return false;
+        if (c == '\r' || c == '\n') {
+            if (c == '\n' && src.len > 1)
+                bstr_xappend(ta_parent, dst, bstr0("\\N"));
+            src = bstr_cut(src, 1);
+            continue;
+        }
+
+        bool replaced = false;
+        for (int n = 0; n < MP_ARRAY_SIZE(webvtt_replace); n++) {
+            bstr from = bstr0(webvtt_replace[n].from);
+            if (bstr_startswith(src, from)) {
+                bstr_xappend(ta_parent, dst, bstr0(webvtt_replace[n].to));
+                src = bstr_cut(src, from.len);
+                replaced = true;
+                break;
+            }
+        }
+        if (replaced)
+            continue;
+
+        if (c == '<') {
+            int end = bstrchr(src, '>');
+            if (end < 0)
+                break; // everything after an unterminated tag is dropped
+            src = bstr_cut(src, end + 1);
+        } else {
+            bstr_xappend(ta_parent, dst, bstr_splice(src, 0, 1));
+            src = bstr_cut(src, 1);
+        }
+    }
+    return true;
+}
+
+// Return the cue text of a packet in the Matroska WebVTT format, which is
+// prefixed with the cue identifier and settings lines. Returns an empty bstr
+// on invalid data. (This is a slice of src.)
+bstr sd_webvtt_webm_text(bstr src)
+{
+    for (int n = 0; n < 2; n++) {
+        int end = bstrcspn(src, "\r\n");
+        if (end + 1 < src.len && src.start[end] == '\r')
+            end++;
+        if (end >= src.len || src.start[end] != '\n')
+            return (bstr){0};
+        src = bstr_cut(src, end + 1);
+    }
+    while (src.len && (src.start[src.len - 1] == '\r' ||
+                       src.start[src.len - 1] == '\n'))
+        src.len--;
+    return src;
+}
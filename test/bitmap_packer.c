@@ -0,0 +1,127 @@
+#include <string.h>
+
+#include "common/common.h"
+#include "osdep/timer.h"
+#include "test_utils.h"
+#include "video/out/bitmap_packer.h"
+
+#define NUM_GLYPHS 2000
+#define PARTS_PER_FRAME 300
+#define NUM_FRAMES 500
+
+static struct pos glyph_size[NUM_GLYPHS + 1];
+static struct pos glyph_pos[NUM_GLYPHS + 1];
+
+static uint32_t rand_state = 1;
+
+static int rnd(int n)
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    return (rand_state >> 8) % n;
+}
+
+static void check_packing(struct bitmap_packer *p, const int *glyphs)
+{
+    int pad = p->padding;
+    for (int i = 0; i < p->count; i++) {
+        struct pos a = p->result[i], sa = glyph_size[glyphs[i]];
+        assert_true(a.x - pad >= 0 && a.y - pad >= 0);
+        assert_true(a.x + sa.x + pad <= p->used_width);
+        assert_true(a.y + sa.y + pad <= p->used_height);
+        assert_true(p->used_width <= p->w && p->used_height <= p->h);
+
+        if (p->incremental) {
+            if (p->reused[i]) {
+                assert_int_equal(a.x, glyph_pos[glyphs[i]].x);
+                assert_int_equal(a.y, glyph_pos[glyphs[i]].y);
+            }
+            glyph_pos[glyphs[i]] = a;
+        }
+
+        for (int j = 0; j < i; j++) {
+            struct pos b = p->result[j], sb = glyph_size[glyphs[j]];
+            // The same contents may be placed only once.
+            if (glyphs[i] == glyphs[j] && a.x == b.x && a.y == b.y)
+                continue;
+            bool overlap = a.x - pad < b.x + sb.x + pad &&
+                           b.x - pad < a.x + sa.x + pad &&
+                           a.y - pad < b.y + sb.y + pad &&
+                           b.y - pad < a.y + sa.y + pad;
+            assert_false(overlap);
+        }
+    }
+}
+
+// Simulate subtitle lines: each frame mostly shows the glyphs of the previous
+// frame, with a few new ones.
+static void run(bool incremental, bool bench)
+{
+    struct bitmap_packer *p = talloc_zero(NULL, struct bitmap_packer);
+    p->padding = 1;
+    p->incremental = incremental;
+    int glyphs[PARTS_PER_FRAME];
+    for (int i = 0; i < PARTS_PER_FRAME; i++)
+        glyphs[i] = 1 + rnd(NUM_GLYPHS);
+
+    double efficiency = 0;
+    int64_t reused = 0, total = 0, time = 0;
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        int changes = frame % 50 == 0 ? PARTS_PER_FRAME : rnd(10);
+        for (int n = 0; n < changes; n++)
+            glyphs[rnd(PARTS_PER_FRAME)] = 1 + rnd(NUM_GLYPHS);
+
+        packer_set_size(p, PARTS_PER_FRAME);
+        for (int i = 0; i < p->count; i++) {
+            p->in[i] = glyph_size[glyphs[i]];
+            if (incremental)
+                p->keys[i] = glyphs[i];
+        }
+
+        int64_t start = mp_time_ns();
+        assert_true(packer_pack(p) >= 0);
+        time += mp_time_ns() - start;
+
+        check_packing(p, glyphs);
+
+        efficiency += packer_get_efficiency(p);
+        for (int i = 0; i < p->count && incremental; i++)
+            reused += p->reused[i];
+        total += p->count;
+    }
+
+    if (bench) {
+        printf("%s: %.2f us/frame, efficiency %.1f%%, reused %.1f%%, "
+               "atlas %dx%d\n", incremental ? "skyline" : "shelf",
+               time / 1e3 / NUM_FRAMES, efficiency / NUM_FRAMES * 100,
+               reused * 100.0 / total, p->w, p->h);
+    }
+
+    talloc_free(p);
+}
+
+int main(int argc, char *argv[])
+{
+    bool bench = argc > 1 && !strcmp(argv[1], "--bench");
+
+    mp_time_init();
+
+    for (int n = 1; n <= NUM_GLYPHS; n++)
+        glyph_size[n] = (struct pos){1 + rnd(40), 1 + rnd(48)};
+
+    run(false, bench);
+    run(true, bench);
+
+    // Keys without any reuse, and zero-sized rectangles.
+    struct bitmap_packer *p = talloc_zero(NULL, struct bitmap_packer);
+    p->incremental = true;
+    packer_set_size(p, 3);
+    p->in[0] = (struct pos){10, 10};
+    p->in[1] = (struct pos){0, 5};
+    p->in[2] = (struct pos){20, 3};
+    assert_int_equal(packer_pack(p), 1);
+    assert_false(p->reused[0] || p->reused[1] || p->reused[2]);
+    assert_int_equal(p->used_area, 10 * 10 + 20 * 3);
+    talloc_free(p);
+
+    return 0;
+}
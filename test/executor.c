@@ -0,0 +1,71 @@
+#include <stdatomic.h>
+
+#include "common/common.h"
+#include "misc/executor.h"
+#include "osdep/threads.h"
+#include "test_utils.h"
+
+#define NUM_ITEMS 1000
+#define NUM_SUBMITTERS 4
+
+struct loop_ctx {
+    atomic_int hits[NUM_ITEMS];
+    int count;
+};
+
+static void count_item(void *ptr, int index)
+{
+    struct loop_ctx *ctx = ptr;
+    assert_true(index >= 0 && index < ctx->count);
+    atomic_fetch_add(&ctx->hits[index], 1);
+}
+
+static void check_loop(int count)
+{
+    struct loop_ctx ctx = {.count = count};
+    mp_parallel_for(count, count_item, &ctx);
+    for (int n = 0; n < NUM_ITEMS; n++)
+        assert_int_equal(atomic_load(&ctx.hits[n]), n < count);
+}
+
+static void nested_item(void *ptr, int index)
+{
+    atomic_int *total = ptr;
+    struct loop_ctx ctx = {.count = 16};
+    mp_parallel_for(ctx.count, count_item, &ctx);
+    for (int n = 0; n < ctx.count; n++)
+        atomic_fetch_add(total, atomic_load(&ctx.hits[n]));
+}
+
+static MP_THREAD_VOID submitter(void *arg)
+{
+    for (int n = 0; n < 50; n++)
+        check_loop(1 + n * 17 % NUM_ITEMS);
+    MP_THREAD_RETURN();
+}
+
+int main(void)
+{
+    assert_true(mp_executor_get_num_threads() >= 1);
+
+    check_loop(0);
+    check_loop(1);
+    check_loop(2);
+    check_loop(NUM_ITEMS);
+
+    // More tasks than fit into the deques.
+    for (int n = 0; n < 10; n++)
+        check_loop(NUM_ITEMS);
+
+    atomic_int total = 0;
+    mp_parallel_for(64, nested_item, &total);
+    assert_int_equal(atomic_load(&total), 64 * 16);
+
+    mp_thread threads[NUM_SUBMITTERS];
+    for (int n = 0; n < NUM_SUBMITTERS; n++)
+        assert_int_equal(mp_thread_create(&threads[n], submitter, NULL), 0);
+    for (int n = 0; n < NUM_SUBMITTERS; n++)
+        mp_thread_join(threads[n]);
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <string.h>
+
+#include "common/common.h"
+#include "osdep/timer.h"
+#include "test_utils.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+
+static const int formats[] = {IMGFMT_NV12, IMGFMT_P010};
+
+static const struct { int w, h; } sizes[] = {
+    {1920, 1080},
+    {3840, 2160},
+    {7680, 4320},
+};
+
+static void fill_image(struct mp_image *img, unsigned seed)
+{
+    for (int n = 0; n < img->num_planes; n++) {
+        int line_bytes = mp_image_plane_bytes(img, n, 0, img->w);
+        for (int y = 0; y < mp_image_plane_h(img, n); y++) {
+            uint8_t *line = img->planes[n] + y * img->stride[n];
+            for (int x = 0; x < line_bytes; x++) {
+                seed = seed * 1664525 + 1013904223;
+                line[x] = seed >> 24;
+            }
+        }
+    }
+}
+
+static void check_equal(struct mp_image *a, struct mp_image *b)
+{
+    for (int n = 0; n < a->num_planes; n++) {
+        int line_bytes = mp_image_plane_bytes(a, n, 0, a->w);
+        for (int y = 0; y < mp_image_plane_h(a, n); y++) {
+            assert_memcmp(a->planes[n] + y * a->stride[n],
+                          b->planes[n] + y * b->stride[n], line_bytes);
+        }
+    }
+}
+
+// Plain single-threaded copy, for comparison.
+static void copy_reference(struct mp_image *dst, struct mp_image *src)
+{
+    for (int n = 0; n < dst->num_planes; n++) {
+        int line_bytes = mp_image_plane_bytes(dst, n, 0, dst->w);
+        memcpy_pic(dst->planes[n], src->planes[n], line_bytes,
+                   mp_image_plane_h(dst, n), dst->stride[n], src->stride[n]);
+    }
+}
+
+static double time_copy(void (*copy)(struct mp_image *, struct mp_image *),
+                        struct mp_image *dst, struct mp_image *src)
+{
+    const int runs = 20;
+    int64_t start = mp_time_ns();
+    for (int n = 0; n < runs; n++)
+        copy(dst, src);
+    return MP_TIME_NS_TO_MS(mp_time_ns() - start) / runs;
+}
+
+int main(int argc, char *argv[])
+{
+    bool bench = argc > 1 && !strcmp(argv[1], "--bench");
+
+    mp_time_init();
+
+    for (int f = 0; f < MP_ARRAY_SIZE(formats); f++) {
+        for (int s = 0; s < MP_ARRAY_SIZE(sizes); s++) {
+            int fmt = formats[f], w = sizes[s].w, h = sizes[s].h;
+
+            struct mp_image *src = mp_image_alloc(fmt, w, h);
+            struct mp_image *dst = mp_image_alloc(fmt, w, h);
+            assert_true(src && dst);
+            fill_image(src, f * 10 + s);
+
+            mp_image_copy(dst, src);
+            check_equal(dst, src);
+
+            // Misaligned pointers and partial lines.
+            struct mp_image src_c = *src, dst_c = *dst;
+            mp_image_crop(&src_c, 2, 2, w - 4, h - 2);
+            mp_image_crop(&dst_c, 4, 2, w - 2, h - 2);
+            fill_image(dst, 1234);
+            mp_image_copy(&dst_c, &src_c);
+            check_equal(&dst_c, &src_c);
+
+            if (bench) {
+                double t_ref = time_copy(copy_reference, dst, src);
+                double t_new = time_copy(mp_image_copy, dst, src);
+                printf("%s %dx%d: memcpy_pic %.3f ms, mp_image_copy %.3f ms\n",
+                       mp_imgfmt_to_name(fmt), w, h, t_ref, t_new);
+            }
+
+            talloc_free(src);
+            talloc_free(dst);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <string.h>
+
+#include "common/common.h"
+#include "misc/interval_tree.h"
+#include "osdep/timer.h"
+#include "test_utils.h"
+
+// Roughly a long typeset track: 50k events over ~24 minutes, many short
+// overlapping ones and a few long ones.
+#define NUM_EVENTS 50000
+
+struct event {
+    int64_t start, end;
+};
+
+static uint32_t rand_state = 1;
+
+static uint32_t rnd(uint32_t max)
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    return (rand_state >> 8) % max;
+}
+
+static void make_event(struct event *ev, int n)
+{
+    ev->start = n * 30 + rnd(2000);
+    ev->end = ev->start + (rnd(100) ? 100 + rnd(5000) : 60000 + rnd(600000));
+}
+
+static int query_linear(struct event *events, int num, int64_t lo, int64_t hi,
+                        int **ids, int *num_ids)
+{
+    for (int n = 0; n < num; n++) {
+        if (events[n].start <= hi && events[n].end > lo)
+            MP_TARRAY_APPEND(NULL, *ids, *num_ids, n);
+    }
+    return *num_ids;
+}
+
+static void check_query(struct mp_interval_tree *t, struct event *events,
+                        int num, int64_t lo, int64_t hi)
+{
+    int *a = NULL, *b = NULL;
+    int num_a = 0, num_b = 0;
+    mp_interval_tree_query(t, lo, hi, NULL, &a, &num_a);
+    query_linear(events, num, lo, hi, &b, &num_b);
+    assert_int_equal(num_a, num_b);
+    if (num_a)
+        assert_memcmp(a, b, num_a * sizeof(int));
+    talloc_free(a);
+    talloc_free(b);
+}
+
+int main(int argc, char *argv[])
+{
+    bool bench = argc > 1 && !strcmp(argv[1], "--bench");
+
+    mp_time_init();
+
+    struct mp_interval_tree *t = mp_interval_tree_new(NULL);
+    struct event *events = talloc_array(t, struct event, NUM_EVENTS);
+
+    // Empty tree.
+    check_query(t, events, 0, 0, 0);
+
+    // Incremental appends, checking as we go.
+    for (int n = 0; n < NUM_EVENTS; n++) {
+        make_event(&events[n], n);
+        mp_interval_tree_set(t, n, events[n].start, events[n].end);
+        if (n % 997 == 0)
+            check_query(t, events, n + 1, events[n].start, events[n].start);
+    }
+    assert_int_equal(mp_interval_tree_num(t), NUM_EVENTS);
+
+    for (int n = 0; n < 2000; n++) {
+        int64_t pos = rnd(NUM_EVENTS * 30 + 10000);
+        check_query(t, events, NUM_EVENTS, pos, pos);
+        check_query(t, events, NUM_EVENTS, pos - 500, pos + 500);
+    }
+
+    // Changing existing intervals (like fixing up unknown durations).
+    for (int n = 0; n < 5000; n++) {
+        int id = rnd(NUM_EVENTS);
+        make_event(&events[id], id);
+        mp_interval_tree_set(t, id, events[id].start, events[id].end);
+    }
+    for (int n = 0; n < 2000; n++) {
+        int64_t pos = rnd(NUM_EVENTS * 30 + 10000);
+        check_query(t, events, NUM_EVENTS, pos, pos);
+    }
+
+    // Boundaries are half-open.
+    mp_interval_tree_clear(t);
+    assert_int_equal(mp_interval_tree_num(t), 0);
+    events[0] = (struct event){100, 200};
+    mp_interval_tree_set(t, 0, 100, 200);
+    check_query(t, events, 1, 99, 99);
+    check_query(t, events, 1, 100, 100);
+    check_query(t, events, 1, 199, 199);
+    check_query(t, events, 1, 200, 200);
+
+    if (bench) {
+        mp_interval_tree_clear(t);
+        int64_t start = mp_time_ns();
+        for (int n = 0; n < NUM_EVENTS; n++) {
+            make_event(&events[n], n);
+            mp_interval_tree_set(t, n, events[n].start, events[n].end);
+        }
+        printf("build: %.3f ms\n", MP_TIME_NS_TO_MS(mp_time_ns() - start));
+
+        // One query per frame at 24 fps over the whole track.
+        int *ids = NULL;
+        int num_ids = 0, total = 0, frames = 0;
+        start = mp_time_ns();
+        for (int64_t pos = 0; pos < NUM_EVENTS * 30; pos += 42, frames++) {
+            num_ids = 0;
+            mp_interval_tree_query(t, pos, pos, t, &ids, &num_ids);
+            total += num_ids;
+        }
+        double t_tree = MP_TIME_NS_TO_MS(mp_time_ns() - start);
+        start = mp_time_ns();
+        for (int64_t pos = 0; pos < NUM_EVENTS * 30; pos += 42) {
+            num_ids = 0;
+            total -= query_linear(events, NUM_EVENTS, pos, pos, &ids, &num_ids);
+        }
+        double t_linear = MP_TIME_NS_TO_MS(mp_time_ns() - start);
+        assert_int_equal(total, 0);
+        printf("%d queries: index %.3f us/query, linear %.3f us/query\n",
+               frames, t_tree * 1000 / frames, t_linear * 1000 / frames);
+        talloc_free(ids);
+    }
+
+    talloc_free(t);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libmpv_common.h"
+
+static char *write_script(const char *dir, const char *name, const char *code)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        fail("Could not create %s\n", path);
+    fputs(code, f);
+    fclose(f);
+    return strdup(path);
+}
+
+static mpv_node *find_key(mpv_node *map, const char *key)
+{
+    for (int n = 0; n < map->u.list->num; n++) {
+        if (strcmp(map->u.list->keys[n], key) == 0)
+            return &map->u.list->values[n];
+    }
+    return NULL;
+}
+
+// Check the script's entry in script-load-times.
+static void check_profile(const char *name, bool lazy, bool started)
+{
+    mpv_node list;
+    check_api_error(mpv_get_property(ctx, "script-load-times", MPV_FORMAT_NODE, &list));
+    mpv_node *entry = NULL;
+    for (int n = 0; n < list.u.list->num; n++) {
+        mpv_node *e = &list.u.list->values[n];
+        if (strcmp(find_key(e, "name")->u.string, name) == 0)
+            entry = e;
+    }
+    if (!entry)
+        fail("No profile for script %s!\n", name);
+    if (find_key(entry, "lazy")->u.flag != lazy)
+        fail("%s: expected lazy=%d!\n", name, lazy);
+    if (find_key(entry, "started")->u.flag != started)
+        fail("%s: expected started=%d!\n", name, started);
+    // The scripts are only checked after they processed a message, so they
+    // have been initialized.
+    if (started && (!find_key(entry, "init-time") || !find_key(entry, "compile-time")))
+        fail("%s: missing load times!\n", name);
+    mpv_free_node_contents(&list);
+}
+
+static void check_unset(const char *property)
+{
+    char *value = mpv_get_property_string(ctx, property);
+    if (value)
+        fail("%s: expected no value but got '%s'!\n", property, value);
+}
+
+static void wait_for_string(const char *property, const char *expect)
+{
+    check_api_error(mpv_observe_property(ctx, 1, property, MPV_FORMAT_STRING));
+    while (1) {
+        mpv_event *event = wrap_wait_event();
+        if (event->event_id != MPV_EVENT_PROPERTY_CHANGE)
+            continue;
+        mpv_event_property *prop = event->data;
+        if (prop->format == MPV_FORMAT_STRING &&
+            strcmp(*(char **)prop->data, expect) == 0)
+            break;
+    }
+    check_api_error(mpv_unobserve_property(ctx, 1));
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+        return 1;
+
+    ctx = mpv_create();
+    if (!ctx)
+        return 1;
+
+    atexit(exit_cleanup);
+
+    char *scripts[] = {
+        write_script(argv[1], "lazy_message.lua",
+            "-- mpv-lazy-message: lazy-test-ping\n"
+            "mp.register_script_message('lazy-test-ping', function()\n"
+            "    mp.set_property('user-data/lazy-test/message', 'pong')\n"
+            "end)\n"),
+        write_script(argv[1], "lazy_binding.lua",
+            "-- A script with a key binding.\n"
+            "-- mpv-lazy-key: Ctrl+F12 hello\n"
+            "mp.add_key_binding(nil, 'hello', function()\n"
+            "    mp.set_property('user-data/lazy-test/binding', 'hello')\n"
+            "end)\n"),
+        write_script(argv[1], "eager.lua",
+            "mp.register_script_message('eager-ping', function()\n"
+            "    mp.set_property('user-data/lazy-test/eager', 'yes')\n"
+            "end)\n"),
+    };
+    mpv_node values[3];
+    for (int n = 0; n < 3; n++)
+        values[n] = (mpv_node){.format = MPV_FORMAT_STRING, .u.string = scripts[n]};
+    mpv_node_list list = {.num = 3, .values = values};
+    mpv_node node = {.format = MPV_FORMAT_NODE_ARRAY, .u.list = &list};
+    check_api_error(mpv_set_option(ctx, "scripts", MPV_FORMAT_NODE, &node));
+    check_api_error(mpv_set_option_string(ctx, "lazy-load-scripts", "yes"));
+    check_api_error(mpv_set_option_string(ctx, "script-bytecode-cache", "no"));
+    initialize();
+
+    const char *fmt = "================ TEST: %s ================\n";
+    printf(fmt, "test_lazy_scripts");
+
+    check_api_error(mpv_command_string(ctx, "script-message-to eager eager-ping"));
+    wait_for_string("user-data/lazy-test/eager", "yes");
+    check_profile("eager", false, true);
+
+    check_profile("lazy_message", true, false);
+    check_profile("lazy_binding", true, false);
+    check_unset("user-data/lazy-test/message");
+    check_unset("user-data/lazy-test/binding");
+
+    // Unrelated messages don't start it.
+    check_api_error(mpv_command_string(ctx, "script-message other-message"));
+    check_profile("lazy_message", true, false);
+
+    check_api_error(mpv_command_string(ctx, "script-message lazy-test-ping"));
+    wait_for_string("user-data/lazy-test/message", "pong");
+    check_profile("lazy_message", false, true);
+    check_profile("lazy_binding", true, false);
+
+    // The declared key binding is defined before the script runs.
+    mpv_node bindings;
+    check_api_error(mpv_get_property(ctx, "input-bindings", MPV_FORMAT_NODE, &bindings));
+    bool found = false;
+    for (int n = 0; n < bindings.u.list->num; n++) {
+        mpv_node *cmd = find_key(&bindings.u.list->values[n], "cmd");
+        found |= strcmp(cmd->u.string, "script-binding lazy_binding/hello") == 0;
+    }
+    mpv_free_node_contents(&bindings);
+    if (!found)
+        fail("Key binding of lazy script not defined!\n");
+
+    check_api_error(mpv_command_string(ctx, "script-binding lazy_binding/hello"));
+    wait_for_string("user-data/lazy-test/binding", "hello");
+    check_profile("lazy_binding", false, true);
+
+    printf("================ SHUTDOWN ================\n");
+
+    mpv_command_string(ctx, "quit");
+    while (wrap_wait_event()->event_id != MPV_EVENT_SHUTDOWN) {}
+
+    for (int n = 0; n < 3; n++)
+        free(scripts[n]);
+    return 0;
+}
@@ -114,6 +114,140 @@ static void test_options_and_properties(void)
         fail("Node: expected 1 but got %d'!\n", result_node.u.flag);
 }
 
+static void test_batch_properties(void)
+{
+    mpv_node_list list = {
+        .num = 3,
+        .keys = (char *[]){"volume", "pause", "speed"},
+        .values = (mpv_node[]){
+            {.format = MPV_FORMAT_DOUBLE, .u.double_ = 42},
+            {.format = MPV_FORMAT_FLAG, .u.flag = 1},
+            {.format = MPV_FORMAT_STRING, .u.string = "1.5"},
+        },
+    };
+    mpv_node values = {.format = MPV_FORMAT_NODE_MAP, .u.list = &list};
+    check_api_error(mpv_set_properties(ctx, &values));
+    check_double("volume", 42);
+    check_flag("pause", 1);
+    check_double("speed", 1.5);
+
+    // Stops at the first failing property.
+    list.keys[1] = "does-not-exist";
+    list.values[0].u.double_ = 10;
+    list.values[2].u.string = "2";
+    if (mpv_set_properties(ctx, &values) != MPV_ERROR_PROPERTY_NOT_FOUND)
+        fail("Expected error for unknown property!\n");
+    check_double("volume", 10);
+    check_double("speed", 1.5);
+
+    // The repeated name is returned once.
+    const char *names[] = {"volume", "does-not-exist", "pause", "volume",
+                           NULL};
+    mpv_node result;
+    check_api_error(mpv_get_properties(ctx, names, &result));
+    if (result.format != MPV_FORMAT_NODE_MAP || result.u.list->num != 3)
+        fail("Node: expected map with 3 entries!\n");
+    for (int n = 0; n < 3; n++) {
+        if (strcmp(result.u.list->keys[n], names[n]) != 0)
+            fail("Node: expected key '%s' but got '%s'!\n", names[n],
+                 result.u.list->keys[n]);
+    }
+    mpv_node *v = result.u.list->values;
+    if (v[0].format != MPV_FORMAT_DOUBLE || v[0].u.double_ != 10)
+        fail("Node: wrong value for volume!\n");
+    if (v[1].format != MPV_FORMAT_NONE)
+        fail("Node: expected no value for unknown property!\n");
+    if (v[2].format != MPV_FORMAT_FLAG || v[2].u.flag != 1)
+        fail("Node: wrong value for pause!\n");
+    mpv_free_node_contents(&result);
+}
+
+// Return the playlist length after applying a delta mode change event to a
+// playlist with the given length.
+static int apply_playlist_delta(mpv_node *data, int count, int *num_patches)
+{
+    if (data->format != MPV_FORMAT_NODE_MAP || data->u.list->num != 1)
+        fail("Node: expected delta map!\n");
+    mpv_node *val = &data->u.list->values[0];
+    if (!strcmp(data->u.list->keys[0], "value"))
+        return val->u.list->num;
+    if (strcmp(data->u.list->keys[0], "patch"))
+        fail("Node: unexpected key '%s'!\n", data->u.list->keys[0]);
+    *num_patches += 1;
+    for (int n = 0; n < val->u.list->num; n++) {
+        mpv_node *op = &val->u.list->values[n];
+        const char *name = op->u.list->values[0].u.string;
+        const char *path = op->u.list->values[1].u.string;
+        if (strchr(path + 1, '/'))
+            continue; // only changes an entry
+        count += !strcmp(name, "add") - !strcmp(name, "remove");
+    }
+    return count;
+}
+
+static void test_observe_options(void)
+{
+    check_api_error(mpv_observe_property(ctx, 10, "playlist", MPV_FORMAT_NODE));
+    check_api_error(mpv_observe_property(ctx, 11, "playlist-count", MPV_FORMAT_INT64));
+    mpv_node_list delta_list = {
+        .num = 1,
+        .keys = (char *[]){"delta"},
+        .values = (mpv_node[]){{.format = MPV_FORMAT_FLAG, .u.flag = 1}},
+    };
+    mpv_node delta = {.format = MPV_FORMAT_NODE_MAP, .u.list = &delta_list};
+    if (mpv_observe_property_options(ctx, 10, &delta) != 1)
+        fail("Expected 1 property to be affected!\n");
+    mpv_node_list rate_list = {
+        .num = 1,
+        .keys = (char *[]){"max-rate"},
+        .values = (mpv_node[]){{.format = MPV_FORMAT_DOUBLE, .u.double_ = 1}},
+    };
+    mpv_node rate = {.format = MPV_FORMAT_NODE_MAP, .u.list = &rate_list};
+    check_api_error(mpv_observe_property_options(ctx, 11, &rate));
+
+    const int num_files = 20;
+    int count = -1, rate_count = -1, num_patches = 0, rate_events = 0;
+    for (int n = 0; n < num_files; n++) {
+        char file[32];
+        snprintf(file, sizeof(file), "file%d.mkv", n);
+        const char *cmd[] = {"loadfile", file, "append", NULL};
+        check_api_error(mpv_command(ctx, cmd));
+        // Wait for each change, so that the delta mode has something to do.
+        while (count != n + 1) {
+            mpv_event *event = wrap_wait_event();
+            if (event->event_id != MPV_EVENT_PROPERTY_CHANGE)
+                continue;
+            mpv_event_property *prop = event->data;
+            if (event->reply_userdata == 10) {
+                count = apply_playlist_delta(prop->data, count < 0 ? 0 : count,
+                                             &num_patches);
+            } else if (event->reply_userdata == 11) {
+                rate_count = *(int64_t *)prop->data;
+                rate_events++;
+            }
+        }
+    }
+    if (num_patches < num_files / 2)
+        fail("Expected patches, but got only %d!\n", num_patches);
+
+    // The rate limited property must arrive at the final value eventually.
+    while (rate_count != num_files) {
+        mpv_event *event = wrap_wait_event();
+        if (event->event_id == MPV_EVENT_PROPERTY_CHANGE &&
+            event->reply_userdata == 11)
+        {
+            rate_count = *(int64_t *)((mpv_event_property *)event->data)->data;
+            rate_events++;
+        }
+    }
+    if (rate_events > num_files / 2)
+        fail("Rate limit: got %d events for %d changes!\n", rate_events, num_files);
+
+    mpv_unobserve_property(ctx, 10);
+    mpv_unobserve_property(ctx, 11);
+    check_api_error(mpv_command_string(ctx, "playlist-clear"));
+}
+
 int main(int argc, char *argv[])
 {
     if (argc != 1)
@@ -130,6 +264,10 @@ int main(int argc, char *argv[])
     const char *fmt = "================ TEST: %s ================\n";
     printf(fmt, "test_options_and_properties");
     test_options_and_properties();
+    printf(fmt, "test_batch_properties");
+    test_batch_properties();
+    printf(fmt, "test_observe_options");
+    test_observe_options();
     printf("================ SHUTDOWN ================\n");
 
     mpv_command_string(ctx, "quit");
@@ -0,0 +1,157 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+
+#include "libmpv_common.h"
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+}
+
+static char *write_playlist(const char *dir, const char *file, int num_entries)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/playlist-loading.m3u", dir);
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        fail("Could not create %s\n", path);
+    fprintf(f, "#EXTM3U\n");
+    for (int n = 0; n < num_entries; n++)
+        fprintf(f, "#EXTINF:0,entry%d\n%s\n", n, file);
+    fclose(f);
+    return strdup(path);
+}
+
+static void load_playlist(const char *path)
+{
+    const char *cmd[] = {"loadfile", path, NULL};
+    check_api_error(mpv_command(ctx, cmd));
+    while (1) {
+        mpv_event *event = wrap_wait_event();
+        if (event->event_id == MPV_EVENT_FILE_LOADED)
+            break;
+        if (event->event_id == MPV_EVENT_IDLE)
+            fail("Playlist was not loaded!\n");
+    }
+}
+
+static void wait_for_count(int64_t count)
+{
+    check_api_error(mpv_observe_property(ctx, 1, "playlist-count", MPV_FORMAT_INT64));
+    while (1) {
+        mpv_event *event = wrap_wait_event();
+        if (event->event_id != MPV_EVENT_PROPERTY_CHANGE)
+            continue;
+        mpv_event_property *prop = event->data;
+        if (prop->format == MPV_FORMAT_INT64 && *(int64_t *)prop->data == count)
+            break;
+    }
+    check_api_error(mpv_unobserve_property(ctx, 1));
+}
+
+static void check_title(int index)
+{
+    char property[64], expect[64];
+    snprintf(property, sizeof(property), "playlist/%d/title", index);
+    snprintf(expect, sizeof(expect), "entry%d", index);
+    check_string(property, expect);
+}
+
+// Entries which were not read yet when the previous entry ends are waited for.
+static void test_play_through(const char *path)
+{
+    check_api_error(mpv_set_property_string(ctx, "playlist-initial-entries", "1"));
+    check_api_error(mpv_set_property_string(ctx, "image-display-duration", "0"));
+    load_playlist(path);
+    for (int loaded = 1; loaded < 3;) {
+        mpv_event *event = wrap_wait_event();
+        if (event->event_id == MPV_EVENT_FILE_LOADED)
+            loaded++;
+        if (event->event_id == MPV_EVENT_IDLE)
+            fail("Playback stopped before the playlist was read!\n");
+    }
+    check_api_error(mpv_command_string(ctx, "stop"));
+    while (wrap_wait_event()->event_id != MPV_EVENT_IDLE) {}
+}
+
+static void test_entries(const char *path, int num_entries, int initial)
+{
+    char value[32];
+    snprintf(value, sizeof(value), "%d", initial);
+    check_api_error(mpv_set_property_string(ctx, "playlist-initial-entries", value));
+    check_api_error(mpv_set_property_string(ctx, "image-display-duration", "inf"));
+
+    int64_t start = now_ns();
+    load_playlist(path);
+    int64_t t_first = now_ns() - start;
+    wait_for_count(num_entries);
+    int64_t t_all = now_ns() - start;
+
+    check_int("playlist-pos", 0);
+    check_title(0);
+    check_title(initial);
+    check_title(num_entries / 2);
+    check_title(num_entries - 1);
+
+    printf("%d entries (%d initial): first file loaded after %.1f ms, "
+           "all entries after %.1f ms\n", num_entries, initial,
+           t_first / 1e6, t_all / 1e6);
+
+    check_api_error(mpv_command_string(ctx, "stop"));
+    while (wrap_wait_event()->event_id != MPV_EVENT_IDLE) {}
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+        return 1;
+    bool bench = argc > 3 && !strcmp(argv[3], "--bench");
+
+    ctx = mpv_create();
+    if (!ctx)
+        return 1;
+
+    atexit(exit_cleanup);
+
+    check_api_error(mpv_set_option_string(ctx, "idle", "yes"));
+    initialize();
+    while (wrap_wait_event()->event_id != MPV_EVENT_IDLE) {}
+
+    const char *fmt = "================ TEST: %s ================\n";
+    printf(fmt, "test_playlist_loading");
+
+    int num_entries = bench ? 1000000 : 5000;
+    char *path = write_playlist(argv[2], argv[1], num_entries);
+
+    test_play_through(path);
+    test_entries(path, num_entries, 100);
+    if (bench)
+        test_entries(path, num_entries, 0);
+
+    printf("================ SHUTDOWN ================\n");
+
+    mpv_command_string(ctx, "quit");
+    while (wrap_wait_event()->event_id != MPV_EVENT_SHUTDOWN) {}
+
+    remove(path);
+    free(path);
+    return 0;
+}
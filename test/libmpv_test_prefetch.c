@@ -0,0 +1,171 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libmpv_common.h"
+
+#define NUM_ENTRIES 6
+#define PREFETCH_ENTRIES 3 // --prefetch-playlist-entries
+
+// Prefetches are looked up by URL, so each entry needs its own file.
+static char entries[NUM_ENTRIES][4096];
+
+static int num_prefetched;
+static bool budget_split;
+
+static void copy_file(const char *src, const char *dst)
+{
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dst, "wb");
+    if (!in || !out)
+        fail("Could not copy %s to %s\n", src, dst);
+    char buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), in)))
+        fwrite(buf, 1, len, out);
+    fclose(in);
+    fclose(out);
+}
+
+static void create_entries(const char *file, const char *dir)
+{
+    const char *ext = strrchr(file, '.');
+    for (int n = 0; n < NUM_ENTRIES; n++) {
+        snprintf(entries[n], sizeof(entries[n]), "%s/prefetch-%d%s", dir, n,
+                 ext ? ext : "");
+        copy_file(file, entries[n]);
+    }
+}
+
+static void handle_log_message(mpv_event_log_message *msg)
+{
+    printf("[%s:%s] %s", msg->prefix, msg->level, msg->text);
+    if (msg->log_level <= MPV_LOG_LEVEL_ERROR)
+        fail("error was logged");
+    if (strncmp(msg->text, "Prefetching: ", 13) == 0)
+        num_prefetched++;
+    // Logged when the budget is split between the maximum number of entries
+    // prefetched at once.
+    char expect[80];
+    snprintf(expect, sizeof(expect), "Prefetch cache limit: %d bytes for each "
+             "of %d entries.\n", (1 << 20) / PREFETCH_ENTRIES, PREFETCH_ENTRIES);
+    budget_split |= strcmp(msg->text, expect) == 0;
+}
+
+// Like wrap_wait_event(), but also look at the prefetch log messages.
+static mpv_event *wait_event(void)
+{
+    while (1) {
+        mpv_event *ev = mpv_wait_event(ctx, 1);
+        if (ev->event_id == MPV_EVENT_LOG_MESSAGE) {
+            handle_log_message(ev->data);
+        } else if (ev->event_id != MPV_EVENT_NONE) {
+            return ev;
+        }
+    }
+}
+
+// Events are returned before log messages, so read the remaining ones.
+static void drain_log_messages(void)
+{
+    mpv_event *ev;
+    while ((ev = mpv_wait_event(ctx, 0))->event_id != MPV_EVENT_NONE) {
+        if (ev->event_id == MPV_EVENT_LOG_MESSAGE)
+            handle_log_message(ev->data);
+    }
+}
+
+static void append_entries(void)
+{
+    for (int n = 0; n < NUM_ENTRIES; n++) {
+        const char *cmd[] = {"loadfile", entries[n], "append-play", NULL};
+        check_api_error(mpv_command(ctx, cmd));
+    }
+}
+
+// All entries are played, and all but the first one are prefetched, several
+// at once.
+static void test_play_through(void)
+{
+    check_api_error(mpv_set_property_string(ctx, "image-display-duration", "0.05"));
+    num_prefetched = 0;
+    budget_split = false;
+    append_entries();
+    int loaded = 0;
+    while (1) {
+        mpv_event *event = wait_event();
+        if (event->event_id == MPV_EVENT_FILE_LOADED)
+            loaded++;
+        if (event->event_id == MPV_EVENT_IDLE)
+            break;
+    }
+    drain_log_messages();
+    if (loaded != NUM_ENTRIES)
+        fail("Expected %d files to be loaded, got %d!\n", NUM_ENTRIES, loaded);
+    if (num_prefetched != NUM_ENTRIES - 1)
+        fail("Expected %d prefetches, got %d!\n", NUM_ENTRIES - 1, num_prefetched);
+    if (!budget_split)
+        fail("Prefetch cache budget was not split!\n");
+    check_api_error(mpv_command_string(ctx, "playlist-clear"));
+}
+
+// Editing the playlist while entries are prefetched drops them.
+static void test_playlist_change(void)
+{
+    check_api_error(mpv_set_property_string(ctx, "image-display-duration", "inf"));
+    append_entries();
+    while (wait_event()->event_id != MPV_EVENT_FILE_LOADED) {}
+    check_api_error(mpv_command_string(ctx, "playlist-clear"));
+    check_int("playlist-count", 1);
+    check_api_error(mpv_command_string(ctx, "playlist-next force"));
+    while (wait_event()->event_id != MPV_EVENT_IDLE) {}
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+        return 1;
+
+    create_entries(argv[1], argv[2]);
+
+    ctx = mpv_create();
+    if (!ctx)
+        return 1;
+
+    atexit(exit_cleanup);
+
+    check_api_error(mpv_set_option_string(ctx, "idle", "yes"));
+    check_api_error(mpv_set_option_string(ctx, "prefetch-playlist", "yes"));
+    check_api_error(mpv_set_option_string(ctx, "prefetch-playlist-entries", "3"));
+    check_api_error(mpv_set_option_string(ctx, "prefetch-playlist-max-bytes", "1MiB"));
+    initialize();
+    while (wait_event()->event_id != MPV_EVENT_IDLE) {}
+
+    const char *fmt = "================ TEST: %s ================\n";
+    printf(fmt, "test_play_through");
+    test_play_through();
+    printf(fmt, "test_playlist_change");
+    test_playlist_change();
+
+    printf("================ SHUTDOWN ================\n");
+
+    mpv_command_string(ctx, "quit");
+    while (wait_event()->event_id != MPV_EVENT_SHUTDOWN) {}
+
+    for (int n = 0; n < NUM_ENTRIES; n++)
+        remove(entries[n]);
+    return 0;
+}
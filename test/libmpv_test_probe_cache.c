@@ -0,0 +1,127 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <dirent.h>
+
+#include "libmpv_common.h"
+
+// The probe cache is written to $XDG_CACHE_HOME/mpv/probe, which the test
+// points to the build directory.
+static void find_cache_file(const char *dir, char *path, size_t size)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+        fail("Cache directory %s was not created!\n", dir);
+    int found = 0;
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (de->d_name[0] == '.')
+            continue;
+        snprintf(path, size, "%s/%s", dir, de->d_name);
+        found++;
+    }
+    closedir(d);
+    if (found != 1)
+        fail("Expected 1 cache file, found %d!\n", found);
+}
+
+static char *read_text(const char *path)
+{
+    static char buf[4096];
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        fail("Could not open %s\n", path);
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[len] = '\0';
+    return buf;
+}
+
+static void load(const char *file, const char *expect_demuxer)
+{
+    reload_file(file);
+    check_string("current-demuxer", expect_demuxer);
+    check_api_error(mpv_command_string(ctx, "stop"));
+    while (wrap_wait_event()->event_id != MPV_EVENT_IDLE) {}
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+        return 1;
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s/mpv/probe", argv[2]);
+    char path[4096 + 256];
+    // Leftovers from previous runs.
+    DIR *d = opendir(dir);
+    if (d) {
+        struct dirent *de;
+        while ((de = readdir(d))) {
+            snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+            if (de->d_name[0] != '.')
+                remove(path);
+        }
+        closedir(d);
+    }
+
+    ctx = mpv_create();
+    if (!ctx)
+        return 1;
+
+    atexit(exit_cleanup);
+
+    check_api_error(mpv_set_option_string(ctx, "idle", "yes"));
+    check_api_error(mpv_set_option_string(ctx, "demuxer-probe-cache", "yes"));
+    initialize();
+    while (wrap_wait_event()->event_id != MPV_EVENT_IDLE) {}
+
+    const char *fmt = "================ TEST: %s ================\n";
+    printf(fmt, "test_probe_cache");
+
+    load(argv[1], "lavf");
+    find_cache_file(dir, path, sizeof(path));
+    char *text = read_text(path);
+    if (!strstr(text, "demuxer=lavf\n") || !strstr(text, "format="))
+        fail("Unexpected cache file contents:\n%s", text);
+
+    // Opening the file again uses the cache, and must not change it.
+    char first[4096];
+    snprintf(first, sizeof(first), "%s", text);
+    load(argv[1], "lavf");
+    if (strcmp(read_text(path), first) != 0)
+        fail("Cache file was rewritten!\n");
+
+    // A wrong cache entry only makes opening slower.
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        fail("Could not open %s\n", path);
+    char *demuxer = strstr(first, "demuxer=lavf\n");
+    fwrite(first, 1, demuxer - first, f);
+    fprintf(f, "demuxer=mkv\n%s", demuxer + strlen("demuxer=lavf\n"));
+    fclose(f);
+    load(argv[1], "lavf");
+    if (!strstr(read_text(path), "demuxer=lavf\n"))
+        fail("Wrong cache entry was not replaced!\n");
+
+    printf("================ SHUTDOWN ================\n");
+
+    mpv_command_string(ctx, "quit");
+    while (wrap_wait_event()->event_id != MPV_EVENT_SHUTDOWN) {}
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "libmpv_common.h"
+
+#define MAX_READERS 16
+
+static atomic_bool stop_readers;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+}
+
+// Poll some properties as fast as possible, like a UI updating its widgets.
+// Returns the number of reads. (Some of the properties are unavailable with
+// images, which is fine.)
+static void *reader_thread(void *arg)
+{
+    mpv_handle *client = mpv_create_client(ctx, NULL);
+    if (!client)
+        fail("Could not create client!\n");
+    int64_t reads = 0;
+    while (!atomic_load(&stop_readers)) {
+        double pos;
+        check_api_error(mpv_get_property(client, "time-pos", MPV_FORMAT_DOUBLE, &pos));
+        mpv_get_property(client, "percent-pos", MPV_FORMAT_DOUBLE, &pos);
+        mpv_node node;
+        if (mpv_get_property(client, "demuxer-cache-state", MPV_FORMAT_NODE, &node) >= 0)
+            mpv_free_node_contents(&node);
+        char *s = mpv_get_property_string(client, "time-remaining");
+        mpv_free(s);
+        reads += 4;
+    }
+    mpv_destroy(client);
+    return (void *)(intptr_t)reads;
+}
+
+// Run num_readers polling threads for the given time, and return the average
+// latency of properties which need the core (in microseconds).
+static double run_readers(int num_readers, double seconds, int64_t *reads)
+{
+    pthread_t threads[MAX_READERS];
+    atomic_store(&stop_readers, false);
+    for (int n = 0; n < num_readers; n++) {
+        if (pthread_create(&threads[n], NULL, reader_thread, NULL))
+            fail("Could not create thread!\n");
+    }
+
+    int64_t start = now_ns(), latency = 0, num_ops = 0;
+    while (now_ns() - start < seconds * 1e9) {
+        int64_t t = now_ns();
+        double volume;
+        check_api_error(mpv_get_property(ctx, "volume", MPV_FORMAT_DOUBLE, &volume));
+        latency += now_ns() - t;
+        num_ops++;
+    }
+
+    atomic_store(&stop_readers, true);
+    *reads = 0;
+    for (int n = 0; n < num_readers; n++) {
+        void *res;
+        pthread_join(threads[n], &res);
+        *reads += (intptr_t)res;
+    }
+    return latency / 1e3 / num_ops;
+}
+
+static void set_snapshot(const char *list)
+{
+    check_api_error(mpv_set_property_string(ctx, "property-snapshot", list));
+}
+
+// Changes made by a client must be visible to it right away, even if the
+// property is in the snapshot.
+static void test_read_own_writes(void)
+{
+    set_snapshot("pause,volume,time-pos");
+    for (int n = 0; n < 1000; n++) {
+        int flag = n & 1;
+        check_api_error(mpv_set_property(ctx, "pause", MPV_FORMAT_FLAG, &flag));
+        int result;
+        check_api_error(mpv_get_property(ctx, "pause", MPV_FORMAT_FLAG, &result));
+        if (result != flag)
+            fail("Flag: expected %d but got %d!\n", flag, result);
+        double volume = n % 100;
+        check_api_error(mpv_set_property(ctx, "volume", MPV_FORMAT_DOUBLE, &volume));
+        check_double("volume", volume);
+    }
+}
+
+// The snapshot must return the same values as the core.
+static void test_values(void)
+{
+    int flag = 1;
+    check_api_error(mpv_set_property(ctx, "pause", MPV_FORMAT_FLAG, &flag));
+
+    const char *props[] = {"time-pos", "pause", "volume", NULL};
+    const mpv_format formats[] = {MPV_FORMAT_STRING, MPV_FORMAT_OSD_STRING};
+    set_snapshot("time-pos,percent-pos,pause,volume");
+    for (int i = 0; props[i]; i++) {
+        for (int f = 0; f < 2; f++) {
+            char *snap = NULL, *core = NULL;
+            // Read repeatedly, so that the form gets published.
+            for (int n = 0; n < 100; n++) {
+                mpv_free(snap);
+                check_api_error(mpv_get_property(ctx, props[i], formats[f], &snap));
+            }
+            set_snapshot("");
+            check_api_error(mpv_get_property(ctx, props[i], formats[f], &core));
+            if (strcmp(snap, core) != 0)
+                fail("%s: expected '%s' but got '%s'!\n", props[i], core, snap);
+            mpv_free(snap);
+            mpv_free(core);
+            set_snapshot("time-pos,percent-pos,pause,volume");
+        }
+    }
+
+    // Errors are returned as well.
+    set_snapshot("unknown-property");
+    for (int n = 0; n < 100; n++) {
+        double d;
+        if (mpv_get_property(ctx, "unknown-property", MPV_FORMAT_DOUBLE, &d) !=
+            MPV_ERROR_PROPERTY_NOT_FOUND)
+            fail("Expected error for unknown property!\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+        return 1;
+    bool bench = argc > 2 && !strcmp(argv[2], "--bench");
+
+    ctx = mpv_create();
+    if (!ctx)
+        return 1;
+
+    atexit(exit_cleanup);
+
+    check_api_error(mpv_set_option_string(ctx, "image-display-duration", "inf"));
+    initialize();
+
+    const char *fmt = "================ TEST: %s ================\n";
+    printf(fmt, "test_property_snapshot");
+
+    const char *cmd[] = {"loadfile", argv[1], NULL};
+    check_api_error(mpv_command(ctx, cmd));
+    while (1) {
+        mpv_event *event = wrap_wait_event();
+        if (event->event_id == MPV_EVENT_PLAYBACK_RESTART)
+            break;
+        if (event->event_id == MPV_EVENT_END_FILE)
+            fail("Unable to load test file!\n");
+    }
+
+    test_read_own_writes();
+    test_values();
+
+    set_snapshot("time-pos,percent-pos,time-remaining,demuxer-cache-state");
+    int64_t reads;
+    run_readers(4, 0.2, &reads);
+
+    if (bench) {
+        for (int snapshot = 0; snapshot < 2; snapshot++) {
+            set_snapshot(snapshot ? "time-pos,percent-pos,time-remaining,"
+                                    "demuxer-cache-state" : "");
+            double latency = run_readers(MAX_READERS, 2, &reads);
+            printf("%s: %d readers, %.0f reads/s, core latency %.1f us\n",
+                   snapshot ? "snapshot" : "no snapshot", MAX_READERS,
+                   reads / 2.0, latency);
+        }
+    }
+
+    printf("================ SHUTDOWN ================\n");
+
+    mpv_command_string(ctx, "quit");
+    while (wrap_wait_event()->event_id != MPV_EVENT_SHUTDOWN) {}
+
+    return 0;
+}
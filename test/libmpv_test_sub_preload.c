@@ -0,0 +1,153 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+
+#include "libmpv_common.h"
+
+#define NUM_FILES 5
+#define NUM_EVENTS 50000
+
+static char *sub_files[NUM_FILES];
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+}
+
+// Large subtitle files, each event lasting one second. The last files are in
+// Latin-1, so that they need charset conversion.
+static void write_sub_files(const char *dir)
+{
+    for (int n = 0; n < NUM_FILES; n++) {
+        bool latin1 = n >= NUM_FILES - 2;
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/sub_preload_%d.srt", dir, n);
+        FILE *f = fopen(path, "wb");
+        if (!f)
+            fail("Could not create %s\n", path);
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            fprintf(f, "%d\n%02d:%02d:%02d,000 --> %02d:%02d:%02d,000\n",
+                    i + 1, i / 3600, i / 60 % 60, i % 60,
+                    (i + 1) / 3600, (i + 1) / 60 % 60, (i + 1) % 60);
+            fprintf(f, "%s %d.%d\n\n", latin1 ? "Caf\xe9" : "Line", n, i);
+        }
+        fclose(f);
+        sub_files[n] = strdup(path);
+    }
+}
+
+static void set_sub_files(void)
+{
+    mpv_node values[NUM_FILES];
+    for (int n = 0; n < NUM_FILES; n++)
+        values[n] = (mpv_node){.format = MPV_FORMAT_STRING, .u.string = sub_files[n]};
+    mpv_node_list list = {.num = NUM_FILES, .values = values};
+    mpv_node node = {.format = MPV_FORMAT_NODE_ARRAY, .u.list = &list};
+    check_api_error(mpv_set_property(ctx, "sub-files", MPV_FORMAT_NODE, &node));
+}
+
+// Return the time from loadfile until the first frame was shown.
+static double load(const char *file, const char *options)
+{
+    const char *cmd[] = {"loadfile", file, "replace", "-1", options, NULL};
+    int64_t start = now_ns();
+    check_api_error(mpv_command(ctx, cmd));
+    while (1) {
+        mpv_event *event = wrap_wait_event();
+        if (event->event_id == MPV_EVENT_PLAYBACK_RESTART)
+            break;
+        if (event->event_id == MPV_EVENT_END_FILE)
+            fail("Unable to load test file!\n");
+    }
+    return (now_ns() - start) / 1e6;
+}
+
+// Wait until the given properties have the expected values. The subtitles are
+// decoded in the background, so this may take a while after the first frame.
+static void wait_sub_text(const char *expect, const char *expect_secondary)
+{
+    check_api_error(mpv_observe_property(ctx, 1, "sub-text", MPV_FORMAT_STRING));
+    check_api_error(mpv_observe_property(ctx, 2, "secondary-sub-text",
+                                         MPV_FORMAT_STRING));
+    bool ok[2] = {false, false};
+    while (!ok[0] || !ok[1]) {
+        mpv_event *event = wrap_wait_event();
+        if (event->event_id != MPV_EVENT_PROPERTY_CHANGE)
+            continue;
+        mpv_event_property *prop = event->data;
+        int i = event->reply_userdata - 1;
+        const char *e = i ? expect_secondary : expect;
+        if (prop->format == MPV_FORMAT_STRING)
+            ok[i] = strcmp(*(char **)prop->data, e) == 0;
+    }
+    mpv_unobserve_property(ctx, 1);
+    mpv_unobserve_property(ctx, 2);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+        return 1;
+    bool bench = argc > 3 && !strcmp(argv[3], "--bench");
+
+    ctx = mpv_create();
+    if (!ctx)
+        return 1;
+
+    atexit(exit_cleanup);
+
+    check_api_error(mpv_set_option_string(ctx, "image-display-duration", "inf"));
+    check_api_error(mpv_set_option_string(ctx, "sub-auto", "no"));
+    check_api_error(mpv_set_option_string(ctx, "sub-codepage", "latin1"));
+    initialize();
+
+    write_sub_files(argv[2]);
+
+    const char *fmt = "================ TEST: %s ================\n";
+    printf(fmt, "test_sub_preload");
+
+    double t_none = load(argv[1], "");
+
+    set_sub_files();
+    double t_subs = load(argv[1], "sid=1,secondary-sid=4");
+    wait_sub_text("Line 0.0", "Caf\xc3\xa9 3.0");
+
+    // Seek while the subtitles are possibly still being preloaded.
+    check_api_error(mpv_command_string(ctx, "seek 0 absolute"));
+    wait_sub_text("Line 0.0", "Caf\xc3\xa9 3.0");
+
+    if (bench) {
+        printf("time to first frame: %.1f ms without subtitles, %.1f ms with "
+               "%d external subtitle files (%d events each)\n",
+               t_none, t_subs, NUM_FILES, NUM_EVENTS);
+    }
+
+    printf("================ SHUTDOWN ================\n");
+
+    mpv_command_string(ctx, "quit");
+    while (wrap_wait_event()->event_id != MPV_EVENT_SHUTDOWN) {}
+
+    for (int n = 0; n < NUM_FILES; n++) {
+        remove(sub_files[n]);
+        free(sub_files[n]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "common/common.h"
+#include "options/m_config_core.h"
+#include "options/m_option.h"
+#include "osdep/timer.h"
+#include "test_utils.h"
+
+// Roughly the size of the top-level option struct.
+#define NUM_ROOT_OPTS 500
+#define NUM_SUB_OPTS 50
+
+struct sub_opts {
+    int values[NUM_SUB_OPTS];
+};
+
+struct root_opts {
+    int values[NUM_ROOT_OPTS];
+    int forced;
+    char *str;
+    struct sub_opts *sub;
+};
+
+static char names[NUM_ROOT_OPTS + NUM_SUB_OPTS][16];
+static struct m_option sub_opt_list[NUM_SUB_OPTS + 1];
+static struct m_option root_opt_list[NUM_ROOT_OPTS + 4];
+
+static const struct m_sub_options sub_conf = {
+    .opts = sub_opt_list,
+    .size = sizeof(struct sub_opts),
+};
+
+static const struct m_sub_options root_conf = {
+    .opts = root_opt_list,
+    .size = sizeof(struct root_opts),
+};
+
+static void init_options(void)
+{
+    for (int n = 0; n < NUM_ROOT_OPTS; n++) {
+        snprintf(names[n], sizeof(names[n]), "opt-%d", n);
+        root_opt_list[n] = (struct m_option){
+            .name = names[n],
+            .type = &m_option_type_int,
+            .offset = offsetof(struct root_opts, values) + n * sizeof(int),
+        };
+    }
+    root_opt_list[NUM_ROOT_OPTS] = (struct m_option){
+        .name = "forced",
+        .type = &m_option_type_int,
+        .offset = offsetof(struct root_opts, forced),
+        .force_update = true,
+    };
+    root_opt_list[NUM_ROOT_OPTS + 1] = (struct m_option){
+        .name = "str",
+        .type = &m_option_type_string,
+        .offset = offsetof(struct root_opts, str),
+    };
+    root_opt_list[NUM_ROOT_OPTS + 2] = (struct m_option){
+        .name = "sub",
+        .type = &m_option_type_subconfig,
+        .offset = offsetof(struct root_opts, sub),
+        .priv = (void *)&sub_conf,
+    };
+    for (int n = 0; n < NUM_SUB_OPTS; n++) {
+        char *name = names[NUM_ROOT_OPTS + n];
+        snprintf(name, sizeof(names[0]), "sub-%d", n);
+        sub_opt_list[n] = (struct m_option){
+            .name = name,
+            .type = &m_option_type_int,
+            .offset = offsetof(struct sub_opts, values) + n * sizeof(int),
+        };
+    }
+}
+
+// Return the next changed option of the cache, or NULL.
+static void *next_changed(struct m_config_cache *cache)
+{
+    void *opt = NULL;
+    m_config_cache_get_next_changed(cache, &opt);
+    return opt;
+}
+
+int main(int argc, char *argv[])
+{
+    bool bench = argc > 1 && !strcmp(argv[1], "--bench");
+
+    mp_time_init();
+    init_options();
+
+    struct m_config_shadow *shadow = m_config_shadow_new(&root_conf);
+    void *caches = talloc_new(NULL);
+    struct m_config_cache *writer =
+        m_config_cache_from_shadow(caches, shadow, &root_conf);
+    struct m_config_cache *root =
+        m_config_cache_from_shadow(caches, shadow, &root_conf);
+    struct m_config_cache *sub =
+        m_config_cache_from_shadow(caches, shadow, &sub_conf);
+    struct root_opts *w = writer->opts, *r = root->opts;
+    struct sub_opts *s = sub->opts;
+
+    // A change is only seen by caches which include the option.
+    w->values[5] = 42;
+    assert_true(m_config_cache_write_opt(writer, &w->values[5]));
+    assert_false(m_config_cache_update(sub));
+    assert_true(m_config_cache_update(root));
+    assert_int_equal(r->values[5], 42);
+    assert_false(m_config_cache_update(root));
+
+    // Writing the same value again is not a change.
+    assert_false(m_config_cache_write_opt(writer, &w->values[5]));
+    assert_false(m_config_cache_update(root));
+
+    // Changed options are returned in order, and only once.
+    w->values[300] = 1;
+    w->values[1] = 2;
+    assert_true(m_config_cache_write_opt(writer, &w->values[300]));
+    assert_true(m_config_cache_write_opt(writer, &w->values[1]));
+    assert_true(next_changed(root) == &r->values[1]);
+    assert_true(next_changed(root) == &r->values[300]);
+    assert_true(next_changed(root) == NULL);
+    assert_int_equal(r->values[1], 2);
+    assert_int_equal(r->values[300], 1);
+
+    // Options changed back before the update are not reported.
+    w->values[7] = 1;
+    assert_true(m_config_cache_write_opt(writer, &w->values[7]));
+    w->values[7] = 0;
+    assert_true(m_config_cache_write_opt(writer, &w->values[7]));
+    assert_false(m_config_cache_update(root));
+
+    // Options with force_update are reported on every write, even if another
+    // option was written after them.
+    assert_true(m_config_cache_write_opt(writer, &w->forced));
+    w->values[8] = 3;
+    assert_true(m_config_cache_write_opt(writer, &w->values[8]));
+    assert_true(next_changed(root) == &r->values[8]);
+    assert_true(next_changed(root) == &r->forced);
+    assert_true(next_changed(root) == NULL);
+
+    // Dynamically allocated option values.
+    w->str = talloc_strdup(writer, "test");
+    assert_true(m_config_cache_write_opt(writer, &w->str));
+    assert_true(m_config_cache_update(root));
+    assert_string_equal(r->str, "test");
+
+    // Sub groups are seen by their own and all parent caches.
+    w->sub->values[3] = 9;
+    assert_true(m_config_cache_write_opt(writer, &w->sub->values[3]));
+    assert_true(m_config_cache_update(sub));
+    assert_int_equal(s->values[3], 9);
+    assert_true(m_config_cache_update(root));
+    assert_int_equal(r->sub->values[3], 9);
+
+    if (bench) {
+        // 1000 option changes, e.g. one second of a script animating an
+        // option, with all caches updating after each change.
+        int64_t t_root = 0, t_sub = 0;
+        for (int n = 0; n < 1000; n++) {
+            w->values[n % 10] = n;
+            m_config_cache_write_opt(writer, &w->values[n % 10]);
+            int64_t start = mp_time_ns();
+            m_config_cache_update(root);
+            int64_t mid = mp_time_ns();
+            m_config_cache_update(sub);
+            t_root += mid - start;
+            t_sub += mp_time_ns() - mid;
+        }
+        printf("1000 sets: changed group %.3f us/update, "
+               "other group %.3f us/update\n", t_root / 1e6, t_sub / 1e6);
+    }
+
+    talloc_free(caches);
+    talloc_free(shadow);
+    return 0;
+}
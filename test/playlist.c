@@ -0,0 +1,216 @@
+#include "common/common.h"
+#include "common/playlist.h"
+#include "demux/demux.h"
+#include "osdep/timer.h"
+#include "stream/stream.h"
+#include "test_utils.h"
+
+// playlist_parse_file() and file:// URLs are not tested here.
+char *mp_file_url_to_filename(void *talloc_ctx, bstr url)
+{
+    return NULL;
+}
+
+struct demuxer *demux_open_url(const char *url, struct demuxer_params *params,
+                               struct mp_cancel *cancel,
+                               struct mpv_global *global)
+{
+    return NULL;
+}
+
+void demux_free(struct demuxer *demuxer) {}
+
+static uint32_t rand_state = 1;
+
+static int rnd(int n)
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    return (rand_state >> 8) % n;
+}
+
+// The entries in the order expected in the playlist.
+struct model {
+    struct playlist_entry **entries;
+    int num_entries;
+};
+
+static void check_playlist(struct playlist *pl, struct model *m)
+{
+    assert_int_equal(pl->num_entries, m->num_entries);
+    assert_int_equal(playlist_entry_count(pl), m->num_entries);
+    int n = 0;
+    for (struct playlist_entry *e = playlist_get_first(pl); e;
+         e = playlist_entry_get_rel(e, 1))
+    {
+        assert_true(n < m->num_entries);
+        assert_true(e == m->entries[n]);
+        assert_int_equal(playlist_entry_to_index(pl, e), n);
+        assert_true(playlist_entry_from_index(pl, n) == e);
+        n++;
+    }
+    assert_int_equal(n, m->num_entries);
+    for (struct playlist_entry *e = playlist_get_last(pl); e;
+         e = playlist_entry_get_rel(e, -1))
+        assert_true(e == m->entries[--n]);
+    assert_int_equal(n, 0);
+    assert_true(!playlist_entry_from_index(pl, -1));
+    assert_true(!playlist_entry_from_index(pl, m->num_entries));
+}
+
+static struct playlist_entry *new_entry(int n)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "file%d.mkv", n);
+    return playlist_entry_new(name);
+}
+
+static void test_random_edits(void)
+{
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    struct model m = {0};
+
+    for (int i = 0; i < 20000; i++) {
+        int op = rnd(10);
+        if (op < 5 || !m.num_entries) {
+            int index = rnd(m.num_entries + 1);
+            struct playlist_entry *at = playlist_entry_from_index(pl, index);
+            struct playlist_entry *e = new_entry(i);
+            playlist_insert_at(pl, e, at);
+            MP_TARRAY_INSERT_AT(NULL, m.entries, m.num_entries, index, e);
+        } else if (op < 8) {
+            int index = rnd(m.num_entries);
+            playlist_remove(pl, m.entries[index]);
+            MP_TARRAY_REMOVE_AT(m.entries, m.num_entries, index);
+        } else {
+            int from = rnd(m.num_entries);
+            int to = rnd(m.num_entries + 1);
+            struct playlist_entry *e = m.entries[from];
+            struct playlist_entry *at = to < m.num_entries ? m.entries[to] : NULL;
+            playlist_move(pl, e, at);
+            if (e != at) {
+                MP_TARRAY_REMOVE_AT(m.entries, m.num_entries, from);
+                if (to > from)
+                    to--;
+                MP_TARRAY_INSERT_AT(NULL, m.entries, m.num_entries, to, e);
+            }
+        }
+        if (i % 97 == 0)
+            check_playlist(pl, &m);
+    }
+    check_playlist(pl, &m);
+
+    // Removing the current entry makes the next one current.
+    pl->current = m.entries[m.num_entries / 2];
+    struct playlist_entry *next = m.entries[m.num_entries / 2 + 1];
+    playlist_remove(pl, pl->current);
+    MP_TARRAY_REMOVE_AT(m.entries, m.num_entries, m.num_entries / 2);
+    assert_true(pl->current == next && pl->current_was_replaced);
+    assert_true(playlist_get_next(pl, 1) == next);
+    check_playlist(pl, &m);
+
+    playlist_clear_except_current(pl);
+    m.entries[0] = next;
+    m.num_entries = 1;
+    check_playlist(pl, &m);
+
+    playlist_clear(pl);
+    assert_true(!pl->current);
+    m.num_entries = 0;
+    check_playlist(pl, &m);
+
+    talloc_free(m.entries);
+    talloc_free(pl);
+}
+
+static void test_transfer_shuffle(void)
+{
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    struct playlist *src = talloc_zero(NULL, struct playlist);
+    struct model m = {0};
+
+    for (int n = 0; n < 1000; n++) {
+        struct playlist_entry *e = new_entry(n);
+        playlist_insert_at(pl, e, NULL);
+        MP_TARRAY_APPEND(NULL, m.entries, m.num_entries, e);
+    }
+    struct playlist_entry **added = NULL;
+    int num_added = 0;
+    for (int n = 0; n < 300; n++) {
+        struct playlist_entry *e = new_entry(n);
+        playlist_insert_at(src, e, NULL);
+        MP_TARRAY_APPEND(NULL, added, num_added, e);
+    }
+
+    int64_t id = playlist_transfer_entries_to(pl, 400, src);
+    assert_int_equal(id, added[0]->id);
+    assert_int_equal(added[num_added - 1]->id, id + num_added - 1);
+    assert_int_equal(src->num_entries, 0);
+    assert_true(!playlist_get_first(src));
+    MP_TARRAY_INSERT_N_AT(NULL, m.entries, m.num_entries, 400, num_added);
+    memcpy(&m.entries[400], added, num_added * sizeof(added[0]));
+    check_playlist(pl, &m);
+
+    playlist_shuffle(pl);
+    assert_int_equal(pl->num_entries, m.num_entries);
+    bool changed = false;
+    for (int n = 0; n < m.num_entries; n++)
+        changed |= playlist_entry_from_index(pl, n) != m.entries[n];
+    assert_true(changed);
+    playlist_unshuffle(pl);
+    check_playlist(pl, &m);
+
+    talloc_free(added);
+    talloc_free(m.entries);
+    talloc_free(src);
+    talloc_free(pl);
+}
+
+// Load, shuffle and edit a playlist with 1M entries.
+static void benchmark(void)
+{
+    const int num_entries = 1000000;
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+
+    int64_t start = mp_time_ns();
+    for (int n = 0; n < num_entries; n++)
+        playlist_insert_at(pl, new_entry(n), NULL);
+    int64_t t_load = mp_time_ns() - start;
+
+    start = mp_time_ns();
+    playlist_shuffle(pl);
+    int64_t t_shuffle = mp_time_ns() - start;
+
+    const int num_ops = 100000;
+    start = mp_time_ns();
+    for (int n = 0; n < num_ops; n++) {
+        struct playlist_entry *e = playlist_entry_from_index(pl, rnd(num_entries));
+        struct playlist_entry *at = playlist_entry_from_index(pl, rnd(num_entries));
+        playlist_move(pl, e, at);
+        playlist_entry_to_index(pl, e);
+    }
+    int64_t t_edit = mp_time_ns() - start;
+
+    start = mp_time_ns();
+    playlist_clear(pl);
+    int64_t t_clear = mp_time_ns() - start;
+
+    printf("%d entries: load %.1f ms, shuffle %.1f ms, clear %.1f ms, "
+           "move+index %.0f ns/op\n", num_entries, t_load / 1e6,
+           t_shuffle / 1e6, t_clear / 1e6, (double)t_edit / num_ops);
+    talloc_free(pl);
+}
+
+int main(int argc, char *argv[])
+{
+    bool bench = argc > 1 && !strcmp(argv[1], "--bench");
+
+    mp_time_init();
+
+    test_random_edits();
+    test_transfer_shuffle();
+
+    if (bench)
+        benchmark();
+
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include <libswscale/swscale.h>
 
+#include "misc/executor.h"
+#include "osdep/timer.h"
 #include "scale_test.h"
 #include "video/fmt-conversion.h"
 #include "video/zimg.h"
@@ -21,6 +23,39 @@ static const struct scale_test_fns fns = {
     .supports_fmts = supports_fmts,
 };
 
+// Time a 1080p YUV to RGB conversion with scaling, run as a single slice and
+// as slices on the executor.
+static void bench_slices(void)
+{
+    struct mp_image *src = mp_image_alloc(IMGFMT_420P, 1920, 1080);
+    struct mp_image *dst = mp_image_alloc(IMGFMT_BGR0, 1280, 720);
+    mp_require(src && dst);
+    for (int p = 0; p < src->num_planes; p++) {
+        for (int y = 0; y < mp_image_plane_h(src, p); y++)
+            memset(src->planes[p] + y * src->stride[p], y & 0xFF,
+                   mp_image_plane_bytes(src, p, 0, src->w));
+    }
+
+    const int runs = 50;
+    for (int threads = 1; threads >= 0; threads--) {
+        struct mp_zimg_context *zimg = mp_zimg_alloc();
+        zimg->opts.threads = threads;
+        // The first conversion includes setting up the slices.
+        mp_require(mp_zimg_convert(zimg, dst, src));
+        int64_t start = mp_time_ns();
+        for (int n = 0; n < runs; n++)
+            mp_require(mp_zimg_convert(zimg, dst, src));
+        double ms = MP_TIME_NS_TO_MS(mp_time_ns() - start) / runs;
+        printf("zimg 1920x1080 yuv420p -> 1280x720 bgr0, %d slice(s), "
+               "%d executor thread(s): %.3f ms\n", zimg->num_states,
+               mp_executor_get_num_threads(), ms);
+        talloc_free(zimg);
+    }
+
+    talloc_free(src);
+    talloc_free(dst);
+}
+
 int main(int argc, char *argv[])
 {
     struct mp_zimg_context *zimg = mp_zimg_alloc();
@@ -50,6 +85,11 @@ int main(int argc, char *argv[])
     assert_text_files_equal(stest->refdir, stest->outdir, "zimg_formats.txt",
                 "This can fail if FFmpeg/libswscale adds or removes pixfmts.");
 
+    if (argc > 3 && !strcmp(argv[3], "--bench")) {
+        mp_time_init();
+        bench_slices();
+    }
+
     talloc_free(stest);
     talloc_free(zimg);
     return 0;
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "common/common.h"
+#include "common/msg.h"
+#include "config.h"
+#include "osdep/timer.h"
+#include "sub/sd.h"
+#include "test_utils.h"
+
+// Events are in the Matroska format, i.e. with ReadOrder, without Start/End.
+#define EVENT_FORMAT "Layer, Start, End, Style, Name, MarginL, MarginR, " \
+                     "MarginV, Effect, Text"
+#define EVENT_HEADER "0,0,Default,,0,0,0,,"
+
+static const char *const samples[] = {
+    "sdh_default.srt", "sdh_mixed.srt", "sdh_all.srt", "sdh_mismatch.srt",
+};
+
+static char *sample_text[MP_ARRAY_SIZE(samples)];
+
+// Return the text of the first (and only) event of a sample, with lines
+// joined by \N like after conversion to ASS.
+static char *load_srt(void *ta_parent, const char *dir, const char *name)
+{
+    char *path = talloc_asprintf(ta_parent, "%s/%s", dir, name);
+    FILE *f = fopen(path, "rb");
+    assert_true(f);
+
+    bstr text = {0};
+    char line[1024];
+    for (int n = 0; fgets(line, sizeof(line), f); n++) {
+        bstr l = bstr_strip_linebreaks(bstr0(line));
+        if (n < 2 || !l.len) // index and timing
+            continue;
+        if (text.len)
+            bstr_xappend(ta_parent, &text, bstr0("\\N"));
+        bstr_xappend(ta_parent, &text, l);
+    }
+    fclose(f);
+    return bstrdup0(ta_parent, text);
+}
+
+static struct sd_filter_chain *create(void *ta_parent,
+                                      struct mp_sub_filter_opts *opts)
+{
+    return sd_filter_chain_create(ta_parent, NULL, mp_null_log, opts,
+                                  EVENT_FORMAT);
+}
+
+// Return the filtered text, or NULL if the event was dropped.
+static char *filter(void *ta_parent, struct sd_filter_chain *c, const char *text)
+{
+    char *buf = talloc_asprintf(ta_parent, EVENT_HEADER "%s", text);
+    bstr event = bstr0(buf);
+    if (!sd_filter_chain_apply(c, &event))
+        return NULL;
+    bstr header = bstr0(EVENT_HEADER);
+    assert_true(bstr_startswith(event, header));
+    return bstrto0(ta_parent, bstr_cut(event, header.len));
+}
+
+static void check(struct sd_filter_chain *c, const char *text,
+                  const char *expect)
+{
+    void *tmp = talloc_new(NULL);
+    char *res = filter(tmp, c, text);
+    if (expect) {
+        assert_true(res);
+        assert_string_equal(res, expect);
+    } else {
+        assert_false(res);
+    }
+    talloc_free(tmp);
+}
+
+static char *enclosures[] = {"()", "[]", "（）", NULL};
+
+static void test_sdh(void)
+{
+    struct mp_sub_filter_opts opts = {
+        .sub_filter_SDH = true,
+        .sub_filter_SDH_enclosures = enclosures,
+    };
+    struct sd_filter_chain *c = create(NULL, &opts);
+
+    check(c, sample_text[0], "Filter (things) from （random） string.");
+    check(c, sample_text[1], "all: 漢字 and وotherو non-ASCII characters、（together）");
+    check(c, sample_text[2], "(this)");
+    check(c, sample_text[3], "(No]　（filter) (should） (be） [applied)");
+    check(c, "{\\an8}[MUSIC] Hello", "{\\an8}Hello");
+    check(c, "- [GASPS]\\N- MAN: Look out!", "- Look out!");
+    check(c, "", "");
+
+    // Unchanged events are not copied.
+    bstr event = bstr0(EVENT_HEADER "Nothing to filter.");
+    bstr orig = event;
+    assert_true(sd_filter_chain_apply(c, &event));
+    assert_true(event.start == orig.start && event.len == orig.len);
+
+    talloc_free(c);
+
+    opts.sub_filter_SDH_harder = true;
+    c = create(NULL, &opts);
+    check(c, sample_text[0], "Filter from string.");
+    check(c, sample_text[1], "漢字 and وotherو non-ASCII characters、");
+    check(c, sample_text[2], NULL);
+    check(c, sample_text[3], "(No]　（filter) (should） (be） [applied)");
+    talloc_free(c);
+}
+
+#if HAVE_POSIX
+static void test_regex(void)
+{
+    struct mp_sub_filter_opts opts = {
+        .sub_filter_SDH = true,
+        .sub_filter_SDH_enclosures = enclosures,
+        .rf_enable = true,
+        .rf_items = (char *[]){"^filter", "(", "TOGETHER", NULL},
+    };
+    struct sd_filter_chain *c = create(NULL, &opts);
+    check(c, sample_text[0], NULL);
+    check(c, sample_text[1], NULL);
+    check(c, sample_text[2], "(this)");
+    check(c, sample_text[3], "(No]　（filter) (should） (be） [applied)");
+    // Regexes see the text after SDH filtering.
+    check(c, "[SIGHS] Filter", NULL);
+    check(c, "{\\i1}Filter", "{\\i1}Filter");
+    talloc_free(c);
+
+    // Backreferences can't be joined, and are matched separately.
+    opts.rf_items = (char *[]){"^filter", "(p)\\1", "together", NULL};
+    c = create(NULL, &opts);
+    check(c, sample_text[2], "(this)");
+    check(c, sample_text[3], NULL);
+    check(c, "pq", "pq");
+    talloc_free(c);
+
+    opts.rf_plain = true;
+    opts.rf_items = (char *[]){"^filter$", NULL};
+    c = create(NULL, &opts);
+    check(c, "{\\i1}Fil{\\i0}ter", NULL);
+    check(c, "{\\i1}Filters", "{\\i1}Filters");
+    check(c, "{\\p1}m 0 0 l 1 1{\\p0}", "{\\p1}m 0 0 l 1 1{\\p0}");
+    talloc_free(c);
+}
+#endif
+
+// Filter the samples, scaled up to a large preloaded subtitle file.
+static void benchmark(const char *name, struct mp_sub_filter_opts *opts)
+{
+    const int num_events = 200000;
+    void *tmp = talloc_new(NULL);
+    struct sd_filter_chain *c = create(tmp, opts);
+
+    char **events = talloc_array(tmp, char *, num_events);
+    for (int n = 0; n < num_events; n++) {
+        events[n] = talloc_asprintf(tmp, EVENT_HEADER "{\\i1}%s{\\i0}\\N%d",
+                                    sample_text[n % MP_ARRAY_SIZE(samples)], n);
+    }
+
+    int kept = 0;
+    int64_t start = mp_time_ns();
+    for (int n = 0; n < num_events; n++) {
+        bstr event = bstr0(events[n]);
+        kept += sd_filter_chain_apply(c, &event);
+    }
+    int64_t time = mp_time_ns() - start;
+
+    printf("%s: %.1f ns/event, %d of %d kept\n", name,
+           (double)time / num_events, kept, num_events);
+    talloc_free(tmp);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+        return 1;
+    bool bench = argc > 2 && !strcmp(argv[2], "--bench");
+
+    mp_time_init();
+
+    void *tmp = talloc_new(NULL);
+    for (int n = 0; n < MP_ARRAY_SIZE(samples); n++)
+        sample_text[n] = load_srt(tmp, argv[1], samples[n]);
+
+    test_sdh();
+#if HAVE_POSIX
+    test_regex();
+#endif
+
+    if (bench) {
+        struct mp_sub_filter_opts opts = {
+            .sub_filter_SDH = true,
+            .sub_filter_SDH_enclosures = enclosures,
+        };
+        benchmark("sdh", &opts);
+        opts.rf_enable = true;
+        opts.rf_items = (char *[]){"^filter", "together", "(p)\\1", "^#",
+                                   "www\\.", "subtitles? by", "sync(ed)? by",
+                                   "\\[[0-9]+\\]", NULL};
+        benchmark("sdh+regex", &opts);
+        opts.rf_plain = true;
+        benchmark("sdh+regex (plain)", &opts);
+    }
+
+    talloc_free(tmp);
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include <string.h>
+
+#include <libavcodec/avcodec.h>
+
+#include "common/common.h"
+#include "osdep/timer.h"
+#include "sub/sd.h"
+#include "test_utils.h"
+
+typedef bool (*native_fn)(void *ta_parent, bstr *dst, bstr src);
+
+static AVCodecContext *open_decoder(const char *name)
+{
+    const AVCodec *codec = avcodec_find_decoder_by_name(name);
+    assert_true(codec);
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    assert_true(avctx);
+    AVDictionary *opts = NULL;
+    av_dict_set(&opts, "sub_text_format", "ass", 0);
+    avctx->pkt_timebase = (AVRational){1, 1000};
+    assert_true(avcodec_open2(avctx, codec, &opts) >= 0);
+    av_dict_free(&opts);
+    return avctx;
+}
+
+// Return the Text field of the event produced by libavcodec, or NULL.
+static char *lavc_convert(void *ta_parent, AVCodecContext *avctx,
+                          const char *text)
+{
+    AVPacket *pkt = av_packet_alloc();
+    assert_true(pkt && av_new_packet(pkt, strlen(text)) >= 0);
+    memcpy(pkt->data, text, strlen(text));
+    pkt->pts = 0;
+    pkt->duration = 1000;
+
+    AVSubtitle sub;
+    int got_sub = 0;
+    char *res = NULL;
+    if (avcodec_decode_subtitle2(avctx, &sub, &got_sub, pkt) >= 0 && got_sub) {
+        char *p = sub.num_rects ? sub.rects[0]->ass : NULL;
+        // Skip ReadOrder, Layer, Style, Name, MarginL/R/V, Effect.
+        for (int n = 0; n < 8 && p; n++) {
+            p = strchr(p, ',');
+            if (p)
+                p++;
+        }
+        res = talloc_strdup(ta_parent, p);
+        avsubtitle_free(&sub);
+    }
+    av_packet_free(&pkt);
+    return res;
+}
+
+// Return the converted text, or NULL if the converter rejected it.
+static char *native_convert(void *ta_parent, native_fn fn, const char *text)
+{
+    bstr dst = {0};
+    if (!fn(ta_parent, &dst, bstr0(text)))
+        return NULL;
+    return bstrdup0(ta_parent, dst);
+}
+
+static void check(AVCodecContext *avctx, native_fn fn, const char *text,
+                  const char *expect)
+{
+    void *tmp = talloc_new(NULL);
+    char *res = native_convert(tmp, fn, text);
+    if (expect) {
+        assert_true(res);
+        assert_string_equal(res, expect);
+        char *lavc = lavc_convert(tmp, avctx, text);
+        assert_true(lavc);
+        assert_string_equal(res, lavc);
+    } else {
+        assert_false(res);
+    }
+    talloc_free(tmp);
+}
+
+static void check_webm(const char *packet, const char *expect)
+{
+    bstr res = sd_webvtt_webm_text(bstr0(packet));
+    assert_int_equal(res.len, strlen(expect));
+    assert_memcmp(res.start, expect, res.len);
+}
+
+static uint32_t rand_state = 1;
+
+static int rnd(int n)
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    return (rand_state >> 8) % n;
+}
+
+// Compare with libavcodec for random combinations of the given pieces,
+// whenever the native converter accepts the text.
+static void check_random(AVCodecContext *avctx, native_fn fn,
+                         const char *const *pieces, int num_pieces)
+{
+    void *tmp = talloc_new(NULL);
+    int accepted = 0;
+    for (int i = 0; i < 20000; i++) {
+        bstr text = {0};
+        int num = 1 + rnd(8);
+        for (int n = 0; n < num; n++)
+            bstr_xappend(tmp, &text, bstr0(pieces[rnd(num_pieces)]));
+        char *s = bstrdup0(tmp, text);
+        char *res = native_convert(tmp, fn, s);
+        if (res) {
+            char *lavc = lavc_convert(tmp, avctx, s);
+            assert_true(lavc);
+            assert_string_equal(res, lavc);
+            accepted++;
+        }
+        talloc_free_children(tmp);
+    }
+    assert_true(accepted > 1000);
+    talloc_free(tmp);
+}
+
+static const char *const srt_pieces[] = {
+    "Hello", "a", ",", " ", "  ", "\n", "\r\n", "<i>", "</i>", "<b>", "</b>",
+    "<u>", "</u>", "<s>", "</s>", "<I>", "</I>", "{\\an8}", "&amp;", "<",
+    ">", "<font color=red>", "</font>", "\\N", "\xc3\xa4", "{", "&", "\\",
+    "i>", "/i>", "b>", "u>",
+};
+
+static const char *const webvtt_pieces[] = {
+    "Hello", "a", " ", "\n", "\r\n", "<i>", "</i>", "<b>", "</b>", "<u>",
+    "</u>", "<c.red>", "</c>", "<v Bob>", "<00:00:01.000>", "&amp;", "&lt;",
+    "&gt;", "&nbsp;", "&lrm;", "&", "<", ">", "{", "\\", "\xc3\xa4",
+};
+
+static void benchmark(AVCodecContext *avctx, native_fn fn, const char *name,
+                      const char *text)
+{
+    const int num_events = 200000;
+    void *tmp = talloc_new(NULL);
+    bstr dst = {0};
+
+    int64_t start = mp_time_ns();
+    for (int n = 0; n < num_events; n++) {
+        dst.len = 0;
+        assert_true(fn(tmp, &dst, bstr0(text)));
+    }
+    int64_t t_native = mp_time_ns() - start;
+
+    AVPacket *pkt = av_packet_alloc();
+    assert_true(pkt && av_new_packet(pkt, strlen(text)) >= 0);
+    memcpy(pkt->data, text, strlen(text));
+    start = mp_time_ns();
+    for (int n = 0; n < num_events; n++) {
+        AVSubtitle sub;
+        int got_sub;
+        assert_true(avcodec_decode_subtitle2(avctx, &sub, &got_sub, pkt) >= 0);
+        if (got_sub)
+            avsubtitle_free(&sub);
+    }
+    int64_t t_lavc = mp_time_ns() - start;
+    av_packet_free(&pkt);
+
+    printf("%s: native %.1f ns/event, libavcodec %.1f ns/event\n", name,
+           (double)t_native / num_events, (double)t_lavc / num_events);
+    talloc_free(tmp);
+}
+
+int main(int argc, char *argv[])
+{
+    bool bench = argc > 1 && !strcmp(argv[1], "--bench");
+
+    mp_time_init();
+
+    AVCodecContext *srt = open_decoder("subrip");
+    AVCodecContext *vtt = open_decoder("webvtt");
+
+    check(srt, sd_srt_to_ass, "Hello\nWorld\n", "Hello\\NWorld");
+    check(srt, sd_srt_to_ass, "<i>Hello</i>\r\n<b>World</b>",
+          "{\\i1}Hello{\\i0}\\N{\\b1}World{\\b0}");
+    check(srt, sd_srt_to_ass, "  Indented \nline\n", "Indented\\Nline");
+    check(srt, sd_srt_to_ass, "<I>across\nlines</I>", "{\\i1}across\\Nlines{\\i0}");
+    check(srt, sd_srt_to_ass, "{\\an8}Top", NULL);
+    check(srt, sd_srt_to_ass, "<font color=\"red\">Red</font>", NULL);
+    check(srt, sd_srt_to_ass, "<i>Unclosed", NULL);
+    check(srt, sd_srt_to_ass, "Two\n\nEvents", NULL);
+    check(srt, sd_srt_to_ass, "{i>x{/i>", NULL);
+    check(srt, sd_srt_to_ass, "&b>x", NULL);
+    check(srt, sd_srt_to_ass, "\\u>x", NULL);
+
+    check(vtt, sd_webvtt_to_ass, "<v Bob>Hi &amp; bye</v>\n<c.yellow>you</c>",
+          "Hi & bye\\Nyou");
+    check(vtt, sd_webvtt_to_ass, "a&nbsp;b &lt;3 &unknown;",
+          "a\\hb <3 &unknown;");
+    check(vtt, sd_webvtt_to_ass, "<i>x</i>\n", "{\\i1}x{\\i0}");
+    check(vtt, sd_webvtt_to_ass, "1 <2", "1 ");
+    check(vtt, sd_webvtt_to_ass, "{braces}", NULL);
+    check(vtt, sd_webvtt_to_ass, "back\\slash", NULL);
+
+    check_webm("id\nsettings\ntext\n", "text");
+    check_webm("\n\nline 1\r\nline 2\r\n", "line 1\r\nline 2");
+    check_webm("id\r\n\r\nt", "t");
+    check_webm("id\ntext", "");
+    check_webm("id\rx\ntext", "");
+    check_webm("id\n\n\n", "");
+
+    check_random(srt, sd_srt_to_ass, srt_pieces, MP_ARRAY_SIZE(srt_pieces));
+    check_random(vtt, sd_webvtt_to_ass, webvtt_pieces,
+                 MP_ARRAY_SIZE(webvtt_pieces));
+
+    if (bench) {
+        benchmark(srt, sd_srt_to_ass, "srt",
+                  "<i>- Did you hear that?</i>\n- Hear what?\n");
+        benchmark(vtt, sd_webvtt_to_ass, "webvtt",
+                  "<v Alice>Did you hear that?</v>\n<c.blue>Hear what?</c>");
+    }
+
+    avcodec_free_context(&srt);
+    avcodec_free_context(&vtt);
+    return 0;
+}
@@ -16,6 +16,7 @@
  */
 
 #include <float.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -84,6 +85,7 @@ struct vd_lavc_params {
     bool check_hw_profile;
     char **avopts;
     int dr;
+    int64_t pool_max_bytes;
 };
 
 static const struct m_opt_choice_alternatives discard_names[] = {
@@ -114,6 +116,8 @@ const struct m_sub_options vd_lavc_conf = {
         {"vd-lavc-o", OPT_KEYVALUELIST(avopts)},
         {"vd-lavc-dr", OPT_CHOICE(dr,
             {"auto", -1}, {"no", 0}, {"yes", 1})},
+        {"vd-lavc-pool-max-bytes", OPT_BYTE_SIZE(pool_max_bytes),
+            M_RANGE(0, M_MAX_MEM_BYTES)},
         {"vd-apply-cropping", OPT_BOOL(apply_cropping)},
         {0}
     },
@@ -903,10 +907,25 @@ static void flush_all(struct mp_filter *vd)
     reset_avctx(vd);
 }
 
+static void log_pool_stats(struct mp_filter *vd, const char *name,
+                           struct mp_image_pool *pool)
+{
+    struct mp_image_pool_stats st;
+    mp_image_pool_get_stats(pool, &st);
+    if (!st.hits && !st.misses)
+        return;
+    MP_VERBOSE(vd, "%s pool: %"PRIu64" hits, %"PRIu64" misses, %"PRIu64
+               " allocations, %d images, %zu bytes resident\n", name, st.hits,
+               st.misses, st.allocs, st.num_images, st.resident_bytes);
+}
+
 static void uninit_avctx(struct mp_filter *vd)
 {
     vd_ffmpeg_ctx *ctx = vd->priv;
 
+    log_pool_stats(vd, "DR", ctx->dr_pool);
+    log_pool_stats(vd, "hwdec download", ctx->hwdec_swpool);
+
     flush_all(vd);
     av_frame_free(&ctx->pic);
     mp_free_av_packet(&ctx->avpkt);
@@ -1452,6 +1471,8 @@ static struct mp_decoder *create(struct mp_filter *parent,
     ctx->decoder = talloc_strdup(ctx, decoder);
     ctx->hwdec_swpool = mp_image_pool_new(ctx);
     ctx->dr_pool = mp_image_pool_new(ctx);
+    mp_image_pool_set_max_bytes(ctx->hwdec_swpool, ctx->opts->pool_max_bytes);
+    mp_image_pool_set_max_bytes(ctx->dr_pool, ctx->opts->pool_max_bytes);
 
     ctx->public.f = vd;
     ctx->public.control = control;
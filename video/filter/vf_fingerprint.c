@@ -15,14 +15,20 @@
  * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <inttypes.h>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "common/common.h"
 #include "common/tags.h"
 #include "filters/filter.h"
 #include "filters/filter_internal.h"
 #include "filters/user_filters.h"
+#include "misc/executor.h"
 #include "options/m_option.h"
+#include "options/path.h"
+#include "osdep/io.h"
 #include "video/img_format.h"
 #include "video/sws_utils.h"
 #include "video/zimg.h"
@@ -31,15 +37,27 @@
 
 #define PRINT_ENTRY_NUM 10
 
+// The choice values are the size of the downscaled image.
+#define TYPE_PHASH 32
+
+// Number of low frequency DCT coefficients (in each direction) used for the
+// perceptual hash. PHASH_BITS^2 is the hash size in bits.
+#define PHASH_BITS 8
+
+#define MAX_BATCH 64
+
 struct f_opts {
     int type;
     bool clear;
     bool print;
+    int batch;
+    char *file;
 };
 
 const struct m_opt_choice_alternatives type_names[] = {
     {"gray-hex-8x8",    8},
     {"gray-hex-16x16",  16},
+    {"phash-64",        TYPE_PHASH},
     {0}
 };
 
@@ -48,12 +66,15 @@ static const struct m_option f_opts_list[] = {
     {"type", OPT_CHOICE_C(type, type_names)},
     {"clear-on-query", OPT_BOOL(clear)},
     {"print", OPT_BOOL(print)},
+    {"batch", OPT_INT(batch), M_RANGE(1, MAX_BATCH)},
+    {"file", OPT_STRING(file), .flags = M_OPT_FILE},
     {0}
 };
 
 static const struct f_opts f_opts_def = {
     .type = 16,
     .clear = true,
+    .batch = 1,
 };
 
 struct print_entry {
@@ -61,89 +82,236 @@ struct print_entry {
     char *print;
 };
 
-struct priv {
-    struct f_opts *opts;
+// Per-frame conversion state. With batch>1, each frame of a batch uses its own
+// slot, and the slots are processed concurrently.
+struct slot {
     struct mp_image *scaled;
     struct mp_sws_context *sws;
     struct mp_zimg_context *zimg;
+    bool fallback_warning;
+    struct mp_frame frame;      // queued input frame
+    char *print;                // result, or NULL on failure
+};
+
+struct priv {
+    struct f_opts *opts;
+    struct mp_log *log;
+    struct slot slots[MAX_BATCH];
+    int num_queued;             // number of slots with a queued frame
+    int num_out;                // if >0: frames to output after processing
+    int out_pos;                // next slot to output
+    float dct[PHASH_BITS][TYPE_PHASH]; // DCT-II basis, low frequencies only
+    FILE *file;
     struct print_entry entries[PRINT_ENTRY_NUM];
     int num_entries;
-    bool fallback_warning;
 };
 
-// (Other code internal to this filter also calls this to reset the frame list.)
-static void f_reset(struct mp_filter *f)
+static void clear_entries(struct priv *p)
 {
-    struct priv *p = f->priv;
-
     for (int n = 0; n < p->num_entries; n++)
         talloc_free(p->entries[n].print);
     p->num_entries = 0;
 }
 
-static void f_process(struct mp_filter *f)
+static void f_reset(struct mp_filter *f)
 {
     struct priv *p = f->priv;
 
-    if (!mp_pin_can_transfer_data(f->ppins[1], f->ppins[0]))
-        return;
+    clear_entries(p);
 
-    struct mp_frame frame = mp_pin_out_read(f->ppins[0]);
+    for (int n = 0; n < MAX_BATCH; n++) {
+        mp_frame_unref(&p->slots[n].frame);
+        TA_FREEP(&p->slots[n].print);
+    }
+    p->num_queued = p->num_out = p->out_pos = 0;
+}
 
-    if (mp_frame_is_signaling(frame)) {
-        mp_pin_in_write(f->ppins[1], frame);
-        return;
+static int cmp_float(const void *a, const void *b)
+{
+    float fa = *(const float *)a, fb = *(const float *)b;
+    return fa < fb ? -1 : fa > fb;
+}
+
+// Compute a DCT based perceptual hash of the TYPE_PHASH sized image. Each bit
+// is set if the corresponding low frequency coefficient is above the median.
+// The plain loops over contiguous float arrays are meant to be vectorized by
+// the compiler.
+static uint64_t compute_phash(struct priv *p, struct mp_image *img)
+{
+    float rows[TYPE_PHASH][PHASH_BITS];
+
+    for (int y = 0; y < TYPE_PHASH; y++) {
+        float line[TYPE_PHASH];
+        uint8_t *src = img->planes[0] + y * img->stride[0];
+        for (int x = 0; x < TYPE_PHASH; x++)
+            line[x] = src[x];
+        for (int u = 0; u < PHASH_BITS; u++) {
+            float sum = 0;
+            for (int x = 0; x < TYPE_PHASH; x++)
+                sum += p->dct[u][x] * line[x];
+            rows[y][u] = sum;
+        }
     }
 
-    if (frame.type != MP_FRAME_VIDEO)
-        goto error;
+    float coeffs[PHASH_BITS * PHASH_BITS];
+    for (int v = 0; v < PHASH_BITS; v++) {
+        for (int u = 0; u < PHASH_BITS; u++) {
+            float sum = 0;
+            for (int y = 0; y < TYPE_PHASH; y++)
+                sum += p->dct[v][y] * rows[y][u];
+            coeffs[v * PHASH_BITS + u] = sum;
+        }
+    }
 
-    struct mp_image *mpi = frame.data;
+    // The DC coefficient (average brightness) doesn't affect the median.
+    float sorted[PHASH_BITS * PHASH_BITS - 1];
+    memcpy(sorted, coeffs + 1, sizeof(sorted));
+    qsort(sorted, MP_ARRAY_SIZE(sorted), sizeof(sorted[0]), cmp_float);
+    float median = sorted[MP_ARRAY_SIZE(sorted) / 2];
+
+    uint64_t hash = 0;
+    for (int n = 0; n < PHASH_BITS * PHASH_BITS; n++)
+        hash |= (uint64_t)(coeffs[n] > median) << (63 - n);
+    return hash;
+}
+
+// Scale the queued frame and compute its fingerprint. Can run on any thread.
+static void process_slot(void *ptr, int index)
+{
+    struct priv *p = ptr;
+    struct slot *s = &p->slots[index];
+    struct mp_image *mpi = s->frame.data;
 
     // Try to achieve minimum conversion, even if it makes the fingerprints less
     // "portable" across source video.
-    p->scaled->params.repr = mpi->params.repr;
-    p->scaled->params.color = mpi->params.color;
+    s->scaled->params.repr = mpi->params.repr;
+    s->scaled->params.color = mpi->params.color;
     // Make output always full range; no reason to lose precision.
-    p->scaled->params.repr.levels = PL_COLOR_LEVELS_FULL;
+    s->scaled->params.repr.levels = PL_COLOR_LEVELS_FULL;
 
-    if (!mp_zimg_convert(p->zimg, p->scaled, mpi)) {
-        if (!p->fallback_warning) {
-            MP_WARN(f, "Falling back to libswscale.\n");
-            p->fallback_warning = true;
+    if (!mp_zimg_convert(s->zimg, s->scaled, mpi)) {
+        if (!s->fallback_warning) {
+            MP_WARN(p, "Falling back to libswscale.\n");
+            s->fallback_warning = true;
         }
-        if (mp_sws_scale(p->sws, p->scaled, mpi) < 0)
-            goto error;
+        if (mp_sws_scale(s->sws, s->scaled, mpi) < 0)
+            return;
     }
 
-    if (p->num_entries >= PRINT_ENTRY_NUM) {
-        talloc_free(p->entries[0].print);
-        MP_TARRAY_REMOVE_AT(p->entries, p->num_entries, 0);
+    if (p->opts->type == TYPE_PHASH) {
+        s->print = talloc_asprintf(NULL, "%016"PRIx64, compute_phash(p, s->scaled));
+        return;
     }
 
-    int size = p->scaled->w;
+    int size = s->scaled->w;
 
-    struct print_entry *e = &p->entries[p->num_entries++];
-    e->pts = mpi->pts;
-    e->print = talloc_array(p, char, size * size * 2 + 1);
+    s->print = talloc_array(NULL, char, size * size * 2 + 1);
 
     for (int y = 0; y < size; y++) {
         for (int x = 0; x < size; x++) {
-            char *offs = &e->print[(y * size + x) * 2];
-            uint8_t v = p->scaled->planes[0][y * p->scaled->stride[0] + x];
+            char *offs = &s->print[(y * size + x) * 2];
+            uint8_t v = s->scaled->planes[0][y * s->scaled->stride[0] + x];
             snprintf(offs, 3, "%02x", v);
         }
     }
+}
+
+static void add_entry(struct mp_filter *f, double pts, char *print)
+{
+    struct priv *p = f->priv;
+
+    if (p->num_entries >= PRINT_ENTRY_NUM) {
+        talloc_free(p->entries[0].print);
+        MP_TARRAY_REMOVE_AT(p->entries, p->num_entries, 0);
+    }
+
+    struct print_entry *e = &p->entries[p->num_entries++];
+    e->pts = pts;
+    e->print = talloc_steal(p, print);
 
     if (p->opts->print)
         MP_INFO(f, "%f: %s\n", e->pts, e->print);
 
-    mp_pin_in_write(f->ppins[1], frame);
+    if (p->file)
+        fprintf(p->file, "%f %s\n", e->pts, e->print);
+}
+
+// Process all queued frames, and prepare them for output.
+static bool flush_batch(struct mp_filter *f)
+{
+    struct priv *p = f->priv;
+
+    mp_parallel_for(p->num_queued, process_slot, p);
+
+    bool ok = true;
+    for (int n = 0; n < p->num_queued; n++) {
+        struct slot *s = &p->slots[n];
+        if (!s->print) {
+            ok = false;
+            continue;
+        }
+        struct mp_image *mpi = s->frame.data;
+        add_entry(f, mpi->pts, s->print);
+        s->print = NULL;
+    }
+
+    if (p->file)
+        fflush(p->file);
+
+    p->num_out = p->num_queued;
+    p->out_pos = 0;
+    p->num_queued = 0;
+    return ok;
+}
+
+static void f_process(struct mp_filter *f)
+{
+    struct priv *p = f->priv;
+
+    if (p->out_pos < p->num_out) {
+        if (!mp_pin_in_needs_data(f->ppins[1]))
+            return;
+        struct slot *s = &p->slots[p->out_pos++];
+        mp_pin_in_write(f->ppins[1], s->frame);
+        s->frame = MP_NO_FRAME;
+        if (p->out_pos == p->num_out)
+            p->num_out = p->out_pos = 0;
+        mp_filter_internal_mark_progress(f);
+        return;
+    }
+
+    if (!mp_pin_can_transfer_data(f->ppins[1], f->ppins[0]))
+        return;
+
+    struct mp_frame frame = mp_pin_out_read(f->ppins[0]);
+
+    if (mp_frame_is_signaling(frame)) {
+        if (p->num_queued) {
+            // Output the incomplete batch first.
+            mp_pin_out_unread(f->ppins[0], frame);
+            if (!flush_batch(f))
+                goto error;
+            mp_filter_internal_mark_progress(f);
+            return;
+        }
+        mp_pin_in_write(f->ppins[1], frame);
+        return;
+    }
+
+    if (frame.type != MP_FRAME_VIDEO) {
+        mp_pin_in_write(f->ppins[1], frame);
+        goto error;
+    }
+
+    p->slots[p->num_queued++].frame = frame;
+    if (p->num_queued == p->opts->batch && !flush_batch(f))
+        goto error;
+
+    mp_filter_internal_mark_progress(f);
     return;
 
 error:
     MP_ERR(f, "unsupported video format\n");
-    mp_pin_in_write(f->ppins[1], frame);
     mp_filter_internal_mark_failed(f);
 }
 
@@ -168,7 +336,7 @@ static bool f_command(struct mp_filter *f, struct mp_filter_command *cmd)
         mp_tags_set_str(t, "type", m_opt_choice_str(type_names, p->opts->type));
 
         if (p->opts->clear)
-            f_reset(f);
+            clear_entries(p);
 
         *(struct mp_tags **)cmd->res = t;
         return true;
@@ -178,11 +346,22 @@ static bool f_command(struct mp_filter *f, struct mp_filter_command *cmd)
     }
 }
 
+static void f_destroy(struct mp_filter *f)
+{
+    struct priv *p = f->priv;
+
+    f_reset(f);
+
+    if (p->file)
+        fclose(p->file);
+}
+
 static const struct mp_filter_info filter = {
     .name = "fingerprint",
     .process = f_process,
     .command = f_command,
     .reset = f_reset,
+    .destroy = f_destroy,
     .priv_size = sizeof(struct priv),
 };
 
@@ -199,22 +378,46 @@ static struct mp_filter *f_create(struct mp_filter *parent, void *options)
 
     struct priv *p = f->priv;
     p->opts = talloc_steal(p, options);
+    p->log = f->log;
     int size = p->opts->type;
-    p->scaled = mp_image_alloc(IMGFMT_Y8, size, size);
-    MP_HANDLE_OOM(p->scaled);
-    talloc_steal(p, p->scaled);
-    p->sws = mp_sws_alloc(p);
-    MP_HANDLE_OOM(p->sws);
-    p->zimg = mp_zimg_alloc();
-    talloc_steal(p, p->zimg);
-    p->zimg->opts = (struct zimg_opts){
-        .scaler = ZIMG_RESIZE_BILINEAR,
-        .scaler_params = {NAN, NAN},
-        .scaler_chroma_params = {NAN, NAN},
-        .scaler_chroma = ZIMG_RESIZE_BILINEAR,
-        .dither = ZIMG_DITHER_NONE,
-        .fast = true,
-    };
+    for (int n = 0; n < p->opts->batch; n++) {
+        struct slot *s = &p->slots[n];
+        s->scaled = mp_image_alloc(IMGFMT_Y8, size, size);
+        MP_HANDLE_OOM(s->scaled);
+        talloc_steal(p, s->scaled);
+        s->sws = mp_sws_alloc(p);
+        MP_HANDLE_OOM(s->sws);
+        s->zimg = mp_zimg_alloc();
+        talloc_steal(p, s->zimg);
+        s->zimg->opts = (struct zimg_opts){
+            .scaler = ZIMG_RESIZE_BILINEAR,
+            .scaler_params = {NAN, NAN},
+            .scaler_chroma_params = {NAN, NAN},
+            .scaler_chroma = ZIMG_RESIZE_BILINEAR,
+            .dither = ZIMG_DITHER_NONE,
+            .fast = true,
+            // A tiny output image is never sliced anyway.
+            .threads = 1,
+        };
+    }
+
+    for (int u = 0; u < PHASH_BITS; u++) {
+        for (int x = 0; x < TYPE_PHASH; x++)
+            p->dct[u][x] = cos(M_PI * u * (2 * x + 1) / (2.0 * TYPE_PHASH));
+    }
+
+    if (p->opts->file && p->opts->file[0]) {
+        char *path = mp_get_user_path(NULL, f->global, p->opts->file);
+        p->file = fopen(path, "a");
+        if (!p->file) {
+            MP_ERR(f, "Could not open '%s' for writing.\n", path);
+            talloc_free(path);
+            talloc_free(f);
+            return NULL;
+        }
+        talloc_free(path);
+    }
+
     return f;
 }
 
@@ -18,6 +18,10 @@
 #include <limits.h>
 #include <assert.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <libavutil/mem.h>
 #include <libavutil/common.h>
 #include <libavutil/display.h>
@@ -36,6 +40,7 @@
 #include "common/common.h"
 #include "fmt-conversion.h"
 #include "hwdec.h"
+#include "misc/executor.h"
 #include "mp_image.h"
 #include "osdep/threads.h"
 #include "sws_utils.h"
@@ -481,17 +486,106 @@ void memcpy_pic(void *dst, const void *src, int bytesPerLine, int height,
     }
 }
 
+// Images with at least this many bytes of pixel data are copied in parallel.
+#define COPY_PARALLEL_MIN_BYTES (4 << 20)
+// Images with at least this many bytes are copied with non-temporal stores.
+// They don't fit into the cache anyway, and the destination usually isn't
+// read again soon (e.g. it's uploaded or encoded later).
+#define COPY_NT_MIN_BYTES (16 << 20)
+// Minimum number of bytes per parallel slice.
+#define COPY_SLICE_MIN_BYTES (1 << 20)
+
+// memcpy() that bypasses the cache for the destination, if possible.
+static void memcpy_nt(void *dst, const void *src, size_t size)
+{
+#if defined(__SSE2__)
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+
+    size_t head = MPMIN(size, (16 - ((uintptr_t)d & 15)) & 15);
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, d += 64, s += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *)s + 0);
+        __m128i b = _mm_loadu_si128((const __m128i *)s + 1);
+        __m128i c = _mm_loadu_si128((const __m128i *)s + 2);
+        __m128i e = _mm_loadu_si128((const __m128i *)s + 3);
+        _mm_stream_si128((__m128i *)d + 0, a);
+        _mm_stream_si128((__m128i *)d + 1, b);
+        _mm_stream_si128((__m128i *)d + 2, c);
+        _mm_stream_si128((__m128i *)d + 3, e);
+    }
+
+    memcpy(d, s, size);
+#else
+    memcpy(dst, src, size);
+#endif
+}
+
+struct copy_slices {
+    struct mp_image *dst, *src;
+    int num_slices;
+    bool nt;
+};
+
+// Copy the index-th horizontal stripe of every plane.
+static void copy_slice(void *ptr, int index)
+{
+    struct copy_slices *c = ptr;
+    struct mp_image *dst = c->dst, *src = c->src;
+
+    for (int n = 0; n < dst->num_planes; n++) {
+        int line_bytes = (mp_image_plane_w(dst, n) * dst->fmt.bpp[n] + 7) / 8;
+        int plane_h = mp_image_plane_h(dst, n);
+        int y0 = (int64_t)plane_h * index / c->num_slices;
+        int y1 = (int64_t)plane_h * (index + 1) / c->num_slices;
+        uint8_t *d = dst->planes[n] + (ptrdiff_t)y0 * dst->stride[n];
+        uint8_t *s = src->planes[n] + (ptrdiff_t)y0 * src->stride[n];
+        if (c->nt) {
+            for (int y = y0; y < y1; y++) {
+                memcpy_nt(d, s, line_bytes);
+                d += dst->stride[n];
+                s += src->stride[n];
+            }
+        } else {
+            memcpy_pic(d, s, line_bytes, y1 - y0, dst->stride[n], src->stride[n]);
+        }
+    }
+
+#if defined(__SSE2__)
+    if (c->nt)
+        _mm_sfence();
+#endif
+}
+
 void mp_image_copy(struct mp_image *dst, struct mp_image *src)
 {
     mp_assert(dst->imgfmt == src->imgfmt);
     mp_assert(dst->w == src->w && dst->h == src->h);
     mp_assert(mp_image_is_writeable(dst));
+
+    size_t bytes = 0;
     for (int n = 0; n < dst->num_planes; n++) {
         int line_bytes = (mp_image_plane_w(dst, n) * dst->fmt.bpp[n] + 7) / 8;
-        int plane_h = mp_image_plane_h(dst, n);
-        memcpy_pic(dst->planes[n], src->planes[n], line_bytes, plane_h,
-                   dst->stride[n], src->stride[n]);
+        bytes += (size_t)line_bytes * mp_image_plane_h(dst, n);
     }
+
+    struct copy_slices c = {
+        .dst = dst,
+        .src = src,
+        .num_slices = 1,
+        .nt = bytes >= COPY_NT_MIN_BYTES,
+    };
+    if (bytes >= COPY_PARALLEL_MIN_BYTES) {
+        c.num_slices = MPMIN(mp_executor_get_num_threads(),
+                             bytes / COPY_SLICE_MIN_BYTES);
+    }
+
+    mp_parallel_for(c.num_slices, copy_slice, &c);
+
     if (dst->fmt.flags & MP_IMGFLAG_PAL)
         memcpy(dst->planes[1], src->planes[1], AVPALETTE_SIZE);
 }
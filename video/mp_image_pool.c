@@ -18,6 +18,7 @@
 #include "config.h"
 
 #include <stddef.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <assert.h>
 
@@ -36,36 +37,46 @@
 #include "fmt-conversion.h"
 #include "mp_image_pool.h"
 #include "mp_image.h"
-#include "osdep/threads.h"
-
-static mp_static_mutex pool_mutex = MP_STATIC_MUTEX_INITIALIZER;
-#define pool_lock() mp_mutex_lock(&pool_mutex)
-#define pool_unlock() mp_mutex_unlock(&pool_mutex)
 
 // Thread-safety: the pool itself is not thread-safe, but pool-allocated images
 // can be referenced and unreferenced from other threads. (As long as the image
 // destructors are thread-safe.)
 
-struct mp_image_pool {
+// Free images of the same format and size.
+struct pool_bucket {
+    int fmt, w, h;
     struct mp_image **images;
     int num_images;
+};
 
-    int fmt, w, h;
+struct mp_image_pool {
+    struct pool_bucket *buckets;
+    int num_buckets;
 
     mp_image_allocator allocator;
     void *allocator_ctx;
 
     bool use_lru;
     unsigned int lru_counter;
+
+    size_t max_bytes;
+    struct mp_image_pool_stats stats;
 };
 
+// Bits in image_flags.state. If both are cleared, the image must be freed.
+// Whoever clears the last bit frees the image.
+#define IMG_REFERENCED (1 << 0)     // outside mp_image reference exists
+#define IMG_POOL_ALIVE (1 << 1)     // the mp_image_pool references this
+
 // Used to gracefully handle the case when the pool is freed while image
 // references allocated from the image pool are still held by someone.
 struct image_flags {
-    // If both of these are false, the image must be freed.
-    bool referenced;            // outside mp_image reference exists
-    bool pool_alive;            // the mp_image_pool references this
+    // Only the pool owner sets bits; other threads can only clear
+    // IMG_REFERENCED (when unreferencing the image).
+    atomic_int state;
     unsigned int order;         // for LRU allocation (basically a timestamp)
+    size_t size;                // allocation size accounted in resident_bytes
+    bool reused;                // was referenced before (for stats.hits)
 };
 
 static void image_pool_destructor(void *ptr)
@@ -83,21 +94,36 @@ struct mp_image_pool *mp_image_pool_new(void *tparent)
     return pool;
 }
 
+static bool image_is_referenced(struct mp_image *img)
+{
+    struct image_flags *it = img->priv;
+    int state = atomic_load(&it->state);
+    mp_assert(state & IMG_POOL_ALIVE);
+    return state & IMG_REFERENCED;
+}
+
+// Drop the pool's reference to the image (and free it if it's unused).
+static void release_image(struct mp_image_pool *pool, struct mp_image *img)
+{
+    struct image_flags *it = img->priv;
+    pool->stats.resident_bytes -= it->size;
+    pool->stats.num_images -= 1;
+    int state = atomic_fetch_and(&it->state, ~IMG_POOL_ALIVE);
+    mp_assert(state & IMG_POOL_ALIVE);
+    if (!(state & IMG_REFERENCED))
+        talloc_free(img);
+}
+
 void mp_image_pool_clear(struct mp_image_pool *pool)
 {
-    for (int n = 0; n < pool->num_images; n++) {
-        struct mp_image *img = pool->images[n];
-        struct image_flags *it = img->priv;
-        bool referenced;
-        pool_lock();
-        mp_assert(it->pool_alive);
-        it->pool_alive = false;
-        referenced = it->referenced;
-        pool_unlock();
-        if (!referenced)
-            talloc_free(img);
+    for (int b = 0; b < pool->num_buckets; b++) {
+        struct pool_bucket *bucket = &pool->buckets[b];
+        for (int n = 0; n < bucket->num_images; n++)
+            release_image(pool, bucket->images[n]);
+        talloc_free(bucket->images);
     }
-    pool->num_images = 0;
+    pool->num_buckets = 0;
+    mp_assert(!pool->stats.resident_bytes && !pool->stats.num_images);
 }
 
 // This is the only function that is allowed to run in a different thread.
@@ -106,41 +132,104 @@ static void unref_image(void *opaque, uint8_t *data)
 {
     struct mp_image *img = opaque;
     struct image_flags *it = img->priv;
-    bool alive;
-    pool_lock();
-    mp_assert(it->referenced);
-    it->referenced = false;
-    alive = it->pool_alive;
-    pool_unlock();
-    if (!alive)
+    int state = atomic_fetch_and(&it->state, ~IMG_REFERENCED);
+    mp_assert(state & IMG_REFERENCED);
+    if (!(state & IMG_POOL_ALIVE))
         talloc_free(img);
 }
 
-// Return a new image of given format/size. Unlike mp_image_pool_get(), this
-// returns NULL if there is no free image of this format/size.
-struct mp_image *mp_image_pool_get_no_alloc(struct mp_image_pool *pool, int fmt,
-                                            int w, int h)
+static struct pool_bucket *find_bucket(struct mp_image_pool *pool, int fmt,
+                                       int w, int h)
+{
+    for (int n = 0; n < pool->num_buckets; n++) {
+        struct pool_bucket *bucket = &pool->buckets[n];
+        if (bucket->fmt == fmt && bucket->w == w && bucket->h == h)
+            return bucket;
+    }
+    return NULL;
+}
+
+// Free the least recently used unreferenced images (other than keep) until
+// the memory limit is honored.
+static void enforce_max_bytes(struct mp_image_pool *pool, struct mp_image *keep)
+{
+    while (pool->max_bytes && pool->stats.resident_bytes > pool->max_bytes) {
+        struct pool_bucket *lru_bucket = NULL;
+        int lru_index = -1;
+        unsigned int lru_order = 0;
+        for (int b = 0; b < pool->num_buckets; b++) {
+            struct pool_bucket *bucket = &pool->buckets[b];
+            for (int n = 0; n < bucket->num_images; n++) {
+                struct mp_image *img = bucket->images[n];
+                struct image_flags *it = img->priv;
+                if (img != keep && !image_is_referenced(img) &&
+                    (!lru_bucket || it->order < lru_order))
+                {
+                    lru_bucket = bucket;
+                    lru_index = n;
+                    lru_order = it->order;
+                }
+            }
+        }
+        if (!lru_bucket)
+            break; // everything is in use
+        release_image(pool, lru_bucket->images[lru_index]);
+        MP_TARRAY_REMOVE_AT(lru_bucket->images, lru_bucket->num_images, lru_index);
+        pool->stats.evictions += 1;
+    }
+}
+
+// Free unreferenced images to honor the memory limit. If there is no limit,
+// free all unreferenced images that don't have the given format/size (i.e.
+// assume the pool user switched to a new size and won't need them anymore).
+static void trim_pool(struct mp_image_pool *pool, int fmt, int w, int h)
 {
+    enforce_max_bytes(pool, NULL);
+
+    for (int b = pool->num_buckets - 1; b >= 0; b--) {
+        struct pool_bucket *bucket = &pool->buckets[b];
+        bool other = bucket->fmt != fmt || bucket->w != w || bucket->h != h;
+        if (!pool->max_bytes && other) {
+            for (int n = bucket->num_images - 1; n >= 0; n--) {
+                struct mp_image *img = bucket->images[n];
+                if (!image_is_referenced(img)) {
+                    release_image(pool, img);
+                    MP_TARRAY_REMOVE_AT(bucket->images, bucket->num_images, n);
+                    pool->stats.evictions += 1;
+                }
+            }
+        }
+        if (!bucket->num_images && other) {
+            talloc_free(bucket->images);
+            MP_TARRAY_REMOVE_AT(pool->buckets, pool->num_buckets, b);
+        }
+    }
+}
+
+// If reused is not NULL, it's set to whether the returned image was referenced
+// before, i.e. whether it wasn't just added to the pool.
+static struct mp_image *take_image(struct mp_image_pool *pool, int fmt,
+                                   int w, int h, bool *reused)
+{
+    struct pool_bucket *bucket = find_bucket(pool, fmt, w, h);
+    if (!bucket)
+        return NULL;
+
     struct mp_image *new = NULL;
-    pool_lock();
-    for (int n = 0; n < pool->num_images; n++) {
-        struct mp_image *img = pool->images[n];
-        struct image_flags *img_it = img->priv;
-        mp_assert(img_it->pool_alive);
-        if (!img_it->referenced) {
-            if (img->imgfmt == fmt && img->w == w && img->h == h) {
-                if (pool->use_lru) {
-                    struct image_flags *new_it = new ? new->priv : NULL;
-                    if (!new_it || new_it->order > img_it->order)
-                        new = img;
-                } else {
+    for (int n = 0; n < bucket->num_images; n++) {
+        struct mp_image *img = bucket->images[n];
+        if (!image_is_referenced(img)) {
+            if (pool->use_lru) {
+                struct image_flags *new_it = new ? new->priv : NULL;
+                struct image_flags *img_it = img->priv;
+                if (!new_it || new_it->order > img_it->order)
                     new = img;
-                    break;
-                }
+            } else {
+                new = img;
+                break;
             }
         }
     }
-    pool_unlock();
     if (!new)
         return NULL;
 
@@ -164,18 +253,61 @@ struct mp_image *mp_image_pool_get_no_alloc(struct mp_image_pool *pool, int fmt,
     }
 
     struct image_flags *it = new->priv;
-    mp_assert(!it->referenced && it->pool_alive);
-    it->referenced = true;
+    int state = atomic_fetch_or(&it->state, IMG_REFERENCED);
+    mp_assert(state == IMG_POOL_ALIVE);
     it->order = ++pool->lru_counter;
+    if (reused)
+        *reused = it->reused;
+    it->reused = true;
     return ref;
 }
 
+// Return a new image of given format/size. Unlike mp_image_pool_get(), this
+// returns NULL if there is no free image of this format/size. Taking an image
+// that was just added with mp_image_pool_add() (after a miss) is not counted
+// as a hit.
+struct mp_image *mp_image_pool_get_no_alloc(struct mp_image_pool *pool, int fmt,
+                                            int w, int h)
+{
+    bool reused = false;
+    struct mp_image *new = take_image(pool, fmt, w, h, &reused);
+    if (!new) {
+        pool->stats.misses += 1;
+    } else if (reused) {
+        pool->stats.hits += 1;
+    }
+    return new;
+}
+
 void mp_image_pool_add(struct mp_image_pool *pool, struct mp_image *new)
 {
+    size_t size = 0;
+    for (int n = 0; n < MP_MAX_PLANES; n++)
+        size += new->bufs[n] ? new->bufs[n]->size : 0;
+
     struct image_flags *it = talloc_ptrtype(new, it);
-    *it = (struct image_flags) { .pool_alive = true };
+    *it = (struct image_flags) {
+        .order = ++pool->lru_counter,
+        .size = size,
+    };
+    atomic_init(&it->state, IMG_POOL_ALIVE);
     new->priv = it;
-    MP_TARRAY_APPEND(pool, pool->images, pool->num_images, new);
+
+    struct pool_bucket *bucket = find_bucket(pool, new->imgfmt, new->w, new->h);
+    if (!bucket) {
+        MP_TARRAY_APPEND(pool, pool->buckets, pool->num_buckets,
+                         (struct pool_bucket){
+                            .fmt = new->imgfmt, .w = new->w, .h = new->h,
+                         });
+        bucket = &pool->buckets[pool->num_buckets - 1];
+    }
+    MP_TARRAY_APPEND(pool, bucket->images, bucket->num_images, new);
+
+    pool->stats.resident_bytes += it->size;
+    pool->stats.num_images += 1;
+    pool->stats.allocs += 1;
+
+    enforce_max_bytes(pool, new);
 }
 
 // Return a new image of given format/size. The only difference to
@@ -191,11 +323,7 @@ struct mp_image *mp_image_pool_get(struct mp_image_pool *pool, int fmt,
         return mp_image_alloc(fmt, w, h);
     struct mp_image *new = mp_image_pool_get_no_alloc(pool, fmt, w, h);
     if (!new) {
-        if (fmt != pool->fmt || w != pool->w || h != pool->h)
-            mp_image_pool_clear(pool);
-        pool->fmt = fmt;
-        pool->w = w;
-        pool->h = h;
+        trim_pool(pool, fmt, w, h);
         if (pool->allocator) {
             new = pool->allocator(pool->allocator_ctx, fmt, w, h);
         } else {
@@ -204,11 +332,28 @@ struct mp_image *mp_image_pool_get(struct mp_image_pool *pool, int fmt,
         if (!new)
             return NULL;
         mp_image_pool_add(pool, new);
-        new = mp_image_pool_get_no_alloc(pool, fmt, w, h);
+        new = take_image(pool, fmt, w, h, NULL);
     }
     return new;
 }
 
+// Limit the memory used by all images in the pool (see resident_bytes). If
+// allocating or adding a new image makes the pool exceed this, the least
+// recently used unreferenced images (of any format/size) are freed. Images in
+// use are never freed, so the pool can stay above the limit while they are
+// referenced. With the default of 0, there is no limit, but unreferenced
+// images not matching the format/size of a new allocation are freed.
+void mp_image_pool_set_max_bytes(struct mp_image_pool *pool, size_t max_bytes)
+{
+    pool->max_bytes = max_bytes;
+}
+
+void mp_image_pool_get_stats(struct mp_image_pool *pool,
+                             struct mp_image_pool_stats *stats)
+{
+    *stats = pool->stats;
+}
+
 // Like mp_image_new_copy(), but allocate the image out of the pool.
 // If pool==NULL, a plain copy is made (for convenience).
 // Returns NULL on OOM.
@@ -2,9 +2,20 @@
 #define MPV_MP_IMAGE_POOL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 struct mp_image_pool;
 
+struct mp_image_pool_stats {
+    uint64_t hits;          // mp_image_pool_get*() calls that reused an image
+    uint64_t misses;        // ...that found no free image
+    uint64_t allocs;        // images added to the pool
+    uint64_t evictions;     // unreferenced images freed by trimming
+    size_t resident_bytes;  // memory of all images owned by the pool
+    int num_images;         // number of images owned by the pool
+};
+
 struct mp_image_pool *mp_image_pool_new(void *tparent);
 struct mp_image *mp_image_pool_get(struct mp_image_pool *pool, int fmt,
                                    int w, int h);
@@ -13,6 +24,9 @@ void mp_image_pool_add(struct mp_image_pool *pool, struct mp_image *new);
 void mp_image_pool_clear(struct mp_image_pool *pool);
 
 void mp_image_pool_set_lru(struct mp_image_pool *pool);
+void mp_image_pool_set_max_bytes(struct mp_image_pool *pool, size_t max_bytes);
+void mp_image_pool_get_stats(struct mp_image_pool *pool,
+                             struct mp_image_pool_stats *stats);
 
 struct mp_image *mp_image_pool_get_no_alloc(struct mp_image_pool *pool, int fmt,
                                             int w, int h);
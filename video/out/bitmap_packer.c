@@ -30,12 +30,27 @@
 
 #define IS_POWER_OF_2(x) (((x) > 0) && !(((x) - 1) & (x)))
 
+// A rectangle placed in incremental mode (position and size include padding).
+struct packer_entry {
+    uint64_t key;
+    int x, y, w, h;
+    int frame;          // last packer_pack() call that used it
+};
+
+// Skyline segment: the area above y in the columns x..x+w-1 is free. The
+// segments are sorted by x and cover the full width without gaps.
+struct packer_segment {
+    int x, y, w;
+};
+
 void packer_reset(struct bitmap_packer *packer)
 {
     struct bitmap_packer old = *packer;
     *packer = (struct bitmap_packer) {
         .w_max = old.w_max,
         .h_max = old.h_max,
+        .padding = old.padding,
+        .incremental = old.incremental,
     };
     talloc_free_children(packer);
 }
@@ -46,6 +61,12 @@ void packer_get_bb(struct bitmap_packer *packer, struct pos out_bb[2])
     out_bb[1] = (struct pos) {packer->used_width, packer->used_height};
 }
 
+double packer_get_efficiency(struct bitmap_packer *packer)
+{
+    int64_t bb_area = (int64_t)packer->used_width * packer->used_height;
+    return bb_area > 0 ? MPMIN(packer->used_area / (double)bb_area, 1.0) : 0;
+}
+
 #define HEIGHT_SORT_BITS 4
 static int size_index(int s)
 {
@@ -124,6 +145,198 @@ static int pack_rectangles(struct pos *in, struct pos *out, int num_rects,
     return num_rects ? -1 : y;
 }
 
+static void skyline_clear(struct bitmap_packer *packer)
+{
+    MP_TARRAY_GROW(packer, packer->skyline, 0);
+    packer->skyline[0] = (struct packer_segment){0, 0, packer->w};
+    packer->num_skyline = 1;
+}
+
+// Lowest y at which a rectangle of size w*h fits with its left edge at
+// segment i, or -1 if it doesn't fit there.
+static int skyline_fit(struct bitmap_packer *packer, int i, int w, int h)
+{
+    struct packer_segment *segs = packer->skyline;
+    if (segs[i].x + w > packer->w)
+        return -1;
+    int y = 0;
+    for (int left = w; left > 0; left -= segs[i++].w) {
+        y = MPMAX(y, segs[i].y);
+        if (y + h > packer->h)
+            return -1;
+    }
+    return y;
+}
+
+// Place a w*h rectangle at the lowest possible position (bottom-left rule,
+// ties broken by the least wasted width). Return false if it doesn't fit.
+static bool skyline_place(struct bitmap_packer *packer, int w, int h,
+                          struct pos *out)
+{
+    int best = -1, best_y = 0, best_top = INT_MAX, best_w = INT_MAX;
+    for (int i = 0; i < packer->num_skyline; i++) {
+        int y = skyline_fit(packer, i, w, h);
+        if (y < 0)
+            continue;
+        int seg_w = packer->skyline[i].w;
+        if (y + h < best_top || (y + h == best_top && seg_w < best_w)) {
+            best = i;
+            best_y = y;
+            best_top = y + h;
+            best_w = seg_w;
+        }
+    }
+    if (best < 0)
+        return false;
+
+    int x = packer->skyline[best].x;
+    *out = (struct pos){x, best_y};
+
+    struct packer_segment seg = {x, best_y + h, w};
+    MP_TARRAY_INSERT_AT(packer, packer->skyline, packer->num_skyline, best, seg);
+
+    // Cut away what the new segment covers from the following segments.
+    int i = best + 1;
+    while (i < packer->num_skyline) {
+        struct packer_segment *s = &packer->skyline[i];
+        int overlap = x + w - s->x;
+        if (overlap <= 0)
+            break;
+        if (overlap < s->w) {
+            s->x += overlap;
+            s->w -= overlap;
+            break;
+        }
+        MP_TARRAY_REMOVE_AT(packer->skyline, packer->num_skyline, i);
+    }
+
+    // Merge neighbours of equal height.
+    for (i = MPMAX(best - 1, 0); i < packer->num_skyline - 1;) {
+        struct packer_segment *s = &packer->skyline[i];
+        if (s->y == s[1].y) {
+            s->w += s[1].w;
+            MP_TARRAY_REMOVE_AT(packer->skyline, packer->num_skyline, i + 1);
+        } else if (i > best) {
+            break;
+        } else {
+            i++;
+        }
+    }
+
+    return true;
+}
+
+static int cmp_order(const void *a, const void *b)
+{
+    uint64_t oa = *(const uint64_t *)a, ob = *(const uint64_t *)b;
+    return oa < ob ? 1 : oa > ob ? -1 : 0; // descending
+}
+
+// Binary search in the entries, which are sorted by key. Return the index of
+// the first entry with a key >= the given key.
+static int find_entry_index(struct bitmap_packer *packer, uint64_t key)
+{
+    int lo = 0, hi = packer->num_entries;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (packer->entries[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Place all rectangles that don't have a reused position yet, tallest first.
+// If full is set, all previous placements are dropped before.
+static bool pack_skyline(struct bitmap_packer *packer, bool full)
+{
+    struct pos *in = packer->in;
+    int num_order = 0;
+
+    if (full) {
+        skyline_clear(packer);
+        packer->num_entries = 0;
+    }
+
+    for (int i = 0; i < packer->count; i++) {
+        packer->reused[i] = false;
+        if (!in[i].x || !in[i].y) {
+            packer->result[i] = (struct pos){0, 0};
+            continue;
+        }
+        uint64_t key = packer->keys[i];
+        int idx = find_entry_index(packer, key);
+        struct packer_entry *e = NULL;
+        if (key && idx < packer->num_entries && packer->entries[idx].key == key)
+            e = &packer->entries[idx];
+        if (e && e->w == in[i].x && e->h == in[i].y) {
+            packer->result[i] = (struct pos){e->x, e->y};
+            packer->reused[i] = true;
+            if (e->frame != packer->frame)
+                packer->used_area += (int64_t)e->w * e->h;
+            e->frame = packer->frame;
+            continue;
+        }
+        // Sort key: height, width (both < 2^16), index.
+        packer->order[num_order++] =
+            ((uint64_t)in[i].y << 48) | ((uint64_t)in[i].x << 32) | i;
+    }
+
+    qsort(packer->order, num_order, sizeof(packer->order[0]), cmp_order);
+
+    for (int n = 0; n < num_order; n++) {
+        int i = (uint32_t)packer->order[n];
+        uint64_t key = packer->keys[i];
+        int idx = find_entry_index(packer, key);
+        struct packer_entry *e = NULL;
+        if (key && idx < packer->num_entries && packer->entries[idx].key == key)
+            e = &packer->entries[idx];
+
+        // Same contents already placed by this call: share the position.
+        if (e && e->frame == packer->frame && e->w == in[i].x &&
+            e->h == in[i].y)
+        {
+            packer->result[i] = (struct pos){e->x, e->y};
+            continue;
+        }
+
+        if (!skyline_place(packer, in[i].x, in[i].y, &packer->result[i]))
+            return false;
+        packer->used_area += (int64_t)in[i].x * in[i].y;
+        if (!key)
+            continue;
+
+        struct packer_entry entry = {
+            .key = key,
+            .x = packer->result[i].x,
+            .y = packer->result[i].y,
+            .w = in[i].x,
+            .h = in[i].y,
+            .frame = packer->frame,
+        };
+        // Same contents with a different size replace the old entry; the old
+        // space is wasted until the next full repack.
+        if (e) {
+            *e = entry;
+        } else {
+            MP_TARRAY_INSERT_AT(packer, packer->entries, packer->num_entries,
+                                idx, entry);
+        }
+    }
+
+    packer->used_width = packer->used_height = 0;
+    for (int n = 0; n < packer->num_skyline; n++) {
+        struct packer_segment *s = &packer->skyline[n];
+        if (s->y > 0)
+            packer->used_width = MPMAX(packer->used_width, s->x + s->w);
+        packer->used_height = MPMAX(packer->used_height, s->y);
+    }
+
+    return true;
+}
+
 int packer_pack(struct bitmap_packer *packer)
 {
     if (packer->count == 0)
@@ -149,12 +362,53 @@ int packer_pack(struct bitmap_packer *packer)
         packer->w = 1 << (mp_log2(xmax - 1) + 1);
     if (ymax > packer->h)
         packer->h = 1 << (mp_log2(ymax - 1) + 1);
+    packer->used_area = 0;
+    if (packer->incremental) {
+        packer->frame++;
+        bool full = packer->w != w_orig || packer->h != h_orig ||
+                    !packer->num_skyline;
+        if (!full) {
+            // Without keys, nothing can be reused, so don't bother keeping the
+            // placements.
+            full = true;
+            for (int i = 0; i < packer->count; i++)
+                full &= !packer->keys[i];
+        }
+        if (full || !pack_skyline(packer, false)) {
+            packer->used_area = 0;
+            while (!pack_skyline(packer, true)) {
+                packer->used_area = 0;
+                int w_max = packer->w_max > 0 ? packer->w_max : INT_MAX;
+                int h_max = packer->h_max > 0 ? packer->h_max : INT_MAX;
+                if (packer->w <= packer->h && packer->w != w_max)
+                    packer->w = MPMIN(packer->w * 2, w_max);
+                else if (packer->h != h_max)
+                    packer->h = MPMIN(packer->h * 2, h_max);
+                else {
+                    packer->w = w_orig;
+                    packer->h = h_orig;
+                    packer->num_skyline = 0;
+                    packer->num_entries = 0;
+                    return -1;
+                }
+            }
+        }
+        if (packer->padding) {
+            for (int i = 0; i < packer->count; i++) {
+                packer->result[i].x += packer->padding;
+                packer->result[i].y += packer->padding;
+            }
+        }
+        return packer->w != w_orig || packer->h != h_orig;
+    }
     while (1) {
         int used_width = 0;
         int y = pack_rectangles(in, packer->result, packer->count,
                                 packer->w, packer->h,
                                 packer->scratch, &used_width);
         if (y >= 0) {
+            for (int i = 0; i < packer->count; i++)
+                packer->used_area += (int64_t)in[i].x * in[i].y;
             packer->used_width = MPMIN(used_width, packer->w);
             packer->used_height = MPMIN(y, packer->h);
             mp_assert(packer->w == 0 || IS_POWER_OF_2(packer->w));
@@ -194,4 +448,14 @@ void packer_set_size(struct bitmap_packer *packer, int size)
                                           packer->asize);
     packer->scratch = talloc_array_ptrtype(packer, packer->scratch,
                                            packer->asize + 16);
+    if (packer->incremental) {
+        packer->keys = talloc_realloc(packer, packer->keys, uint64_t,
+                                      packer->asize);
+        talloc_free(packer->reused);
+        talloc_free(packer->order);
+        packer->reused = talloc_array_ptrtype(packer, packer->reused,
+                                              packer->asize);
+        packer->order = talloc_array_ptrtype(packer, packer->order,
+                                             packer->asize);
+    }
 }
@@ -1,6 +1,9 @@
 #ifndef MPLAYER_PACK_RECTANGLES_H
 #define MPLAYER_PACK_RECTANGLES_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 struct pos {
     int x;
     int y;
@@ -18,16 +21,43 @@ struct bitmap_packer {
     int used_width;
     int used_height;
 
+    // Sum of the areas of the rectangles (including padding) placed by the
+    // last packer_pack() call. See packer_get_efficiency().
+    int64_t used_area;
+
+    // If set, keep the placements of rectangles across packer_pack() calls
+    // (see there). Must be set before the first packer_set_size() call.
+    bool incremental;
+    // Incremental mode only, allocated by packer_set_size(). keys[n] is
+    // written by the user and identifies the contents of in[n]; 0 means the
+    // contents are unknown and the rectangle is always placed anew.
+    uint64_t *keys;
+    // Incremental mode only, set by packer_pack(): reused[n] is true if
+    // result[n] is the position of an earlier rectangle with the same key and
+    // size, whose contents are assumed to be still in place.
+    bool *reused;
+
     // internal
     int *scratch;
     int asize;
+    uint64_t *order;
+    struct packer_entry *entries;
+    int num_entries;
+    struct packer_segment *skyline;
+    int num_skyline;
+    int frame;
 };
 
 struct sub_bitmaps;
 
-// Clear all internal state. Leave the following fields: w_max, h_max
+// Clear all internal state. Leave the following fields: w_max, h_max, padding,
+// incremental
 void packer_reset(struct bitmap_packer *packer);
 
+// Return the fraction of the bounding box (see packer_get_bb()) covered by the
+// rectangles of the last packer_pack() call (0-1).
+double packer_get_efficiency(struct bitmap_packer *packer);
+
 // Get the bounding box used for bitmap data (including padding).
 // The bounding box doesn't exceed (0,0)-(packer->w,packer->h).
 void packer_get_bb(struct bitmap_packer *packer, struct pos out_bb[2]);
@@ -45,6 +75,12 @@ void packer_set_size(struct bitmap_packer *packer, int size);
  * There is a strong guarantee that w and h will be powers of 2 (or set to 0).
  * Return value is -1 if packing failed because w and h were set to max
  * values but that wasn't enough, 1 if w or h was increased, and 0 otherwise.
+ *
+ * In incremental mode, rectangles are placed with a skyline packer, and
+ * rectangles whose key was packed before (with the same size) keep their
+ * previous position (see packer->reused). New rectangles go into free space.
+ * Only if they don't fit, everything is repacked from scratch, which also
+ * drops rectangles that are not in use anymore.
  */
 int packer_pack(struct bitmap_packer *packer);
 
@@ -52,6 +52,7 @@ struct mpgl_osd_part {
     int change_id;
     struct ra_tex *texture;
     int w, h;
+    uint64_t packed_version; // sub_bitmaps.packed_version in texture, or 0
     int num_subparts;
     int prev_num_subparts;
     struct sub_bitmap *subparts;
@@ -137,6 +138,7 @@ static bool upload_osd(struct mpgl_osd *ctx, struct mpgl_osd_part *osd,
     {
         ra_tex_free(ra, &osd->texture);
 
+        osd->packed_version = 0;
         osd->format = imgs->format;
         osd->w = MPMAX(32, req_w);
         osd->h = MPMAX(32, req_h);
@@ -165,17 +167,37 @@ static bool upload_osd(struct mpgl_osd *ctx, struct mpgl_osd_part *osd,
             goto done;
     }
 
+    // If the texture already has an older version of the contents, upload
+    // only what changed.
+    struct mp_rect rc = {0, 0, imgs->packed_w, imgs->packed_h};
+    bool partial = false;
+    if (imgs->packed_version && imgs->packed_version == osd->packed_version) {
+        ok = true;
+        goto done;
+    }
+    if (imgs->packed_base_version &&
+        imgs->packed_base_version == osd->packed_version)
+    {
+        rc = imgs->packed_dirty;
+        partial = true;
+        if (mp_rect_w(rc) <= 0 || mp_rect_h(rc) <= 0) {
+            ok = true;
+            goto done;
+        }
+    }
+
     struct ra_tex_upload_params params = {
         .tex = osd->texture,
-        .src = imgs->packed->planes[0],
-        .invalidate = true,
-        .rc = &(struct mp_rect){0, 0, imgs->packed_w, imgs->packed_h},
+        .src = mp_image_pixel_ptr(imgs->packed, 0, rc.x0, rc.y0),
+        .invalidate = !partial,
+        .rc = &rc,
         .stride = imgs->packed->stride[0],
     };
 
     ok = ra->fns->tex_upload(ra, &params);
 
 done:
+    osd->packed_version = ok ? imgs->packed_version : 0;
     return ok;
 }
 
@@ -1,5 +1,7 @@
 #include "mpv/render_gl.h"
 #include "libmpv.h"
+#include "misc/thread_pool.h"
+#include "misc/thread_tools.h"
 #include "sub/osd.h"
 #include "video/sws_utils.h"
 
@@ -13,8 +15,38 @@ struct priv {
     struct mp_rect src_rc, dst_rc;
     struct mp_osd_res osd_rc;
     bool anything_changed;
+
+    // Render-ahead state (MPV_RENDER_PARAM_SW_RENDER_AHEAD). While ahead_busy
+    // is set, the worker owns sws, ahead_src and ahead_img.
+    bool render_ahead;
+    struct mp_thread_pool *ahead_tp;
+    struct mp_waiter ahead_waiter;
+    bool ahead_busy;
+    struct mp_image *ahead_src;     // frame being/was scaled ahead
+    struct mp_image *ahead_img;     // target-sized result
+    uint64_t ahead_id;              // vo_frame ID of ahead_src, 0 if none
+    bool ahead_ok;                  // ahead_img contains a valid result
 };
 
+// Wait until the render-ahead job (if any) is done. Afterwards, the caller
+// owns all render-ahead fields again.
+static void ahead_wait(struct priv *p)
+{
+    if (p->ahead_busy) {
+        mp_waiter_wait(&p->ahead_waiter);
+        p->ahead_busy = false;
+    }
+}
+
+// Wait for and discard any pre-rendered frame.
+static void ahead_drop(struct priv *p)
+{
+    ahead_wait(p);
+    TA_FREEP(&p->ahead_src);
+    p->ahead_id = 0;
+    p->ahead_ok = false;
+}
+
 static int init(struct render_backend *ctx, mpv_render_param *params)
 {
     ctx->priv = talloc_zero(NULL, struct priv);
@@ -30,6 +62,14 @@ static int init(struct render_backend *ctx, mpv_render_param *params)
     p->sws = mp_sws_alloc(p);
     mp_sws_enable_cmdline_opts(p->sws, ctx->global);
 
+    p->render_ahead = GET_MPV_RENDER_PARAM(params,
+                        MPV_RENDER_PARAM_SW_RENDER_AHEAD, int, 0);
+    if (p->render_ahead) {
+        p->ahead_tp = mp_thread_pool_create(p, 1, 1, 1);
+        if (!p->ahead_tp)
+            return MPV_ERROR_GENERIC;
+    }
+
     p->anything_changed = true;
 
     return 0;
@@ -54,13 +94,16 @@ static void reconfig(struct render_backend *ctx, struct mp_image_params *params)
 {
     struct priv *p = ctx->priv;
 
+    ahead_drop(p);
     p->src_params = *params;
     p->anything_changed = true;
 }
 
 static void reset(struct render_backend *ctx)
 {
-    // stateless
+    struct priv *p = ctx->priv;
+
+    ahead_drop(p);
 }
 
 static void update_external(struct render_backend *ctx, struct vo *vo)
@@ -68,6 +111,10 @@ static void update_external(struct render_backend *ctx, struct vo *vo)
     struct priv *p = ctx->priv;
 
     p->osd = vo ? vo->osd : NULL;
+
+    // Render-ahead needs to see the next frame in vo_frame.frames[1].
+    if (vo && p->render_ahead)
+        vo_set_queue_params(vo, 0, 2);
 }
 
 static void resize(struct render_backend *ctx, struct mp_rect *src,
@@ -75,6 +122,7 @@ static void resize(struct render_backend *ctx, struct mp_rect *src,
 {
     struct priv *p = ctx->priv;
 
+    ahead_drop(p);
     p->src_rc = *src;
     p->dst_rc = *dst;
     p->osd_rc = *osd;
@@ -93,11 +141,86 @@ static int get_target_size(struct render_backend *ctx, mpv_render_param *params,
     return 0;
 }
 
+// Scale img into the full target surface dst, including black borders.
+static int scale_frame(struct priv *p, struct mp_image *dst_surface,
+                       struct mp_image *img)
+{
+    mp_image_clear_rc_inv(dst_surface, p->dst_rc);
+
+    struct mp_image src = *img;
+    struct mp_rect src_rc = p->src_rc;
+    src_rc.x0 = MP_ALIGN_DOWN(src_rc.x0, src.fmt.align_x);
+    src_rc.y0 = MP_ALIGN_DOWN(src_rc.y0, src.fmt.align_y);
+    mp_image_crop_rc(&src, src_rc);
+
+    struct mp_image dst = *dst_surface;
+    mp_image_crop_rc(&dst, p->dst_rc);
+
+    return mp_sws_scale(p->sws, &dst, &src);
+}
+
+static void ahead_thread(void *ptr)
+{
+    struct priv *p = ptr;
+
+    p->ahead_ok = scale_frame(p, p->ahead_img, p->ahead_src) >= 0;
+    mp_waiter_wakeup(&p->ahead_waiter, 0);
+}
+
+// Start scaling the frame following the current one on the worker thread, so
+// that it overlaps with the API user presenting the current frame.
+static void ahead_start(struct priv *p, struct vo_frame *frame)
+{
+    mp_assert(!p->ahead_busy);
+
+    if (frame->num_frames < 2 || !frame->frames[1] || !frame->frame_id)
+        return;
+
+    uint64_t id = frame->frame_id + 1;
+    if (id == p->ahead_id)
+        return; // already done (e.g. redraw of the current frame)
+
+    TA_FREEP(&p->ahead_src);
+    p->ahead_id = 0;
+    p->ahead_ok = false;
+
+    struct mp_image *next = frame->frames[1];
+    if (next->imgfmt != p->src_params.imgfmt ||
+        next->w != p->src_params.w || next->h != p->src_params.h)
+        return;
+
+    if (!p->ahead_img || p->ahead_img->imgfmt != p->dst_params.imgfmt ||
+        p->ahead_img->w != p->dst_params.w || p->ahead_img->h != p->dst_params.h)
+    {
+        talloc_free(p->ahead_img);
+        p->ahead_img = mp_image_alloc(p->dst_params.imgfmt,
+                                      p->dst_params.w, p->dst_params.h);
+        if (!p->ahead_img)
+            return;
+        talloc_steal(p, p->ahead_img);
+    }
+    mp_image_set_params(p->ahead_img, &p->dst_params);
+
+    p->ahead_src = mp_image_new_ref(next);
+    if (!p->ahead_src)
+        return;
+    p->ahead_id = id;
+
+    p->ahead_waiter = (struct mp_waiter)MP_WAITER_INITIALIZER;
+    p->ahead_busy = true;
+    bool r = mp_thread_pool_run(p->ahead_tp, ahead_thread, p);
+    // The pool has a permanent thread, and there is never more than 1 job.
+    mp_assert(r);
+}
+
 static int render(struct render_backend *ctx, mpv_render_param *params,
                   struct vo_frame *frame)
 {
     struct priv *p = ctx->priv;
 
+    // The render-ahead job uses p->sws, and may have to be reused below.
+    ahead_wait(p);
+
     int *sz = get_mpv_render_param(params, MPV_RENDER_PARAM_SW_SIZE, NULL);
     char *fmt = get_mpv_render_param(params, MPV_RENDER_PARAM_SW_FORMAT, NULL);
     size_t *stride = get_mpv_render_param(params, MPV_RENDER_PARAM_SW_STRIDE, NULL);
@@ -114,6 +237,8 @@ static int render(struct render_backend *ctx, mpv_render_param *params,
         p->anything_changed = true;
 
     if (p->anything_changed) {
+        ahead_drop(p);
+
         p->dst_params = (struct mp_image_params){
             .imgfmt = mp_imgfmt_from_name(bstr0(fmt)),
             .w = sz[0],
@@ -164,18 +289,10 @@ static int render(struct render_backend *ctx, mpv_render_param *params,
     if (img) {
         mp_assert(p->src_params.imgfmt);
 
-        mp_image_clear_rc_inv(&wrap_img, p->dst_rc);
-
-        struct mp_image src = *img;
-        struct mp_rect src_rc = p->src_rc;
-        src_rc.x0 = MP_ALIGN_DOWN(src_rc.x0, src.fmt.align_x);
-        src_rc.y0 = MP_ALIGN_DOWN(src_rc.y0, src.fmt.align_y);
-        mp_image_crop_rc(&src, src_rc);
-
-        struct mp_image dst = wrap_img;
-        mp_image_crop_rc(&dst, p->dst_rc);
-
-        if (mp_sws_scale(p->sws, &dst, &src) < 0) {
+        if (p->ahead_ok && p->ahead_id && p->ahead_id == frame->frame_id) {
+            // Already scaled by the render-ahead job; just copy it.
+            mp_image_copy(&wrap_img, p->ahead_img);
+        } else if (scale_frame(p, &wrap_img, img) < 0) {
             mp_image_clear(&wrap_img, 0, 0, wrap_img.w, wrap_img.h);
             return MPV_ERROR_GENERIC;
         }
@@ -186,12 +303,18 @@ static int render(struct render_backend *ctx, mpv_render_param *params,
     if (p->osd)
         osd_draw_on_image(p->osd, p->osd_rc, img ? img->pts : 0, 0, &wrap_img);
 
+    if (img && p->render_ahead)
+        ahead_start(p, frame);
+
     return 0;
 }
 
 static void destroy(struct render_backend *ctx)
 {
-    // nop
+    struct priv *p = ctx->priv;
+
+    if (p)
+        ahead_drop(p);
 }
 
 const struct render_backend_fns render_backend_sw = {